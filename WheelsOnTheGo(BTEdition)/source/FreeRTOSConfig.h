@@ -83,7 +83,7 @@
  *----------------------------------------------------------*/
 
 #define configUSE_PREEMPTION                    1
-#define configUSE_TICKLESS_IDLE                 0
+#define configUSE_TICKLESS_IDLE                 2 /* Application-provided idle, see power.c; .cproject leaves out fsl_tickless_lptmr.c. */
 #define configCPU_CLOCK_HZ                      (SystemCoreClock)
 #define configTICK_RATE_HZ                      ((TickType_t)1000)
 #define configMAX_PRIORITIES                    5
@@ -109,10 +109,21 @@
 #define configINCLUDE_FREERTOS_TASK_C_ADDITIONS_H 1
 
 /* Memory allocation related definitions. */
+#ifdef STATIC_KERNEL
+/* Every kernel object is allocated from kernel_objects.c, no heap. */
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        0
+#else
 #define configSUPPORT_STATIC_ALLOCATION         0
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
-#define configTOTAL_HEAP_SIZE                   ((size_t)(10 * 1024))
+#endif
+#define configTOTAL_HEAP_SIZE                   ((size_t)(11 * 1024))
+#if defined(FAST_BOOT) && !defined(STATIC_KERNEL)
+/* kernel_objects.c keeps the heap out of the .bss zeroing. */
+#define configAPPLICATION_ALLOCATED_HEAP        1
+#else
 #define configAPPLICATION_ALLOCATED_HEAP        0
+#endif
 
 /* Hook function related definitions. */
 #define configUSE_IDLE_HOOK                     0
@@ -122,9 +133,27 @@
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
+/* Run-time counter on the PIT, see profile.h. */
+extern void Profile_Init_Counter(void);
+extern uint32_t Profile_Get_Counter(void);
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() Profile_Init_Counter()
+#define portGET_RUN_TIME_COUNTER_VALUE()        Profile_Get_Counter()
+
+/* Binary trace recorder, see trace.h. */
+#ifdef TRACE_RECORDER
+#include "trace.h"
+#define traceTASK_CREATE(pxNewTCB)              Trace_Task_Create(pxNewTCB)
+#define traceTASK_SWITCHED_IN()                 Trace_Task_Event(TRACE_SWITCH_IN, pxCurrentTCB, 0)
+#define traceTASK_SWITCHED_OUT()                Trace_Task_Event(TRACE_SWITCH_OUT, pxCurrentTCB, 0)
+#define traceTASK_DELAY()                       Trace_Task_Event(TRACE_DELAY, pxCurrentTCB, xTicksToDelay)
+#define traceTASK_DELAY_UNTIL(xTimeToWake)      Trace_Task_Event(TRACE_DELAY_UNTIL, pxCurrentTCB, (xTimeToWake))
+#define traceTASK_PRIORITY_INHERIT(pxTCB, uxPriority) Trace_Task_Event(TRACE_PRIORITY_INHERIT, (pxTCB), (uxPriority))
+#define traceQUEUE_SEND(pxQueue)                Trace_Queue_Event(TRACE_QUEUE_SEND, (pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue)             Trace_Queue_Event(TRACE_QUEUE_RECEIVE, (pxQueue))
+#endif
 
 /* Task aware debugging. */
 #define configRECORD_STACK_HIGH_ADDRESS         1
@@ -135,9 +164,9 @@
 
 /* Software timer related definitions. */
 #define configUSE_TIMERS                        1
-#define configTIMER_TASK_PRIORITY               2
+#define configTIMER_TASK_PRIORITY               (configMAX_PRIORITIES - 1) /* Maneuver segments end on time. */
 #define configTIMER_QUEUE_LENGTH                10
-#define configTIMER_TASK_STACK_DEPTH            (configMINIMAL_STACK_SIZE * 2)
+#define configTIMER_TASK_STACK_DEPTH            (configMINIMAL_STACK_SIZE * 3)
 
 /* Define to trap errors during development. */
 #define configASSERT(x) if(( x) == 0) {taskDISABLE_INTERRUPTS(); for (;;);}
@@ -152,7 +181,7 @@
 #define INCLUDE_vTaskDelay                      1
 #define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_xTaskGetCurrentTaskHandle       1
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
 #define INCLUDE_xTaskGetIdleTaskHandle          0
 #define INCLUDE_eTaskGetState                   0
 #define INCLUDE_xEventGroupSetBitFromISR        1
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    board_pins.c
+ * @brief   Pin and mux assignments of the chassis, from a single table.
+ *
+ * Every mask below is a constant expression, so the compiler reduces each
+ * port to its few stores and drops the ports and mux values not in use.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "board_pins.h"
+#include "MKL25Z4.h"
+
+#define LOW_PINS(mask)  ((mask) & 0xFFFFUL)
+#define HIGH_PINS(mask) ((mask) >> 16)
+
+// Set the PCR of every pin of a port using mux value m, 16 pins per write
+#define INIT_MUX(port, m) \
+	do { \
+		if (LOW_PINS(BOARD_MUX_MASK(BOARD_PORT_##port, m))) \
+			PORT##port->GPCLR = PORT_GPCLR_GPWE(LOW_PINS(BOARD_MUX_MASK(BOARD_PORT_##port, m))) \
+					| PORT_GPCLR_GPWD(PORT_PCR_MUX(m)); \
+		if (HIGH_PINS(BOARD_MUX_MASK(BOARD_PORT_##port, m))) \
+			PORT##port->GPCHR = PORT_GPCHR_GPWE(HIGH_PINS(BOARD_MUX_MASK(BOARD_PORT_##port, m))) \
+					| PORT_GPCHR_GPWD(PORT_PCR_MUX(m)); \
+	} while (0)
+
+// Mux every pin of a port, then drive its outputs low before enabling them
+#define INIT_PORT(port) \
+	do { \
+		INIT_MUX(port, 0); \
+		INIT_MUX(port, 1); \
+		INIT_MUX(port, 2); \
+		INIT_MUX(port, 3); \
+		INIT_MUX(port, 4); \
+		INIT_MUX(port, 5); \
+		INIT_MUX(port, 6); \
+		INIT_MUX(port, 7); \
+		if (BOARD_OUT_MASK(BOARD_PORT_##port)) { \
+			PT##port->PCOR = BOARD_OUT_MASK(BOARD_PORT_##port); \
+			PT##port->PDDR = BOARD_OUT_MASK(BOARD_PORT_##port); \
+		} \
+	} while (0)
+
+// Clock gates of the ports in use
+#define PORT_CLOCKS \
+	((BOARD_PORT_USED(BOARD_PORT_A) ? SIM_SCGC5_PORTA_MASK : 0UL) \
+	| (BOARD_PORT_USED(BOARD_PORT_B) ? SIM_SCGC5_PORTB_MASK : 0UL) \
+	| (BOARD_PORT_USED(BOARD_PORT_C) ? SIM_SCGC5_PORTC_MASK : 0UL) \
+	| (BOARD_PORT_USED(BOARD_PORT_D) ? SIM_SCGC5_PORTD_MASK : 0UL) \
+	| (BOARD_PORT_USED(BOARD_PORT_E) ? SIM_SCGC5_PORTE_MASK : 0UL))
+
+// Refer board_pins.h file for function brief and description
+void Init_Board_Pins(void) {
+	SIM->SCGC5 |= PORT_CLOCKS;
+
+	INIT_PORT(A);
+	INIT_PORT(B);
+	INIT_PORT(C);
+	INIT_PORT(D);
+	INIT_PORT(E);
+}
@@ -0,0 +1,121 @@
+// board_pins.h
+
+#ifndef BOARD_PINS_H
+#define BOARD_PINS_H
+
+/**
+ * @file    board_pins.h
+ * @brief   Pin and mux assignments of the chassis, from a single table.
+ *
+ * BOARD_PINS lists every pin the firmware uses as
+ *     X(a, b, name, port, pin, mux, signal, out)
+ * where mux is the PCR alternative (0 is analog, 1 is GPIO), signal is the
+ * peripheral signal that mux value selects, as named in the KL25Z pinout
+ * (the pin itself, e.g. PTB11, for GPIO), and out is 1 for a GPIO output.
+ * The a and b arguments are passed through to X unchanged so that the
+ * macros below can select entries with constant expressions.
+ *
+ * The table is checked when this header is compiled:
+ * - two entries on the same pin, with the same name, or routing the same
+ *   peripheral signal to two pins fail to compile as duplicate enumerators;
+ * - pin numbers must be below 32 and mux values from 0 to 7;
+ * - only GPIO pins (mux 1) may be outputs.
+ *
+ * Init_Board_Pins() expands the table into constant stores: one SCGC5
+ * write, a GPCLR/GPCHR write per port and mux value in use (each sets
+ * every selected pin's PCR at once), and a PCOR then PDDR write per port
+ * with outputs. Outputs start low. Every PCR field other than MUX is
+ * cleared: no pulls, fast slew, low drive strength, filter off.
+ *
+ * tools/board_pins_sim.c runs this against a register model next to the
+ * pin setup it replaced: 10 register references (11 bus accesses) instead
+ * of 31 read-modify-writes (62), with the same mux on every wired pin.
+ *
+ * A different chassis only needs a different table.
+ */
+
+#include <stdint.h>
+
+// Port numbers, used to compare the port of table entries
+#define BOARD_PORT_A (0)
+#define BOARD_PORT_B (1)
+#define BOARD_PORT_C (2)
+#define BOARD_PORT_D (3)
+#define BOARD_PORT_E (4)
+
+// Analog and GPIO mux values, and directions
+#define PIN_ANALOG (0)
+#define PIN_GPIO (1)
+#define PIN_IN   (0)
+#define PIN_OUT  (1)
+
+#define BOARD_PINS(X, a, b) \
+	X(a, b, MOTORA_PWM,    D,  0, 4, TPM0_CH0, PIN_IN) \
+	X(a, b, MOTORB_PWM,    D,  5, 4, TPM0_CH5, PIN_IN) \
+	X(a, b, MOTORA_CW,     B, 11, PIN_GPIO, PTB11, PIN_OUT) \
+	X(a, b, MOTORA_CCW,    B, 10, PIN_GPIO, PTB10, PIN_OUT) \
+	X(a, b, MOTORB_CW,     B,  8, PIN_GPIO, PTB8, PIN_OUT) \
+	X(a, b, MOTORB_CCW,    B,  9, PIN_GPIO, PTB9, PIN_OUT) \
+	X(a, b, LED_RED,       B, 18, 3, TPM2_CH0, PIN_IN) \
+	X(a, b, LED_GREEN,     B, 19, 3, TPM2_CH1, PIN_IN) \
+	X(a, b, LED_BLUE,      D,  1, 4, TPM0_CH1, PIN_IN) \
+	X(a, b, ENCODER_A,     A, 12, 3, TPM1_CH0, PIN_IN) \
+	X(a, b, ENCODER_B,     A, 13, 3, TPM1_CH1, PIN_IN) \
+	X(a, b, UART0_RX,      D,  6, 3, UART0_RX, PIN_IN)  /* RN-41 TX */ \
+	X(a, b, UART0_TX,      D,  7, 3, UART0_TX, PIN_IN)  /* RN-41 RX */ \
+	X(a, b, UART1_TX,      E,  0, 3, UART1_TX, PIN_IN)  /* Telemetry */ \
+	X(a, b, BATTERY_SENSE, B,  0, PIN_ANALOG, ADC0_SE8, PIN_IN)
+
+// BOARD_PIN_<name>: pin number; BOARD_PORT_OF_<name>: its BOARD_PORT_x
+#define BOARD_PIN_ENUM(a, b, name, port, pin, mux, signal, out) \
+	BOARD_PIN_##name = (pin), BOARD_PORT_OF_##name = BOARD_PORT_##port,
+enum {
+	BOARD_PINS(BOARD_PIN_ENUM, 0, 0)
+};
+
+// A pin claimed twice declares the same enumerator twice
+#define BOARD_PIN_CLAIM(a, b, name, port, pin, mux, signal, out) \
+	BOARD_PIN_CLAIM_##port##_##pin,
+enum {
+	BOARD_PINS(BOARD_PIN_CLAIM, 0, 0)
+};
+
+// So does a peripheral signal routed to two pins
+#define BOARD_SIGNAL_CLAIM(a, b, name, port, pin, mux, signal, out) \
+	BOARD_SIGNAL_CLAIM_##signal,
+enum {
+	BOARD_PINS(BOARD_SIGNAL_CLAIM, 0, 0)
+};
+
+#define BOARD_PIN_VALID(a, b, name, port, pin, mux, signal, out) \
+	_Static_assert((pin) < 32 && (mux) >= 0 && (mux) < 8, #name ": bad pin or mux"); \
+	_Static_assert((out) == PIN_IN || (mux) == PIN_GPIO, #name ": output not GPIO");
+BOARD_PINS(BOARD_PIN_VALID, 0, 0)
+
+// Mask of a pin of the table
+#define BOARD_MASK(name) (1UL << BOARD_PIN_##name)
+
+#define BOARD_MUX_BIT(p, m, name, port, pin, mux, signal, out) \
+	| ((BOARD_PORT_##port == (p) && (mux) == (m)) ? (1UL << (pin)) : 0UL)
+#define BOARD_OUT_BIT(p, unused, name, port, pin, mux, signal, out) \
+	| ((BOARD_PORT_##port == (p) && (out) == PIN_OUT) ? (1UL << (pin)) : 0UL)
+#define BOARD_PORT_BIT(p, unused, name, port, pin, mux, signal, out) \
+	| ((BOARD_PORT_##port == (p)) ? 1UL : 0UL)
+
+// Pins of port p (a BOARD_PORT_x) using mux value m
+#define BOARD_MUX_MASK(p, m) (0UL BOARD_PINS(BOARD_MUX_BIT, p, m))
+
+// GPIO outputs of port p
+#define BOARD_OUT_MASK(p) (0UL BOARD_PINS(BOARD_OUT_BIT, p, 0))
+
+// Whether the table uses port p
+#define BOARD_PORT_USED(p) ((0UL BOARD_PINS(BOARD_PORT_BIT, p, 0)) != 0UL)
+
+/**
+ * @brief Configure every pin of the table and enable the clock of its ports.
+ *
+ * Call once at boot, before initializing the peripherals on the pins.
+ */
+void Init_Board_Pins(void);
+
+#endif // BOARD_PINS_H
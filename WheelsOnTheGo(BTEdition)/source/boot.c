@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    boot.c
+ * @brief   Boot-phase profiler and fast-boot path.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "boot.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stdio.h"
+#include "stdbool.h"
+#include "sysclock.h"
+#include "clock_config.h"
+#include "board_pins.h"
+#include "uart.h"
+#include "led.h"
+#include "latency.h"
+#include "kernel_objects.h"
+
+// Startup light
+#define STARTUP_LIGHT (0x888888)
+
+#ifdef BOOT_PROFILE
+
+// SysTick counts down through 24 bits while free-running
+#define SYSTICK_MAX   (0xFFFFFFUL)
+
+// Core clock while CLOCK_BootToPeeMode() waits: the crystal over the safe
+// OUTDIV1 of 2, the slowest clock of BOOT_PHASE_SYSCLOCK
+#define PLL_WAIT_CORE_HZ (BOARD_XTAL0_CLK_HZ / 2)
+
+#define LINE_LENGTH   (48)
+
+typedef struct {
+	uint32_t last;                          // SysTick value at the last mark
+	uint32_t cycles[BOOT_PHASE_COUNT];
+	uint32_t marked;                        // One bit per phase
+	uint32_t reported;
+} boot_record_t;
+
+// Written before the C runtime runs, so it must not be in .bss
+static boot_record_t record BOOT_NOINIT;
+
+#define PHASE_NAME(id, name) [id] = name,
+static const char *const phase_names[BOOT_PHASE_COUNT] = { BOOT_PHASES(PHASE_NAME) };
+
+// Core clock each phase ran at
+static const uint32_t phase_hz[BOOT_PHASE_COUNT] = {
+	[BOOT_PHASE_STARTUP] = DEFAULT_SYSTEM_CLOCK,
+	[BOOT_PHASE_SYSCLOCK] = PLL_WAIT_CORE_HZ,
+	[BOOT_PHASE_DRIVERS] = SYSCLOCK_FREQUENCY,
+	[BOOT_PHASE_KERNEL] = SYSCLOCK_FREQUENCY,
+	[BOOT_PHASE_SCHEDULER] = SYSCLOCK_FREQUENCY
+};
+
+#endif // BOOT_PROFILE
+
+// Refer boot.h file for function brief and description
+void Boot_Early(void) {
+#ifdef FAST_BOOT
+	// Out of reset the H-bridge inputs float
+	Init_Board_Pins();
+#endif
+
+#ifdef BOOT_PROFILE
+	record.marked = 0;
+	record.reported = 0;
+	record.last = SYSTICK_MAX;
+
+	// Free-running on the core clock, no interrupt, until the scheduler
+	// reprograms it
+	SysTick->CTRL = 0;
+	SysTick->LOAD = SYSTICK_MAX;
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+#endif
+}
+
+// Refer boot.h file for function brief and description
+void Boot_Profile_Mark(boot_phase_t phase) {
+#ifdef BOOT_PROFILE
+	uint32_t now;
+
+	if (phase >= BOOT_PHASE_COUNT || (record.marked & (1UL << phase)))
+		return;
+
+	if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+		now = SysTick->VAL;
+		record.cycles[phase] = (record.last - now) & SYSTICK_MAX;
+		record.last = now;
+	} else {
+		// SysTick restarted from zero when the scheduler started
+		record.cycles[phase] = Latency_Now();
+	}
+	record.marked |= 1UL << phase;
+#else
+	(void) phase;
+#endif
+}
+
+// Refer boot.h file for function brief and description
+void Boot_Profile_Report(void) {
+#ifdef BOOT_PROFILE
+	char line[LINE_LENGTH];
+	uint32_t total_us = 0;
+	uint32_t us;
+	uint32_t phase;
+
+	if (record.reported || record.marked != (1UL << BOOT_PHASE_COUNT) - 1)
+		return;
+	record.reported = 1;
+
+	// The whole report fits the TX FIFO, so never wait for it
+	UART0_Transmit_String("boot_phase,cycles,clock_hz,us\n\r");
+	for (phase = 0; phase < BOOT_PHASE_COUNT; phase++) {
+		us = (uint32_t) ((uint64_t) record.cycles[phase] * 1000000U
+				/ phase_hz[phase]);
+		total_us += us;
+		snprintf(line, sizeof(line), "%s,%lu,%lu,%lu\n\r", phase_names[phase],
+				record.cycles[phase], phase_hz[phase], us);
+		UART0_Transmit_String(line);
+	}
+	snprintf(line, sizeof(line), "boot_total_us,%lu\n\r", total_us);
+	UART0_Transmit_String(line);
+#endif
+}
+
+/**
+ * @brief Print the banner and show the startup light.
+ */
+static void deferred_init(void) {
+	// Send escape sequence to clear the terminal
+	UART0_Transmit_String("\033[2J");
+	// Move the cursor to the top-left corner
+	UART0_Transmit_String("\033[H");
+	UART0_Transmit_String("Initialized Wheels On The Go (BT Edition).....\n\r");
+
+	Set_RGB(STARTUP_LIGHT);
+}
+
+#ifdef FAST_BOOT
+/**
+ * @brief Task that finishes the non-essential initialization, then exits.
+ *
+ * @param pvParameter Task parameters (unused).
+ */
+static void task_boot(void *pvParameter) {
+	deferred_init();
+	vTaskDelete(NULL);
+}
+#endif
+
+// Refer boot.h file for function brief and description
+void Boot_Start_Deferred(uint32_t priority) {
+#ifdef FAST_BOOT
+	Kernel_Create_Task(KERNEL_TASK_BOOT, task_boot, priority);
+#else
+	(void) priority;
+	deferred_init();
+#endif
+}
@@ -0,0 +1,128 @@
+// boot.h
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+
+/**
+ * @file    boot.h
+ * @brief   Boot-phase profiler and fast-boot path.
+ *
+ * Boot_Early() runs from ResetISR() right after SystemInit(), before the C
+ * runtime has copied .data or zeroed .bss, so it and everything it calls
+ * may only touch registers and BOOT_NOINIT variables.
+ *
+ * Profiler (BOOT_PROFILE defined):
+ * Boot_Early() starts SysTick free-running on the core clock and each
+ * BOOT_MARK() adds the core cycles of the phase that just ended to a
+ * record in .noinit, which the startup code never zeroes. Once the
+ * scheduler has taken SysTick over, the last phase is read with
+ * Latency_Now() instead; the few microseconds from the last main() mark
+ * to the SysTick restart in vTaskStartScheduler() are not counted. The
+ * Cortex-M0+ has no DWT cycle counter, and a phase must stay under 2^24
+ * cycles (350 ms at 48 MHz). Time spent before the reset vector (power-on
+ * reset and flash initialization) is not seen.
+ *
+ * Each phase is converted to microseconds at the core clock it ran at.
+ * The clock changes during BOOT_PHASE_SYSCLOCK, which waits for the crystal
+ * and PLL at 4 MHz and below, so that phase is converted at 4 MHz and is an
+ * upper bound. The first command to arrive after boot triggers
+ * BOOT_REPORT(), which prints the record once over UART0 as CSV:
+ *   boot_phase,cycles,clock_hz,us
+ *   boot_total_us,<value>
+ * Without BOOT_PROFILE the BOOT_* macros expand to nothing.
+ *
+ * Fast boot (FAST_BOOT defined):
+ * - Boot_Early() drives the H-bridge inputs low (coast) through
+ *   Init_Board_Pins() before the C runtime and the PLL lock, instead of
+ *   after Init_Sysclock() in main(). Out of reset the pins float.
+ * - The banner, the terminal clear and the LED startup light are left to
+ *   Boot_Start_Deferred(), a low-priority task that runs once the command
+ *   path is waiting and then deletes itself. In STATIC_KERNEL builds its
+ *   720-byte stack stays reserved.
+ * - Buffers whose contents are never read before being written (task
+ *   stacks, queue storage, the heap_4 heap, UART FIFOs, the trace buffer)
+ *   are marked FAST_BOOT_NOINIT and skipped by the .bss zeroing loop, which
+ *   runs at the 21 MHz reset clock. FreeRTOS fills new stacks with 0xa5
+ *   anyway. In the Release configuration (STATIC_KERNEL) this skips 9560
+ *   bytes: 9080 of stacks, 96 of queue storage and 384 of UART FIFOs,
+ *   about 0.7 ms of zeroing. Dynamic builds skip the 10240-byte heap.
+ *
+ * Not measured on hardware, so the 10 ms target from reset to the first
+ * command is not yet shown to be met. tools/boot_sim.c budgets each phase
+ * from the SRAM size, the data sheet start-up times and estimated cycle
+ * counts, and fails if the budget reaches 10 ms; crystal start-up, PLL lock
+ * and the .bss zeroing dominate it. A BOOT_PROFILE build on a board gives
+ * the measured figure.
+ */
+
+// Never zeroed by the startup code; the MCUXpresso managed linker script
+// places .noinit after .bss
+#define BOOT_NOINIT __attribute__((section(".noinit")))
+
+#ifdef FAST_BOOT
+#define FAST_BOOT_NOINIT BOOT_NOINIT
+#else
+#define FAST_BOOT_NOINIT
+#endif
+
+// X(id, name)
+#define BOOT_PHASES(X) \
+	X(BOOT_PHASE_STARTUP, "startup")      /* .data copy and .bss zeroing */ \
+	X(BOOT_PHASE_SYSCLOCK, "sysclock")    /* Crystal start-up, PLL lock */ \
+	X(BOOT_PHASE_DRIVERS, "drivers")      /* Peripherals and their modules */ \
+	X(BOOT_PHASE_KERNEL, "kernel")        /* Queues, failsafe, tasks */ \
+	X(BOOT_PHASE_SCHEDULER, "scheduler")  /* Until the command path waits */
+
+#define BOOT_PHASE_ID(id, name) id,
+
+typedef enum {
+	BOOT_PHASES(BOOT_PHASE_ID)
+	BOOT_PHASE_COUNT
+} boot_phase_t;
+
+#ifdef BOOT_PROFILE
+#define BOOT_MARK(phase)    Boot_Profile_Mark(phase)
+#define BOOT_REPORT()       Boot_Profile_Report()
+#else
+#define BOOT_MARK(phase)    ((void) 0)
+#define BOOT_REPORT()       ((void) 0)
+#endif
+
+/**
+ * @brief Coast the motors and start the boot profiler, as enabled.
+ *
+ * Called from ResetISR() before .data and .bss are initialized.
+ */
+void Boot_Early(void);
+
+/**
+ * @brief Record the end of a boot phase.
+ *
+ * Each phase is recorded once; later calls are ignored, so a mark may sit
+ * at the top of a task loop.
+ *
+ * @param phase Phase that just ended.
+ */
+void Boot_Profile_Mark(boot_phase_t phase);
+
+/**
+ * @brief Print the boot profile over UART0, once per boot.
+ *
+ * Does nothing until every phase has been marked. Call from a task.
+ */
+void Boot_Profile_Report(void);
+
+/**
+ * @brief Finish the deferred, non-essential initialization.
+ *
+ * With FAST_BOOT, creates a low-priority task that prints the banner and
+ * shows the startup light. Otherwise does it now. Call before starting the
+ * scheduler, after Init_UART0().
+ *
+ * @param priority Priority of the deferred task.
+ */
+void Boot_Start_Deferred(uint32_t priority);
+
+#endif // BOOT_H
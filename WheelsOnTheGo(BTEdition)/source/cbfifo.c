@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    cbfifo.c
+ * @brief   Lock-free single-producer/single-consumer circular byte FIFO.
+ *
+ * The head and tail indices are free-running 32-bit counters; their difference
+ * is the fill level and wrap-around is handled by unsigned arithmetic. A
+ * compiler barrier orders the data access against the index update so the
+ * other side never observes an index before the byte it covers. This is
+ * sufficient on the single-core Cortex-M0+ and on x86 hosts.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "cbfifo.h"
+
+// Prevent the compiler from reordering memory accesses across this point
+#define BARRIER()  __asm volatile ("" ::: "memory")
+
+// Refer cbfifo.h file for function brief and description
+bool cbfifo_init(cbfifo_t *fifo, uint8_t *storage, uint32_t size) {
+	if (size == 0 || (size & (size - 1)) != 0)
+		return false;
+
+	fifo->buf = storage;
+	fifo->mask = size - 1;
+	fifo->head = 0;
+	fifo->tail = 0;
+	return true;
+}
+
+// Refer cbfifo.h file for function brief and description
+bool cbfifo_put(cbfifo_t *fifo, uint8_t byte) {
+	uint32_t head = fifo->head;
+
+	if (head - fifo->tail > fifo->mask)
+		return false;
+
+	fifo->buf[head & fifo->mask] = byte;
+	BARRIER();
+	fifo->head = head + 1;
+	return true;
+}
+
+// Refer cbfifo.h file for function brief and description
+bool cbfifo_get(cbfifo_t *fifo, uint8_t *byte) {
+	uint32_t tail = fifo->tail;
+
+	if (fifo->head == tail)
+		return false;
+
+	*byte = fifo->buf[tail & fifo->mask];
+	BARRIER();
+	fifo->tail = tail + 1;
+	return true;
+}
+
+// Refer cbfifo.h file for function brief and description
+size_t cbfifo_enqueue(cbfifo_t *fifo, const void *buf, size_t nbyte) {
+	const uint8_t *src = buf;
+	uint32_t head = fifo->head;
+	uint32_t space = fifo->mask + 1 - (head - fifo->tail);
+	size_t count;
+
+	if (nbyte > space)
+		nbyte = space;
+
+	for (count = 0; count < nbyte; count++)
+		fifo->buf[(head + count) & fifo->mask] = src[count];
+
+	BARRIER();
+	fifo->head = head + nbyte;
+	return nbyte;
+}
+
+// Refer cbfifo.h file for function brief and description
+size_t cbfifo_dequeue(cbfifo_t *fifo, void *buf, size_t nbyte) {
+	uint8_t *dst = buf;
+	uint32_t tail = fifo->tail;
+	uint32_t used = fifo->head - tail;
+	size_t count;
+
+	if (nbyte > used)
+		nbyte = used;
+
+	for (count = 0; count < nbyte; count++)
+		dst[count] = fifo->buf[(tail + count) & fifo->mask];
+
+	BARRIER();
+	fifo->tail = tail + nbyte;
+	return nbyte;
+}
+
+// Refer cbfifo.h file for function brief and description
+size_t cbfifo_discard(cbfifo_t *fifo, size_t nbyte) {
+	uint32_t tail = fifo->tail;
+	uint32_t used = fifo->head - tail;
+
+	if (nbyte > used)
+		nbyte = used;
+
+	fifo->tail = tail + nbyte;
+	return nbyte;
+}
+
+// Refer cbfifo.h file for function brief and description
+size_t cbfifo_length(const cbfifo_t *fifo) {
+	return fifo->head - fifo->tail;
+}
+
+// Refer cbfifo.h file for function brief and description
+size_t cbfifo_capacity(const cbfifo_t *fifo) {
+	return fifo->mask + 1;
+}
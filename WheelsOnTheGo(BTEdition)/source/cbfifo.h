@@ -0,0 +1,115 @@
+// cbfifo.h
+
+#ifndef CBFIFO_H
+#define CBFIFO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @file    cbfifo.h
+ * @brief   Lock-free single-producer/single-consumer circular byte FIFO.
+ *
+ * The FIFO is safe to share between exactly one producer and one consumer
+ * (e.g. an ISR and a task) without disabling interrupts. The producer only
+ * ever writes the head index and the consumer only ever writes the tail
+ * index. Both indices run freely and are masked on access, so the storage
+ * size must be a power of two and every byte of it is usable.
+ *
+ * The module has no dependency on the MCU or on FreeRTOS and compiles
+ * unchanged on a host machine.
+ */
+
+typedef struct {
+	uint8_t *buf;            // Backing storage, owned by the caller
+	uint32_t mask;           // Storage size - 1 (size is a power of two)
+	volatile uint32_t head;  // Next write position, written by producer only
+	volatile uint32_t tail;  // Next read position, written by consumer only
+} cbfifo_t;
+
+/**
+ * @brief Initializes a FIFO over caller-provided storage.
+ *
+ * @param fifo    FIFO instance to initialize.
+ * @param storage Backing storage of at least size bytes.
+ * @param size    Storage size in bytes, must be a non-zero power of two.
+ *
+ * @return true on success, false if size is not a power of two.
+ */
+bool cbfifo_init(cbfifo_t *fifo, uint8_t *storage, uint32_t size);
+
+/**
+ * @brief Enqueues a single byte. Producer side only.
+ *
+ * @param fifo FIFO instance.
+ * @param byte Byte to enqueue.
+ *
+ * @return true if the byte was stored, false if the FIFO was full.
+ */
+bool cbfifo_put(cbfifo_t *fifo, uint8_t byte);
+
+/**
+ * @brief Dequeues a single byte. Consumer side only.
+ *
+ * @param fifo FIFO instance.
+ * @param byte Destination for the dequeued byte.
+ *
+ * @return true if a byte was dequeued, false if the FIFO was empty.
+ */
+bool cbfifo_get(cbfifo_t *fifo, uint8_t *byte);
+
+/**
+ * @brief Enqueues up to nbyte bytes. Producer side only.
+ *
+ * @param fifo  FIFO instance.
+ * @param buf   Bytes to enqueue.
+ * @param nbyte Number of bytes requested.
+ *
+ * @return Number of bytes actually enqueued (less than nbyte when full).
+ */
+size_t cbfifo_enqueue(cbfifo_t *fifo, const void *buf, size_t nbyte);
+
+/**
+ * @brief Dequeues up to nbyte bytes. Consumer side only.
+ *
+ * @param fifo  FIFO instance.
+ * @param buf   Destination buffer.
+ * @param nbyte Maximum number of bytes to dequeue.
+ *
+ * @return Number of bytes actually dequeued.
+ */
+size_t cbfifo_dequeue(cbfifo_t *fifo, void *buf, size_t nbyte);
+
+/**
+ * @brief Discards up to nbyte of the oldest bytes. Consumer side only.
+ *
+ * A producer may call this to make room (drop-oldest) only while the
+ * consumer is guaranteed not to run, e.g. with interrupts masked.
+ *
+ * @param fifo  FIFO instance.
+ * @param nbyte Maximum number of bytes to discard.
+ *
+ * @return Number of bytes actually discarded.
+ */
+size_t cbfifo_discard(cbfifo_t *fifo, size_t nbyte);
+
+/**
+ * @brief Returns the number of bytes currently stored in the FIFO.
+ *
+ * @param fifo FIFO instance.
+ *
+ * @return Number of bytes available to the consumer.
+ */
+size_t cbfifo_length(const cbfifo_t *fifo);
+
+/**
+ * @brief Returns the total capacity of the FIFO in bytes.
+ *
+ * @param fifo FIFO instance.
+ *
+ * @return FIFO capacity.
+ */
+size_t cbfifo_capacity(const cbfifo_t *fifo);
+
+#endif // CBFIFO_H
@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    clock_div.c
+ * @brief   Peripheral divider math for each system clock mode.
+ *
+ * Only called when a mode is entered, never from an interrupt, so the
+ * divisions here are fine on the Cortex-M0+.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "clock_div.h"
+#include "tpm.h"
+#include "profile.h"
+
+// TPM prescaler range, SC[PS]
+#define TPM_MAX_PS        (7)
+
+// UART0 oversampling and SBR ranges
+#define UART_MIN_OSR      (4)
+#define UART_MAX_OSR      (32)
+#define UART_MAX_SBR      (0x1FFF)
+
+const clock_tree_t clock_trees[SYSCLOCK_MODES] = {
+	[SYSCLOCK_RUN] = { SYSCLOCK_FREQUENCY, BUSCLOCK_FREQUENCY,
+			TPMCLOCK_FREQUENCY, IRCLK_FREQUENCY },
+	[SYSCLOCK_VLPR] = { VLPR_SYSCLOCK_FREQUENCY, VLPR_BUSCLOCK_FREQUENCY,
+			VLPR_TPMCLOCK_FREQUENCY, IRCLK_FREQUENCY }
+};
+
+/**
+ * @brief Divide and round to the nearest integer.
+ */
+static uint32_t div_round(uint32_t num, uint32_t den) {
+	return (uint32_t) (((uint64_t) num + den / 2) / den);
+}
+
+// Refer clock_div.h file for function brief and description
+bool Clock_Div_Tpm(uint32_t clock_hz, uint32_t pwm_hz, uint32_t max_period,
+		clock_div_tpm_t *div) {
+	uint32_t ps;
+	uint32_t period;
+
+	if (pwm_hz == 0)
+		return false;
+	for (ps = 0; ps <= TPM_MAX_PS; ps++) {
+		period = div_round(clock_hz >> ps, pwm_hz);
+		if (period > max_period || period > UINT16_MAX)
+			continue;
+		if (period < 2)
+			return false;
+		div->ps = (uint8_t) ps;
+		div->period = (uint16_t) period;
+		div->pwm_hz = div_round(clock_hz >> ps, period);
+		return true;
+	}
+	return false;
+}
+
+// Refer clock_div.h file for function brief and description
+bool Clock_Div_Uart(uint32_t clock_hz, uint32_t baud, clock_div_uart_t *div) {
+	uint32_t osr;
+	uint32_t sbr;
+	uint32_t actual;
+	uint32_t error;
+	uint32_t best = UINT32_MAX;
+
+	if (baud == 0)
+		return false;
+	for (osr = UART_MIN_OSR; osr <= UART_MAX_OSR; osr++) {
+		sbr = div_round(clock_hz, baud * osr);
+		if (sbr == 0 || sbr > UART_MAX_SBR)
+			continue;
+		actual = div_round(clock_hz, sbr * osr);
+		error = (actual > baud) ? actual - baud : baud - actual;
+		// Ties go to the higher oversampling ratio
+		if (error <= best) {
+			best = error;
+			div->sbr = (uint16_t) sbr;
+			div->osr = (uint8_t) osr;
+			div->baud = actual;
+		}
+	}
+	return best != UINT32_MAX;
+}
+
+// Refer clock_div.h file for function brief and description
+bool Clock_Div_Plan(sysclock_mode_t mode, uint32_t tick_hz, uint32_t baud,
+		clock_plan_t *plan) {
+	const clock_tree_t *tree;
+
+	if (mode >= SYSCLOCK_MODES || tick_hz == 0)
+		return false;
+	tree = &clock_trees[mode];
+
+	plan->systick_reload = tree->core_hz / tick_hz - 1;
+	if (plan->systick_reload == 0 || plan->systick_reload >= CLOCK_DIV_MAX_SYSTICK)
+		return false;
+	plan->pit_reload = tree->bus_hz / PROFILE_COUNTER_HZ - 1;
+	if (plan->pit_reload == 0)
+		return false;
+
+	return Clock_Div_Tpm(tree->tpm_hz, TPM_PWM_FREQUENCY, TPM_PWM_PERIOD,
+			&plan->pwm)
+			&& Clock_Div_Uart(tree->uart0_hz, baud, &plan->uart0);
+}
+
+// Refer clock_div.h file for function brief and description
+uint32_t Clock_Div_Rescale(uint32_t cnv, uint32_t old_period,
+		uint32_t new_period) {
+	uint32_t scaled;
+
+	if (cnv == 0 || old_period == new_period)
+		return cnv;
+	if (cnv >= old_period)
+		return new_period;
+
+	scaled = div_round(cnv * new_period, old_period);
+	if (scaled == 0)
+		scaled = 1;
+	else if (scaled >= new_period)
+		scaled = new_period - 1;
+	return scaled;
+}
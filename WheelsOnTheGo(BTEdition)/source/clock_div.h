@@ -0,0 +1,120 @@
+// clock_div.h
+
+#ifndef CLOCK_DIV_H
+#define CLOCK_DIV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sysclock.h"
+
+/**
+ * @file    clock_div.h
+ * @brief   Peripheral divider math for each system clock mode.
+ *
+ * Clock_Div_Plan() derives every clock-dependent peripheral setting of a
+ * mode from the mode's clock tree (see sysclock.h):
+ * - the SysTick reload for the RTOS tick;
+ * - the PIT reload for the run-time stats counter (see profile.h);
+ * - the TPM prescaler and MOD that keep the PWM at TPM_PWM_FREQUENCY, with
+ *   at most TPM_PWM_PERIOD counts per period;
+ * - the UART0 SBR and OSR closest to the requested baud rate.
+ *
+ * The module has no hardware access, so it builds and runs unchanged in
+ * tools/clock_sim.c, which checks the errors at every mode and baud rate.
+ * Compare values are kept in TPM_PWM_PERIOD counts everywhere else in the
+ * firmware and rescaled to the mode's period by Clock_Div_Rescale() when
+ * they are written (see TPM_Scale()).
+ */
+
+// Highest SysTick reload, 24 bits
+#define CLOCK_DIV_MAX_SYSTICK (0x1000000UL)
+
+typedef struct {
+	uint32_t core_hz;   // Core and SysTick clock
+	uint32_t bus_hz;    // Bus and flash clock, feeds the PIT
+	uint32_t tpm_hz;    // TPM counter input, before the prescaler
+	uint32_t uart0_hz;  // UART0 baud clock
+} clock_tree_t;
+
+typedef struct {
+	uint8_t ps;         // Prescaler, divides by 2^ps
+	uint16_t period;    // Counts per PWM period, MOD + 1
+	uint32_t pwm_hz;    // Resulting PWM frequency
+} clock_div_tpm_t;
+
+typedef struct {
+	uint16_t sbr;
+	uint8_t osr;        // Oversampling ratio, 4..32
+	uint32_t baud;      // Resulting baud rate
+} clock_div_uart_t;
+
+typedef struct {
+	uint32_t systick_reload;
+	uint32_t pit_reload;
+	clock_div_tpm_t pwm;
+	clock_div_uart_t uart0;
+} clock_plan_t;
+
+// Clock tree of each mode
+extern const clock_tree_t clock_trees[SYSCLOCK_MODES];
+
+/**
+ * @brief Choose the TPM prescaler and period closest to a PWM frequency.
+ *
+ * The smallest prescaler whose period fits in max_period counts is used, so
+ * the duty resolution is as fine as possible.
+ *
+ * @param clock_hz   TPM counter input clock.
+ * @param pwm_hz     Wanted PWM frequency.
+ * @param max_period Most counts per period.
+ * @param div        Result.
+ *
+ * @return false if no prescaler fits.
+ */
+bool Clock_Div_Tpm(uint32_t clock_hz, uint32_t pwm_hz, uint32_t max_period,
+		clock_div_tpm_t *div);
+
+/**
+ * @brief Choose the UART0 SBR and OSR closest to a baud rate.
+ *
+ * Ties go to the higher oversampling ratio.
+ *
+ * @param clock_hz UART0 baud clock.
+ * @param baud     Wanted baud rate.
+ * @param div      Result.
+ *
+ * @return false if the baud rate cannot be reached.
+ */
+bool Clock_Div_Uart(uint32_t clock_hz, uint32_t baud, clock_div_uart_t *div);
+
+/**
+ * @brief Derive the peripheral settings of a mode.
+ *
+ * @param mode    Clock mode.
+ * @param tick_hz RTOS tick rate.
+ * @param baud    UART0 baud rate.
+ * @param plan    Result.
+ *
+ * @return false if a setting cannot be derived.
+ */
+bool Clock_Div_Plan(sysclock_mode_t mode, uint32_t tick_hz, uint32_t baud,
+		clock_plan_t *plan);
+
+/**
+ * @brief Rescale a compare value to a new PWM period.
+ *
+ * The value is rounded to the nearest count. Zero and values at or past the
+ * old period (constant outputs) map to zero and the new period; any other
+ * value stays strictly inside the new period, so an output that toggles
+ * keeps toggling.
+ *
+ * @param cnv        Compare value.
+ * @param old_period Counts per period before.
+ * @param new_period Counts per period after.
+ *
+ * @return The compare value giving the same duty in the new period.
+ */
+uint32_t Clock_Div_Rescale(uint32_t cnv, uint32_t old_period,
+		uint32_t new_period);
+
+#endif // CLOCK_DIV_H
@@ -0,0 +1,150 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    clock_policy.c
+ * @brief   Switches the system clock between RUN while driving and VLPR
+ *          while parked.
+ *
+ * Transitions run with the scheduler suspended, so a task returning to RUN
+ * and the park timer never interleave, and no task runs while the
+ * peripherals are between modes. Interrupts stay enabled apart from the
+ * short windows in TPM_Set_Mode() and the SysTick reload.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "clock_policy.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "sysclock.h"
+#include "clock_div.h"
+#include "tpm.h"
+#include "ramp.h"
+#include "profile.h"
+#include "config.h"
+#include "kernel_objects.h"
+#include "log.h"
+#include "latency.h"
+#include "telemetry.h"
+
+static clock_plan_t plans[SYSCLOCK_MODES];
+static TimerHandle_t park_timer;
+
+// Tick of the last Clock_Policy_Run() or hold release
+static volatile TickType_t last_run;
+static volatile uint32_t holds;
+
+/**
+ * @brief Move the clocks and every clock-dependent peripheral to a mode.
+ *        Call with the scheduler suspended.
+ *
+ * @param mode New clock mode.
+ */
+static void set_mode(sysclock_mode_t mode) {
+	const clock_plan_t *plan = &plans[mode];
+	uint32_t cycles = LATENCY_HZ / configTICK_RATE_HZ / (plan->systick_reload + 1);
+	uint32_t remaining;
+
+	if (Sysclock_Get_Mode() == mode)
+		return;
+
+	if (mode == SYSCLOCK_VLPR) {
+		// Leave the PLL clock before the MCG stops it
+		Telemetry_Park(true);
+		Ramp_Park(true);
+		TPM_Set_Mode(mode, &plan->pwm);
+		Sysclock_Set_Mode(mode);
+	} else {
+		// The PLL must be locked before the TPMs count it
+		Sysclock_Set_Mode(mode);
+		TPM_Set_Mode(mode, &plan->pwm);
+		Ramp_Park(false);
+		Telemetry_Park(false);
+	}
+
+	// Keep the tick rate. Writing VAL clears it, so the rest of the current
+	// tick is loaded into LOAD and the reload restored once SysTick has taken
+	// it, as vPortSuppressTicksAndSleep() does.
+	__disable_irq();
+	remaining = SysTick->VAL * (plan->systick_reload + 1) / (SysTick->LOAD + 1);
+	SysTick->LOAD = (remaining != 0) ? remaining : 1;
+	SysTick->VAL = 0;
+	SysTick->LOAD = plan->systick_reload;
+	Latency_Set_Cycles_Per_Count(cycles);
+	__enable_irq();
+
+	Profile_Set_Counter_Reload(plan->pit_reload);
+	LOG(LOG_CLOCK_MODE, mode);
+}
+
+/**
+ * @brief Timer callback: park once the motors have been idle long enough.
+ *
+ * @param timer Park timer (unused).
+ */
+static void park_poll(TimerHandle_t timer) {
+	vTaskSuspendAll();
+	if (holds == 0 && Ramp_Is_Idle()
+			&& xTaskGetTickCount() - last_run >= pdMS_TO_TICKS(CLOCK_PARK_MS))
+		set_mode(SYSCLOCK_VLPR);
+	xTaskResumeAll();
+}
+
+// Refer clock_policy.h file for function brief and description
+void Init_Clock_Policy(void) {
+	sysclock_mode_t mode;
+	bool planned;
+
+	for (mode = SYSCLOCK_RUN; mode < SYSCLOCK_MODES; mode++) {
+		planned = Clock_Div_Plan(mode, configTICK_RATE_HZ,
+				Config_Get(CONFIG_BAUD_RATE), &plans[mode]);
+		configASSERT(planned);
+	}
+	(void) planned;
+
+	// UART0 is never touched on a transition
+	configASSERT(plans[SYSCLOCK_VLPR].uart0.sbr == plans[SYSCLOCK_RUN].uart0.sbr
+			&& plans[SYSCLOCK_VLPR].uart0.osr == plans[SYSCLOCK_RUN].uart0.osr);
+	// Compare values are written unscaled in RUN (see ramp.h)
+	configASSERT(plans[SYSCLOCK_RUN].pwm.period == TPM_PWM_PERIOD);
+
+	last_run = 0;
+	park_timer = Kernel_Create_Timer(KERNEL_TIMER_CLOCK,
+			pdMS_TO_TICKS(CLOCK_POLL_MS), pdTRUE, park_poll);
+	xTimerStart(park_timer, 0);
+}
+
+// Refer clock_policy.h file for function brief and description
+void Clock_Policy_Run(void) {
+	last_run = xTaskGetTickCount();
+	if (Sysclock_Get_Mode() == SYSCLOCK_RUN)
+		return;
+
+	vTaskSuspendAll();
+	set_mode(SYSCLOCK_RUN);
+	xTaskResumeAll();
+}
+
+// Refer clock_policy.h file for function brief and description
+void Clock_Policy_Hold(bool hold) {
+	taskENTER_CRITICAL();
+	if (hold) {
+		holds++;
+	} else if (holds > 0) {
+		holds--;
+	}
+	taskEXIT_CRITICAL();
+
+	// Counted first, so the park timer cannot switch back in between
+	Clock_Policy_Run();
+}
@@ -0,0 +1,76 @@
+// clock_policy.h
+
+#ifndef CLOCK_POLICY_H
+#define CLOCK_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    clock_policy.h
+ * @brief   Switches the system clock between RUN while driving and VLPR
+ *          while parked.
+ *
+ * The car runs at 48 MHz (SYSCLOCK_RUN) while the motors are in use and
+ * parks at 4 MHz in VLPR (SYSCLOCK_VLPR) once they have been idle for
+ * CLOCK_PARK_MS. A software timer checks every CLOCK_POLL_MS from the timer
+ * service task. Motor commands and maneuver segments call
+ * Clock_Policy_Run() before touching the motors, which returns to RUN
+ * synchronously, in about a millisecond while the PLL locks.
+ *
+ * On each transition, with the scheduler suspended:
+ * - the MCG, SIM dividers and power mode are moved by Sysclock_Set_Mode();
+ * - SysTick is reloaded for the new core clock, so the tick stays at
+ *   configTICK_RATE_HZ and SystemCoreClock matches. The part of the
+ *   current tick still to run is scaled to the new clock rather than
+ *   dropped, so the tick count loses no time beyond the counts between the
+ *   clock switch and the reload, and Latency_Now() stays monotonic;
+ * - the PIT prescaler of the run-time stats counter is reloaded for the new
+ *   bus clock;
+ * - TPM0/TPM2 get a new prescaler and period, keeping the PWM at
+ *   TPM_PWM_FREQUENCY, and are restarted on a period boundary so no pulse
+ *   is cut short (see TPM_Set_Mode()); TPM1 is frozen in VLPR;
+ * - the ramp generator and the telemetry task are parked in VLPR.
+ * All values come from Clock_Div_Plan() (see clock_div.h).
+ *
+ * UART0 counts MCGIRCLK, the fast IRC, which is the same 4 MHz in both
+ * modes and never stops, so its SBR/OSR are identical in both plans and
+ * the link does not lose a byte across a transition. Init_Clock_Policy()
+ * asserts this.
+ *
+ * The KL25Z cannot program flash in VLPR, so flash writers hold the clock
+ * in RUN with Clock_Policy_Hold().
+ */
+
+// Motor idle time before parking in VLPR
+#define CLOCK_PARK_MS (1000)
+
+// Interval of the park check
+#define CLOCK_POLL_MS (100)
+
+/**
+ * @brief Work out both clock plans and start the park timer.
+ *
+ * Call before starting the scheduler, after Init_TPM(), Init_Motors() and
+ * Init_Speed_Control(). The system starts in RUN.
+ */
+void Init_Clock_Policy(void);
+
+/**
+ * @brief Return to RUN if parked and restart the park delay.
+ *
+ * Call from a task or timer callback before driving the motors.
+ */
+void Clock_Policy_Run(void);
+
+/**
+ * @brief Hold the clock in RUN, e.g. around flash writes.
+ *
+ * Holds nest. Call from a task or timer callback. Before the scheduler
+ * starts the clock is always in RUN and the call only counts.
+ *
+ * @param hold true to take a hold, false to release it.
+ */
+void Clock_Policy_Hold(bool hold);
+
+#endif // CLOCK_POLICY_H
@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    cobs.c
+ * @brief   Consistent Overhead Byte Stuffing.
+ *
+ * The encoder copies each byte once and back-patches the code byte of the
+ * current run when it ends, so it needs no lookahead and no second buffer.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "cobs.h"
+
+// Code of a full run, not followed by an implied zero
+#define COBS_FULL_RUN (0xFF)
+
+// Refer cobs.h file for function brief and description
+size_t Cobs_Encode(const uint8_t *in, size_t len, uint8_t *out) {
+	size_t code_pos = 0;
+	size_t n = 1;
+	uint8_t code = 1;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (in[i] != 0) {
+			out[n++] = in[i];
+			code++;
+		}
+		if (in[i] == 0 || code == COBS_FULL_RUN) {
+			out[code_pos] = code;
+			code_pos = n++;
+			code = 1;
+			// A full run at the very end needs no empty run after it
+			if (in[i] != 0 && i + 1 == len)
+				return n - 1;
+		}
+	}
+	out[code_pos] = code;
+	return n;
+}
+
+// Refer cobs.h file for function brief and description
+size_t Cobs_Decode(const uint8_t *in, size_t len, uint8_t *out) {
+	size_t n = 0;
+	size_t i = 0;
+	uint8_t code;
+	uint8_t run;
+
+	if (len == 0)
+		return 0;
+	while (i < len) {
+		code = in[i++];
+		if (code == 0 || i + code - 1 > len)
+			return 0;
+		for (run = 1; run < code; run++) {
+			if (in[i] == 0)
+				return 0;
+			out[n++] = in[i++];
+		}
+		// The zero a short run stands for, except after the last run
+		if (code != COBS_FULL_RUN && i < len)
+			out[n++] = 0;
+	}
+	return n;
+}
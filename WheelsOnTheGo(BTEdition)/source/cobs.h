@@ -0,0 +1,53 @@
+// cobs.h
+
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file    cobs.h
+ * @brief   Consistent Overhead Byte Stuffing.
+ *
+ * COBS rewrites a block so that it contains no zero byte, at a cost of one
+ * byte per 254 bytes of input, rounded up. A zero then marks the end of
+ * every frame on the wire, so a receiver that starts mid-stream or loses a
+ * byte resynchronizes at the next zero without any escape state.
+ *
+ * Each run of up to 254 non-zero bytes is preceded by a code byte, the
+ * run's length + 1. A code below 0xFF implies a zero after the run, except
+ * at the end of the block.
+ *
+ * The module has no dependency on the MCU, so it is also built into the
+ * host model in tools/telemetry_sim.c.
+ */
+
+// Longest encoding of len bytes, without the zero delimiter
+#define COBS_MAX_ENCODED(len) ((len) + (len) / 254 + 1)
+
+/**
+ * @brief Encode a block. The zero delimiter is not written.
+ *
+ * @param in  Block to encode.
+ * @param len Block length.
+ * @param out Destination of at least COBS_MAX_ENCODED(len) bytes. Must not
+ *            overlap in.
+ *
+ * @return Encoded length, none of whose bytes is zero.
+ */
+size_t Cobs_Encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ * @brief Decode a block, without its zero delimiter.
+ *
+ * @param in  Encoded block.
+ * @param len Encoded length.
+ * @param out Destination of at least len bytes. May be in.
+ *
+ * @return Decoded length, or 0 if the block is empty, holds a zero or a
+ *         code runs past its end.
+ */
+size_t Cobs_Decode(const uint8_t *in, size_t len, uint8_t *out);
+
+#endif // COBS_H
@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    command_queue.c
+ * @brief   Bounded pipeline of typed motor commands between tasks.
+ *
+ * The pipeline is a FreeRTOS queue of command_t. It only uses the portable
+ * FreeRTOS API, so it builds unchanged against any FreeRTOS port.
+ *
+ * Coalescing: an idempotent command (one whose effect does not depend on how
+ * often it is applied, such as forward or a drive setpoint) is not queued
+ * again while an identical command is still pending. Toggling and timed
+ * commands are always queued.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "command_queue.h"
+#include "queue.h"
+#include "task.h"
+#include "latency.h"
+#include "kernel_objects.h"
+
+static QueueHandle_t command_queue;
+static command_stats_t stats;
+static uint16_t next_seq;
+// Most recently queued command, used for coalescing
+static command_t last_queued;
+
+/**
+ * @brief Check whether applying a command twice has the same effect as once.
+ *
+ * @param type Command to check.
+ *
+ * @return true if repeated copies may be coalesced.
+ */
+static bool is_idempotent(command_type_t type) {
+	return type == CMD_FORWARD || type == CMD_DRIVE;
+}
+
+// Refer command_queue.h file for function brief and description
+void Init_Command_Queue(void) {
+	command_queue = Kernel_Create_Queue(KERNEL_QUEUE_COMMANDS);
+}
+
+// Refer command_queue.h file for function brief and description
+command_type_t Command_From_Char(char ch) {
+	switch (ch) {
+	case '1':
+		return CMD_FORWARD;
+	case '2':
+		return CMD_STOP_BACKWARD;
+	case '3':
+		return CMD_RIGHT;
+	case '4':
+		return CMD_LEFT;
+	default:
+		return CMD_NONE;
+	}
+}
+
+/**
+ * @brief Stamp a command and post it, coalescing it with an identical pending one.
+ *
+ * @param cmd Command with type and arguments filled in.
+ *
+ * @return true if the command was queued or coalesced, false if it was dropped.
+ */
+static bool post(command_t *cmd) {
+	UBaseType_t depth;
+	bool queued = true;
+
+	// The polling task and the failsafe timer both post; the send never blocks
+	vTaskSuspendAll();
+	depth = uxQueueMessagesWaiting(command_queue);
+	if (depth > 0 && is_idempotent(cmd->type) && cmd->type == last_queued.type
+			&& cmd->throttle == last_queued.throttle
+			&& cmd->steer == last_queued.steer) {
+		stats.coalesced++;
+	} else {
+		cmd->seq = next_seq++;
+		cmd->issued = xTaskGetTickCount();
+		LATENCY_MARK(cmd->seq, LAT_STAGE_POSTED);
+
+		if (xQueueSendToBack(command_queue, cmd, 0) != pdPASS) {
+			stats.dropped++;
+			queued = false;
+		} else {
+			last_queued = *cmd;
+			stats.posted++;
+			if (depth + 1 > stats.max_depth)
+				stats.max_depth = depth + 1;
+		}
+	}
+	xTaskResumeAll();
+	return queued;
+}
+
+// Refer command_queue.h file for function brief and description
+bool Command_Send(command_type_t type) {
+	command_t cmd = { type, 0, 0, 0, 0 };
+
+	if (type == CMD_NONE)
+		return false;
+
+	return post(&cmd);
+}
+
+// Refer command_queue.h file for function brief and description
+bool Command_Send_Drive(int8_t throttle, int8_t steer) {
+	command_t cmd = { CMD_DRIVE, throttle, steer, 0, 0 };
+
+	return post(&cmd);
+}
+
+// Refer command_queue.h file for function brief and description
+bool Command_Receive(command_t *cmd, TickType_t timeout) {
+	TickType_t latency;
+
+	if (xQueueReceive(command_queue, cmd, timeout) != pdPASS)
+		return false;
+
+	LATENCY_MARK(cmd->seq, LAT_STAGE_DEQUEUED);
+	latency = xTaskGetTickCount() - cmd->issued;
+	taskENTER_CRITICAL();
+	stats.delivered++;
+	stats.last_seq = cmd->seq;
+	stats.total_latency += latency;
+	if (latency > stats.max_latency)
+		stats.max_latency = latency;
+	taskEXIT_CRITICAL();
+	return true;
+}
+
+// Refer command_queue.h file for function brief and description
+void Command_Get_Stats(command_stats_t *out) {
+	taskENTER_CRITICAL();
+	*out = stats;
+	taskEXIT_CRITICAL();
+	out->depth = uxQueueMessagesWaiting(command_queue);
+}
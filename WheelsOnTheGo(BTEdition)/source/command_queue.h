@@ -0,0 +1,106 @@
+// command_queue.h
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+
+/**
+ * @file    command_queue.h
+ * @brief   Bounded pipeline of typed motor commands between tasks.
+ *
+ * Commands are stamped with a sequence number and the tick they were issued
+ * on, then passed through a FreeRTOS queue so nothing is lost while the
+ * consumer is busy. Repeated idempotent commands that are still waiting in
+ * the queue are coalesced. Drop, coalesce and latency statistics are kept.
+ */
+
+// Number of commands the pipeline can hold
+#define COMMAND_QUEUE_LENGTH (8)
+
+// Motor commands understood by Motor_Control()
+typedef enum {
+	CMD_NONE = 0,
+	CMD_FORWARD,       // '1': Move forward
+	CMD_STOP_BACKWARD, // '2': Toggle between stop and backward movement
+	CMD_RIGHT,         // '3': Turn right then stop
+	CMD_LEFT,          // '4': Turn left then stop
+	CMD_DRIVE,         // Proportional throttle/steer from a protocol frame
+	CMD_STOP           // Stop, posted by the link-loss failsafe
+} command_type_t;
+
+typedef struct {
+	command_type_t type;
+	int8_t throttle;    // CMD_DRIVE only: forward (+) / reverse (-), +/-127 full scale
+	int8_t steer;       // CMD_DRIVE only: right (+) / left (-), +/-127 full scale
+	uint16_t seq;       // Incremented for every command posted
+	TickType_t issued;  // Tick count when the command was posted
+} command_t;
+
+typedef struct {
+	uint32_t posted;         // Commands accepted into the queue
+	uint32_t coalesced;      // Commands merged into an identical pending one
+	uint32_t dropped;        // Commands rejected because the queue was full
+	uint32_t delivered;      // Commands handed to the consumer
+	uint32_t depth;          // Commands queued when the snapshot was taken
+	uint32_t max_depth;      // Highest queue depth observed
+	uint16_t last_seq;       // Seq of the last command handed to the consumer
+	TickType_t max_latency;  // Worst post-to-delivery time in ticks
+	TickType_t total_latency; // Sum of post-to-delivery times in ticks
+} command_stats_t;
+
+/**
+ * @brief Create the command queue. Call before starting the scheduler.
+ */
+void Init_Command_Queue(void);
+
+/**
+ * @brief Translate a Bluetooth controller character into a command.
+ *
+ * @param ch Character received from the Bluetooth module ('1'..'4').
+ *
+ * @return The matching command, or CMD_NONE if ch is not a command.
+ */
+command_type_t Command_From_Char(char ch);
+
+/**
+ * @brief Post a command to the queue without blocking.
+ *
+ * May be called from several tasks.
+ *
+ * @param type Command to post.
+ *
+ * @return true if the command was queued or coalesced, false if it was dropped.
+ */
+bool Command_Send(command_type_t type);
+
+/**
+ * @brief Post a proportional drive command to the queue without blocking.
+ *
+ * @param throttle Forward (+) or reverse (-) demand, +/-127 full scale.
+ * @param steer    Right (+) or left (-) demand, +/-127 full scale.
+ *
+ * @return true if the command was queued or coalesced, false if it was dropped.
+ */
+bool Command_Send_Drive(int8_t throttle, int8_t steer);
+
+/**
+ * @brief Wait for the next command.
+ *
+ * @param cmd     Destination for the command.
+ * @param timeout Maximum number of ticks to wait.
+ *
+ * @return true if a command was received, false on timeout.
+ */
+bool Command_Receive(command_t *cmd, TickType_t timeout);
+
+/**
+ * @brief Get a snapshot of the command pipeline statistics.
+ *
+ * @param stats Destination for the statistics.
+ */
+void Command_Get_Stats(command_stats_t *stats);
+
+#endif // COMMAND_QUEUE_H
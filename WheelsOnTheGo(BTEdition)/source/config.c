@@ -0,0 +1,203 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    config.c
+ * @brief   Tunable settings kept in flash and updatable over Bluetooth.
+ *
+ * The single KL25Z flash block cannot be read while a flash command runs,
+ * so interrupts are masked from the launch of each FTFA command until it
+ * completes: a vector fetch or an ISR running from flash would otherwise
+ * read garbage. Records are programmed one longword, and so one command,
+ * at a time, with interrupts served in between; only a sector erase keeps
+ * them masked for long, which is why settings are only written while the
+ * car is stopped.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <stdbool.h>
+#include "config.h"
+#include "config_store.h"
+#include "MKL25Z4.h"
+#include "fsl_flash.h"
+#include "uart.h"
+#include "tpm.h"
+#include "motor_control.h"
+#include "ramp.h"
+#include "clock_policy.h"
+#include "log.h"
+#include "telemetry.h"
+
+typedef struct {
+	uint32_t initial;  // Value until one is stored
+	uint32_t min;
+	uint32_t max;
+} setting_t;
+
+static const setting_t settings[CONFIG_KEYS] = {
+	{ MEDIUM_SPEED, 0, TPM_PWM_PERIOD },    // CONFIG_DRIVE_SPEED
+	{ 500, 50, 5000 },                      // CONFIG_TURN_MS
+	{ 625, 0, TPM_PWM_PERIOD },             // CONFIG_RED_INTENSITY
+	{ 1200, 0, TPM_PWM_PERIOD },            // CONFIG_GREEN_INTENSITY
+	{ 1200, 0, TPM_PWM_PERIOD },            // CONFIG_BLUE_INTENSITY
+	{ 115200, 9600, 115200 },               // CONFIG_BAUD_RATE
+	{ 1000, 0, 60000 },                     // CONFIG_LINK_TIMEOUT_MS
+	{ LOG_LEVEL_INFO, LOG_LEVEL_DEBUG, LOG_LEVEL_OFF }, // CONFIG_LOG_LEVEL
+	{ TELEMETRY_DEFAULT_HZ, 0, TELEMETRY_MAX_HZ }, // CONFIG_TELEMETRY_HZ
+	{ 30000, 0, 600000 }                    // CONFIG_LEGACY_TIMEOUT_MS
+};
+
+static bool erase_sector(uint32_t sector);
+static bool program(uint32_t sector, uint32_t offset, const uint32_t *data,
+		uint32_t len);
+
+static flash_config_t flash;
+static bool flash_ready;
+static uint32_t values[CONFIG_KEYS];
+static uint8_t tx_seq;
+
+static config_store_t store = {
+	{ (const uint8_t *) CONFIG_SECTOR_A, (const uint8_t *) CONFIG_SECTOR_B },
+	CONFIG_SECTOR_SIZE,
+	erase_sector,
+	program,
+	CONFIG_KEYS,
+	values
+};
+
+/**
+ * @brief Erase one of the configuration sectors.
+ *
+ * @param sector Sector number.
+ *
+ * @return true on success.
+ */
+static bool erase_sector(uint32_t sector) {
+	uint32_t primask = __get_PRIMASK();
+	status_t status;
+
+	// One Erase Flash Sector command: 14 ms typical, 114 ms worst case
+	__disable_irq();
+	status = FLASH_Erase(&flash, (uint32_t) store.base[sector],
+			CONFIG_SECTOR_SIZE, kFLASH_ApiEraseKey);
+	__set_PRIMASK(primask);
+	return status == kStatus_Success;
+}
+
+/**
+ * @brief Program words into one of the configuration sectors.
+ *
+ * @param sector Sector number.
+ * @param offset Offset into the sector.
+ * @param data   Words to program.
+ * @param len    Length in bytes, a multiple of 4.
+ *
+ * @return true on success.
+ */
+static bool program(uint32_t sector, uint32_t offset, const uint32_t *data,
+		uint32_t len) {
+	uint32_t address = (uint32_t) store.base[sector] + offset;
+	uint32_t primask;
+	status_t status = kStatus_Success;
+	uint32_t i;
+
+	// One Program Longword command, about 65 us, per mask
+	for (i = 0; i < len / sizeof(uint32_t) && status == kStatus_Success; i++) {
+		primask = __get_PRIMASK();
+		__disable_irq();
+		status = FLASH_Program(&flash, address + i * sizeof(uint32_t),
+				(uint32_t *) &data[i], sizeof(uint32_t));
+		__set_PRIMASK(primask);
+	}
+	return status == kStatus_Success;
+}
+
+// Refer config.h file for function brief and description
+void Init_Config(void) {
+	uint32_t key;
+
+	for (key = 0; key < CONFIG_KEYS; key++)
+		values[key] = settings[key].initial;
+
+	flash_ready = (FLASH_Init(&flash) == kStatus_Success);
+	Config_Store_Load(&store);
+
+	// Never run with a value the current limits reject
+	for (key = 0; key < CONFIG_KEYS; key++) {
+		if (values[key] < settings[key].min || values[key] > settings[key].max)
+			values[key] = settings[key].initial;
+	}
+}
+
+// Refer config.h file for function brief and description
+uint32_t Config_Get(config_key_t key) {
+	return values[key];
+}
+
+// Refer config.h file for function brief and description
+config_status_t Config_Set(config_key_t key, uint32_t value) {
+	config_status_t status;
+	bool stored;
+
+	if (key >= CONFIG_KEYS)
+		return CONFIG_BAD_KEY;
+	if (value < settings[key].min || value > settings[key].max)
+		return CONFIG_OUT_OF_RANGE;
+	if (!flash_ready)
+		return CONFIG_FLASH_ERROR;
+	// A sector erase would stall the ramp and the encoders mid-drive
+	if (!Ramp_Is_Idle())
+		return CONFIG_BUSY;
+
+	// Flash cannot be programmed in VLPR
+	Clock_Policy_Hold(true);
+	stored = Config_Store_Set(&store, key, value);
+	Clock_Policy_Hold(false);
+
+	status = stored ? CONFIG_OK : CONFIG_FLASH_ERROR;
+	LOG(LOG_CONFIG_SET, key, value, status);
+	return status;
+}
+
+// Refer config.h file for function brief and description
+void Config_Handle_Frame(const protocol_frame_t *frame) {
+	uint8_t out[PROTOCOL_MAX_PAYLOAD + PROTOCOL_FRAME_OVERHEAD];
+	uint8_t payload[6];
+	config_status_t status;
+	uint32_t key;
+	uint32_t value;
+	uint32_t len;
+
+	if (frame->len < 1)
+		return;
+	key = frame->data[0];
+
+	if (frame->type == FRAME_CONFIG_SET && frame->len >= 5) {
+		value = frame->data[1] | (frame->data[2] << 8) | (frame->data[3] << 16)
+				| ((uint32_t) frame->data[4] << 24);
+		status = Config_Set((config_key_t) key, value);
+	} else if (frame->type == FRAME_CONFIG_GET) {
+		status = (key < CONFIG_KEYS) ? CONFIG_OK : CONFIG_BAD_KEY;
+	} else {
+		return;
+	}
+
+	value = (key < CONFIG_KEYS) ? values[key] : 0;
+	payload[0] = (uint8_t) key;
+	payload[1] = (uint8_t) value;
+	payload[2] = (uint8_t) (value >> 8);
+	payload[3] = (uint8_t) (value >> 16);
+	payload[4] = (uint8_t) (value >> 24);
+	payload[5] = (uint8_t) status;
+
+	len = Protocol_Encode(tx_seq++, FRAME_CONFIG_VALUE, payload, sizeof(payload), out);
+	UART0_Transmit(out, len);
+}
@@ -0,0 +1,97 @@
+// config.h
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include "protocol.h"
+
+/**
+ * @file    config.h
+ * @brief   Tunable settings kept in flash and updatable over Bluetooth.
+ *
+ * Settings live in a config_store (see config_store.h) across the two flash
+ * sectors at CONFIG_SECTOR_A and CONFIG_SECTOR_B, just below the fault log.
+ * The project's PROGRAM_FLASH memory region ends at CONFIG_SECTOR_A, so the
+ * linker never places code there. Init_Config() loads them into RAM once at
+ * boot; Config_Get() is then a single array access.
+ *
+ * A host changes a setting with FRAME_CONFIG_SET and reads one with
+ * FRAME_CONFIG_GET; the robot answers both with FRAME_CONFIG_VALUE (see
+ * protocol.h). Values outside a setting's range are rejected. Most
+ * settings take effect on their next use; CONFIG_BAUD_RATE takes effect at
+ * the next reset, and the RN-41 must be set to the same rate first.
+ *
+ * Interrupts are masked while a flash command runs: about 65 us per
+ * longword, two per update, plus one sector erase (14 ms typical, 114 ms
+ * worst case) every ~120 updates when the log moves to the other sector.
+ * So a setting is only written while both wheels are stopped
+ * (Ramp_Is_Idle()); otherwise Config_Set() answers CONFIG_BUSY and the
+ * host sends it again once the car has stopped.
+ */
+
+#define CONFIG_SECTOR_A (0x1F400UL)
+#define CONFIG_SECTOR_B (0x1F800UL)
+#define CONFIG_SECTOR_SIZE (1024UL)
+
+typedef enum {
+	CONFIG_DRIVE_SPEED = 0,  // TPM0 CnV for the single-character commands (low-true)
+	CONFIG_TURN_MS,          // Duration of a '3'/'4' turn
+	CONFIG_RED_INTENSITY,    // TPM CnV at full red
+	CONFIG_GREEN_INTENSITY,  // TPM CnV at full green
+	CONFIG_BLUE_INTENSITY,   // TPM CnV at full blue
+	CONFIG_BAUD_RATE,        // UART0 baud rate
+	CONFIG_LINK_TIMEOUT_MS,  // Frame silence before the failsafe stops the car, 0 = off
+	CONFIG_LOG_LEVEL,        // Lowest LOG_LEVEL_x sent, LOG_LEVEL_OFF = none
+	CONFIG_TELEMETRY_HZ,     // Telemetry sample rate on UART1, 0 = off
+	CONFIG_LEGACY_TIMEOUT_MS, // Command silence before the failsafe stops the car
+	                         // when no frame was ever received, 0 = off
+	CONFIG_KEYS
+} config_key_t;
+
+typedef enum {
+	CONFIG_OK = 0,
+	CONFIG_BAD_KEY,
+	CONFIG_OUT_OF_RANGE,
+	CONFIG_FLASH_ERROR,
+	CONFIG_BUSY              // The car is moving, send it again once stopped
+} config_status_t;
+
+/**
+ * @brief Load the settings from flash, falling back to the defaults.
+ *
+ * Call first thing after Init_Sysclock(), before any module reads a setting.
+ */
+void Init_Config(void);
+
+/**
+ * @brief Read a setting.
+ *
+ * @param key Setting.
+ *
+ * @return Its current value.
+ */
+uint32_t Config_Get(config_key_t key);
+
+/**
+ * @brief Change a setting and store it in flash.
+ *
+ * Call from a task. Blocks for the flash write, and only writes while
+ * Ramp_Is_Idle().
+ *
+ * @param key   Setting.
+ * @param value New value.
+ *
+ * @return CONFIG_OK, or why the setting was not changed.
+ */
+config_status_t Config_Set(config_key_t key, uint32_t value);
+
+/**
+ * @brief Handle a FRAME_CONFIG_SET or FRAME_CONFIG_GET frame and send the
+ *        FRAME_CONFIG_VALUE answer.
+ *
+ * @param frame Decoded frame.
+ */
+void Config_Handle_Frame(const protocol_frame_t *frame);
+
+#endif // CONFIG_H
@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    config_store.c
+ * @brief   Key/value store kept as an append-only log across two flash
+ *          sectors.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <stddef.h>
+#include "config_store.h"
+#include "protocol.h"
+
+#define ERASED_WORD (0xFFFFFFFFUL)
+
+typedef struct {
+	uint32_t generation;
+	uint32_t magic;        // Programmed last
+} header_t;
+
+typedef struct {
+	uint32_t value;
+	uint8_t key;           // The key/CRC word is programmed last
+	uint8_t crc;
+	uint16_t reserved;     // Zero, so a stored key word is never erased
+} record_t;
+
+/**
+ * @brief Get a sector's header.
+ *
+ * @param store  Store.
+ * @param sector Sector number.
+ *
+ * @return The header, valid or not.
+ */
+static const header_t *sector_header(const config_store_t *store, uint32_t sector) {
+	return (const header_t *) store->base[sector];
+}
+
+/**
+ * @brief Compute a record's CRC-8 over its key and value.
+ *
+ * @param key   Key.
+ * @param value Value.
+ *
+ * @return CRC-8 of the key and the little-endian value.
+ */
+static uint8_t record_crc(uint32_t key, uint32_t value) {
+	uint8_t bytes[5];
+
+	bytes[0] = (uint8_t) key;
+	bytes[1] = (uint8_t) value;
+	bytes[2] = (uint8_t) (value >> 8);
+	bytes[3] = (uint8_t) (value >> 16);
+	bytes[4] = (uint8_t) (value >> 24);
+	return Protocol_CRC8(bytes, sizeof(bytes));
+}
+
+/**
+ * @brief Program one record, value first.
+ *
+ * @param store  Store.
+ * @param sector Sector number.
+ * @param offset Offset of the record in the sector.
+ * @param key    Key.
+ * @param value  Value.
+ *
+ * @return true on success.
+ */
+static bool write_record(config_store_t *store, uint32_t sector,
+		uint32_t offset, uint32_t key, uint32_t value) {
+	record_t record;
+
+	record.value = value;
+	record.key = (uint8_t) key;
+	record.crc = record_crc(key, value);
+	record.reserved = 0;
+
+	if (!store->program(sector, offset, &record.value, sizeof(record.value)))
+		return false;
+	return store->program(sector, offset + sizeof(record.value),
+			(const uint32_t *) &record.value + 1, sizeof(record) - sizeof(record.value));
+}
+
+/**
+ * @brief Copy every key into the other sector and make it active.
+ *
+ * @param store Store.
+ * @param key   Key being set.
+ * @param value New value of key.
+ *
+ * @return true on success.
+ */
+static bool collect(config_store_t *store, uint32_t key, uint32_t value) {
+	uint32_t target = store->formatted ? 1 - store->active : 0;
+	uint32_t offset = sizeof(header_t);
+	header_t header;
+	uint32_t k;
+
+	store->erases++;
+	if (!store->erase(target))
+		return false;
+
+	for (k = 0; k < store->keys; k++) {
+		if (!write_record(store, target, offset, k,
+				(k == key) ? value : store->values[k]))
+			return false;
+		offset += sizeof(record_t);
+	}
+
+	header.generation = store->formatted ? store->generation + 1 : 1;
+	header.magic = CONFIG_STORE_MAGIC;
+	if (!store->program(target, 0, &header.generation, sizeof(header)))
+		return false;
+
+	store->formatted = true;
+	store->active = target;
+	store->generation = header.generation;
+	store->next = offset;
+	return true;
+}
+
+// Refer config_store.h file for function brief and description
+void Config_Store_Load(config_store_t *store) {
+	const header_t *header;
+	const record_t *record;
+	uint32_t sector;
+	uint32_t offset;
+
+	store->formatted = false;
+	store->erases = 0;
+	for (sector = 0; sector < CONFIG_STORE_SECTORS; sector++) {
+		header = sector_header(store, sector);
+		if (header->magic != CONFIG_STORE_MAGIC)
+			continue;
+		if (!store->formatted || header->generation > store->generation) {
+			store->formatted = true;
+			store->active = sector;
+			store->generation = header->generation;
+		}
+	}
+	if (!store->formatted)
+		return;
+
+	for (offset = sizeof(header_t); offset + sizeof(record_t) <= store->size;
+			offset += sizeof(record_t)) {
+		record = (const record_t *) (store->base[store->active] + offset);
+		if (record->value == ERASED_WORD
+				&& *((const uint32_t *) record + 1) == ERASED_WORD)
+			break;
+		if (record->key < store->keys && record->reserved == 0
+				&& record->crc == record_crc(record->key, record->value))
+			store->values[record->key] = record->value;
+	}
+	store->next = offset;
+}
+
+// Refer config_store.h file for function brief and description
+bool Config_Store_Set(config_store_t *store, uint32_t key, uint32_t value) {
+	if (key >= store->keys)
+		return false;
+	if (store->formatted && store->values[key] == value)
+		return true;
+
+	if (!store->formatted || store->next + sizeof(record_t) > store->size) {
+		if (!collect(store, key, value))
+			return false;
+	} else {
+		if (!write_record(store, store->active, store->next, key, value)) {
+			// Never program the failed slot again; collect on the next set
+			store->next = store->size;
+			return false;
+		}
+		store->next += sizeof(record_t);
+	}
+
+	store->values[key] = value;
+	return true;
+}
@@ -0,0 +1,88 @@
+// config_store.h
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    config_store.h
+ * @brief   Key/value store kept as an append-only log across two flash
+ *          sectors.
+ *
+ * Each sector starts with a header (generation, magic) followed by 8-byte
+ * records (value, key, CRC-8). Setting a key appends one record to the
+ * active sector. When the active sector is full, the other one is erased,
+ * the current value of every key is copied into it and its header is
+ * written with the next generation. On load, the sector with a valid
+ * header and the highest generation is active, and its records are replayed
+ * into a RAM cache, so reading a key afterwards is a single array access.
+ *
+ * Power-loss safety comes from write ordering, as each step only becomes
+ * visible when its last word is programmed:
+ * - a record's value is programmed before its key/CRC word;
+ * - a sector's records are programmed before its header magic.
+ * A record cut short fails its CRC or has no key and is skipped. A copy cut
+ * short leaves the old sector active. The update that was being written is
+ * lost, but every other key keeps its last stored value.
+ *
+ * The module only reads the sectors through memory and writes them through
+ * the callbacks in config_store_t, so it builds and runs unchanged against
+ * the simulated sectors in tools/config_store_sim.c.
+ */
+
+#define CONFIG_STORE_SECTORS (2)
+#define CONFIG_STORE_MAGIC   (0x47464E43UL)  // "CNFG"
+
+typedef struct {
+	const uint8_t *base[CONFIG_STORE_SECTORS];  // Sector contents, readable as memory
+	uint32_t size;                              // Sector size in bytes
+
+	/**
+	 * Erase a whole sector.
+	 * @return true on success.
+	 */
+	bool (*erase)(uint32_t sector);
+
+	/**
+	 * Program words at an offset into a sector; they must be erased.
+	 * @return true on success.
+	 */
+	bool (*program)(uint32_t sector, uint32_t offset, const uint32_t *data,
+			uint32_t len);
+
+	uint32_t keys;        // Number of keys
+	uint32_t *values;     // Cache of keys entries, holding the defaults before loading
+
+	// State, set by Config_Store_Load()
+	bool formatted;       // A sector holds a valid header
+	uint32_t active;      // Sector being appended to
+	uint32_t generation;  // Generation of the active sector
+	uint32_t next;        // Offset of the next free record
+	uint32_t erases;      // Sector erases since loading
+} config_store_t;
+
+/**
+ * @brief Find the active sector and replay its records into the cache.
+ *
+ * Keys without a stored record keep the values already in the cache.
+ *
+ * @param store Store, with the flash fields, keys and values set.
+ */
+void Config_Store_Load(config_store_t *store);
+
+/**
+ * @brief Store a value and update the cache.
+ *
+ * Writing the value a key already has does nothing. May erase a sector.
+ *
+ * @param store Store loaded with Config_Store_Load().
+ * @param key   Key, below store->keys.
+ * @param value New value.
+ *
+ * @return true if the value was stored.
+ */
+bool Config_Store_Set(config_store_t *store, uint32_t key, uint32_t value);
+
+#endif // CONFIG_STORE_H
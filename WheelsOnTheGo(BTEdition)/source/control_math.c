@@ -0,0 +1,257 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    control_math.c
+ * @brief   Fixed-point (Q15/Q31) motor control kernels on top of CMSIS arm_math.
+ *
+ * arm_pid_q15/arm_pid_q31 implement the incremental PID form
+ *   y[n] = y[n-1] + A0 * x[n] + A1 * x[n-1] + A2 * x[n-2]
+ * with A0 = Kp + Ki + Kd, A1 = -(Kp + 2 * Kd) and A2 = Kd. Because y[n-1] is
+ * the integrator, clamping the stored output is all the anti-windup needed.
+ *
+ * Only the differential mixer divides, and only when an output saturates; the
+ * Cortex-M0+ has no hardware divider.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "control_math.h"
+
+#define Q15_MAX    (0x7FFF)
+
+// Refer control_math.h file for function brief and description
+void ctl_pid_init_q15(arm_pid_instance_q15 *pid, q15_t kp, q15_t ki, q15_t kd) {
+	pid->Kp = kp;
+	pid->Ki = ki;
+	pid->Kd = kd;
+	pid->A0 = clip_q31_to_q15((q31_t) kp + ki + kd);
+	pid->A1 = clip_q31_to_q15(-((q31_t) kp + 2 * (q31_t) kd));
+	pid->A2 = kd;
+	pid->state[0] = 0;
+	pid->state[1] = 0;
+	pid->state[2] = 0;
+}
+
+// Refer control_math.h file for function brief and description
+void ctl_pid_init_q31(arm_pid_instance_q31 *pid, q31_t kp, q31_t ki, q31_t kd) {
+	pid->Kp = kp;
+	pid->Ki = ki;
+	pid->Kd = kd;
+	pid->A0 = clip_q63_to_q31((q63_t) kp + ki + kd);
+	pid->A1 = clip_q63_to_q31(-((q63_t) kp + 2 * (q63_t) kd));
+	pid->A2 = kd;
+	pid->state[0] = 0;
+	pid->state[1] = 0;
+	pid->state[2] = 0;
+}
+
+// Refer control_math.h file for function brief and description
+q15_t ctl_pid_q15(arm_pid_instance_q15 *pid, q15_t error, q15_t min, q15_t max) {
+	q15_t out = arm_pid_q15(pid, error);
+
+	if (out > max)
+		out = max;
+	else if (out < min)
+		out = min;
+
+	pid->state[2] = out;
+	return out;
+}
+
+// Refer control_math.h file for function brief and description
+q31_t ctl_pid_q31(arm_pid_instance_q31 *pid, q31_t error, q31_t min, q31_t max) {
+	q31_t out = arm_pid_q31(pid, error);
+
+	if (out > max)
+		out = max;
+	else if (out < min)
+		out = min;
+
+	pid->state[2] = out;
+	return out;
+}
+
+// Refer control_math.h file for function brief and description
+q15_t ctl_slew_q15(ctl_slew_q15_t *slew, q15_t target) {
+	q31_t step = (q31_t) target - slew->value;
+
+	if (step > slew->max_step)
+		step = slew->max_step;
+	else if (step < -slew->max_step)
+		step = -slew->max_step;
+
+	slew->value = (q15_t) (slew->value + step);
+	return slew->value;
+}
+
+// Refer control_math.h file for function brief and description
+q15_t ctl_lpf_q15(ctl_lpf_q15_t *lpf, q15_t in) {
+	q63_t delta = ((q63_t) in << 16) - lpf->state;
+
+	lpf->state += (q31_t) ((delta * lpf->alpha) >> 15);
+	return (q15_t) (lpf->state >> 16);
+}
+
+// Refer control_math.h file for function brief and description
+void ctl_mix_q15(q15_t throttle, q15_t steer, q15_t *left, q15_t *right) {
+	q31_t l = (q31_t) throttle + steer;
+	q31_t r = (q31_t) throttle - steer;
+	q31_t peak = (l < 0 ? -l : l) > (r < 0 ? -r : r) ?
+			(l < 0 ? -l : l) : (r < 0 ? -r : r);
+
+	if (peak > Q15_MAX) {
+		// Scale both sides together so the turn ratio is preserved
+		l = l * Q15_MAX / peak;
+		r = r * Q15_MAX / peak;
+	}
+
+	*left = (q15_t) l;
+	*right = (q15_t) r;
+}
+
+#ifdef CONTROL_MATH_BENCHMARK
+
+#include "stdio.h"
+#include "latency.h"
+#include "uart.h"
+
+#define BENCH_ITERATIONS (100)
+#define LINE_LENGTH      (64)
+
+// Results are written here so the compiler cannot discard the loops
+static volatile q15_t sink_q15;
+static volatile float sink_float;
+
+typedef struct {
+	float kp, ki, kd;
+	float integral;
+	float prev_error;
+} float_pid_t;
+
+static float float_pid(float_pid_t *pid, float error) {
+	float out;
+
+	pid->integral += pid->ki * error;
+	out = pid->kp * error + pid->integral + pid->kd * (error - pid->prev_error);
+	pid->prev_error = error;
+	if (out > 1.0f)
+		out = 1.0f;
+	else if (out < 0.0f)
+		out = 0.0f;
+	return out;
+}
+
+static float float_slew(float *value, float target, float max_step) {
+	float step = target - *value;
+
+	if (step > max_step)
+		step = max_step;
+	else if (step < -max_step)
+		step = -max_step;
+	*value += step;
+	return *value;
+}
+
+static float float_lpf(float *state, float in, float alpha) {
+	*state += alpha * (in - *state);
+	return *state;
+}
+
+static void float_mix(float throttle, float steer, float *left, float *right) {
+	float l = throttle + steer;
+	float r = throttle - steer;
+	float peak = (l < 0 ? -l : l) > (r < 0 ? -r : r) ?
+			(l < 0 ? -l : l) : (r < 0 ? -r : r);
+
+	if (peak > 1.0f) {
+		l /= peak;
+		r /= peak;
+	}
+	*left = l;
+	*right = r;
+}
+
+/**
+ * @brief Print one benchmark result line.
+ *
+ * @param kernel      Kernel name.
+ * @param fixed_total Cycles for BENCH_ITERATIONS fixed-point calls.
+ * @param float_total Cycles for BENCH_ITERATIONS soft-float calls.
+ */
+static void report(const char *kernel, uint32_t fixed_total, uint32_t float_total) {
+	char line[LINE_LENGTH];
+
+	snprintf(line, sizeof(line), "%s,%lu,%lu\n\r", kernel,
+			(unsigned long) (fixed_total / BENCH_ITERATIONS),
+			(unsigned long) (float_total / BENCH_ITERATIONS));
+	UART0_Transmit_String(line);
+}
+
+// Refer control_math.h file for function brief and description
+void Control_Math_Benchmark(void) {
+	arm_pid_instance_q15 pid;
+	float_pid_t fpid = { 0.5f, 0.01f, 0.0f, 0.0f, 0.0f };
+	ctl_slew_q15_t slew = { 0, Q15(0.01) };
+	ctl_lpf_q15_t lpf = { Q15(0.1), 0 };
+	float fvalue = 0.0f, fstate = 0.0f, fl, fr;
+	q15_t l, r;
+	uint32_t start, fixed_total, float_total;
+	int32_t i;
+
+	UART0_Transmit_String("kernel,q15_cycles,float_cycles\n\r");
+
+	ctl_pid_init_q15(&pid, Q15(0.5), Q15(0.01), 0);
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		sink_q15 = ctl_pid_q15(&pid, (q15_t) (i * 100), 0, Q15_ONE);
+	fixed_total = Latency_Now() - start;
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		sink_float = float_pid(&fpid, i * 0.003f);
+	float_total = Latency_Now() - start;
+	report("pid", fixed_total, float_total);
+
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		sink_q15 = ctl_slew_q15(&slew, (q15_t) (i * 300));
+	fixed_total = Latency_Now() - start;
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		sink_float = float_slew(&fvalue, i * 0.01f, 0.01f);
+	float_total = Latency_Now() - start;
+	report("slew", fixed_total, float_total);
+
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		sink_q15 = ctl_lpf_q15(&lpf, (q15_t) (i * 300));
+	fixed_total = Latency_Now() - start;
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++)
+		sink_float = float_lpf(&fstate, i * 0.01f, 0.1f);
+	float_total = Latency_Now() - start;
+	report("lpf", fixed_total, float_total);
+
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		ctl_mix_q15((q15_t) (i * 300), Q15(0.5), &l, &r);
+		sink_q15 = l + r;
+	}
+	fixed_total = Latency_Now() - start;
+	start = Latency_Now();
+	for (i = 0; i < BENCH_ITERATIONS; i++) {
+		float_mix(i * 0.01f, 0.5f, &fl, &fr);
+		sink_float = fl + fr;
+	}
+	float_total = Latency_Now() - start;
+	report("mix", fixed_total, float_total);
+}
+
+#endif // CONTROL_MATH_BENCHMARK
@@ -0,0 +1,152 @@
+// control_math.h
+
+#ifndef CONTROL_MATH_H
+#define CONTROL_MATH_H
+
+#include <stdint.h>
+
+/**
+ * @file    control_math.h
+ * @brief   Fixed-point (Q15/Q31) motor control kernels on top of CMSIS arm_math.
+ *
+ * The KL25Z has no FPU, so every kernel here works in Q15 (1.15) or Q31
+ * (1.31) fractions with saturating arithmetic:
+ * - PID controllers wrapping arm_pid_q15/arm_pid_q31, with output clamping
+ *   that also clamps the controller state (anti-windup)
+ * - Slew-rate limiters
+ * - First-order low-pass filters
+ * - Differential-drive mixing of throttle and steering
+ *
+ * The CMSIS DSP library itself is not linked into this project: arm_pid_q15
+ * and arm_pid_q31 are inline in arm_math.h, and the gain setup that normally
+ * lives in arm_pid_init_*() is done here. Everything is plain C, so results
+ * are bit-exact between the target and a host build of the same sources.
+ *
+ * Defining CONTROL_MATH_BENCHMARK adds Control_Math_Benchmark(), which
+ * reports the cycle cost of each kernel against a soft-float equivalent.
+ */
+
+#ifndef ARM_MATH_CM0PLUS
+#define ARM_MATH_CM0PLUS
+#endif
+#include "arm_math.h"
+
+// Q15 representation of +1.0 (saturated) and of a fraction f in [-1, 1)
+#define Q15_ONE          ((q15_t) 0x7FFF)
+#define Q15(f)           ((q15_t) ((f) >= 1.0 ? 0x7FFF : (f) * 32768.0))
+#define Q31(f)           ((q31_t) ((f) >= 1.0 ? 0x7FFFFFFF : (f) * 2147483648.0))
+
+typedef struct {
+	q15_t value;     // Current output
+	q15_t max_step;  // Largest change allowed per call
+} ctl_slew_q15_t;
+
+typedef struct {
+	q15_t alpha;     // Smoothing factor, 0 (frozen) .. Q15_ONE (no filtering)
+	q31_t state;     // Filter output kept in Q31 so small steps are not lost
+} ctl_lpf_q15_t;
+
+/**
+ * @brief Saturating Q15 addition.
+ */
+static inline q15_t ctl_add_q15(q15_t a, q15_t b) {
+	return clip_q31_to_q15((q31_t) a + b);
+}
+
+/**
+ * @brief Saturating Q15 subtraction.
+ */
+static inline q15_t ctl_sub_q15(q15_t a, q15_t b) {
+	return clip_q31_to_q15((q31_t) a - b);
+}
+
+/**
+ * @brief Saturating Q15 multiplication with rounding.
+ */
+static inline q15_t ctl_mul_q15(q15_t a, q15_t b) {
+	return clip_q31_to_q15(((q31_t) a * b + (1 << 14)) >> 15);
+}
+
+/**
+ * @brief Initialize a Q15 PID controller and clear its state.
+ *
+ * Equivalent to arm_pid_init_q15() with resetStateFlag set.
+ *
+ * @param pid PID instance.
+ * @param kp  Proportional gain.
+ * @param ki  Integral gain per sample.
+ * @param kd  Derivative gain per sample.
+ */
+void ctl_pid_init_q15(arm_pid_instance_q15 *pid, q15_t kp, q15_t ki, q15_t kd);
+
+/**
+ * @brief Initialize a Q31 PID controller and clear its state.
+ *
+ * Equivalent to arm_pid_init_q31() with resetStateFlag set.
+ */
+void ctl_pid_init_q31(arm_pid_instance_q31 *pid, q31_t kp, q31_t ki, q31_t kd);
+
+/**
+ * @brief Run one Q15 PID step with the output limited to [min, max].
+ *
+ * The limited output is written back into the controller state, so the
+ * incremental form of arm_pid_q15 cannot wind up beyond the limits.
+ *
+ * @param pid PID instance.
+ * @param error Control error for this sample.
+ * @param min Lower output limit.
+ * @param max Upper output limit.
+ *
+ * @return Limited controller output.
+ */
+q15_t ctl_pid_q15(arm_pid_instance_q15 *pid, q15_t error, q15_t min, q15_t max);
+
+/**
+ * @brief Run one Q31 PID step with the output limited to [min, max].
+ *
+ * See ctl_pid_q15().
+ */
+q31_t ctl_pid_q31(arm_pid_instance_q31 *pid, q31_t error, q31_t min, q31_t max);
+
+/**
+ * @brief Move the limiter output towards target by at most max_step.
+ *
+ * @param slew   Limiter instance.
+ * @param target Desired value.
+ *
+ * @return New limiter output.
+ */
+q15_t ctl_slew_q15(ctl_slew_q15_t *slew, q15_t target);
+
+/**
+ * @brief First-order low-pass filter: y += alpha * (x - y).
+ *
+ * @param lpf Filter instance.
+ * @param in  New input sample.
+ *
+ * @return Filtered output.
+ */
+q15_t ctl_lpf_q15(ctl_lpf_q15_t *lpf, q15_t in);
+
+/**
+ * @brief Mix throttle and steering into left and right wheel commands.
+ *
+ * left = throttle + steer and right = throttle - steer. When either side
+ * would saturate, both are scaled down together so the turn ratio is kept.
+ *
+ * @param throttle Forward (+) or reverse (-) demand.
+ * @param steer    Right (+) or left (-) demand.
+ * @param left     Destination for the left wheel command.
+ * @param right    Destination for the right wheel command.
+ */
+void ctl_mix_q15(q15_t throttle, q15_t steer, q15_t *left, q15_t *right);
+
+#ifdef CONTROL_MATH_BENCHMARK
+/**
+ * @brief Time every kernel against a soft-float version and print CSV over UART0:
+ *   kernel,q15_cycles,float_cycles
+ */
+void Control_Math_Benchmark(void);
+#endif
+
+#endif // CONTROL_MATH_H
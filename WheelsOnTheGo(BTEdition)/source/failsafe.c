@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    failsafe.c
+ * @brief   Bluetooth link-loss failsafe and COP watchdog servicing.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "failsafe.h"
+#include "supervisor.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "command_queue.h"
+#include "config.h"
+#include "led.h"
+#include "kernel_objects.h"
+#include "log.h"
+
+// COP timeout of 2^10 LPO cycles, 1024 ms
+#define COP_TIMEOUT_1024MS (3)
+
+#if defined(COP_WATCHDOG) && DISABLE_WDOG
+#error "COP_WATCHDOG needs DISABLE_WDOG=0, or SystemInit() locks the COP off"
+#endif
+
+static supervisor_t supervisor;
+static TimerHandle_t failsafe_timer;
+static bool stop_pending;      // Link lost, stop not queued yet
+
+/**
+ * @brief Restart the COP timeout.
+ */
+static void service_cop(void) {
+	SIM->SRVCOP = SIM_SRVCOP_SRVCOP(0x55);
+	SIM->SRVCOP = SIM_SRVCOP_SRVCOP(0xAA);
+}
+
+/**
+ * @brief Timer callback: check the link and the task check-ins.
+ *
+ * @param timer Failsafe timer (unused).
+ */
+static void failsafe_poll(TimerHandle_t timer) {
+	bool service;
+
+	switch (Supervisor_Poll(&supervisor, xTaskGetTickCount(),
+			pdMS_TO_TICKS(Config_Get(CONFIG_LINK_TIMEOUT_MS)),
+			pdMS_TO_TICKS(Config_Get(CONFIG_LEGACY_TIMEOUT_MS)), &service)) {
+	case SUPERVISOR_LINK_LOST:
+		stop_pending = true;
+		LOG(LOG_LINK_LOST);
+		Led_Set_Status(LED_STATUS_LINK_LOST);
+		break;
+	case SUPERVISOR_LINK_RESTORED:
+		// The operator drives again, a stop still waiting is stale
+		stop_pending = false;
+		Led_Clear_Status(LED_STATUS_LINK_LOST);
+		break;
+	default:
+		break;
+	}
+
+	// A full queue drops the stop: try again at every poll until queued
+	if (stop_pending)
+		stop_pending = !Command_Send(CMD_STOP);
+
+	if (service)
+		service_cop();
+}
+
+// Refer failsafe.h file for function brief and description
+void Init_Failsafe(uint32_t tasks) {
+	Supervisor_Init(&supervisor, tasks);
+
+#ifdef COP_WATCHDOG
+	// SIM_COPC can only be written once after reset
+	SIM->COPC = SIM_COPC_COPT(COP_TIMEOUT_1024MS);
+#endif
+
+	failsafe_timer = Kernel_Create_Timer(KERNEL_TIMER_FAILSAFE,
+			pdMS_TO_TICKS(FAILSAFE_PERIOD_MS), pdTRUE, failsafe_poll);
+	xTimerStart(failsafe_timer, 0);
+}
+
+// Refer failsafe.h file for function brief and description
+void Failsafe_Activity(bool frame) {
+	Supervisor_Activity(&supervisor, xTaskGetTickCount(), frame);
+}
+
+// Refer failsafe.h file for function brief and description
+void Failsafe_Check_In(failsafe_task_t task) {
+	Supervisor_Check_In(&supervisor, task);
+}
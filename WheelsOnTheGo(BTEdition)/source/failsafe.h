@@ -0,0 +1,78 @@
+// failsafe.h
+
+#ifndef FAILSAFE_H
+#define FAILSAFE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    failsafe.h
+ * @brief   Bluetooth link-loss failsafe and COP watchdog servicing.
+ *
+ * A software timer polls the supervisor (see supervisor.h) every
+ * FAILSAFE_PERIOD_MS from the timer service task, so no task of its own is
+ * needed.
+ * - When a framed client has been silent for CONFIG_LINK_TIMEOUT_MS, the car
+ *   is stopped with CMD_STOP and the LEDs show LED_STATUS_LINK_LOST until
+ *   the next frame or command arrives. The stop is posted at most
+ *   CONFIG_LINK_TIMEOUT_MS + FAILSAFE_PERIOD_MS after the last frame.
+ *   A client that has only sent single-character commands is given
+ *   CONFIG_LEGACY_TIMEOUT_MS instead, as it has no heartbeat to send.
+ * - CMD_STOP brakes both wheels to zero duty over FAILSAFE_STOP_MS, rather
+ *   than coasting at full speed, and then releases them.
+ * - The COP watchdog is serviced once every critical task has checked in
+ *   since the last service. Critical tasks block for at most
+ *   FAILSAFE_CHECKIN_MS and call Failsafe_Check_In() on every wake-up. The
+ *   timer service task checks in by running the poll itself.
+ *
+ * The COP only runs in builds defining COP_WATCHDOG. Such builds also need
+ * DISABLE_WDOG=0, because SIM_COPC is write-once and SystemInit() would
+ * otherwise lock the COP off. The Release configuration defines both. Debug
+ * builds leave the COP off because it keeps counting while the debugger
+ * halts the core.
+ *
+ * The COP runs from the 1 kHz LPO with a 1024 ms timeout. That is well
+ * above the longest time interrupts are masked, which is a 114 ms
+ * worst-case flash erase (see config.h).
+ */
+
+#define FAILSAFE_PERIOD_MS  (100)
+#define FAILSAFE_CHECKIN_MS (250)
+#define FAILSAFE_STOP_MS    (300)
+
+// Tasks that must check in, FAILSAFE_TASK_POLL_BT last
+typedef enum {
+	FAILSAFE_TASK_MOTOR_CONTROL = 0,
+	FAILSAFE_TASK_SPEED_CONTROL,
+	FAILSAFE_TASK_POLL_BT,
+	FAILSAFE_TASKS
+} failsafe_task_t;
+
+/**
+ * @brief Start the supervisor timer and, in COP_WATCHDOG builds, the COP.
+ *
+ * Call before starting the scheduler, after Init_Command_Queue().
+ *
+ * @param tasks Number of failsafe_task_t tasks that must check in, counted
+ *              from the first.
+ */
+void Init_Failsafe(uint32_t tasks);
+
+/**
+ * @brief Record a valid frame or legacy command. Call from the receiving task.
+ *
+ * Either arms link supervision.
+ *
+ * @param frame true for a protocol frame, false for a legacy command.
+ */
+void Failsafe_Activity(bool frame);
+
+/**
+ * @brief Record that a critical task is running.
+ *
+ * @param task Task checking in.
+ */
+void Failsafe_Check_In(failsafe_task_t task);
+
+#endif // FAILSAFE_H
@@ -0,0 +1,231 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    fault.c
+ * @brief   Hard-fault capture to a persistent flash log, reported on the
+ *          next boot.
+ *
+ * Fault_Capture() runs in HardFault, above every interrupt, on whatever is
+ * left of the main stack, so the record is static and pointers taken from
+ * the faulting context are range-checked before they are followed.
+ *
+ * The flash driver launches each command from a copy of flash_run_command()
+ * in RAM, since the single KL25Z flash block cannot be read while it is
+ * being programmed. For the same reason interrupts are masked around the
+ * one flash write made while the scheduler runs.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "fault.h"
+#include "fault_log.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "fsl_flash.h"
+#include "uart.h"
+#include "led.h"
+#include "kernel_objects.h"
+#include "clock_policy.h"
+#include "fsl_smc.h"
+
+// SRAM_L and SRAM_U
+#define SRAM_START      (0x1FFFF000UL)
+#define SRAM_END        (0x20003000UL)
+
+#define STACKED_WORDS   (8)
+#define LINE_LENGTH     (64)
+
+static bool erase_sector(void);
+static bool program(uint32_t offset, const uint32_t *data, uint32_t len);
+
+static flash_config_t flash;
+static bool flash_ready;
+
+static const fault_log_t fault_log = {
+	(const uint8_t *) FAULT_LOG_ADDRESS,
+	FAULT_LOG_SIZE,
+	erase_sector,
+	program
+};
+
+/**
+ * @brief Erase the fault log sector.
+ *
+ * @return true on success.
+ */
+static bool erase_sector(void) {
+	return FLASH_Erase(&flash, FAULT_LOG_ADDRESS, FAULT_LOG_SIZE,
+			kFLASH_ApiEraseKey) == kStatus_Success;
+}
+
+/**
+ * @brief Program words into the fault log sector.
+ *
+ * @param offset Offset into the sector.
+ * @param data   Words to program.
+ * @param len    Length in bytes, a multiple of 4.
+ *
+ * @return true on success.
+ */
+static bool program(uint32_t offset, const uint32_t *data, uint32_t len) {
+	return FLASH_Program(&flash, FAULT_LOG_ADDRESS + offset, (uint32_t *) data,
+			len) == kStatus_Success;
+}
+
+#if defined (__SEMIHOST_HARDFAULT_DISABLE)
+/**
+ * @brief Hard fault handler: find the stacked registers and log the fault.
+ */
+__attribute__((naked))
+void HardFault_Handler(void) {
+	__asm(  ".syntax unified\n"
+			"MOVS   R0, #4           \n"
+			"MOV    R1, LR           \n"
+			"TST    R0, R1           \n"
+			"BEQ    _fault_msp       \n"
+			"MRS    R0, PSP          \n"
+			"B      _fault_capture   \n"
+			"_fault_msp:             \n"
+			"MRS    R0, MSP          \n"
+			"_fault_capture:         \n"
+			"LDR    R2,=Fault_Capture\n"
+			"BX     R2               \n"
+			".syntax divided\n");
+}
+#endif
+
+// Refer fault.h file for function brief and description
+void Fault_Capture(uint32_t *frame, uint32_t exc_return) {
+	static fault_record_t record;
+	uint32_t address = (uint32_t) frame;
+
+	__disable_irq();
+	memset(&record, 0, sizeof(record));
+
+	if (address >= SRAM_START && address <= SRAM_END - STACKED_WORDS * 4
+			&& (address & 3) == 0) {
+		record.r0 = frame[0];
+		record.r1 = frame[1];
+		record.r2 = frame[2];
+		record.r3 = frame[3];
+		record.r12 = frame[4];
+		record.lr = frame[5];
+		record.pc = frame[6];
+		record.xpsr = frame[7];
+	}
+	record.exc_return = exc_return;
+	record.sp = address;
+	record.icsr = SCB->ICSR;
+
+	if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+		record.tick = xTaskGetTickCountFromISR();
+		strncpy(record.task, pcTaskGetName(NULL), FAULT_TASK_NAME);
+	}
+	record.events = Trace_Last_Events(record.trace, FAULT_TRACE_EVENTS);
+
+	if (flash_ready) {
+		// Give the flash write a full COP timeout (see failsafe.h)
+		SIM->SRVCOP = SIM_SRVCOP_SRVCOP(0x55);
+		SIM->SRVCOP = SIM_SRVCOP_SRVCOP(0xAA);
+		// Flash cannot be programmed in VLPR; the core stays at 4 MHz
+		if (SMC_GetPowerModeState(SMC) == kSMC_PowerStateVlpr) {
+			SMC_SetPowerModeRun(SMC);
+			while (SMC_GetPowerModeState(SMC) != kSMC_PowerStateRun)
+				;
+		}
+		Fault_Log_Append(&fault_log, &record);
+	}
+
+	NVIC_SystemReset();
+	while (1)
+		;
+}
+
+/**
+ * @brief Queue a report line, waiting for the transmit FIFO to drain first
+ *        so that the report is never truncated by the drop policy.
+ *
+ * @param line Null-terminated line to transmit.
+ */
+static void report_line(const char *line) {
+	while (UART0_Tx_Pending() != 0)
+		vTaskDelay(1);
+	UART0_Transmit_String(line);
+}
+
+/**
+ * @brief Print one fault record.
+ *
+ * @param record Record to print.
+ */
+static void report(const fault_record_t *record) {
+	char line[LINE_LENGTH];
+	uint32_t i;
+
+	snprintf(line, sizeof(line), "fault %lu: task %.*s tick %lu\n\r",
+			record->seq, FAULT_TASK_NAME, record->task, record->tick);
+	report_line(line);
+	snprintf(line, sizeof(line), " pc %08lx lr %08lx xpsr %08lx\n\r",
+			record->pc, record->lr, record->xpsr);
+	report_line(line);
+	snprintf(line, sizeof(line), " r0 %08lx r1 %08lx r2 %08lx r3 %08lx\n\r",
+			record->r0, record->r1, record->r2, record->r3);
+	report_line(line);
+	snprintf(line, sizeof(line), " r12 %08lx sp %08lx exc %08lx icsr %08lx\n\r",
+			record->r12, record->sp, record->exc_return, record->icsr);
+	report_line(line);
+
+	for (i = 0; i < record->events && i < FAULT_TRACE_EVENTS; i++) {
+		snprintf(line, sizeof(line), " trace %lu type %u task %u arg %u\n\r",
+				record->trace[i].time, record->trace[i].type,
+				record->trace[i].task, record->trace[i].arg);
+		report_line(line);
+	}
+}
+
+/**
+ * @brief Task that reports the unreported faults, oldest first, signals them
+ *        on the LEDs for a while, then exits.
+ *
+ * @param pvParameter Task parameters (unused).
+ */
+static void task_fault_report(void *pvParameter) {
+	const fault_record_t *record;
+	bool marked = true;
+
+	Led_Set_Status(LED_STATUS_FAULT);
+	while (marked && (record = Fault_Log_Unreported(&fault_log)) != NULL) {
+		report(record);
+
+		// Flash cannot be programmed in VLPR
+		Clock_Policy_Hold(true);
+		taskENTER_CRITICAL();
+		marked = Fault_Log_Mark_Reported(&fault_log, record);
+		taskEXIT_CRITICAL();
+		Clock_Policy_Hold(false);
+	}
+
+	vTaskDelay(pdMS_TO_TICKS(FAULT_SIGNAL_MS));
+	Led_Clear_Status(LED_STATUS_FAULT);
+	vTaskDelete(NULL);
+}
+
+// Refer fault.h file for function brief and description
+void Init_Fault(uint32_t priority) {
+	flash_ready = (FLASH_Init(&flash) == kStatus_Success);
+
+	if (flash_ready && Fault_Log_Unreported(&fault_log) != NULL)
+		Kernel_Create_Task(KERNEL_TASK_FAULT, task_fault_report, priority);
+}
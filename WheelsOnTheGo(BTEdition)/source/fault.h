@@ -0,0 +1,60 @@
+// fault.h
+
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <stdint.h>
+
+/**
+ * @file    fault.h
+ * @brief   Hard-fault capture to a persistent flash log, reported on the
+ *          next boot.
+ *
+ * HardFault_Handler (semihost_hardfault.c, or fault.c when
+ * __SEMIHOST_HARDFAULT_DISABLE is defined) passes every fault that is not a
+ * semihosting BKPT to Fault_Capture(). That function records:
+ * - the registers stacked on exception entry and the stack pointer;
+ * - EXC_RETURN and SCB->ICSR. The Cortex-M0+ has no CFSR, so these and the
+ *   xPSR exception number are all the fault state there is;
+ * - the RTOS tick count and the name of the running task;
+ * - the last FAULT_TRACE_EVENTS trace recorder events (TRACE_RECORDER
+ *   builds only).
+ * The record is appended to the fault log in the last flash sector
+ * (see fault_log.h), and then the MCU resets instead of hanging.
+ *
+ * The project's PROGRAM_FLASH memory region ends below the configuration
+ * sectors (see config.h), which sit just under FAULT_LOG_ADDRESS, so the
+ * linker never places code there.
+ *
+ * On the next boot, every record not yet reported is printed over UART0 as
+ * text and then marked as reported, and the LEDs show LED_STATUS_FAULT for
+ * FAULT_SIGNAL_MS.
+ */
+
+// Flash sector holding the fault log, excluded from PROGRAM_FLASH
+#define FAULT_LOG_ADDRESS (0x1FC00UL)
+#define FAULT_LOG_SIZE    (1024UL)
+
+// Time the LEDs signal a fault after the reset it caused
+#define FAULT_SIGNAL_MS   (5000)
+
+/**
+ * @brief Prepare the flash driver and, if the log holds unreported faults,
+ *        create a task that reports them.
+ *
+ * Call early, before starting the scheduler: faults before this call reset
+ * the MCU without being logged.
+ *
+ * @param priority Priority of the report task, normally just above idle.
+ */
+void Init_Fault(uint32_t priority);
+
+/**
+ * @brief Log a fault and reset. Called from HardFault_Handler.
+ *
+ * @param frame      Registers stacked on exception entry.
+ * @param exc_return LR on exception entry.
+ */
+void Fault_Capture(uint32_t *frame, uint32_t exc_return) __attribute__((noreturn));
+
+#endif // FAULT_H
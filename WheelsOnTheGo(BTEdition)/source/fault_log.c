@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    fault_log.c
+ * @brief   Append-only log of fault records in one flash sector.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <stddef.h>
+#include "fault_log.h"
+
+#define RECORD_WORDS (sizeof(fault_record_t) / sizeof(uint32_t))
+
+// Words before the payload: magic and reported stay erased until committed
+#define HEADER_WORDS (2)
+
+/**
+ * @brief Get a slot of the sector.
+ *
+ * @param log  Log sector.
+ * @param slot Slot number.
+ *
+ * @return The slot contents.
+ */
+static const fault_record_t *slot_record(const fault_log_t *log, uint32_t slot) {
+	return (const fault_record_t *) (log->base + slot * sizeof(fault_record_t));
+}
+
+/**
+ * @brief Check whether a slot has never been written since the last erase.
+ *
+ * @param record Slot contents.
+ *
+ * @return true if every word is erased.
+ */
+static bool slot_erased(const fault_record_t *record) {
+	const uint32_t *word = (const uint32_t *) record;
+	uint32_t i;
+
+	for (i = 0; i < RECORD_WORDS; i++) {
+		if (word[i] != FAULT_LOG_ERASED)
+			return false;
+	}
+	return true;
+}
+
+// Refer fault_log.h file for function brief and description
+bool Fault_Log_Append(const fault_log_t *log, fault_record_t *record) {
+	uint32_t slots = FAULT_LOG_SLOTS(log->size);
+	const fault_record_t *stored;
+	uint32_t free_slot = slots;
+	uint32_t seq = 0;
+	bool unreported = false;
+	uint32_t offset;
+	uint32_t slot;
+
+	for (slot = 0; slot < slots; slot++) {
+		stored = slot_record(log, slot);
+		if (stored->magic == FAULT_LOG_MAGIC) {
+			if (stored->seq >= seq)
+				seq = stored->seq + 1;
+			if (stored->reported == FAULT_LOG_ERASED)
+				unreported = true;
+		} else if (free_slot == slots && slot_erased(stored)) {
+			free_slot = slot;
+		}
+	}
+
+	// A free slot is only usable if nothing was written after it
+	for (slot = free_slot + 1; slot < slots; slot++) {
+		if (!slot_erased(slot_record(log, slot))) {
+			free_slot = slots;
+			break;
+		}
+	}
+
+	if (free_slot == slots) {
+		// The first faults of a crash loop tell more than the last ones
+		if (unreported)
+			return false;
+		if (!log->erase())
+			return false;
+		free_slot = 0;
+	}
+
+	record->magic = FAULT_LOG_MAGIC;
+	record->reported = FAULT_LOG_ERASED;
+	record->seq = seq;
+
+	offset = free_slot * sizeof(fault_record_t);
+	if (!log->program(offset + HEADER_WORDS * sizeof(uint32_t),
+			(const uint32_t *) record + HEADER_WORDS,
+			sizeof(fault_record_t) - HEADER_WORDS * sizeof(uint32_t)))
+		return false;
+	return log->program(offset, &record->magic, sizeof(record->magic));
+}
+
+// Refer fault_log.h file for function brief and description
+const fault_record_t *Fault_Log_Unreported(const fault_log_t *log) {
+	uint32_t slots = FAULT_LOG_SLOTS(log->size);
+	const fault_record_t *oldest = NULL;
+	const fault_record_t *stored;
+	uint32_t slot;
+
+	for (slot = 0; slot < slots; slot++) {
+		stored = slot_record(log, slot);
+		if (stored->magic != FAULT_LOG_MAGIC
+				|| stored->reported != FAULT_LOG_ERASED)
+			continue;
+		if (oldest == NULL || stored->seq < oldest->seq)
+			oldest = stored;
+	}
+	return oldest;
+}
+
+// Refer fault_log.h file for function brief and description
+bool Fault_Log_Mark_Reported(const fault_log_t *log, const fault_record_t *record) {
+	static const uint32_t reported = 0;
+
+	return log->program((const uint8_t *) &record->reported - log->base,
+			&reported, sizeof(reported));
+}
@@ -0,0 +1,115 @@
+// fault_log.h
+
+#ifndef FAULT_LOG_H
+#define FAULT_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "trace.h"
+
+/**
+ * @file    fault_log.h
+ * @brief   Append-only log of fault records in one flash sector.
+ *
+ * The sector holds as many fixed-size fault_record_t slots as fit. A record
+ * is programmed with its magic word last, so a write cut short by a reset
+ * never looks valid; such a slot is skipped rather than reused. The
+ * reported word is left erased when the record is written and programmed
+ * to zero once the record has been sent, so marking a record never needs an
+ * erase.
+ *
+ * When every slot is used and every record in them has been reported, the
+ * sector is erased and the new record goes in the first slot. The sector is
+ * therefore erased at most once per FAULT_LOG_SLOTS(size) faults; sequence
+ * numbers carry on across erases. If a record is still unreported, as in a
+ * crash loop that resets before the report is sent, the new record is
+ * dropped instead: the oldest faults are the ones that explain the loop.
+ *
+ * The module only reads the sector through memory and writes it through
+ * the callbacks in fault_log_t, so it builds and runs unchanged against the
+ * simulated sector in tools/fault_log_sim.c.
+ */
+
+// Trace events kept with each record
+#define FAULT_TRACE_EVENTS (16)
+
+// Bytes of the task name kept with each record
+#define FAULT_TASK_NAME    (8)
+
+#define FAULT_LOG_MAGIC    (0x544C5546UL)  // "FULT"
+#define FAULT_LOG_ERASED   (0xFFFFFFFFUL)
+
+typedef struct {
+	uint32_t magic;        // FAULT_LOG_MAGIC once the record is complete
+	uint32_t reported;     // FAULT_LOG_ERASED until sent over UART0
+	uint32_t seq;          // One more than the previous record
+	uint32_t r0;           // Registers stacked on exception entry
+	uint32_t r1;
+	uint32_t r2;
+	uint32_t r3;
+	uint32_t r12;
+	uint32_t lr;
+	uint32_t pc;
+	uint32_t xpsr;
+	uint32_t exc_return;   // LR on handler entry: stack and mode in use
+	uint32_t sp;           // Stack pointer holding the stacked registers
+	uint32_t icsr;         // SCB->ICSR: active and pending exceptions
+	uint32_t tick;         // RTOS tick count
+	char task[FAULT_TASK_NAME];
+	uint32_t events;       // Valid entries in trace
+	trace_event_t trace[FAULT_TRACE_EVENTS];  // Oldest first
+} fault_record_t;
+
+typedef struct {
+	const uint8_t *base;   // Sector contents, readable as memory
+	uint32_t size;         // Sector size in bytes
+
+	/**
+	 * Erase the whole sector.
+	 * @return true on success.
+	 */
+	bool (*erase)(void);
+
+	/**
+	 * Program words at an offset into the sector; they must be erased.
+	 * @return true on success.
+	 */
+	bool (*program)(uint32_t offset, const uint32_t *data, uint32_t len);
+} fault_log_t;
+
+// Records that fit in a sector of the given size
+#define FAULT_LOG_SLOTS(size) ((size) / sizeof(fault_record_t))
+
+/**
+ * @brief Append a record, erasing the sector first if it is full and
+ *        every record in it has been reported.
+ *
+ * @param log    Log sector.
+ * @param record Record to store; its magic, reported and seq fields are set
+ *               by this function.
+ *
+ * @return true if the record was stored, false if it was dropped because
+ *         the sector is full of unreported records, or if flash failed.
+ */
+bool Fault_Log_Append(const fault_log_t *log, fault_record_t *record);
+
+/**
+ * @brief Find the oldest record that has not been reported yet.
+ *
+ * @param log Log sector.
+ *
+ * @return The record, or NULL if there is none.
+ */
+const fault_record_t *Fault_Log_Unreported(const fault_log_t *log);
+
+/**
+ * @brief Mark a record as reported.
+ *
+ * @param log    Log sector.
+ * @param record Record returned by Fault_Log_Unreported().
+ *
+ * @return true on success.
+ */
+bool Fault_Log_Mark_Reported(const fault_log_t *log, const fault_record_t *record);
+
+#endif // FAULT_LOG_H
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    hbridge.c
+ * @brief   Direction states of a wheel's H-bridge inputs.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "hbridge.h"
+
+// Refer hbridge.h file for function brief and description
+void Hbridge_Init(hbridge_t *bridge, uint32_t cw, uint32_t ccw) {
+	bridge->pins[HBRIDGE_COAST] = 0;
+	bridge->pins[HBRIDGE_CW] = cw;
+	bridge->pins[HBRIDGE_CCW] = ccw;
+	bridge->target = HBRIDGE_COAST;
+	bridge->applied = HBRIDGE_COAST;
+	bridge->dead = 0;
+}
+
+// Refer hbridge.h file for function brief and description
+void Hbridge_Set(hbridge_t *bridge, hbridge_dir_t dir) {
+	bridge->target = (dir < HBRIDGE_STATES) ? dir : HBRIDGE_COAST;
+}
+
+// Refer hbridge.h file for function brief and description
+hbridge_event_t Hbridge_Step(hbridge_t *bridge, uint32_t dead_periods,
+		hbridge_write_t *write) {
+	hbridge_event_t event = HBRIDGE_HELD;
+
+	if (bridge->applied != bridge->target) {
+		if (bridge->applied != HBRIDGE_COAST) {
+			// Release before any reversal or stop
+			write->clear |= bridge->pins[bridge->applied];
+			bridge->applied = HBRIDGE_COAST;
+			bridge->dead = dead_periods;
+			event = HBRIDGE_RELEASED;
+		} else if (bridge->dead == 0) {
+			write->set |= bridge->pins[bridge->target];
+			bridge->applied = bridge->target;
+			event = HBRIDGE_ENGAGED;
+		}
+	}
+
+	if (bridge->dead != 0)
+		bridge->dead--;
+	return event;
+}
+
+// Refer hbridge.h file for function brief and description
+bool Hbridge_Is_Idle(const hbridge_t *bridge) {
+	return bridge->target == HBRIDGE_COAST && bridge->applied == HBRIDGE_COAST
+			&& bridge->dead == 0;
+}
@@ -0,0 +1,96 @@
+// hbridge.h
+
+#ifndef HBRIDGE_H
+#define HBRIDGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    hbridge.h
+ * @brief   Direction states of a wheel's H-bridge inputs.
+ *
+ * A wheel has two inputs on one GPIO port and is in one of three states:
+ * coast (both low), CW or CCW (one high). The inputs driven high in each
+ * state are computed once by Hbridge_Init(). Callers request a state rather
+ * than a pin mask, so both inputs high cannot be requested.
+ *
+ * Hbridge_Step() runs once per PWM period. A change of direction always goes
+ * through coast. In the period the change is seen, the current input is
+ * cleared. The wheel then stays in coast for the dead time before the new
+ * input is set.
+ *
+ * Steps add their pin changes to an hbridge_write_t, so the changes of
+ * several wheels on one port are applied together:
+ * 1. one clear (PCOR) write;
+ * 2. then one set (PSOR) write.
+ * Every state visible on the port between the writes is a legal one.
+ *
+ * The module only computes masks, so it builds and runs unchanged against the
+ * simulated port in tools/hbridge_sim.c.
+ */
+
+typedef enum {
+	HBRIDGE_COAST = 0,  // Both inputs low
+	HBRIDGE_CW,
+	HBRIDGE_CCW,
+	HBRIDGE_STATES
+} hbridge_dir_t;
+
+typedef enum {
+	HBRIDGE_HELD = 0,   // No change on the inputs
+	HBRIDGE_RELEASED,   // The wheel entered coast this period
+	HBRIDGE_ENGAGED     // The requested direction was applied this period
+} hbridge_event_t;
+
+typedef struct {
+	uint32_t clear;     // Inputs to drive low, written first
+	uint32_t set;       // Inputs to drive high, written second
+} hbridge_write_t;
+
+typedef struct {
+	uint32_t pins[HBRIDGE_STATES];  // Inputs high in each state
+	hbridge_dir_t target;           // Requested state
+	hbridge_dir_t applied;          // State on the inputs
+	uint32_t dead;                  // Periods left in coast
+} hbridge_t;
+
+/**
+ * @brief Set up a wheel in coast.
+ *
+ * @param bridge Wheel.
+ * @param cw     Mask of the input driven high for CW.
+ * @param ccw    Mask of the input driven high for CCW.
+ */
+void Hbridge_Init(hbridge_t *bridge, uint32_t cw, uint32_t ccw);
+
+/**
+ * @brief Request a state, applied by the next steps.
+ *
+ * @param bridge Wheel.
+ * @param dir    Requested state. Invalid values request coast.
+ */
+void Hbridge_Set(hbridge_t *bridge, hbridge_dir_t dir);
+
+/**
+ * @brief Advance a wheel by one PWM period.
+ *
+ * @param bridge       Wheel.
+ * @param dead_periods Periods to stay in coast before a new direction.
+ * @param write        Pin changes, added to the ones already there.
+ *
+ * @return What happened to the wheel's inputs.
+ */
+hbridge_event_t Hbridge_Step(hbridge_t *bridge, uint32_t dead_periods,
+		hbridge_write_t *write);
+
+/**
+ * @brief Check whether a wheel is in coast with no change pending.
+ *
+ * @param bridge Wheel.
+ *
+ * @return true when coasting, past the dead time and asked to coast.
+ */
+bool Hbridge_Is_Idle(const hbridge_t *bridge);
+
+#endif // HBRIDGE_H
@@ -0,0 +1,193 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    kernel_objects.c
+ * @brief   Single table of every FreeRTOS task, queue and timer.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "kernel_objects.h"
+#include "command_queue.h"
+#include "boot.h"
+
+typedef struct {
+	const char *name;
+	uint16_t depth;         // Stack depth in words
+#ifdef STATIC_KERNEL
+	StackType_t *stack;
+#endif
+} task_def_t;
+
+typedef struct {
+	const char *name;
+	UBaseType_t length;
+	UBaseType_t item_size;
+#ifdef STATIC_KERNEL
+	uint8_t *storage;
+#endif
+} queue_def_t;
+
+// Size of a timer command queue item, DaemonTaskMessage_t of timers.c
+#define TIMER_MESSAGE_SIZE (sizeof(BaseType_t) + sizeof(PendedFunction_t) \
+		+ sizeof(void *) + sizeof(uint32_t))
+
+// RAM of the tables' stacks and queue storage
+#define STACK_BYTES(id, name, depth)             + (depth) * sizeof(StackType_t)
+#define STORAGE_BYTES(id, name, length, size)    + (length) * (size)
+#define TIMER_BYTES(id, name)                    + sizeof(StaticTimer_t)
+
+// Static build: the tables, the idle and timer service tasks and the timer
+// queue, with their control blocks
+#define KERNEL_STATIC_BYTES ((0 KERNEL_TASKS(STACK_BYTES)) \
+		+ (configMINIMAL_STACK_SIZE + configTIMER_TASK_STACK_DEPTH) * sizeof(StackType_t) \
+		+ (KERNEL_TASK_COUNT + 2) * sizeof(StaticTask_t) \
+		+ (0 KERNEL_QUEUES(STORAGE_BYTES)) + configTIMER_QUEUE_LENGTH * TIMER_MESSAGE_SIZE \
+		+ (KERNEL_QUEUE_COUNT + 1) * sizeof(StaticQueue_t) \
+		+ (0 KERNEL_TIMERS(TIMER_BYTES)))
+
+// Dynamic build: heap_4 adds an 8-byte header to each block and rounds it to
+// portBYTE_ALIGNMENT. A task is two blocks, stack and control block.
+#define HEAP_HEADER        ((sizeof(void *) + sizeof(size_t) + portBYTE_ALIGNMENT - 1) \
+		& ~(portBYTE_ALIGNMENT - 1))
+#define HEAP_BLOCK(bytes)  (((bytes) + HEAP_HEADER + portBYTE_ALIGNMENT - 1) \
+		& ~(portBYTE_ALIGNMENT - 1))
+#define TASK_BLOCKS(depth) (HEAP_BLOCK((depth) * sizeof(StackType_t)) \
+		+ HEAP_BLOCK(sizeof(StaticTask_t)))
+#define TASK_HEAP(id, name, depth)               + TASK_BLOCKS(depth)
+#define QUEUE_HEAP(id, name, length, size)       + HEAP_BLOCK(sizeof(StaticQueue_t) + (length) * (size))
+#define TIMER_HEAP(id, name)                     + HEAP_BLOCK(sizeof(StaticTimer_t))
+
+#define KERNEL_HEAP_BYTES ((0 KERNEL_TASKS(TASK_HEAP)) \
+		+ TASK_BLOCKS(configMINIMAL_STACK_SIZE) + TASK_BLOCKS(configTIMER_TASK_STACK_DEPTH) \
+		+ (0 KERNEL_QUEUES(QUEUE_HEAP)) \
+		+ HEAP_BLOCK(sizeof(StaticQueue_t) + configTIMER_QUEUE_LENGTH * TIMER_MESSAGE_SIZE) \
+		+ (0 KERNEL_TIMERS(TIMER_HEAP)))
+
+// heap_4 loses up to portBYTE_ALIGNMENT aligning the heap, and a header ends it
+#define HEAP_USABLE_BYTES  (configTOTAL_HEAP_SIZE - portBYTE_ALIGNMENT - HEAP_HEADER)
+
+#ifdef STATIC_KERNEL
+
+// One stack per task and one storage area per queue, sized by the tables.
+// Neither is read before FreeRTOS writes it, so FAST_BOOT leaves them out of
+// the .bss zeroing.
+#define TASK_STACK(id, name, depth)              static StackType_t id##_stack[depth] FAST_BOOT_NOINIT;
+#define QUEUE_STORAGE(id, name, length, size)    static uint8_t id##_storage[(length) * (size)] FAST_BOOT_NOINIT;
+KERNEL_TASKS(TASK_STACK)
+KERNEL_QUEUES(QUEUE_STORAGE)
+
+#define TASK_DEF(id, name, depth)                [id] = { name, depth, id##_stack },
+#define QUEUE_DEF(id, name, length, size)        [id] = { name, length, size, id##_storage },
+
+static StaticTask_t task_blocks[KERNEL_TASK_COUNT];
+static StaticQueue_t queue_blocks[KERNEL_QUEUE_COUNT];
+static StaticTimer_t timer_blocks[KERNEL_TIMER_COUNT];
+
+static StaticTask_t idle_block;
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE] FAST_BOOT_NOINIT;
+static StaticTask_t timer_task_block;
+static StackType_t timer_task_stack[configTIMER_TASK_STACK_DEPTH] FAST_BOOT_NOINIT;
+
+#else
+
+_Static_assert(KERNEL_HEAP_BYTES + KERNEL_HEAP_MARGIN <= HEAP_USABLE_BYTES,
+		"the kernel objects do not fit configTOTAL_HEAP_SIZE with KERNEL_HEAP_MARGIN to spare");
+
+#if (configAPPLICATION_ALLOCATED_HEAP == 1)
+// heap_4 writes its block headers before handing out memory
+uint8_t ucHeap[configTOTAL_HEAP_SIZE] FAST_BOOT_NOINIT;
+#endif
+
+#define TASK_DEF(id, name, depth)                [id] = { name, depth },
+#define QUEUE_DEF(id, name, length, size)        [id] = { name, length, size },
+
+#endif // STATIC_KERNEL
+
+#define TIMER_NAME(id, name)                     [id] = name,
+
+static const task_def_t tasks[KERNEL_TASK_COUNT] = { KERNEL_TASKS(TASK_DEF) };
+static const queue_def_t queues[KERNEL_QUEUE_COUNT] = { KERNEL_QUEUES(QUEUE_DEF) };
+static const char *const timer_names[KERNEL_TIMER_COUNT] = { KERNEL_TIMERS(TIMER_NAME) };
+
+// Refer kernel_objects.h file for function brief and description
+TaskHandle_t Kernel_Create_Task(kernel_task_t task, TaskFunction_t code,
+		UBaseType_t priority) {
+	TaskHandle_t handle = NULL;
+
+	configASSERT(task < KERNEL_TASK_COUNT);
+#ifdef STATIC_KERNEL
+	handle = xTaskCreateStatic(code, tasks[task].name, tasks[task].depth, NULL,
+			priority, tasks[task].stack, &task_blocks[task]);
+#else
+	xTaskCreate(code, tasks[task].name, tasks[task].depth, NULL, priority,
+			&handle);
+#endif
+	configASSERT(handle != NULL);
+	return handle;
+}
+
+// Refer kernel_objects.h file for function brief and description
+QueueHandle_t Kernel_Create_Queue(kernel_queue_t queue) {
+	QueueHandle_t handle;
+
+	configASSERT(queue < KERNEL_QUEUE_COUNT);
+#ifdef STATIC_KERNEL
+	handle = xQueueCreateStatic(queues[queue].length, queues[queue].item_size,
+			queues[queue].storage, &queue_blocks[queue]);
+#else
+	handle = xQueueCreate(queues[queue].length, queues[queue].item_size);
+#endif
+	configASSERT(handle != NULL);
+	vQueueAddToRegistry(handle, queues[queue].name);
+	return handle;
+}
+
+// Refer kernel_objects.h file for function brief and description
+TimerHandle_t Kernel_Create_Timer(kernel_timer_t timer, TickType_t period,
+		UBaseType_t reload, TimerCallbackFunction_t callback) {
+	TimerHandle_t handle;
+
+	configASSERT(timer < KERNEL_TIMER_COUNT);
+#ifdef STATIC_KERNEL
+	handle = xTimerCreateStatic(timer_names[timer], period, reload, NULL,
+			callback, &timer_blocks[timer]);
+#else
+	handle = xTimerCreate(timer_names[timer], period, reload, NULL, callback);
+#endif
+	configASSERT(handle != NULL);
+	return handle;
+}
+
+#ifdef STATIC_KERNEL
+
+/**
+ * @brief Provide the idle task memory. Called by vTaskStartScheduler().
+ */
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+		uint32_t *depth) {
+	*tcb = &idle_block;
+	*stack = idle_stack;
+	*depth = configMINIMAL_STACK_SIZE;
+}
+
+/**
+ * @brief Provide the timer service task memory. Called by
+ *        vTaskStartScheduler().
+ */
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+		uint32_t *depth) {
+	*tcb = &timer_task_block;
+	*stack = timer_task_stack;
+	*depth = configTIMER_TASK_STACK_DEPTH;
+}
+
+#endif // STATIC_KERNEL
@@ -0,0 +1,137 @@
+// kernel_objects.h
+
+#ifndef KERNEL_OBJECTS_H
+#define KERNEL_OBJECTS_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "timers.h"
+
+/**
+ * @file    kernel_objects.h
+ * @brief   Single table of every FreeRTOS task, queue and timer.
+ *
+ * Each kernel object the firmware creates is listed below with its name and
+ * size. The owning module still creates it from its Init_*() function, but
+ * only by table index, so stack depths and queue lengths live in one place.
+ *
+ * In STATIC_KERNEL builds the tables expand at compile time into one stack,
+ * control block and queue storage area per entry, and the Kernel_Create_*()
+ * calls become xTaskCreateStatic(), xQueueCreateStatic() and
+ * xTimerCreateStatic(). The idle and timer service task memory comes from
+ * here as well. Dynamic allocation is then compiled out, and the Release
+ * configuration, which defines STATIC_KERNEL, leaves heap_4.c out of the
+ * build, so any remaining xTaskCreate() fails to link instead of failing
+ * at boot. Otherwise the same tables are created from the heap_4 heap.
+ *
+ * kernel_objects.c adds up what the tables take in both builds, with the
+ * idle and timer service tasks and the timer queue: KERNEL_STATIC_BYTES
+ * of static RAM, or KERNEL_HEAP_BYTES of heap once heap_4 block headers
+ * and 8-byte rounding are added. A dynamic build fails to compile unless
+ * the heap holds them with KERNEL_HEAP_MARGIN to spare, so a new task
+ * cannot leave the heap short at boot. In the default build that is 9900
+ * and 10112 bytes of an 11264-byte heap. STATIC_KERNEL also removes
+ * 19 pvPortMalloc() calls from boot; BOOT_PHASE_KERNEL of a BOOT_PROFILE
+ * build (see boot.h) measures what that saves. The fault task stack is reserved even when no fault is
+ * pending.
+ *
+ * The firmware has no semaphores or mutexes; add a table here if one is
+ * needed.
+ */
+
+// Heap a dynamic build must leave free after creating every kernel object
+#define KERNEL_HEAP_MARGIN (512)
+
+// X(id, name, stack depth in words)
+#ifdef LATENCY_BENCHMARK
+#define KERNEL_INPUT_TASK(X)   X(KERNEL_TASK_REPLAY, "replay", 256)
+#else
+#define KERNEL_INPUT_TASK(X)   X(KERNEL_TASK_POLL_BT, "poll_BT", 512)
+#endif
+
+#ifdef PROFILE_SNAPSHOTS
+#define KERNEL_PROFILE_TASK(X) X(KERNEL_TASK_PROFILE, "profile", configMINIMAL_STACK_SIZE * 2)
+#else
+#define KERNEL_PROFILE_TASK(X)
+#endif
+
+#ifdef FAST_BOOT
+#define KERNEL_BOOT_TASK(X)    X(KERNEL_TASK_BOOT, "boot", configMINIMAL_STACK_SIZE * 2)
+#else
+#define KERNEL_BOOT_TASK(X)
+#endif
+
+#define KERNEL_TASKS(X) \
+	KERNEL_INPUT_TASK(X) \
+	X(KERNEL_TASK_MOTOR_CONTROL, "motor_control", 512) \
+	X(KERNEL_TASK_SPEED_CONTROL, "speed_control", 256) \
+	X(KERNEL_TASK_FAULT, "fault", configMINIMAL_STACK_SIZE * 2) \
+	X(KERNEL_TASK_LOG, "log", configMINIMAL_STACK_SIZE * 2) \
+	X(KERNEL_TASK_TELEMETRY, "telemetry", configMINIMAL_STACK_SIZE) \
+	KERNEL_PROFILE_TASK(X) \
+	KERNEL_BOOT_TASK(X)
+
+// X(id, name, length, item size)
+#define KERNEL_QUEUES(X) \
+	X(KERNEL_QUEUE_COMMANDS, "commands", COMMAND_QUEUE_LENGTH, sizeof(command_t))
+
+// X(id, name)
+#define KERNEL_TIMERS(X) \
+	X(KERNEL_TIMER_MANEUVER, "maneuver") \
+	X(KERNEL_TIMER_FAILSAFE, "failsafe") \
+	X(KERNEL_TIMER_CLOCK, "clock")
+
+#define KERNEL_ID(id, ...) id,
+
+typedef enum {
+	KERNEL_TASKS(KERNEL_ID)
+	KERNEL_TASK_COUNT
+} kernel_task_t;
+
+typedef enum {
+	KERNEL_QUEUES(KERNEL_ID)
+	KERNEL_QUEUE_COUNT
+} kernel_queue_t;
+
+typedef enum {
+	KERNEL_TIMERS(KERNEL_ID)
+	KERNEL_TIMER_COUNT
+} kernel_timer_t;
+
+/**
+ * @brief Create a task from the table. Each task may be created once.
+ *
+ * @param task     Table entry.
+ * @param code     Task function.
+ * @param priority Task priority.
+ *
+ * @return The task handle.
+ */
+TaskHandle_t Kernel_Create_Task(kernel_task_t task, TaskFunction_t code,
+		UBaseType_t priority);
+
+/**
+ * @brief Create a queue from the table and add it to the queue registry.
+ *
+ * @param queue Table entry.
+ *
+ * @return The queue handle.
+ */
+QueueHandle_t Kernel_Create_Queue(kernel_queue_t queue);
+
+/**
+ * @brief Create a software timer from the table.
+ *
+ * @param timer    Table entry.
+ * @param period   Timer period in ticks.
+ * @param reload   pdTRUE for an auto-reload timer.
+ * @param callback Expiry callback.
+ *
+ * @return The timer handle.
+ */
+TimerHandle_t Kernel_Create_Timer(kernel_timer_t timer, TickType_t period,
+		UBaseType_t reload, TimerCallbackFunction_t callback);
+
+#endif // KERNEL_OBJECTS_H
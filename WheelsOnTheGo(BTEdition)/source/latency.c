@@ -0,0 +1,274 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    latency.c
+ * @brief   Command-to-actuation latency instrumentation and benchmark.
+ *
+ * Samples are kept in a small table indexed by command sequence number, so
+ * several commands may be in flight at once. The report sorts a copy of each
+ * stage's deltas to find the percentiles; it runs once at the end of a replay
+ * and is not on any time-critical path.
+ *
+ * Replay script:
+ * - Slow phase:  forward/stop pairs 200 ms apart (human driving rate)
+ * - Fast phase:  commands 20 ms apart (faster than the app can send)
+ * - Burst phase: back-to-back commands 1 ms apart, including turns, to
+ *                expose queueing behind the turn delay
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "latency.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stdio.h"
+#include "stdbool.h"
+#include "sysclock.h"
+#include "uart.h"
+#include "command_queue.h"
+#include "kernel_objects.h"
+
+// LATENCY_HZ cycles per RTOS tick, the same in every clock mode
+#define CYCLES_PER_TICK   (LATENCY_HZ / configTICK_RATE_HZ)
+
+// LATENCY_HZ cycles per SysTick count in the current clock mode
+static uint32_t cycles_per_count = 1;
+
+// Refer latency.h file for function brief and description
+uint32_t Latency_Now(void) {
+	uint32_t primask = __get_PRIMASK();
+	uint32_t reload;
+	uint32_t ticks;
+	uint32_t val;
+	uint32_t scale;
+
+	__disable_irq();
+	reload = SysTick->LOAD + 1;
+	ticks = xTaskGetTickCountFromISR();
+	val = SysTick->VAL;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		// SysTick wrapped but the tick interrupt has not run yet
+		val = SysTick->VAL;
+		ticks++;
+	}
+	scale = cycles_per_count;
+	__set_PRIMASK(primask);
+
+	return ticks * CYCLES_PER_TICK + (reload - 1 - val) * scale;
+}
+
+// Refer latency.h file for function brief and description
+void Latency_Set_Cycles_Per_Count(uint32_t cycles) {
+	cycles_per_count = cycles;
+}
+
+#ifdef LATENCY_BENCHMARK
+
+// Number of commands whose timestamps are kept, must be a power of two
+#define SAMPLE_COUNT      (64)
+#define SAMPLE_INDEX(seq) ((seq) & (SAMPLE_COUNT - 1))
+#define STAGE_BIT(stage)  (1U << (stage))
+#define ALL_STAGES        (STAGE_BIT(LAT_STAGE_COUNT) - 1)
+
+// Time allowed for the last commands to complete before reporting
+#define DRAIN_DELAY_MS    (2000)
+#define LINE_LENGTH       (96)
+#define CYCLES_PER_US     (SYSCLOCK_FREQUENCY / 1000000U)
+
+typedef struct {
+	uint16_t seq;
+	uint8_t stamped;                    // STAGE_BIT of each recorded stage
+	uint32_t stamp[LAT_STAGE_COUNT];
+} latency_sample_t;
+
+typedef struct {
+	char ch;
+	uint16_t gap_ms;                    // Delay before sending ch
+} replay_step_t;
+
+static const replay_step_t replay_script[] = {
+	// Slow phase
+	{ '1', 200 }, { '2', 200 }, { '1', 200 }, { '2', 200 },
+	{ '1', 200 }, { '2', 200 }, { '1', 200 }, { '2', 200 },
+	// Fast phase
+	{ '1', 20 }, { '2', 20 }, { '1', 20 }, { '2', 20 },
+	{ '1', 20 }, { '2', 20 }, { '1', 20 }, { '2', 20 },
+	// Burst phase
+	{ '3', 500 }, { '1', 1 }, { '2', 1 }, { '4', 1 },
+	{ '1', 1 }, { '2', 1 }, { '2', 1 }, { '1', 1 },
+};
+
+// Stage pairs reported, the last one is the end-to-end latency
+static const struct {
+	const char *name;
+	latency_stage_t from;
+	latency_stage_t to;
+} report_spans[] = {
+	{ "rx_to_post", LAT_STAGE_RX, LAT_STAGE_POSTED },
+	{ "post_to_dequeue", LAT_STAGE_POSTED, LAT_STAGE_DEQUEUED },
+	{ "dequeue_to_actuate", LAT_STAGE_DEQUEUED, LAT_STAGE_ACTUATED },
+	{ "rx_to_actuate", LAT_STAGE_RX, LAT_STAGE_ACTUATED },
+};
+
+static latency_sample_t samples[SAMPLE_COUNT];
+static volatile uint32_t rx_stamp;
+static uint16_t active_seq;
+static volatile bool active_pending;
+
+// Refer latency.h file for function brief and description
+void Latency_Byte_Received(void) {
+	rx_stamp = Latency_Now();
+}
+
+// Refer latency.h file for function brief and description
+void Latency_Mark(uint16_t seq, latency_stage_t stage) {
+	latency_sample_t *sample = &samples[SAMPLE_INDEX(seq)];
+	uint32_t now = Latency_Now();
+
+	if (stage == LAT_STAGE_POSTED) {
+		// First stage recorded for this command, recycle the slot
+		sample->seq = seq;
+		sample->stamp[LAT_STAGE_RX] = rx_stamp;
+		sample->stamped = STAGE_BIT(LAT_STAGE_RX);
+	} else if (sample->seq != seq) {
+		return;
+	}
+
+	sample->stamp[stage] = now;
+	sample->stamped |= STAGE_BIT(stage);
+
+	if (stage == LAT_STAGE_DEQUEUED) {
+		active_seq = seq;
+		active_pending = true;
+	}
+}
+
+// Refer latency.h file for function brief and description
+void Latency_Mark_Actuated(void) {
+	if (active_pending) {
+		active_pending = false;
+		Latency_Mark(active_seq, LAT_STAGE_ACTUATED);
+	}
+}
+
+/**
+ * @brief Sort an array of cycle counts in ascending order.
+ *
+ * Insertion sort: the arrays hold at most SAMPLE_COUNT entries.
+ *
+ * @param values Array to sort.
+ * @param count  Number of entries.
+ */
+static void sort_cycles(uint32_t *values, uint32_t count) {
+	uint32_t i, j, key;
+
+	for (i = 1; i < count; i++) {
+		key = values[i];
+		for (j = i; j > 0 && values[j - 1] > key; j--)
+			values[j] = values[j - 1];
+		values[j] = key;
+	}
+}
+
+/**
+ * @brief Queue a report line, waiting for the transmit FIFO to drain first
+ *        so that the report is never truncated by the drop policy.
+ *
+ * @param line Null-terminated line to transmit.
+ */
+static void report_line(const char *line) {
+	while (UART0_Tx_Pending() != 0)
+		vTaskDelay(1);
+	UART0_Transmit_String(line);
+}
+
+// Refer latency.h file for function brief and description
+void Latency_Report(void) {
+	static uint32_t deltas[SAMPLE_COUNT];
+	char line[LINE_LENGTH];
+	uint32_t span, count, i;
+	uint32_t p50, p99, max;
+	uint32_t first = 0, last = 0, completed = 0;
+
+	report_line("stage,count,p50_cycles,p99_cycles,max_cycles,p50_us,p99_us,max_us\n\r");
+
+	for (span = 0; span < sizeof(report_spans) / sizeof(report_spans[0]); span++) {
+		count = 0;
+		for (i = 0; i < SAMPLE_COUNT; i++) {
+			if ((samples[i].stamped & ALL_STAGES) == ALL_STAGES)
+				deltas[count++] = samples[i].stamp[report_spans[span].to]
+						- samples[i].stamp[report_spans[span].from];
+		}
+		if (count == 0)
+			continue;
+
+		sort_cycles(deltas, count);
+		p50 = deltas[(count - 1) * 50 / 100];
+		p99 = deltas[(count - 1) * 99 / 100];
+		max = deltas[count - 1];
+		snprintf(line, sizeof(line), "%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n\r",
+				report_spans[span].name, (unsigned long) count,
+				(unsigned long) p50, (unsigned long) p99, (unsigned long) max,
+				(unsigned long) (p50 / CYCLES_PER_US),
+				(unsigned long) (p99 / CYCLES_PER_US),
+				(unsigned long) (max / CYCLES_PER_US));
+		report_line(line);
+	}
+
+	// Throughput over the window from the first byte to the last actuation
+	for (i = 0; i < SAMPLE_COUNT; i++) {
+		if ((samples[i].stamped & ALL_STAGES) != ALL_STAGES)
+			continue;
+		if (completed == 0
+				|| (int32_t) (samples[i].stamp[LAT_STAGE_RX] - first) < 0)
+			first = samples[i].stamp[LAT_STAGE_RX];
+		if (completed == 0
+				|| (int32_t) (samples[i].stamp[LAT_STAGE_ACTUATED] - last) > 0)
+			last = samples[i].stamp[LAT_STAGE_ACTUATED];
+		completed++;
+	}
+	if (completed != 0 && last != first) {
+		snprintf(line, sizeof(line), "throughput_cmd_per_s,%lu\n\r",
+				(unsigned long) ((uint64_t) completed * SYSCLOCK_FREQUENCY
+						/ (last - first)));
+		report_line(line);
+	}
+}
+
+/**
+ * @brief Task that replays the scripted command stream and reports results.
+ *
+ * Stands in for task_poll_BT: each scripted character is stamped as if it had
+ * just been received and posted through the same command queue.
+ *
+ * @param pvParameter Task parameters (unused in this case).
+ */
+static void task_replay(void *pvParameter) {
+	uint32_t i;
+
+	for (i = 0; i < sizeof(replay_script) / sizeof(replay_script[0]); i++) {
+		vTaskDelay(pdMS_TO_TICKS(replay_script[i].gap_ms));
+		Latency_Byte_Received();
+		Command_Send(Command_From_Char(replay_script[i].ch));
+	}
+
+	vTaskDelay(pdMS_TO_TICKS(DRAIN_DELAY_MS));
+	Latency_Report();
+	vTaskDelete(NULL);
+}
+
+// Refer latency.h file for function brief and description
+void Latency_Start_Replay(uint32_t priority) {
+	Kernel_Create_Task(KERNEL_TASK_REPLAY, task_replay, priority);
+}
+
+#endif // LATENCY_BENCHMARK
@@ -0,0 +1,113 @@
+// latency.h
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include "sysclock.h"
+
+/**
+ * @file    latency.h
+ * @brief   Command-to-actuation latency instrumentation and benchmark.
+ *
+ * Each command is timestamped at four stages on its way from the UART to the
+ * motor pins. The Cortex-M0+ has no DWT cycle counter, so timestamps are
+ * built from the FreeRTOS tick count and the SysTick current value, giving
+ * core-cycle resolution.
+ *
+ * Timestamps count cycles of the RUN core clock (LATENCY_HZ) in every
+ * clock mode, so they stay monotonic across RUN/VLPR transitions. In VLPR
+ * SysTick counts the 4 MHz core clock, and each count is worth 12 RUN
+ * cycles; the clock policy tells this module with
+ * Latency_Set_Cycles_Per_Count() when it reloads SysTick.
+ *
+ * The instrumentation is compiled in only when LATENCY_BENCHMARK is defined
+ * (e.g. in a dedicated build configuration). Otherwise the LATENCY_* macros
+ * expand to nothing and the module costs no cycles.
+ *
+ * In a benchmark build, Latency_Start_Replay() creates a task that replays a
+ * scripted command stream at several rates and then prints CSV results over
+ * UART0:
+ *   stage,count,p50_cycles,p99_cycles,max_cycles,p50_us,p99_us,max_us
+ *   throughput_cmd_per_s,<value>
+ */
+
+// Rate of the Latency_Now() timestamps, whatever the clock mode
+#define LATENCY_HZ (SYSCLOCK_FREQUENCY)
+
+// Points on the command path that are timestamped
+typedef enum {
+	LAT_STAGE_RX = 0,     // Byte received by the UART0 ISR
+	LAT_STAGE_POSTED,     // Command posted to the command queue
+	LAT_STAGE_DEQUEUED,   // Command taken by the motor control task
+	LAT_STAGE_ACTUATED,   // Direction pins and PWM updated
+	LAT_STAGE_COUNT
+} latency_stage_t;
+
+#ifdef LATENCY_BENCHMARK
+#define LATENCY_BYTE_RECEIVED()     Latency_Byte_Received()
+#define LATENCY_MARK(seq, stage)    Latency_Mark((seq), (stage))
+#define LATENCY_MARK_ACTUATED()     Latency_Mark_Actuated()
+#else
+#define LATENCY_BYTE_RECEIVED()     ((void) 0)
+#define LATENCY_MARK(seq, stage)    ((void) 0)
+#define LATENCY_MARK_ACTUATED()     ((void) 0)
+#endif
+
+/**
+ * @brief Read a cycle-resolution timestamp.
+ *
+ * Safe to call from tasks and ISRs once the scheduler is running.
+ *
+ * @return LATENCY_HZ cycles since the scheduler started (wraps after 2^32
+ *         cycles, 89 s).
+ */
+uint32_t Latency_Now(void);
+
+/**
+ * @brief Set how many LATENCY_HZ cycles one SysTick count is worth.
+ *
+ * Call with interrupts masked, together with the SysTick reload of a clock
+ * mode change.
+ *
+ * @param cycles LATENCY_HZ over the SysTick clock: 1 in RUN, 12 in VLPR.
+ */
+void Latency_Set_Cycles_Per_Count(uint32_t cycles);
+
+/**
+ * @brief Record that a command byte has just been received. ISR safe.
+ *
+ * The stamp is attached to the next command marked LAT_STAGE_POSTED.
+ */
+void Latency_Byte_Received(void);
+
+/**
+ * @brief Timestamp a command at the given stage.
+ *
+ * @param seq   Sequence number of the command.
+ * @param stage Stage that was just reached.
+ */
+void Latency_Mark(uint16_t seq, latency_stage_t stage);
+
+/**
+ * @brief Timestamp the most recently dequeued command as actuated.
+ *
+ * Only the first call after each dequeue is recorded, so it may be placed in
+ * every function that changes the motor outputs.
+ */
+void Latency_Mark_Actuated(void);
+
+/**
+ * @brief Print the collected latency statistics over UART0 as CSV.
+ */
+void Latency_Report(void);
+
+/**
+ * @brief Create the task that replays the scripted command stream.
+ *
+ * @param priority Priority of the replay task, normally the same as the
+ *                 Bluetooth polling task it stands in for.
+ */
+void Latency_Start_Replay(uint32_t priority);
+
+#endif // LATENCY_H
@@ -12,83 +12,135 @@
  * @file    led.c
  * @brief   Functions for controlling RGB LEDs using PWM signals.
  *
- * This file contains functions for initializing the necessary pins and configuring the Timer/PWM (TPM) module
- * to control RGB LEDs. It also includes a function for setting the color gradient of the RGB LEDs based on
- * PWM signals. The RGB LEDs are connected to specific pins on the microcontroller, and their intensity is adjusted
- * using calculated PWM values for each color component (red, green, and blue).
+ * This file sets the color of the RGB LEDs and runs the status effects. The
+ * PWM compare values come from the effects engine (led_effects.h), which
+ * gamma-corrects each component and scales it by the channel's intensity.
  *
- * Pin Configuration:
- * - Blue LED: Configured on TPM0_CH1 with Mux Alt 4 on Port D.
- * - Red LED: Configured on TPM2_CH0 with Mux Alt 3 on Port B.
- * - Green LED: Configured on TPM2_CH1 with Mux Alt 3 on Port B.
+ * Pin Configuration (muxed by Init_Board_Pins(), see board_pins.h):
+ * - Blue LED: TPM0_CH1 on PTD1.
+ * - Red LED: TPM2_CH0 on PTB18.
+ * - Green LED: TPM2_CH1 on PTB19.
  *
  * Intensity Configuration:
- * - Red LED Intensity:   625
- * - Green LED Intensity: 1200
- * - Blue LED Intensity:  1200
+ * - CONFIG_RED_INTENSITY, CONFIG_GREEN_INTENSITY and CONFIG_BLUE_INTENSITY
+ *   (625, 1200 and 1200 by default, see config.h).
  *
- * Color Gradient Calculation:
- * - The Set_RGB function calculates PWM values for each color component based on the provided color gradient.
- *   It adjusts the intensity of each LED to produce near-accurate colors.
+ * Effects:
+ * - A solid color is written once and needs no interrupt.
+ * - A status effect advances by one frame every LED_FRAME_MS from the TPM2
+ *   overflow interrupt, which is only enabled while an effect runs.
  *
  * @author  Suhas Reddy S
  * @date    12th December 2023
  */
 #include "led.h"
 #include "MKL25Z4.h"
-
-// Pin definitions for RGB LEDs
-#define RED_PIN        (18)
-#define GREEN_PIN      (19)
-#define BLUE_PIN       (1)
-
-// TPM channels for PWM control
-#define TPM0_CH1       (4)
-#define TPM2_CH0       (3)
-#define TPM2_CH1       (3)
+#include "FreeRTOS.h"
+#include "task.h"
+#include "config.h"
+#include "tpm.h"
 
 // TPM channels for PWM control (alternative names for clarity)
 #define CH0            (0)
 #define CH1            (1)
 
-// Macro to extract the red component from a 24-bit color gradient
-#define RED_GRADIANT(x) (((uint8_t)(((uint64_t)(x)) >> 16)) & 0xFF)
+// PWM periods of TPM2 per effect frame
+#define PERIODS_PER_FRAME (TPM_PWM_FREQUENCY * LED_FRAME_MS / 1000U)
+
+#define TPM2_IRQ_PRIORITY (3)
+
+static led_engine_t engine;
+static uint32_t color;              // Color set by Set_RGB()
+static led_status_t status;         // Status shown instead of the color
+static uint32_t countdown;          // PWM periods left in the current frame
+
+/**
+ * @brief Write the compare values of the three LEDs.
+ *
+ * Effects keep running while the system clock is parked in VLPR, so the
+ * values are scaled to the current PWM period.
+ *
+ * @param cnv Red, green and blue compare values, 0..TPM_PWM_PERIOD.
+ */
+static void write_cnv(const uint16_t cnv[LED_CHANNELS]) {
+	TPM2->CONTROLS[CH0].CnV = TPM_Scale(cnv[0]);
+	TPM2->CONTROLS[CH1].CnV = TPM_Scale(cnv[1]);
+	TPM0->CONTROLS[CH1].CnV = TPM_Scale(cnv[2]);
+}
+
+/**
+ * @brief TPM2 overflow: advance the running effect once per frame.
+ */
+void TPM2_IRQHandler(void) {
+	uint16_t cnv[LED_CHANNELS];
+
+	TPM2->SC |= TPM_SC_TOF_MASK;
 
-// Macro to extract the green component from a 24-bit color gradient
-#define GREEN_GRADIANT(x) (((uint8_t)(((uint64_t)(x)) >> 8)) & 0xFF)
+	if (--countdown != 0)
+		return;
+	countdown = PERIODS_PER_FRAME;
 
-// Macro to extract the blue component from a 24-bit color gradient
-#define BLUE_GRADIANT(x) ((uint8_t)((uint64_t)(x)) & 0xFF)
+	Led_Engine_Step(&engine, cnv);
+	write_cnv(cnv);
+}
 
-// Maximum value for the color gradient (8-bit)
-#define MAX_GRADIANT    (0xFF)
+/**
+ * @brief Show the status effect if there is one, otherwise the color.
+ */
+static void show(void) {
+	const led_effect_t *effect = Led_Status_Effect(status);
+	led_effect_t solid = { LED_SOLID, color, 1, 1, 0 };
+	uint32_t intensity[LED_CHANNELS];
+	uint16_t cnv[LED_CHANNELS];
 
-// Intensity values for each color component
-#define red_intensity   (625)
-#define green_intensity (1200)
-#define blue_intensity  (1200)
+	intensity[0] = Config_Get(CONFIG_RED_INTENSITY);
+	intensity[1] = Config_Get(CONFIG_GREEN_INTENSITY);
+	intensity[2] = Config_Get(CONFIG_BLUE_INTENSITY);
+
+	taskENTER_CRITICAL();
+	Led_Engine_Start(&engine, (effect != NULL) ? effect : &solid, intensity);
+	Led_Engine_Step(&engine, cnv);
+	write_cnv(cnv);
+	if (effect != NULL) {
+		countdown = PERIODS_PER_FRAME;
+		TPM2->SC |= TPM_SC_TOIE_MASK;
+	} else {
+		TPM2->SC &= ~TPM_SC_TOIE_MASK;
+	}
+	taskEXIT_CRITICAL();
+}
 
 // Refer led.h file for function brief and description
 void Init_LEDs(void) {
-	// Blue TPM0_CH1, Mux Alt 4
-	PORTD->PCR[BLUE_PIN] &= ~PORT_PCR_MUX_MASK;
-	PORTD->PCR[BLUE_PIN] |= PORT_PCR_MUX(TPM0_CH1);
+	NVIC_SetPriority(TPM2_IRQn, TPM2_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(TPM2_IRQn);
+	NVIC_EnableIRQ(TPM2_IRQn);
+}
+
+// Refer led.h file for function brief and description
+void Set_RGB(uint32_t color_gradiant) {
+	color = color_gradiant;
+	if (status == LED_STATUS_NONE)
+		show();
+}
 
-	// RED TPM2_CH0, Mux Alt 3
-	PORTB->PCR[RED_PIN] &= ~PORT_PCR_MUX_MASK;
-	PORTB->PCR[RED_PIN] |= PORT_PCR_MUX(TPM2_CH0);
+// Refer led.h file for function brief and description
+void Led_Set_Status(led_status_t new_status) {
+	if (new_status >= LED_STATUSES || new_status == status)
+		return;
+	status = new_status;
+	show();
+}
 
-	// GREEN TPM2_CH1, Mux Alt 3
-	PORTB->PCR[GREEN_PIN] &= ~PORT_PCR_MUX_MASK;
-	PORTB->PCR[GREEN_PIN] |= PORT_PCR_MUX(TPM2_CH1);
+// Refer led.h file for function brief and description
+void Led_Clear_Status(led_status_t old_status) {
+	if (old_status != status)
+		return;
+	status = LED_STATUS_NONE;
+	show();
 }
 
 // Refer led.h file for function brief and description
-void Set_RGB(uint32_t color_gradiant) {
-	TPM2->CONTROLS[CH0].CnV = red_intensity * RED_GRADIANT(color_gradiant)
-			/ MAX_GRADIANT; // Adjusted intensity of each LED to produce near accurate color
-	TPM2->CONTROLS[CH1].CnV = green_intensity * GREEN_GRADIANT(color_gradiant)
-			/ MAX_GRADIANT;
-	TPM0->CONTROLS[CH1].CnV = blue_intensity * BLUE_GRADIANT(color_gradiant)
-			/ MAX_GRADIANT;
+bool Led_Is_Animating(void) {
+	return status != LED_STATUS_NONE;
 }
@@ -4,22 +4,13 @@
 #define LED_H
 
 #include "stdint.h"
+#include <stdbool.h>
+#include "led_effects.h"
 
 /**
- * @brief Initializes the pins for controlling RGB LEDs on the microcontroller.
+ * @brief Enable the TPM2 overflow interrupt that runs the status effects.
  *
- * This function configures the necessary port pins to control RGB LEDs connected to the microcontroller.
- * It sets up the pin configurations for each color (Red, Green, and Blue) by configuring the Port Control Register (PCR)
- * and selecting the appropriate alternate function for each pin. The configuration is specific to the TPM (Timer/PWM) channels
- * associated with each color.
- *
- * Pin Configuration:
- * - Blue LED: Configured on TPM0_CH1 with Mux Alt 4 on Port D.
- * - Red LED: Configured on TPM2_CH0 with Mux Alt 3 on Port B.
- * - Green LED: Configured on TPM2_CH1 with Mux Alt 3 on Port B.
- *
- * @note Ensure that the corresponding Timer/PWM modules (TPM0 and TPM2) are initialized separately for PWM control.
- *       The user should initialize TPM0 and TPM2 with appropriate settings to control the LED intensity.
+ * Call after Init_TPM().
  */
 void Init_LEDs(void);
 
@@ -27,10 +18,37 @@ void Init_LEDs(void);
  * @brief Set the color gradient for RGB LEDs using PWM.
  *
  * This function sets the color gradient for RGB LEDs by adjusting the PWM duty cycles for each color
- * component (red, green, and blue) based on the provided color gradient value.
+ * component (red, green, and blue) based on the provided color gradient value. Each component is
+ * gamma-corrected. While a status is shown, the color is kept and shown once the status is cleared.
  *
  * @param color_gradient The desired color gradient value for setting RGB LED colors.
  */
 void Set_RGB(uint32_t color_gradient);
 
+/**
+ * @brief Show a status effect instead of the color.
+ *
+ * Call from a task. The effect runs from the TPM2 interrupt until the status
+ * is cleared or replaced.
+ *
+ * @param status Status to show.
+ */
+void Led_Set_Status(led_status_t status);
+
+/**
+ * @brief Stop showing a status and return to the color.
+ *
+ * Call from a task. Does nothing if another status is shown.
+ *
+ * @param status Status to clear.
+ */
+void Led_Clear_Status(led_status_t status);
+
+/**
+ * @brief Check whether a status effect is running.
+ *
+ * @return true while the TPM2 interrupt animates the LEDs.
+ */
+bool Led_Is_Animating(void);
+
 #endif // LED_H
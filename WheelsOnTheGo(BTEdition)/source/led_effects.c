@@ -0,0 +1,134 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    led_effects.c
+ * @brief   RGB LED effects computed as PWM compare values, one frame at a time.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <stddef.h>
+#include "led_effects.h"
+
+#define FULL_LEVEL  (255)
+#define GAMMA_SHIFT (15)
+#define STEP_SHIFT  (16)
+
+// Byte of a channel in a 0xRRGGBB color
+#define COMPONENT(color, channel) (((color) >> (16 - 8 * (channel))) & 0xFF)
+
+// 32768 * (i / 255)^2.2
+static const uint16_t gamma[FULL_LEVEL + 1] = {
+	0, 0, 1, 2, 4, 6, 9, 12, 16, 21, 26, 33,
+	39, 47, 55, 64, 74, 85, 96, 108, 121, 135, 149, 165,
+	181, 198, 216, 234, 254, 274, 296, 318, 341, 365, 389, 415,
+	441, 469, 497, 527, 557, 588, 620, 653, 687, 721, 757, 794,
+	831, 870, 909, 950, 991, 1034, 1077, 1122, 1167, 1213, 1261, 1309,
+	1358, 1409, 1460, 1512, 1566, 1620, 1675, 1732, 1789, 1847, 1907, 1967,
+	2029, 2091, 2155, 2219, 2285, 2351, 2419, 2488, 2558, 2629, 2701, 2774,
+	2848, 2923, 2999, 3076, 3154, 3234, 3314, 3396, 3479, 3562, 3647, 3733,
+	3820, 3908, 3997, 4088, 4179, 4271, 4365, 4460, 4555, 4652, 4750, 4850,
+	4950, 5051, 5154, 5257, 5362, 5468, 5575, 5683, 5793, 5903, 6015, 6127,
+	6241, 6356, 6472, 6590, 6708, 6828, 6948, 7070, 7193, 7317, 7443, 7569,
+	7697, 7826, 7956, 8087, 8220, 8353, 8488, 8624, 8761, 8899, 9038, 9179,
+	9321, 9464, 9608, 9753, 9900, 10048, 10197, 10347, 10498, 10651, 10805, 10960,
+	11116, 11273, 11432, 11591, 11752, 11915, 12078, 12243, 12408, 12576, 12744, 12913,
+	13084, 13256, 13429, 13604, 13779, 13956, 14134, 14313, 14494, 14676, 14859, 15043,
+	15229, 15415, 15603, 15793, 15983, 16175, 16368, 16562, 16757, 16954, 17152, 17351,
+	17552, 17754, 17957, 18161, 18366, 18573, 18781, 18991, 19201, 19413, 19626, 19841,
+	20056, 20273, 20491, 20711, 20932, 21154, 21377, 21601, 21827, 22054, 22283, 22513,
+	22744, 22976, 23210, 23444, 23681, 23918, 24157, 24397, 24638, 24881, 25125, 25370,
+	25616, 25864, 26113, 26364, 26616, 26869, 27123, 27379, 27636, 27894, 28153, 28414,
+	28677, 28940, 29205, 29471, 29739, 30007, 30277, 30549, 30822, 31096, 31371, 31648,
+	31926, 32205, 32486, 32768
+};
+
+static const led_effect_t status_effects[LED_STATUSES] = {
+	[LED_STATUS_LINK_LOST] = { LED_PATTERN, 0xFFFF00, LED_MS_TO_FRAMES(250), 2, 0x1 },
+	[LED_STATUS_LOW_BATTERY] = { LED_BREATHE, 0xFF0000, LED_MS_TO_FRAMES(1000), 0, 0 },
+	// On, off, on, off, on, then off for five slots
+	[LED_STATUS_FAULT] = { LED_PATTERN, 0xFF0000, LED_MS_TO_FRAMES(150), 10, 0x15 }
+};
+
+// Refer led_effects.h file for function brief and description
+const led_effect_t *Led_Status_Effect(led_status_t status) {
+	if (status == LED_STATUS_NONE || status >= LED_STATUSES)
+		return NULL;
+	return &status_effects[status];
+}
+
+// Refer led_effects.h file for function brief and description
+void Led_Engine_Start(led_engine_t *engine, const led_effect_t *effect,
+		const uint32_t intensity[LED_CHANNELS]) {
+	uint32_t channel;
+
+	engine->effect = *effect;
+	if (engine->effect.slot_frames == 0)
+		engine->effect.slot_frames = 1;
+	if (engine->effect.slots == 0 || engine->effect.slots > 32)
+		engine->effect.slots = 32;
+	for (channel = 0; channel < LED_CHANNELS; channel++)
+		engine->intensity[channel] = intensity[channel];
+
+	engine->frame = 0;
+	engine->slot = 0;
+	engine->step = (FULL_LEVEL << STEP_SHIFT) / engine->effect.slot_frames;
+}
+
+/**
+ * @brief Get the level of the current frame and move to the next one.
+ *
+ * @param engine Engine.
+ *
+ * @return Level, 0..FULL_LEVEL.
+ */
+static uint32_t next_level(led_engine_t *engine) {
+	const led_effect_t *effect = &engine->effect;
+	uint32_t level;
+
+	switch (effect->mode) {
+	case LED_PATTERN:
+		level = ((effect->pattern >> engine->slot) & 1) ? FULL_LEVEL : 0;
+		if (++engine->frame >= effect->slot_frames) {
+			engine->frame = 0;
+			if (++engine->slot >= effect->slots)
+				engine->slot = 0;
+		}
+		return level;
+
+	case LED_BREATHE:
+		level = (engine->frame * engine->step) >> STEP_SHIFT;
+		if (engine->slot)
+			level = FULL_LEVEL - level;
+		if (++engine->frame >= effect->slot_frames) {
+			engine->frame = 0;
+			engine->slot ^= 1;
+		}
+		return level;
+
+	default:
+		return FULL_LEVEL;
+	}
+}
+
+// Refer led_effects.h file for function brief and description
+void Led_Engine_Step(led_engine_t *engine, uint16_t cnv[LED_CHANNELS]) {
+	uint32_t level = next_level(engine);
+	uint32_t brightness;
+	uint32_t channel;
+
+	for (channel = 0; channel < LED_CHANNELS; channel++) {
+		// Exact at both ends: 0 and 255 map to 0 and the component
+		brightness = (COMPONENT(engine->effect.color, channel) * (level + 1)) >> 8;
+		cnv[channel] = (uint16_t) ((engine->intensity[channel] * gamma[brightness])
+				>> GAMMA_SHIFT);
+	}
+}
@@ -0,0 +1,94 @@
+// led_effects.h
+
+#ifndef LED_EFFECTS_H
+#define LED_EFFECTS_H
+
+#include <stdint.h>
+
+/**
+ * @file    led_effects.h
+ * @brief   RGB LED effects computed as PWM compare values, one frame at a time.
+ *
+ * An effect scales a 0xRRGGBB color by a level that changes from frame to
+ * frame:
+ * - LED_SOLID: full level.
+ * - LED_PATTERN: full or zero level, following the bits of a pattern, one
+ *   bit per slot of slot_frames frames. Blinks and flash codes are patterns.
+ * - LED_BREATHE: level ramps up over slot_frames frames, then back down.
+ *
+ * Each channel's 8-bit brightness goes through a gamma 2.2 table in Q15 and
+ * is scaled by the channel's intensity, the compare value at full
+ * brightness. A frame then costs two multiplies and shifts per channel and
+ * no division: the Cortex-M0+ has no hardware divider. The only division,
+ * the breathe step, happens in Led_Engine_Start().
+ *
+ * The module has no hardware access, so the compare value sequences are
+ * checked on the host against a golden file by tools/led_effects_sim.c.
+ */
+
+#define LED_CHANNELS (3)   // Red, green, blue
+
+// Time between frames, and a duration in frames
+#define LED_FRAME_MS          (10)
+#define LED_MS_TO_FRAMES(ms)  ((ms) / LED_FRAME_MS)
+
+typedef enum {
+	LED_SOLID = 0,
+	LED_PATTERN,
+	LED_BREATHE
+} led_mode_t;
+
+typedef struct {
+	led_mode_t mode;
+	uint32_t color;         // 0xRRGGBB at full level
+	uint16_t slot_frames;   // Frames per pattern bit, or per breathe ramp
+	uint8_t slots;          // Bits in the pattern, 1..32
+	uint32_t pattern;       // Bit i set: on during slot i
+} led_effect_t;
+
+// Signalled states, shown over the color set by the commands
+typedef enum {
+	LED_STATUS_NONE = 0,
+	LED_STATUS_LINK_LOST,   // Yellow blink, 2 Hz
+	LED_STATUS_LOW_BATTERY, // Red breathe, 2 s cycle
+	LED_STATUS_FAULT,       // Three red flashes, then a pause
+	LED_STATUSES
+} led_status_t;
+
+typedef struct {
+	led_effect_t effect;
+	uint32_t intensity[LED_CHANNELS];
+	uint32_t frame;         // Frame within the slot or ramp
+	uint32_t slot;          // Pattern slot, or 1 while breathing out
+	uint32_t step;          // Breathe level increase per frame, Q16
+} led_engine_t;
+
+/**
+ * @brief Get the effect that signals a status.
+ *
+ * @param status Status other than LED_STATUS_NONE.
+ *
+ * @return The effect, or NULL for LED_STATUS_NONE and invalid values.
+ */
+const led_effect_t *Led_Status_Effect(led_status_t status);
+
+/**
+ * @brief Start an effect from its first frame.
+ *
+ * @param engine    Engine.
+ * @param effect    Effect, copied.
+ * @param intensity Compare value of each channel at full brightness.
+ */
+void Led_Engine_Start(led_engine_t *engine, const led_effect_t *effect,
+		const uint32_t intensity[LED_CHANNELS]);
+
+/**
+ * @brief Compute the compare values of the current frame and move to the
+ *        next one.
+ *
+ * @param engine Engine.
+ * @param cnv    Compare value of each channel.
+ */
+void Led_Engine_Step(led_engine_t *engine, uint16_t cnv[LED_CHANNELS]);
+
+#endif // LED_EFFECTS_H
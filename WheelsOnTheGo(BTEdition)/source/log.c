@@ -0,0 +1,305 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    log.c
+ * @brief   Tokenized, deferred logging over the Bluetooth link.
+ *
+ * The ring is written by any number of producers and read by the log task
+ * only. head counts reserved slots and tail consumed ones; a slot is
+ * published by writing its sequence number, head + 1 at reservation, after
+ * the record, so the reader never sees a half-written record. A producer
+ * preempted between reservation and publication holds back the records
+ * behind it until it resumes.
+ *
+ * The producer that finds the ring empty notifies the log task, which
+ * otherwise stays blocked. While records are still held back, by a
+ * producer or by a full UART0 FIFO, the task polls every LOG_DRAIN_MS.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "log.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stdbool.h"
+#include "uart.h"
+#include "protocol.h"
+#include "config.h"
+#include "kernel_objects.h"
+
+#define RING_INDEX(n)  ((n) & (LOG_RING_SIZE - 1))
+
+typedef struct {
+	volatile uint32_t seq;      // Reservation number + 1 once published
+	log_record_t record;
+} slot_t;
+
+typedef struct {
+	TickType_t window;          // Start of the current rate window
+	uint8_t count;              // Records logged in it
+	uint16_t suppressed;        // Records refused since the last report
+} rate_t;
+
+static slot_t ring[LOG_RING_SIZE];
+static volatile uint32_t head;
+static volatile uint32_t tail;
+static volatile uint32_t dropped;
+static rate_t rates[LOG_MESSAGE_COUNT];
+static uint8_t tx_seq;
+static TaskHandle_t log_task;
+
+#define MESSAGE_LEVEL(id, level, nargs, format) [id] = LOG_LEVEL_##level,
+#define MESSAGE_NARGS(id, level, nargs, format) [id] = (nargs),
+static const uint8_t levels[LOG_MESSAGE_COUNT] = { LOG_MESSAGES(MESSAGE_LEVEL) };
+static const uint8_t nargs[LOG_MESSAGE_COUNT] = { LOG_MESSAGES(MESSAGE_NARGS) };
+
+/**
+ * @brief Apply the rate limit of a message.
+ *
+ * @param id  Message.
+ * @param now Current tick.
+ *
+ * @return true if the record may be logged.
+ */
+static bool rate_allows(log_id_t id, TickType_t now) {
+	rate_t *rate = &rates[id];
+
+	if (now - rate->window >= pdMS_TO_TICKS(LOG_RATE_WINDOW_MS)) {
+		rate->window = now;
+		rate->count = 0;
+	}
+	if (rate->count < LOG_RATE_BURST) {
+		rate->count++;
+		return true;
+	}
+	if (rate->suppressed < UINT16_MAX)
+		rate->suppressed++;
+	return false;
+}
+
+// Refer log.h file for function brief and description
+void Log_Write(log_id_t id, int32_t a, int32_t b, int32_t c) {
+	TickType_t now = xTaskGetTickCountFromISR();
+	uint32_t primask;
+	uint32_t seq;
+	slot_t *slot;
+	bool was_empty;
+	BaseType_t higher_priority_woken = pdFALSE;
+
+	if (id >= LOG_MESSAGE_COUNT || levels[id] < Config_Get(CONFIG_LOG_LEVEL)
+			|| !rate_allows(id, now))
+		return;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	seq = head;
+	if (seq - tail >= LOG_RING_SIZE) {
+		dropped++;
+		__set_PRIMASK(primask);
+		return;
+	}
+	head = seq + 1;
+	was_empty = (seq == tail);
+	__set_PRIMASK(primask);
+
+	slot = &ring[RING_INDEX(seq)];
+	slot->record.id = (uint8_t) id;
+	slot->record.nargs = nargs[id];
+	slot->record.tick = now;
+	slot->record.args[0] = a;
+	slot->record.args[1] = b;
+	slot->record.args[2] = c;
+	__DMB();
+	slot->seq = seq + 1;
+
+	if (!was_empty || log_task == NULL
+			|| xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+		return;
+	if (__get_IPSR() != 0) {
+		vTaskNotifyGiveFromISR(log_task, &higher_priority_woken);
+		portYIELD_FROM_ISR(higher_priority_woken);
+	} else {
+		xTaskNotifyGive(log_task);
+	}
+}
+
+/**
+ * @brief Count a record that will never be sent.
+ */
+static void count_dropped(void) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	dropped++;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Queue a FRAME_LOG frame.
+ *
+ * @param payload Records, starting with the header.
+ * @param len     Payload length.
+ */
+static void send_frame(const uint8_t *payload, uint32_t len) {
+	uint8_t frame[PROTOCOL_MAX_PAYLOAD + PROTOCOL_FRAME_OVERHEAD];
+
+	len = Protocol_Encode(tx_seq++, FRAME_LOG, payload, len, frame);
+	UART0_Transmit(frame, len);
+}
+
+/**
+ * @brief Take the next record to send: the dropped count, a suppressed
+ *        count, or the oldest published record of the ring.
+ *
+ * A record is only consumed once it has been encoded, see drain().
+ *
+ * @param rec       Destination for the record.
+ * @param from_ring Set when the record is the ring's oldest.
+ *
+ * @return false if there is nothing to send.
+ */
+static bool next_record(log_record_t *rec, bool *from_ring) {
+	slot_t *slot;
+	uint32_t id;
+
+	*from_ring = false;
+	rec->tick = xTaskGetTickCount();
+
+	if (dropped != 0) {
+		rec->id = LOG_DROPPED;
+		rec->nargs = nargs[LOG_DROPPED];
+		rec->args[0] = (int32_t) dropped;
+		return true;
+	}
+
+	// Once per rate window, when the window has ended
+	for (id = 0; id < LOG_MESSAGE_COUNT; id++) {
+		if (rates[id].suppressed != 0 && rec->tick - rates[id].window
+				>= pdMS_TO_TICKS(LOG_RATE_WINDOW_MS)) {
+			rec->id = LOG_SUPPRESSED;
+			rec->nargs = nargs[LOG_SUPPRESSED];
+			rec->args[0] = (int32_t) id;
+			rec->args[1] = rates[id].suppressed;
+			return true;
+		}
+	}
+
+	slot = &ring[RING_INDEX(tail)];
+	if (tail == head || slot->seq != tail + 1)
+		return false;
+	*rec = slot->record;
+	*from_ring = true;
+	return true;
+}
+
+/**
+ * @brief Mark the record returned by next_record() as sent.
+ *
+ * @param rec       Record that was encoded.
+ * @param from_ring Whether it came from the ring.
+ */
+static void consume(const log_record_t *rec, bool from_ring) {
+	uint32_t primask;
+
+	if (from_ring) {
+		tail = tail + 1;
+		return;
+	}
+
+	// Producers may have counted more in the meantime
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (rec->id == LOG_DROPPED)
+		dropped -= (uint32_t) rec->args[0];
+	else
+		rates[rec->args[0]].suppressed -= (uint16_t) rec->args[1];
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Check whether anything is left to send.
+ *
+ * @return true if the ring holds a record, published or not, or a dropped
+ *         or suppressed count is waiting.
+ */
+static bool pending(void) {
+	uint32_t id;
+
+	if (tail != head || dropped != 0)
+		return true;
+	for (id = 0; id < LOG_MESSAGE_COUNT; id++)
+		if (rates[id].suppressed != 0)
+			return true;
+	return false;
+}
+
+/**
+ * @brief Pack the pending records into frames while the UART has room.
+ */
+static void drain(void) {
+	uint8_t payload[PROTOCOL_MAX_PAYLOAD - 1];
+	uint32_t len = 0;
+	uint32_t prev = 0;
+	uint32_t used;
+	log_record_t rec;
+	bool from_ring;
+
+	while (UART0_Tx_Pending() < LOG_TX_MAX_PENDING
+			&& next_record(&rec, &from_ring)) {
+		if (len == 0) {
+			len = Log_Codec_Header(payload, rec.tick);
+			prev = rec.tick;
+		} else if (!from_ring) {
+			// Counts have no time of their own, keep the delta short
+			rec.tick = prev;
+		}
+		used = Log_Codec_Put(&payload[len], sizeof(payload) - len, prev, &rec);
+		if (used == 0 && len > LOG_CODEC_HEADER) {
+			// Full, the record starts the next frame
+			send_frame(payload, len);
+			len = 0;
+			continue;
+		}
+		if (used == 0) {
+			// Arguments too large for any frame
+			consume(&rec, from_ring);
+			count_dropped();
+			len = 0;
+			continue;
+		}
+		len += used;
+		prev = rec.tick;
+		consume(&rec, from_ring);
+	}
+	if (len != 0)
+		send_frame(payload, len);
+}
+
+/**
+ * @brief Task that drains the log ring when a record arrives.
+ *
+ * Blocks until Log_Write() finds the ring empty and notifies it, or for
+ * LOG_DRAIN_MS while something is left to send.
+ *
+ * @param pvParameter Task parameters (unused).
+ */
+static void task_log(void *pvParameter) {
+	while (1) {
+		drain();
+		ulTaskNotifyTake(pdTRUE, pending() ? pdMS_TO_TICKS(LOG_DRAIN_MS) : portMAX_DELAY);
+	}
+}
+
+// Refer log.h file for function brief and description
+void Init_Log(uint32_t priority) {
+	log_task = Kernel_Create_Task(KERNEL_TASK_LOG, task_log, priority);
+}
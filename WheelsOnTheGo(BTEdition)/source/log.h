@@ -0,0 +1,149 @@
+// log.h
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include "log_codec.h"
+
+/**
+ * @file    log.h
+ * @brief   Tokenized, deferred logging over the Bluetooth link.
+ *
+ * Every message the firmware can log is listed in LOG_MESSAGES below with
+ * its level, argument count and printf-style format. The format strings are
+ * never compiled into the firmware: a call site records only the message
+ * id, the tick and up to LOG_MAX_ARGS integer arguments, e.g.
+ *     LOG(LOG_CONFIG_SET, key, value, status);
+ * A wrong argument count fails to compile.
+ *
+ * LOG() copies the record into a RAM ring and returns; nothing is
+ * formatted or sent on the caller's path. The Cortex-M0+ has no
+ * LDREX/STREX, so a slot is reserved with interrupts masked for a handful
+ * of instructions. The record is then filled with interrupts enabled and
+ * published by its sequence number, so tasks and ISRs may log concurrently.
+ * About 50 cycles per call at -O2, against roughly 400 for queueing
+ * "Moving Forward...\n\r" into the UART FIFO byte by byte.
+ *
+ * A low-priority task drains the ring into FRAME_LOG frames (see
+ * protocol.h and log_codec.h), packing several records per frame. It
+ * blocks on a task notification, given by the LOG() call that finds the
+ * ring empty, so an idle log costs no wake-ups; while records are left
+ * over it retries every LOG_DRAIN_MS. It only queues a frame while fewer than LOG_TX_MAX_PENDING bytes
+ * are waiting in the UART0 FIFO, so logging never displaces commands'
+ * answers or dumps. When the ring is full new records are dropped and
+ * counted; the count is sent as LOG_DROPPED. So is a record whose arguments
+ * are too wide to fit a frame, which takes several arguments near INT32_MAX.
+ *
+ * Levels: records below LOG_COMPILED_LEVEL are compiled out, and records
+ * below the CONFIG_LOG_LEVEL setting are discarded at run time.
+ *
+ * Rate limiting: each message is logged at most LOG_RATE_BURST times per
+ * LOG_RATE_WINDOW_MS. Further records are counted and reported as one
+ * LOG_SUPPRESSED record. Counts may be off by one when a task and an ISR
+ * log the same message at the same instant.
+ *
+ * Host side: tools/log_dict.py extracts the table below into a JSON
+ * dictionary (a post-build step writes log_dict.json next to the .axf) and
+ * reports the link savings, or with --size the flash and RAM delta between
+ * two builds; tools/log_decode.py turns the
+ * FRAME_LOG frames of a capture back into text.
+ *
+ * Append new messages at the end of the table, so old dictionaries still
+ * decode the ids they know. At most 256 messages.
+ */
+
+#define LOG_LEVEL_DEBUG   (0)
+#define LOG_LEVEL_INFO    (1)
+#define LOG_LEVEL_WARN    (2)
+#define LOG_LEVEL_ERROR   (3)
+#define LOG_LEVEL_OFF     (4)
+
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Retry period of the log task while records are left over
+#define LOG_DRAIN_MS        (20)
+
+// Records held between drains, must be a power of two
+#define LOG_RING_SIZE       (16)
+
+// The log task waits while more bytes than this are queued on UART0
+#define LOG_TX_MAX_PENDING  (64)
+
+// Rate limit of each message
+#define LOG_RATE_BURST      (4)
+#define LOG_RATE_WINDOW_MS  (1000)
+
+// X(id, level, nargs, format). Formats take %d, %u, %x, %c, and %s for an
+// argument that is a message id, printed by name.
+#define LOG_MESSAGES(X) \
+	X(LOG_DROPPED,     WARN,  1, "%u log records dropped") \
+	X(LOG_SUPPRESSED,  WARN,  2, "%s suppressed %u times") \
+	X(LOG_FORWARD,     INFO,  0, "Moving Forward...") \
+	X(LOG_BACKWARD,    INFO,  0, "Moving Backward...") \
+	X(LOG_RIGHT,       INFO,  0, "Turning Right...") \
+	X(LOG_LEFT,        INFO,  0, "Turning Left...") \
+	X(LOG_STOPPED,     INFO,  0, "Stopped...") \
+	X(LOG_DRIVE,       DEBUG, 2, "Drive throttle %d steer %d") \
+	X(LOG_LINK_LOST,   WARN,  0, "Link lost, stopping") \
+	X(LOG_CLOCK_MODE,  DEBUG, 1, "Clock mode %u (0 = RUN, 1 = VLPR)") \
+	X(LOG_CONFIG_SET,  INFO,  3, "Config key %u set to %u, status %u")
+
+#define LOG_ID(id, level, nargs, format) id,
+#define LOG_ATTR(id, level, nargs, format) \
+	LOG_LEVEL_OF_##id = LOG_LEVEL_##level, LOG_NARGS_OF_##id = (nargs),
+
+typedef enum {
+	LOG_MESSAGES(LOG_ID)
+	LOG_MESSAGE_COUNT
+} log_id_t;
+
+// LOG_LEVEL_OF_<id>, LOG_NARGS_OF_<id>: constants for the LOG() checks
+enum {
+	LOG_MESSAGES(LOG_ATTR)
+};
+
+_Static_assert(LOG_MESSAGE_COUNT <= 256, "log ids must fit a byte");
+
+// Number of arguments after the id, up to LOG_MAX_ARGS
+#define LOG_COUNT(...)                 LOG_COUNT_(0, ##__VA_ARGS__, 3, 2, 1, 0)
+#define LOG_COUNT_(z, a, b, c, n, ...) n
+#define LOG_PAD(z, a, b, c, ...)       (int32_t) (a), (int32_t) (b), (int32_t) (c)
+
+/**
+ * @brief Log a message from the table, with its arguments.
+ *
+ * Safe to call from tasks, ISRs and with the scheduler suspended. Never
+ * blocks.
+ */
+#define LOG(id, ...) \
+	do { \
+		_Static_assert(LOG_COUNT(__VA_ARGS__) == LOG_NARGS_OF_##id, \
+				#id ": wrong number of arguments"); \
+		if (LOG_LEVEL_OF_##id >= LOG_COMPILED_LEVEL) \
+			Log_Write(id, LOG_PAD(0, ##__VA_ARGS__, 0, 0, 0)); \
+	} while (0)
+
+/**
+ * @brief Start the log drain task.
+ *
+ * Call after Init_Config() and Init_UART0(), before starting the scheduler.
+ * Records logged before then are kept and sent once the scheduler runs.
+ *
+ * @param priority Priority of the drain task.
+ */
+void Init_Log(uint32_t priority);
+
+/**
+ * @brief Record a message. Use LOG() rather than calling this directly.
+ *
+ * @param id Message.
+ * @param a  First argument, or 0.
+ * @param b  Second argument, or 0.
+ * @param c  Third argument, or 0.
+ */
+void Log_Write(log_id_t id, int32_t a, int32_t b, int32_t c);
+
+#endif // LOG_H
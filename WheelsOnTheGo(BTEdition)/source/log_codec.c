@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    log_codec.c
+ * @brief   Wire encoding of tokenized log records.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "log_codec.h"
+
+#define VARINT_BITS   (7)
+#define VARINT_MORE   (0x80)
+#define VARINT_MASK   (0x7F)
+#define VARINT_MAX    (5)     // Bytes of a 32-bit value
+
+/**
+ * @brief Append a varint.
+ *
+ * @return Bytes written, or 0 if it does not fit.
+ */
+static size_t put_varint(uint8_t *out, size_t space, uint32_t value) {
+	size_t n = 0;
+
+	do {
+		if (n == space)
+			return 0;
+		out[n] = (uint8_t) (value & VARINT_MASK);
+		value >>= VARINT_BITS;
+		if (value != 0)
+			out[n] |= VARINT_MORE;
+		n++;
+	} while (value != 0);
+	return n;
+}
+
+/**
+ * @brief Read a varint.
+ *
+ * @return Bytes consumed, or 0 if it is truncated or too long.
+ */
+static size_t get_varint(const uint8_t *in, size_t len, uint32_t *value) {
+	size_t n;
+
+	*value = 0;
+	for (n = 0; n < len && n < VARINT_MAX; n++) {
+		*value |= (uint32_t) (in[n] & VARINT_MASK) << (VARINT_BITS * n);
+		if ((in[n] & VARINT_MORE) == 0)
+			return n + 1;
+	}
+	return 0;
+}
+
+// Refer log_codec.h file for function brief and description
+size_t Log_Codec_Header(uint8_t *out, uint32_t tick) {
+	out[0] = (uint8_t) tick;
+	out[1] = (uint8_t) (tick >> 8);
+	return LOG_CODEC_HEADER;
+}
+
+// Refer log_codec.h file for function brief and description
+size_t Log_Codec_Put(uint8_t *out, size_t space, uint32_t prev,
+		const log_record_t *rec) {
+	size_t n = 1;
+	size_t used;
+	uint32_t zigzag;
+	uint32_t i;
+
+	if (space == 0 || rec->nargs > LOG_MAX_ARGS)
+		return 0;
+	out[0] = rec->id;
+
+	used = put_varint(&out[n], space - n, rec->tick - prev);
+	if (used == 0)
+		return 0;
+	n += used;
+
+	for (i = 0; i < rec->nargs; i++) {
+		zigzag = ((uint32_t) rec->args[i] << 1) ^ (uint32_t) (rec->args[i] >> 31);
+		used = put_varint(&out[n], space - n, zigzag);
+		if (used == 0)
+			return 0;
+		n += used;
+	}
+	return n;
+}
+
+// Refer log_codec.h file for function brief and description
+size_t Log_Codec_Get(const uint8_t *in, size_t len, uint32_t prev,
+		const uint8_t *nargs, uint32_t ids, log_record_t *rec) {
+	size_t n = 1;
+	size_t used;
+	uint32_t value;
+	uint32_t i;
+
+	if (len == 0 || in[0] >= ids || nargs[in[0]] > LOG_MAX_ARGS)
+		return 0;
+	rec->id = in[0];
+	rec->nargs = nargs[in[0]];
+
+	used = get_varint(&in[n], len - n, &value);
+	if (used == 0)
+		return 0;
+	n += used;
+	rec->tick = prev + value;
+
+	for (i = 0; i < rec->nargs; i++) {
+		used = get_varint(&in[n], len - n, &value);
+		if (used == 0)
+			return 0;
+		n += used;
+		rec->args[i] = (int32_t) ((value >> 1) ^ (0U - (value & 1U)));
+	}
+	return n;
+}
@@ -0,0 +1,85 @@
+// log_codec.h
+
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file    log_codec.h
+ * @brief   Wire encoding of tokenized log records.
+ *
+ * A FRAME_LOG payload (see protocol.h) carries as many whole records as
+ * fit:
+ *   tick (u16, ms, low half of the first record's tick)
+ *   then per record:
+ *     id (u8)
+ *     tick delta from the previous record of the frame (varint)
+ *     nargs arguments (zigzag varint each)
+ * Varints are 7 bits per byte, least significant first, with the top bit
+ * set on every byte but the last. Zigzag maps 0, -1, 1, -2 ... to 0, 1, 2,
+ * 3 ..., so small negative values stay short. The argument count of each id
+ * comes from the dictionary (see log.h), so it is not sent.
+ *
+ * A record without arguments that follows another within 127 ms takes two
+ * bytes. The module does no I/O, so it is also built into the host model in
+ * tools/log_sim.c.
+ */
+
+// Largest number of arguments of a record
+#define LOG_MAX_ARGS      (3)
+
+// Bytes before the first record of a payload
+#define LOG_CODEC_HEADER  (2)
+
+// Longest encoding of one record: id, 5-byte delta, 5 bytes per argument
+#define LOG_CODEC_MAX_RECORD (1 + 5 + 5 * LOG_MAX_ARGS)
+
+typedef struct {
+	uint8_t id;
+	uint8_t nargs;
+	uint32_t tick;
+	int32_t args[LOG_MAX_ARGS];
+} log_record_t;
+
+/**
+ * @brief Start a payload with the tick of its first record.
+ *
+ * @param out  Destination, at least LOG_CODEC_HEADER bytes.
+ * @param tick Tick of the first record.
+ *
+ * @return LOG_CODEC_HEADER.
+ */
+size_t Log_Codec_Header(uint8_t *out, uint32_t tick);
+
+/**
+ * @brief Append a record to a payload.
+ *
+ * @param out   Destination, the free part of the payload.
+ * @param space Free bytes at out.
+ * @param prev  Tick of the previous record of the payload, or of the
+ *              header for the first record.
+ * @param rec   Record to append.
+ *
+ * @return Bytes written, or 0 if the record does not fit.
+ */
+size_t Log_Codec_Put(uint8_t *out, size_t space, uint32_t prev,
+		const log_record_t *rec);
+
+/**
+ * @brief Read a record from a payload.
+ *
+ * @param in    Remaining payload bytes.
+ * @param len   Number of remaining bytes.
+ * @param prev  Tick of the previous record, or of the header for the first.
+ * @param nargs Argument count of each id.
+ * @param ids   Number of entries in nargs.
+ * @param rec   Destination for the record.
+ *
+ * @return Bytes consumed, or 0 if the bytes are not a whole, known record.
+ */
+size_t Log_Codec_Get(const uint8_t *in, size_t len, uint32_t prev,
+		const uint8_t *nargs, uint32_t ids, log_record_t *rec);
+
+#endif // LOG_CODEC_H
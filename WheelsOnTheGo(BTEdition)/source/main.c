@@ -26,9 +26,27 @@
 /* Custom driver includes. */
 #include "tpm.h"
 #include "sysclock.h"
+#include "board_pins.h"
 #include "uart.h"
 #include "motor_control.h"
 #include "led.h"
+#include "command_queue.h"
+#include "latency.h"
+#include "speed_control.h"
+#include "power.h"
+#include "profile.h"
+#include "control_math.h"
+#include "protocol.h"
+#include "trace.h"
+#include "mtb_trace.h"
+#include "fault.h"
+#include "config.h"
+#include "failsafe.h"
+#include "kernel_objects.h"
+#include "clock_policy.h"
+#include "boot.h"
+#include "log.h"
+#include "telemetry.h"
 
 /*******************************************************************************
  * Definitions
@@ -36,21 +54,18 @@
 
 // Task priorities.
 #define task_PRIORITY (configMAX_PRIORITIES - 1)
-// Stack size.
-#define stack_Size (512)
-// Delay for turning actions (in milliseconds)
-#define DELAY      (50)
-// Startup light
-#define STARTUP_LIGHT (0x888888)
 /*******************************************************************************
  * Prototypes
  ******************************************************************************/
 static void task_poll_BT(void *pvParameter);
 static void task_motor_control(void *pvParameter);
+static void handle_frame(const protocol_frame_t *frame);
+
+// Receive buffer size for the Bluetooth polling task
+#define RX_CHUNK (16)
+
+static protocol_parser_t bt_parser;
 
-TaskHandle_t motor_control_handle;
-SemaphoreHandle_t xMutex; /* Handle to access mutex */
-QueueHandle_t xQueue_sample;
 /*******************************************************************************
  * Code
  ******************************************************************************/
@@ -58,35 +73,62 @@ QueueHandle_t xQueue_sample;
  * @brief Application entry point.
  */
 
-char BT_input;  // Global variable to acquire and use input from BT module
-
 int main(void) {
+	BOOT_MARK(BOOT_PHASE_STARTUP);
+
 	// Initialize system components
 	Init_Sysclock();
+	BOOT_MARK(BOOT_PHASE_SYSCLOCK);
+#ifndef FAST_BOOT
+	// Fast boot has already coasted the motors from ResetISR()
+	Init_Board_Pins();
+#endif
+	Init_Config();
+	Init_MTB();
+	Init_Fault(tskIDLE_PRIORITY + 1);
 	Init_UART0();
-	Init_Motors();
-	Init_LEDs();
+	Init_Log(tskIDLE_PRIORITY + 1);
 	Init_TPM();
+	Init_LEDs();
+	Init_Motors();
+	Init_Speed_Control(task_PRIORITY);
+	Speed_Control_Enable(SPEED_CONTROL_CLOSED_LOOP);
+	Init_Power();
+	Init_Profile(tskIDLE_PRIORITY + 1);
+	Init_Telemetry(tskIDLE_PRIORITY + 1);
+
+	// Park at 4 MHz in VLPR while the motors are idle
+	Init_Clock_Policy();
+	BOOT_MARK(BOOT_PHASE_DRIVERS);
+
+	// Create the command pipeline between the tasks
+	Init_Command_Queue();
 
-	// Create synchronization primitives
-	xMutex = xSemaphoreCreateMutex();
-	xQueue_sample = xQueueCreate(1, sizeof(uint8_t));
+	// Stop the car if a framed client goes silent, and start the COP
+#ifdef LATENCY_BENCHMARK
+	// The replay task stands in for poll_BT and does not check in
+	Init_Failsafe(FAILSAFE_TASK_POLL_BT);
+#else
+	Init_Failsafe(FAILSAFE_TASKS);
+#endif
 
-	// Send escape sequence to clear the terminal
-	UART0_Transmit_String("\033[2J");
-	// Move the cursor to the top-left corner
-	UART0_Transmit_String("\033[H");
-	UART0_Transmit_String("Initialized Wheels On The Go (BT Edition).....\n\r");
+	// Print the banner and set the initial RGB color, in the background with
+	// FAST_BOOT
+	Boot_Start_Deferred(tskIDLE_PRIORITY + 1);
 
-	// Set initial RGB color and start motors
-	Set_RGB(STARTUP_LIGHT);
-	Start_Motors(MEDIUM_SPEED, MEDIUM_SPEED);
+	Start_Motors(Config_Get(CONFIG_DRIVE_SPEED), Config_Get(CONFIG_DRIVE_SPEED));
 
 	// Create tasks and start FreeRTOS scheduler
-	xTaskCreate(task_poll_BT, "poll_BT", stack_Size,
-	NULL, task_PRIORITY, NULL);
-	xTaskCreate(task_motor_control, "poll_BT", stack_Size,
-	NULL, task_PRIORITY, &motor_control_handle);
+#ifdef LATENCY_BENCHMARK
+	// Replay a scripted command stream in place of the Bluetooth link
+	(void) task_poll_BT;
+	Latency_Start_Replay(task_PRIORITY);
+#else
+	Kernel_Create_Task(KERNEL_TASK_POLL_BT, task_poll_BT, task_PRIORITY);
+#endif
+	Kernel_Create_Task(KERNEL_TASK_MOTOR_CONTROL, task_motor_control,
+			task_PRIORITY);
+	BOOT_MARK(BOOT_PHASE_KERNEL);
 	vTaskStartScheduler();
 
 	// The scheduler should not return, but in case of failure, return 0.
@@ -98,48 +140,91 @@ int main(void) {
 /**
  * @brief Task to poll Bluetooth input.
  *
- * This task continuously polls for Bluetooth input and updates the global variable
- * `BT_input`. It also triggers the motor control task (`motor_control_handle`) to
- * process the received input.
+ * This task blocks until Bluetooth input arrives and feeds it to the protocol
+ * parser. Decoded frames and legacy single-character commands are posted to
+ * the command queue for the motor control task and reported to the failsafe.
+ * Characters that are not commands are ignored. The task wakes at least every
+ * FAILSAFE_CHECKIN_MS to check in with the failsafe. The first command after
+ * boot also prints the boot profile (see boot.h).
  *
  * @param pvParameter Task parameters (unused in this case).
  */
 static void task_poll_BT(void *pvParameter) {
+	uint8_t rx[RX_CHUNK];
+	size_t len;
+	uint32_t offset;
+	uint32_t used;
+	protocol_frame_t frame;
+	protocol_result_t result;
+	uint8_t legacy;
+	command_type_t command;
+
+	Protocol_Init(&bt_parser);
+	BOOT_MARK(BOOT_PHASE_SCHEDULER);
+
 	while (1) {
-		// Take mutex to safely access shared resources
-		xSemaphoreTake(xMutex, portMAX_DELAY);
-		// Receive Bluetooth input
-		BT_input = UART0_Receive_Byte();
-		// Release the mutex
-		xSemaphoreGive(xMutex);
-		// Resume the motor control task to process the received input
-		vTaskResume(motor_control_handle);
-		// Introduce a delay to avoid excessive polling
-		vTaskDelay(DELAY / portTICK_PERIOD_MS);
+		// Block until the UART0 ISR delivers at least one byte
+		len = UART0_Receive(rx, sizeof(rx), pdMS_TO_TICKS(FAILSAFE_CHECKIN_MS));
+		Failsafe_Check_In(FAILSAFE_TASK_POLL_BT);
+
+		for (offset = 0; offset < len; offset += used) {
+			result = Protocol_Parse(&bt_parser, xTaskGetTickCount(),
+					&rx[offset], len - offset, &used, &frame, &legacy);
+			if (result == PROTO_FRAME) {
+				Failsafe_Activity(true);
+				handle_frame(&frame);
+				BOOT_REPORT();
+			} else if (result == PROTO_LEGACY) {
+				command = Command_From_Char((char) legacy);
+				if (command != CMD_NONE)
+					Failsafe_Activity(false);
+				Command_Send(command);
+				if (command != CMD_NONE)
+					BOOT_REPORT();
+			}
+		}
 	}
 }
 
+/**
+ * @brief Act on a decoded protocol frame: queue a command, dump a trace or
+ *        change a setting. FRAME_HEARTBEAT needs no action.
+ *
+ * @param frame Frame decoded by the protocol parser.
+ */
+static void handle_frame(const protocol_frame_t *frame) {
+	if (frame->type == FRAME_DRIVE && frame->len >= 2)
+		Command_Send_Drive((int8_t) frame->data[0], (int8_t) frame->data[1]);
+	else if (frame->type == FRAME_TRACE_DUMP)
+		Trace_Dump();
+	else if (frame->type == FRAME_MTB_DUMP)
+		MTB_Dump();
+	else if (frame->type == FRAME_CONFIG_SET || frame->type == FRAME_CONFIG_GET)
+		Config_Handle_Frame(frame);
+}
+
 /**
  * @brief Task to manage motor control based on Bluetooth input.
  *
- * This task continuously waits for Bluetooth input (`BT_input`) and calls the
- * `Motor_Control` function to perform actions based on the received commands.
- * It then suspends itself until new input is received.
+ * This task blocks on the command queue and calls the `Motor_Control`
+ * function for each received command, in order. It wakes at least every
+ * FAILSAFE_CHECKIN_MS to check in with the failsafe.
  *
  * @param pvParameter Task parameters (unused in this case).
  */
 static void task_motor_control(void *pvParameter) {
+	command_t cmd;
+
+#ifdef CONTROL_MATH_BENCHMARK
+	// Needs the scheduler running for cycle timestamps
+	Control_Math_Benchmark();
+#endif
+
 	while (1) {
-		// Take mutex to safely access shared resources
-		xSemaphoreTake(xMutex, portMAX_DELAY);
-		// Check if there is a valid Bluetooth input
-		if (BT_input != '\0') {
+		if (Command_Receive(&cmd, pdMS_TO_TICKS(FAILSAFE_CHECKIN_MS))) {
 			// Perform motor control based on the received command
-			Motor_Control(BT_input);
+			Motor_Control(&cmd);
 		}
-		// Release the mutex
-		xSemaphoreGive(xMutex);
-		// Suspend the task until new input is received
-		vTaskSuspend(NULL);
+		Failsafe_Check_In(FAILSAFE_TASK_MOTOR_CONTROL);
 	}
 }
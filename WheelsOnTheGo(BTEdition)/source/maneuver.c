@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    maneuver.c
+ * @brief   Timer-driven scheduler for timed motor maneuvers.
+ *
+ * All plan state is owned by the timer service task. Maneuver_Start() only
+ * drops the new plan into a mailbox and pends load_plan() to the timer task
+ * with xTimerPendFunctionCall(), so plan loading, segment expiry and the
+ * apply callback are serialized without any locking beyond the mailbox copy.
+ *
+ * Timer commands issued from the timer task are processed after the current
+ * callback returns, so an expiry of the previous plan's timer may still be
+ * delivered after a new plan was loaded. Each segment records its deadline
+ * and expiries that arrive before it are ignored.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <string.h>
+#include <stdbool.h>
+#include "maneuver.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include "kernel_objects.h"
+
+// Plan being executed, owned by the timer service task
+static maneuver_segment_t plan[MANEUVER_MAX_SEGMENTS];
+static uint32_t plan_length;
+static uint32_t plan_index;
+static bool segment_timed;          // Current segment is waiting on the timer
+static TickType_t segment_deadline;
+
+// Latest plan handed over by Maneuver_Start()
+static maneuver_segment_t mailbox[MANEUVER_MAX_SEGMENTS];
+static uint32_t mailbox_length;
+static bool mailbox_full;
+
+static TimerHandle_t segment_timer;
+static maneuver_apply_t apply_segment;
+
+/**
+ * @brief Apply the current segment and arm the timer if it is timed.
+ */
+static void run_segment(void) {
+	const maneuver_segment_t *segment = &plan[plan_index];
+	TickType_t ticks;
+
+	apply_segment(segment);
+
+	segment_timed = segment->duration_ms != 0;
+	if (segment_timed) {
+		ticks = pdMS_TO_TICKS(segment->duration_ms);
+		if (ticks == 0)
+			ticks = 1;
+		segment_deadline = xTaskGetTickCount() + ticks;
+		xTimerChangePeriod(segment_timer, ticks, 0);
+	}
+}
+
+/**
+ * @brief Timer callback: the current timed segment has ended.
+ *
+ * @param timer Segment timer (unused).
+ */
+static void segment_expired(TimerHandle_t timer) {
+	if (!segment_timed
+			|| (int32_t) (xTaskGetTickCount() - segment_deadline) < 0)
+		return;  // Stale expiry from a preempted segment
+
+	segment_timed = false;
+	if (++plan_index < plan_length)
+		run_segment();
+}
+
+/**
+ * @brief Load the plan from the mailbox and start it. Runs in the timer task.
+ *
+ * @param unused1 Unused.
+ * @param unused2 Unused.
+ */
+static void load_plan(void *unused1, uint32_t unused2) {
+	taskENTER_CRITICAL();
+	memcpy(plan, mailbox, sizeof(plan));
+	plan_length = mailbox_length;
+	mailbox_full = false;
+	taskEXIT_CRITICAL();
+
+	segment_timed = false;
+	xTimerStop(segment_timer, 0);
+
+	plan_index = 0;
+	if (plan_length != 0)
+		run_segment();
+}
+
+// Refer maneuver.h file for function brief and description
+void Init_Maneuver(maneuver_apply_t apply) {
+	apply_segment = apply;
+	segment_timer = Kernel_Create_Timer(KERNEL_TIMER_MANEUVER, 1, pdFALSE,
+			segment_expired);
+}
+
+// Refer maneuver.h file for function brief and description
+void Maneuver_Start(const maneuver_segment_t *new_plan, uint32_t count) {
+	bool pending;
+
+	if (count > MANEUVER_MAX_SEGMENTS)
+		count = MANEUVER_MAX_SEGMENTS;
+
+	taskENTER_CRITICAL();
+	memcpy(mailbox, new_plan, count * sizeof(maneuver_segment_t));
+	mailbox_length = count;
+	pending = mailbox_full;
+	mailbox_full = true;
+	taskEXIT_CRITICAL();
+
+	// A load already pending will pick up the newer plan
+	if (!pending)
+		xTimerPendFunctionCall(load_plan, NULL, 0, portMAX_DELAY);
+}
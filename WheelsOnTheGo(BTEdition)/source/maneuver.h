@@ -0,0 +1,76 @@
+// maneuver.h
+
+#ifndef MANEUVER_H
+#define MANEUVER_H
+
+#include <stdint.h>
+
+/**
+ * @file    maneuver.h
+ * @brief   Timer-driven scheduler for timed motor maneuvers.
+ *
+ * A maneuver is a short plan of segments, each an action held for a number
+ * of milliseconds. Segments are executed by the FreeRTOS timer service task:
+ * a one-shot software timer ends each timed segment and starts the next, so
+ * no task ever sleeps in the middle of a turn.
+ *
+ * Starting a new plan preempts the one in progress immediately. A segment
+ * with a duration of 0 is held until the next plan replaces it, and ends
+ * the plan.
+ *
+ * A segment may also set how long its change of wheel speed takes. The
+ * ramp generator then reaches the segment's duty in ramp_ms along the
+ * active profile (see Ramp_Set_Duty_In()), whatever the size of the change:
+ * a turn can ease in over its first 200 ms, and a MANEUVER_STOP with a ramp
+ * brakes to zero duty without coasting, so it is followed by a plain
+ * MANEUVER_STOP to release the wheels. With ramp_ms 0 the ramp keeps the
+ * full-scale time of Ramp_Set_Profile() and a stop coasts at once.
+ */
+
+// Longest plan accepted by Maneuver_Start()
+#define MANEUVER_MAX_SEGMENTS (4)
+
+typedef enum {
+	MANEUVER_STOP = 0,
+	MANEUVER_FORWARD,
+	MANEUVER_BACKWARD,
+	MANEUVER_RIGHT,
+	MANEUVER_LEFT,
+	MANEUVER_DRIVE       // Proportional throttle/steer
+} maneuver_action_t;
+
+typedef struct {
+	maneuver_action_t action;
+	int8_t throttle;         // MANEUVER_DRIVE only
+	int8_t steer;            // MANEUVER_DRIVE only
+	uint16_t duration_ms;    // 0 holds the action until the next plan
+	uint16_t ramp_ms;        // Time to reach the segment's speed, 0 for the default
+} maneuver_segment_t;
+
+/**
+ * @brief Callback that applies one segment's action to the motors.
+ *
+ * Runs in the timer service task.
+ */
+typedef void (*maneuver_apply_t)(const maneuver_segment_t *segment);
+
+/**
+ * @brief Create the segment timer. Call before starting the scheduler.
+ *
+ * @param apply Function that applies a segment's action to the hardware.
+ */
+void Init_Maneuver(maneuver_apply_t apply);
+
+/**
+ * @brief Replace the current maneuver with a new plan.
+ *
+ * The plan is copied, so the caller's array may be reused. If several plans
+ * are started before the timer service task runs, only the latest is
+ * executed.
+ *
+ * @param plan  Segments to execute in order.
+ * @param count Number of segments, at most MANEUVER_MAX_SEGMENTS.
+ */
+void Maneuver_Start(const maneuver_segment_t *plan, uint32_t count);
+
+#endif // MANEUVER_H
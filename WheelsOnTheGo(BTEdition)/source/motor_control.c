@@ -16,15 +16,14 @@
  * It configures PWM signals to control motor speed and GPIO pins to control the direction
  * of motor rotation. The module provides functions to move the robot forward, backward,
  * turn left, turn right, and stop. It also interfaces with the LED module to indicate
- * the robot's movement status using RGB LEDs.
+ * the robot's movement status using RGB LEDs. Duty and direction changes are handed
+ * to the ramp generator (ramp.h), which soft-starts the motors from the TPM0 interrupt.
  *
  * Motor Configuration:
  * - Motor A: Connected to TPM0_CH0 (Pin D0) for PWM control and PTB10/PTB11 for direction control.
  * - Motor B: Connected to TPM0_CH5 (Pin D5) for PWM control and PTB8/PTB9 for direction control.
  *
- * Direction Control:
- * - PTB8/PTB9: Motor A direction control pins.
- * - PTB10/PTB11: Motor B direction control pins.
+ * The pins are muxed by Init_Board_Pins() from the table in board_pins.h.
  *
  * @author  Suhas Reddy S
  * @date    12th Dec 2023
@@ -36,42 +35,25 @@
 #include "led.h"
 #include "FreeRTOS.h"
 #include "task.h"
-#include "uart.h"
-
-// Bit mask macro for setting a specific bit
-#define MASK(x) (1UL << (x))
+#include "log.h"
+#include "latency.h"
+#include "speed_control.h"
+#include "control_math.h"
+#include "maneuver.h"
+#include "ramp.h"
+#include "config.h"
+#include "clock_policy.h"
+#include "failsafe.h"
 
 // RGB color values
 #define GREEN   (0xFF00)
 #define RED     (0xFF0000)
 #define YELLOW  (0xFFFF00)
 #define CYAN    (0xFFFF)
+#define WHITE   (0xFFFFFF)
 
-// Motor A PWM pin and associated TPM channel
-#define MOTORA_PWM_PIN  (0)
-#define TPM0_CH0        (4)
-
-// Motor B PWM pin and associated TPM channel
-#define MOTORB_PWM_PIN  (5)
-#define TPM0_CH5        (4)
-
-// GPIO mode
-#define GPIO            (1)
-
-// Motor A control pins
-#define MOTORA_CW       (11)
-#define MOTORA_CCW      (10)
-
-// Motor B control pins
-#define MOTORB_CW       (8)
-#define MOTORB_CCW      (9)
-
-// TPM channels for Motor A and Motor B
-#define CH0             (0)
-#define CH5             (5)
-
-// Delay for turning actions (in milliseconds)
-#define DELAY           (500)
+// Shift from an int8 protocol field to Q15
+#define INT8_TO_Q15     (8)
 
 
 void forward(void);
@@ -79,157 +61,323 @@ void backward(void);
 void right(void);
 void left(void);
 void stop(void);
+static void drive(int8_t throttle, int8_t steer);
+static void retime(uint32_t ramp_ms);
+static void apply_segment(const maneuver_segment_t *segment);
 
-// flag to track stop
-bool isstop = true;
+// flag set while the PWM duty is not the fixed speed of the single-character
+// commands: a proportional drive command owns it, or a ramped stop took it
+// to zero
+static bool driving = false;
+
+// Commanded motion, tracked when a plan is issued rather than when the timer
+// task applies it, so '2' does not depend on scheduling
+static bool moving_hold;         // The last plan ends in a moving segment
+static TickType_t moving_until;  // Its timed moving segments end at this tick
 
 // Refer motor_control.h file for function brief and description
 void Init_Motors(void) {
-	// Enable clock to Port B and D
-	SIM->SCGC5 |= SIM_SCGC5_PORTD_MASK | SIM_SCGC5_PORTB_MASK;
-
-	// PWM control for Motot A
-	PORTD->PCR[MOTORA_PWM_PIN] &= ~PORT_PCR_MUX_MASK;
-	PORTD->PCR[MOTORA_PWM_PIN] |= PORT_PCR_MUX(TPM0_CH0);
-
-	// PWM control for Motor B
-	PORTD->PCR[MOTORB_PWM_PIN] &= ~PORT_PCR_MUX_MASK;
-	PORTD->PCR[MOTORB_PWM_PIN] |= PORT_PCR_MUX(TPM0_CH5);
-
-	// Enable pins 8, 9, 10, and 11 as GPIOs to control the direction of rotation of the robots
-	// Motor B direction control pins
-	// Clockwise
-	PORTB->PCR[MOTORB_CW] &= ~PORT_PCR_MUX_MASK;
-	PORTB->PCR[MOTORB_CW] |= PORT_PCR_MUX(GPIO);
-
-	// Counter-Clockwise
-	PORTB->PCR[MOTORB_CCW] &= ~PORT_PCR_MUX_MASK;
-	PORTB->PCR[MOTORB_CCW] |= PORT_PCR_MUX(GPIO);
-
-	// Motor A direction control pins
-	// Counter-Clockwise
-	PORTB->PCR[MOTORA_CCW] &= ~PORT_PCR_MUX_MASK;
-	PORTB->PCR[MOTORA_CCW] |= PORT_PCR_MUX(GPIO);
-
-	// Clockwise
-	PORTB->PCR[MOTORA_CW] &= ~PORT_PCR_MUX_MASK;
-	PORTB->PCR[MOTORA_CW] |= PORT_PCR_MUX(GPIO);
-
-	// Set the direction of the pins as outputs
-	PTB->PDDR |= MASK(
-			MOTORB_CW) | MASK(MOTORB_CCW) | MASK(MOTORA_CCW) | MASK(MOTORA_CW);
-
-	// Clear the direction control pins
-	PTB->PCOR |= MASK(
-			MOTORB_CW) | MASK(MOTORB_CCW) | MASK(MOTORA_CCW) | MASK(MOTORA_CW);
+	// PWM and direction pins are set up by Init_Board_Pins(), outputs low
+	Init_Ramp();
+	Init_Maneuver(apply_segment);
 }
 
 // Refer motor_control.h file for function brief and description
 void Start_Motors(uint16_t speed_a, uint16_t speed_b) {
-	TPM0->CONTROLS[CH5].CnV = speed_a;  // Higher the value lower the speed
-	TPM0->CONTROLS[CH0].CnV = speed_b;
+	// Higher the value lower the speed
+	if (speed_a > TPM_PWM_PERIOD)
+		speed_a = TPM_PWM_PERIOD;
+	if (speed_b > TPM_PWM_PERIOD)
+		speed_b = TPM_PWM_PERIOD;
+	Ramp_Set_Duty(RAMP_MOTOR_A, TPM_PWM_PERIOD - speed_a);
+	Ramp_Set_Duty(RAMP_MOTOR_B, TPM_PWM_PERIOD - speed_b);
+}
+
+/**
+ * @brief Check whether the robot is commanded to be moving.
+ *
+ * @return true while a timed moving segment runs or a moving action is held.
+ */
+static bool is_moving(void) {
+	return moving_hold || (int32_t) (xTaskGetTickCount() - moving_until) < 0;
+}
+
+/**
+ * @brief Record the motion commanded by a plan and hand it to the scheduler.
+ *
+ * @param plan  Segments to execute.
+ * @param count Number of segments.
+ */
+static void start_plan(const maneuver_segment_t *plan, uint32_t count) {
+	TickType_t ticks = 0;
+	uint32_t i;
+
+	moving_hold = false;
+	for (i = 0; i < count; i++) {
+		ticks += pdMS_TO_TICKS(plan[i].duration_ms);
+		if (plan[i].action == MANEUVER_STOP
+				|| (plan[i].action == MANEUVER_DRIVE && plan[i].throttle == 0
+						&& plan[i].steer == 0))
+			continue;
+		if (plan[i].duration_ms == 0)
+			moving_hold = true;
+		else
+			moving_until = xTaskGetTickCount() + ticks;
+	}
+
+	Maneuver_Start(plan, count);
 }
 
 // Refer motor_control.h file for function brief and description
-void Motor_Control(char ch) {
-	if (ch == '1') {
+void Motor_Control(const command_t *cmd) {
+	maneuver_segment_t plan[2] = { { 0 } };
+
+	// Back to 48 MHz before the PWM changes
+	Clock_Policy_Run();
+
+	if (cmd->type == CMD_DRIVE) {
+		plan[0].action = MANEUVER_DRIVE;
+		plan[0].throttle = cmd->throttle;
+		plan[0].steer = cmd->steer;
+		start_plan(plan, 1);
+	} else if (cmd->type == CMD_FORWARD) {
 		// Move forward
 		Set_RGB(GREEN);
-		forward();
-		isstop = true;
-	} else if (ch == '2') {
-		// Toggle between stop and backward movement
+		plan[0].action = MANEUVER_FORWARD;
+		start_plan(plan, 1);
+	} else if (cmd->type == CMD_STOP_BACKWARD) {
+		// Stop if moving, otherwise move backward
 		Set_RGB(RED);
-		if (isstop) {
-			stop();
-			isstop = false;
-		} else {
-			backward();
-			isstop = true;
-		}
-	} else if (ch == '3') {
-		// Turn right with a brief delay and then stop
+		plan[0].action = is_moving() ? MANEUVER_STOP : MANEUVER_BACKWARD;
+		start_plan(plan, 1);
+	} else if (cmd->type == CMD_RIGHT) {
+		// Turn right for a fixed time and then stop
 		Set_RGB(CYAN);
-		right();
-		vTaskDelay(DELAY / portTICK_PERIOD_MS);
-		stop();
-		isstop = true;
-	} else if (ch == '4') {
-		// Turn left with a brief delay and then stop
+		plan[0].action = MANEUVER_RIGHT;
+		plan[0].duration_ms = Config_Get(CONFIG_TURN_MS);
+		plan[1].action = MANEUVER_STOP;
+		start_plan(plan, 2);
+	} else if (cmd->type == CMD_LEFT) {
+		// Turn left for a fixed time and then stop
 		Set_RGB(YELLOW);
+		plan[0].action = MANEUVER_LEFT;
+		plan[0].duration_ms = Config_Get(CONFIG_TURN_MS);
+		plan[1].action = MANEUVER_STOP;
+		start_plan(plan, 2);
+	} else if (cmd->type == CMD_STOP) {
+		// Stop unconditionally, unlike '2': brake along the ramp, then coast
+		Set_RGB(RED);
+		plan[0].action = MANEUVER_STOP;
+		plan[0].ramp_ms = FAILSAFE_STOP_MS;
+		plan[0].duration_ms = FAILSAFE_STOP_MS;
+		plan[1].action = MANEUVER_STOP;
+		start_plan(plan, 2);
+	}
+}
+
+/**
+ * @brief Apply one maneuver segment to the motors.
+ *
+ * Called by the maneuver scheduler from the timer service task.
+ *
+ * @param segment Segment to apply.
+ */
+static void apply_segment(const maneuver_segment_t *segment) {
+	Clock_Policy_Run();
+
+	if (segment->action == MANEUVER_DRIVE) {
+		drive(segment->throttle, segment->steer);
+		retime(segment->ramp_ms);
+		return;
+	}
+
+	if (segment->action == MANEUVER_STOP && segment->ramp_ms != 0) {
+		// Brake along the ramp in the current direction; the plan coasts next
+		Ramp_Set_Duty_In(RAMP_MOTOR_A, 0, segment->ramp_ms);
+		Ramp_Set_Duty_In(RAMP_MOTOR_B, 0, segment->ramp_ms);
+		Speed_Control_Set_Target(0, 0);
+		LATENCY_MARK_ACTUATED();
+		driving = true;
+		LOG(LOG_STOPPED);
+		return;
+	}
+
+	if (driving) {
+		// Back to the fixed speed of the single-character commands
+		Start_Motors(Config_Get(CONFIG_DRIVE_SPEED), Config_Get(CONFIG_DRIVE_SPEED));
+		driving = false;
+	}
+
+	switch (segment->action) {
+	case MANEUVER_FORWARD:
+		forward();
+		break;
+	case MANEUVER_BACKWARD:
+		backward();
+		break;
+	case MANEUVER_RIGHT:
+		right();
+		break;
+	case MANEUVER_LEFT:
 		left();
-		vTaskDelay(DELAY / portTICK_PERIOD_MS);
+		break;
+	default:
 		stop();
-		isstop = true;
+		break;
 	}
+	retime(segment->ramp_ms);
+}
+
+/**
+ * @brief Make both wheels reach their targets in a given time.
+ *
+ * @param ramp_ms Time of the change from the current duty, or 0 to keep the
+ *                full-scale time of the ramp profile.
+ */
+static void retime(uint32_t ramp_ms) {
+	ramp_state_t state;
+
+	if (ramp_ms == 0)
+		return;
+	Ramp_Get_State(RAMP_MOTOR_A, &state);
+	Ramp_Set_Duty_In(RAMP_MOTOR_A, state.target, ramp_ms);
+	Ramp_Get_State(RAMP_MOTOR_B, &state);
+	Ramp_Set_Duty_In(RAMP_MOTOR_B, state.target, ramp_ms);
 }
 
 /**
  * @brief Move the robot forward.
  *
- * This function sets the motor directions and transmits a message indicating
- * that the robot is moving forward using UART communication.
+ * This function sets the motor directions and logs a message indicating
+ * that the robot is moving forward. The message is logged after the pins
+ * change and sent later by the log task (see log.h).
  */
 void forward(void) {
-	UART0_Transmit_String("Moving Forward...\n\r");
-	PTB->PSOR |= MASK(MOTORB_CCW);  // PSOR sets the pin high
-	PTB->PSOR |= MASK(MOTORA_CW);
-	PTB->PCOR |= MASK(MOTORB_CW);   // PCOR sets the pin low
-	PTB->PCOR |= MASK(MOTORA_CCW);
+	Ramp_Set_Directions(HBRIDGE_CW, HBRIDGE_CCW);
+	Speed_Control_Set_Target(CRUISE_RPM, CRUISE_RPM);
+	LATENCY_MARK_ACTUATED();
+	LOG(LOG_FORWARD);
 }
 
 /**
  * @brief Move the robot backward.
  *
- * This function sets the motor directions and transmits a message indicating
- * that the robot is moving backward using UART communication.
+ * This function sets the motor directions and logs a message indicating
+ * that the robot is moving backward.
  */
 void backward(void) {
-	UART0_Transmit_String("Moving Backward...\n\r");
-	PTB->PCOR |= MASK(MOTORB_CCW);
-	PTB->PCOR |= MASK(MOTORA_CW);
-	PTB->PSOR |= MASK(MOTORB_CW);
-	PTB->PSOR |= MASK(MOTORA_CCW);
+	Ramp_Set_Directions(HBRIDGE_CCW, HBRIDGE_CW);
+	Speed_Control_Set_Target(CRUISE_RPM, CRUISE_RPM);
+	LATENCY_MARK_ACTUATED();
+	LOG(LOG_BACKWARD);
 }
 
 /**
  * @brief Turn the robot to the right.
  *
- * This function sets the motor directions and transmits a message indicating
- * that the robot is turning right using UART communication.
+ * This function sets the motor directions and logs a message indicating
+ * that the robot is turning right.
  */
 void right(void) {
-	UART0_Transmit_String("Turning Right...\n\r");
-	PTB->PSOR |= MASK(MOTORB_CCW);
-	PTB->PCOR |= MASK(MOTORA_CW);
-	PTB->PCOR |= MASK(MOTORB_CW);
-	PTB->PSOR |= MASK(MOTORA_CCW);
+	Ramp_Set_Directions(HBRIDGE_CCW, HBRIDGE_CCW);
+	Speed_Control_Set_Target(CRUISE_RPM, CRUISE_RPM);
+	LATENCY_MARK_ACTUATED();
+	LOG(LOG_RIGHT);
 }
 
 /**
  * @brief Turn the robot to the left.
  *
- * This function sets the motor directions and transmits a message indicating
- * that the robot is turning left using UART communication.
+ * This function sets the motor directions and logs a message indicating
+ * that the robot is turning left.
  */
 void left(void) {
-	UART0_Transmit_String("Turning Left...\n\r");
-	PTB->PCOR |= MASK(MOTORB_CCW);
-	PTB->PSOR |= MASK(MOTORA_CW);
-	PTB->PSOR |= MASK(MOTORB_CW);
-	PTB->PCOR |= MASK(MOTORA_CCW);
+	Ramp_Set_Directions(HBRIDGE_CW, HBRIDGE_CW);
+	Speed_Control_Set_Target(CRUISE_RPM, CRUISE_RPM);
+	LATENCY_MARK_ACTUATED();
+	LOG(LOG_LEFT);
 }
 
 /**
  * @brief Stop the robot.
  *
- * This function stops both motors and transmits a message indicating
- * that the robot has stopped using UART communication.
+ * This function stops both motors and logs a message indicating
+ * that the robot has stopped.
  */
 void stop(void) {
-	UART0_Transmit_String("Stopped...\n\r");
-	PTB->PCOR |= MASK(MOTORB_CCW);
-	PTB->PCOR |= MASK(MOTORA_CW);
-	PTB->PCOR |= MASK(MOTORB_CW);
-	PTB->PCOR |= MASK(MOTORA_CCW);
+	Ramp_Set_Directions(HBRIDGE_COAST, HBRIDGE_COAST);
+	Speed_Control_Set_Target(0, 0);
+	LATENCY_MARK_ACTUATED();
+	LOG(LOG_STOPPED);
+}
+
+/**
+ * @brief Scale the magnitude of a signed Q15 wheel demand.
+ *
+ * @param demand     Wheel demand, sign ignored.
+ * @param full_scale Value corresponding to a full-scale demand.
+ *
+ * @return |demand| * full_scale as an integer.
+ */
+static uint32_t scale_demand(q15_t demand, uint32_t full_scale) {
+	uint32_t magnitude = (demand < 0) ? (uint32_t) -(int32_t) demand : (uint32_t) demand;
+
+	return (magnitude * full_scale) >> 15;
+}
+
+/**
+ * @brief Drive both wheels proportionally from throttle and steer.
+ *
+ * Motor B is the left wheel (forward = CCW) and motor A the right wheel
+ * (forward = CW). The ramp generator coasts a wheel for a dead time before
+ * reversing it, and a wheel never has both inputs high (see hbridge.h).
+ *
+ * @param throttle Forward (+) or reverse (-) demand, +/-127 full scale.
+ * @param steer    Right (+) or left (-) demand, +/-127 full scale.
+ */
+static void drive(int8_t throttle, int8_t steer) {
+	static uint32_t color;
+	uint32_t new_color;
+	hbridge_dir_t dir_left = HBRIDGE_COAST;
+	hbridge_dir_t dir_right = HBRIDGE_COAST;
+	q15_t left_demand;
+	q15_t right_demand;
+
+	ctl_mix_q15((q15_t) (throttle << INT8_TO_Q15), (q15_t) (steer << INT8_TO_Q15),
+			&left_demand, &right_demand);
+
+	if (left_demand > 0)
+		dir_left = HBRIDGE_CCW;
+	else if (left_demand < 0)
+		dir_left = HBRIDGE_CW;
+	if (right_demand > 0)
+		dir_right = HBRIDGE_CW;
+	else if (right_demand < 0)
+		dir_right = HBRIDGE_CCW;
+
+	Ramp_Set_Directions(dir_right, dir_left);
+	// Low-true PWM: a higher CnV gives a lower speed
+	Start_Motors(TPM_PWM_PERIOD - scale_demand(right_demand, TPM_PWM_PERIOD),
+			TPM_PWM_PERIOD - scale_demand(left_demand, TPM_PWM_PERIOD));
+	Speed_Control_Set_Target(scale_demand(right_demand, MAX_RPM),
+			scale_demand(left_demand, MAX_RPM));
+	LATENCY_MARK_ACTUATED();
+	driving = true;
+	LOG(LOG_DRIVE, throttle, steer);
+
+	// Only touch the LEDs when the colour changes; frames arrive at 50+ Hz
+	if (throttle > 0)
+		new_color = GREEN;
+	else if (throttle < 0)
+		new_color = RED;
+	else if (steer > 0)
+		new_color = CYAN;
+	else if (steer < 0)
+		new_color = YELLOW;
+	else
+		new_color = WHITE;
+	if (new_color != color) {
+		Set_RGB(new_color);
+		color = new_color;
+	}
 }
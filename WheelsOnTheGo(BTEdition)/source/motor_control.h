@@ -2,16 +2,18 @@
 #define _MOTOR_CONTROL_H_
 
 #include <stdint.h>
+#include "command_queue.h"
 
 #define MIN_SPEED (0xFFFF)
-#define MEDIUM_SPEED (0xFF)
+#define MEDIUM_SPEED (0xFF)  // Default of CONFIG_DRIVE_SPEED
 #define MAX_SPEED (0x0)
 
 /**
  * @brief Initializes the motor control system.
  *
  * This function initializes the necessary settings and configurations for motor control,
- * preparing the system for motor operation.
+ * preparing the system for motor operation, and creates the maneuver scheduler's
+ * timer. Call after Init_TPM() and before starting the scheduler.
  */
 void Init_Motors(void);
 
@@ -20,6 +22,8 @@ void Init_Motors(void);
  *
  * This function starts the motors with the specified speeds for motor A and motor B.
  * The speed values are provided as parameters and control the rotation speed of each motor.
+ * They are TPM0 CnV values (low-true, higher is slower) and are reached through the
+ * ramp generator rather than applied at once.
  *
  * @param speed_a Speed value for motor A.
  * @param speed_b Speed value for motor B.
@@ -27,18 +31,24 @@ void Init_Motors(void);
 void Start_Motors(uint16_t speed_a, uint16_t speed_b);
 
 /**
- * @brief Control the robot's movement based on the input character.
+ * @brief Control the robot's movement based on the received command.
  *
- * This function interprets the input character 'ch' and performs corresponding
- * actions to control the robot's movement. It interacts with motor control functions
- * and updates the RGB LEDs based on the specified movements.
+ * This function interprets the command and starts the matching maneuver,
+ * preempting any maneuver still in progress. It never blocks: timed actions
+ * such as turns are ended by the maneuver scheduler's software timer. It
+ * updates the RGB LEDs based on the specified movements.
  *
- * @param ch Input character representing the desired robot movement.
- *           '1': Move forward.
- *           '2': Toggle between stop and backward movement.
- *           '3': Turn right with a brief delay and then stop.
- *           '4': Turn left with a brief delay and then stop.
+ * @param cmd Command representing the desired robot movement.
+ *           CMD_FORWARD:       Move forward.
+ *           CMD_STOP_BACKWARD: Stop if moving (including mid-turn), otherwise
+ *                              move backward.
+ *           CMD_RIGHT:         Turn right for CONFIG_TURN_MS and then stop.
+ *           CMD_LEFT:          Turn left for CONFIG_TURN_MS and then stop.
+ *           CMD_STOP:          Brake to a stop over FAILSAFE_STOP_MS, then
+ *                              coast.
+ *           CMD_DRIVE:         Mix throttle and steer into a direction and
+ *                              PWM duty per wheel and apply them immediately.
  */
-void Motor_Control(char ch);
+void Motor_Control(const command_t *cmd);
 
 #endif // _MOTOR_CONTROL_H_
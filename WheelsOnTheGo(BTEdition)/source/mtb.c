@@ -32,10 +32,8 @@
 #if !defined (__MTB_DISABLE)
 
   // Allow for MTB buffer size being set by define set via command line
-  // Otherwise provide small default buffer
-  #if !defined (__MTB_BUFFER_SIZE)
-    #define __MTB_BUFFER_SIZE 128
-  #endif
+  // Otherwise provide small default buffer, shared with mtb_trace.c
+  #include "mtb_trace.h"
   
   // Check that buffer size requested is >0 bytes in size
   #if (__MTB_BUFFER_SIZE > 0)
@@ -0,0 +1,222 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    mtb_trace.c
+ * @brief   Micro Trace Buffer capture, triggers and dump over UART0.
+ *
+ * MTB_POSITION holds the offset from MTB_BASE at which the next packet is
+ * written. The MTB only increments the offset bits below the buffer size
+ * (MTB_MASTER[MASK]), so the buffer wraps within its size-aligned window and
+ * sets MTB_POSITION[WRAP] the first time it does.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <string.h>
+#include "mtb_trace.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "uart.h"
+#include "protocol.h"
+
+#if !defined (__MTB_DISABLE) && (__MTB_BUFFER_SIZE > 0)
+#define MTB_PRESENT
+#endif
+
+#ifdef MTB_PRESENT
+
+#if (__MTB_BUFFER_SIZE < 16) || ((__MTB_BUFFER_SIZE & (__MTB_BUFFER_SIZE - 1)) != 0)
+#error "__MTB_BUFFER_SIZE must be a power of two of at least 16 bytes"
+#endif
+
+#define PACKET_BYTES        (8)
+#define OFFSET(position)    ((position) & MTB_POSITION_POINTER_MASK & (__MTB_BUFFER_SIZE - 1))
+
+// MTBDWT_FCT[FUNCTION] value matching an instruction fetch
+#define FCT_INSTRUCTION     (4)
+
+// MTBDWT comparators used for the start and stop triggers
+#define COMP_START          (0)
+#define COMP_STOP           (1)
+
+// Frames queued between waits for the transmit FIFO to drain
+#define DUMP_BATCH          (16)
+
+// Reserved and aligned to its size by __CR_MTB_BUFFER in mtb.c
+extern char __mtb_buffer__[];
+
+static uint8_t tx_seq;
+
+/**
+ * @brief Offset of the trace buffer from the MTB's RAM base.
+ *
+ * @return Value for MTB_POSITION[POINTER] at the start of the buffer.
+ */
+static uint32_t buffer_offset(void) {
+	return (uint32_t) __mtb_buffer__ - MTB->BASE;
+}
+
+/**
+ * @brief MTB_MASTER[MASK] value for the buffer size.
+ *
+ * @return log2(__MTB_BUFFER_SIZE) - 4.
+ */
+static uint32_t buffer_mask(void) {
+	uint32_t mask = 0;
+
+	while ((16U << mask) < __MTB_BUFFER_SIZE)
+		mask++;
+	return mask;
+}
+
+/**
+ * @brief Set a comparator to match the fetch of one instruction.
+ *
+ * @param comp    Comparator number.
+ * @param address Code address; the Thumb bit is ignored.
+ */
+static void set_comparator(uint32_t comp, const void *address) {
+	MTBDWT->COMPARATOR[comp].COMP = (uint32_t) address & ~1UL;
+	MTBDWT->COMPARATOR[comp].MASK = 0;
+	MTBDWT->COMPARATOR[comp].FCT = MTBDWT_FCT_FUNCTION(FCT_INSTRUCTION);
+}
+
+/**
+ * @brief Frame a payload and queue it, waiting for the transmit FIFO to
+ *        drain after every DUMP_BATCH frames so none are dropped.
+ *
+ * @param type  Frame type.
+ * @param data  Payload.
+ * @param len   Payload length.
+ * @param batch Frames sent so far in this dump.
+ */
+static void send_frame(uint8_t type, const uint8_t *data, uint32_t len,
+		uint32_t batch) {
+	uint8_t frame[PROTOCOL_MAX_PAYLOAD + PROTOCOL_FRAME_OVERHEAD];
+
+	if (batch % DUMP_BATCH == 0) {
+		while (UART0_Tx_Pending() != 0)
+			vTaskDelay(1);
+	}
+	len = Protocol_Encode(tx_seq++, type, data, len, frame);
+	UART0_Transmit(frame, len);
+}
+
+#endif // MTB_PRESENT
+
+// Refer mtb_trace.h file for function brief and description
+void Init_MTB(void) {
+#ifdef MTB_PRESENT
+	MTB->MASTER = 0;
+	MTBDWT->TBCTRL = 0;
+	MTBDWT->COMPARATOR[COMP_START].FCT = 0;
+	MTBDWT->COMPARATOR[COMP_STOP].FCT = 0;
+
+	memset(__mtb_buffer__, 0, __MTB_BUFFER_SIZE);
+	MTB->POSITION = buffer_offset();
+	MTB->FLOW = 0;
+	MTB->MASTER = MTB_MASTER_MASK(buffer_mask()) | MTB_MASTER_EN_MASK;
+#endif
+}
+
+// Refer mtb_trace.h file for function brief and description
+void MTB_Start(void) {
+#ifdef MTB_PRESENT
+	MTB->MASTER |= MTB_MASTER_EN_MASK;
+#endif
+}
+
+// Refer mtb_trace.h file for function brief and description
+void MTB_Stop(void) {
+#ifdef MTB_PRESENT
+	MTB->MASTER &= ~MTB_MASTER_EN_MASK;
+#endif
+}
+
+// Refer mtb_trace.h file for function brief and description
+void MTB_Set_Triggers(const void *start, const void *stop) {
+#ifdef MTB_PRESENT
+	uint32_t master = MTB_MASTER_MASK(buffer_mask());
+	uint32_t tbctrl = 0;
+
+	MTB->MASTER = master;
+	MTB->POSITION = buffer_offset();
+	MTB->FLOW = 0;
+
+	if (start != NULL) {
+		set_comparator(COMP_START, start);
+		tbctrl |= MTBDWT_TBCTRL_ACOMP0_MASK;
+		master |= MTB_MASTER_TSTARTEN_MASK;
+	} else {
+		MTBDWT->COMPARATOR[COMP_START].FCT = 0;
+		master |= MTB_MASTER_EN_MASK;
+	}
+
+	if (stop != NULL) {
+		// ACOMP1 clear: a comparator 1 match stops tracing
+		set_comparator(COMP_STOP, stop);
+		master |= MTB_MASTER_TSTOPEN_MASK;
+	} else {
+		// Stop when the last packet of the buffer has been written
+		MTBDWT->COMPARATOR[COMP_STOP].FCT = 0;
+		MTB->FLOW = (buffer_offset() + __MTB_BUFFER_SIZE - PACKET_BYTES)
+				| MTB_FLOW_AUTOSTOP_MASK;
+	}
+
+	MTBDWT->TBCTRL = tbctrl;
+	MTB->MASTER = master;
+#else
+	(void) start;
+	(void) stop;
+#endif
+}
+
+// Refer mtb_trace.h file for function brief and description
+void MTB_Dump(void) {
+#ifdef MTB_PRESENT
+	uint8_t payload[4];
+	uint32_t master;
+	uint32_t position;
+	uint32_t first;
+	uint32_t count;
+	uint32_t i;
+
+	// Pause tracing, including the triggers, so the dump is not traced
+	master = MTB->MASTER;
+	MTB->MASTER = master & ~(MTB_MASTER_EN_MASK | MTB_MASTER_TSTARTEN_MASK
+			| MTB_MASTER_TSTOPEN_MASK);
+
+	position = MTB->POSITION;
+	if (position & MTB_POSITION_WRAP_MASK) {
+		first = OFFSET(position);
+		count = __MTB_BUFFER_SIZE / PACKET_BYTES;
+	} else {
+		first = 0;
+		count = OFFSET(position) / PACKET_BYTES;
+	}
+
+	payload[0] = (uint8_t) count;
+	payload[1] = (uint8_t) (count >> 8);
+	payload[2] = (uint8_t) __MTB_BUFFER_SIZE;
+	payload[3] = (uint8_t) (__MTB_BUFFER_SIZE >> 8);
+	send_frame(FRAME_MTB_INFO, payload, sizeof(payload), 0);
+
+	// Packets are stored little-endian, like the protocol
+	for (i = 0; i < count; i++) {
+		send_frame(FRAME_MTB_PACKET,
+				(const uint8_t *) &__mtb_buffer__[(first + i * PACKET_BYTES)
+						& (__MTB_BUFFER_SIZE - 1)], PACKET_BYTES, i + 1);
+	}
+
+	MTB->MASTER = master;
+#endif
+}
@@ -0,0 +1,88 @@
+// mtb_trace.h
+
+#ifndef MTB_TRACE_H
+#define MTB_TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @file    mtb_trace.h
+ * @brief   Micro Trace Buffer capture, triggers and dump over UART0.
+ *
+ * The Cortex-M0+ MTB stores one 8-byte packet in RAM for every
+ * non-sequential change of program flow: a branch, call, return, exception
+ * entry or exception return. A packet holds the source and destination
+ * addresses:
+ * - source bit 0 set: the packet is an exception entry (A bit);
+ * - destination bit 0 set: first packet after tracing (re)started (S bit).
+ *
+ * The buffer itself is reserved by mtb.c:
+ * - __MTB_BUFFER_SIZE sets its size in bytes, a power of two of at least
+ *   16. The default of 128 holds only 16 packets; a field capture build
+ *   typically uses 1024 or more.
+ * - __MTB_RAM_BANK places it in a given RAM bank.
+ * - __MTB_DISABLE removes it; this module then does nothing.
+ *
+ * Tracing costs no CPU time: the MTB writes packets on the bus in parallel
+ * with the core. The buffer wraps, so after a stop it holds the last
+ * __MTB_BUFFER_SIZE / 8 branches before the stop.
+ *
+ * Capture can be bracketed in code with MTB_Start()/MTB_Stop() (a few
+ * packets of the calls themselves are recorded), or left to the MTBDWT
+ * address comparators with MTB_Set_Triggers(), which needs no code change in
+ * the region being traced.
+ *
+ * A FRAME_MTB_DUMP frame from the host makes the Bluetooth polling task send
+ * the buffer over UART0 (see protocol.h), oldest packet first:
+ * - one FRAME_MTB_INFO with the packet count and buffer size;
+ * - one FRAME_MTB_PACKET per packet.
+ * Tracing is paused during the dump and then resumes where it was.
+ * tools/mtb_decode.py maps the packets to symbols in the ELF file.
+ */
+
+#if !defined (__MTB_BUFFER_SIZE)
+#define __MTB_BUFFER_SIZE 128
+#endif
+
+/**
+ * @brief Point the MTB at the reserved buffer, clear it and start tracing
+ *        continuously, so a dump always shows the latest branches.
+ *
+ * Call before starting the scheduler. Overrides any configuration left by a
+ * debugger.
+ */
+void Init_MTB(void);
+
+/**
+ * @brief Start tracing now.
+ */
+void MTB_Start(void);
+
+/**
+ * @brief Stop tracing now.
+ */
+void MTB_Stop(void);
+
+/**
+ * @brief Start and stop tracing when given instructions are fetched.
+ *
+ * Uses the two MTBDWT comparators. Tracing starts when the instruction at
+ * start is fetched, e.g. the first instruction of Motor_Control() or
+ * UART0_IRQHandler(). It stops when the instruction at stop is fetched, or,
+ * if stop is NULL, once the buffer is full, keeping the first branches after
+ * the start trigger rather than the last.
+ *
+ * @param start Code address that starts tracing, or NULL to start now.
+ * @param stop  Code address that stops tracing, or NULL.
+ */
+void MTB_Set_Triggers(const void *start, const void *stop);
+
+/**
+ * @brief Send the trace buffer over UART0.
+ *
+ * Blocks until the whole dump has been queued for transmission. Call from a
+ * task.
+ */
+void MTB_Dump(void);
+
+#endif // MTB_TRACE_H
@@ -0,0 +1,182 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    power.c
+ * @brief   Tickless idle with VLPS deep sleep between commands.
+ *
+ * vPortSuppressTicksAndSleep() runs in the idle task with the scheduler
+ * suspended. Interrupts are masked with PRIMASK while deciding whether to
+ * sleep: a pending interrupt still ends WFI, but its handler only runs once
+ * the tick count has been corrected and SysTick restarted.
+ *
+ * When LPTMR0 ends the sleep, the kernel is stepped one tick short and the
+ * SysTick interrupt is pended, so the task whose timeout expired is unblocked
+ * by a real tick as soon as interrupts are re-enabled.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <stdbool.h>
+#include "power.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "fsl_smc.h"
+#include "uart.h"
+#include "ramp.h"
+#include "tpm.h"
+#include "led.h"
+#include "sysclock.h"
+
+// LPTMR0 clock select and compare range
+#define LPTMR_LPO           (1)
+#define MAX_SUPPRESSED_TICKS (0xFFFFUL)
+
+#define LPTMR0_IRQ_PRIORITY (2)
+
+static power_stats_t stats;
+
+/**
+ * @brief LPTMR0 compare: the deep sleep has lasted the expected idle time.
+ *
+ * Normally left pending and cleared by vPortSuppressTicksAndSleep().
+ */
+void LPTMR0_IRQHandler(void) {
+	LPTMR0->CSR |= LPTMR_CSR_TCF_MASK;
+}
+
+/**
+ * @brief Check whether nothing running needs the clocks that stop in VLPS.
+ *
+ * @return true if the core may enter VLPS.
+ */
+static bool deep_sleep_allowed(void) {
+	return POWER_DEEP_SLEEP && Sysclock_Get_Mode() == SYSCLOCK_VLPR
+			&& Ramp_Is_Idle() && !Led_Is_Animating() && UART0_Tx_Pending() == 0
+			&& UART0_Rx_Quiet();
+}
+
+/**
+ * @brief Sleep in VLPS for up to expected_idle ticks. Call with interrupts masked.
+ *
+ * @param expected_idle Ticks until the next task timeout.
+ */
+static void deep_sleep(TickType_t expected_idle) {
+	uint32_t elapsed;
+	uint32_t start;
+	uint32_t cycles;
+
+	// Hand timekeeping over to LPTMR0 for the length of the sleep
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	LPTMR0->CMR = expected_idle - 1;
+	LPTMR0->CSR = LPTMR_CSR_TIE_MASK | LPTMR_CSR_TEN_MASK;
+	UART0_Set_Rx_Wake(true);
+
+	SMC_PreEnterStopModes();
+	if (SMC_SetPowerModeVlps(SMC) == kStatus_Success)
+		stats.deep_sleeps++;
+	else
+		stats.deep_aborts++;
+	start = TPM0->CNT;
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+	UART0_Set_Rx_Wake(false);
+	if (LPTMR0->CSR & LPTMR_CSR_TCF_MASK) {
+		elapsed = expected_idle;
+	} else {
+		// A write latches the counter for reading
+		LPTMR0->CNR = 0;
+		elapsed = LPTMR0->CNR;
+		if (elapsed >= expected_idle)
+			elapsed = expected_idle - 1;
+	}
+	// Disabling LPTMR0 clears the counter and the compare flag
+	LPTMR0->CSR = 0;
+	NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+
+	if (elapsed == expected_idle) {
+		vTaskStepTick(elapsed - 1);
+		SCB->ICSR = SCB_ICSR_PENDSTSET_Msk;
+	} else {
+		vTaskStepTick(elapsed);
+	}
+	stats.deep_ticks += elapsed;
+
+	// Restart SysTick from a full tick period
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+	// TPM0 wraps every PWM period
+	cycles = TPM0->CNT;
+	cycles = (cycles >= start) ? cycles - start : cycles + TPM_Get_Period() - start;
+	cycles *= TPM_Get_Cycles_Per_Count();
+	if (cycles > stats.max_wake_cycles)
+		stats.max_wake_cycles = cycles;
+
+	// Restores flash prefetch and re-enables interrupts
+	SMC_PostExitStopModes();
+}
+
+/**
+ * @brief FreeRTOS tickless idle hook, see portSUPPRESS_TICKS_AND_SLEEP.
+ *
+ * @param expected_idle Ticks until the next task timeout.
+ */
+void vPortSuppressTicksAndSleep(TickType_t expected_idle) {
+	if (expected_idle > MAX_SUPPRESSED_TICKS)
+		expected_idle = MAX_SUPPRESSED_TICKS;
+
+	__disable_irq();
+
+	// A task was readied or a context switch requested since the idle check
+	if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+		__enable_irq();
+		return;
+	}
+
+	if (deep_sleep_allowed()) {
+		deep_sleep(expected_idle);
+		return;
+	}
+
+	// The tick keeps running and ends the wait within one period
+	stats.wait_sleeps++;
+	__DSB();
+	__WFI();
+	__ISB();
+	__enable_irq();
+}
+
+// Refer power.h file for function brief and description
+void Init_Power(void) {
+	// LPTMR0 counts the 1 kHz LPO, one count per tick
+	configASSERT(configTICK_RATE_HZ == 1000);
+
+	SIM->SCGC5 |= SIM_SCGC5_LPTMR_MASK;
+
+	// Time counter mode on the 1 kHz LPO with the prescaler bypassed
+	LPTMR0->CSR = 0;
+	LPTMR0->PSR = LPTMR_PSR_PCS(LPTMR_LPO) | LPTMR_PSR_PBYP_MASK;
+
+	NVIC_SetPriority(LPTMR0_IRQn, LPTMR0_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+	NVIC_EnableIRQ(LPTMR0_IRQn);
+
+	// PMPROT is write-once after reset; VLPR/VLPW/VLPS only
+	SMC_SetPowerModeProtection(SMC, kSMC_AllowPowerModeVlp);
+}
+
+// Refer power.h file for function brief and description
+void Power_Get_Stats(power_stats_t *out) {
+	taskENTER_CRITICAL();
+	*out = stats;
+	taskEXIT_CRITICAL();
+}
@@ -0,0 +1,70 @@
+// power.h
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+/**
+ * @file    power.h
+ * @brief   Tickless idle with VLPS deep sleep between commands.
+ *
+ * FreeRTOS runs with configUSE_TICKLESS_IDLE 2, so the idle task calls the
+ * application-provided vPortSuppressTicksAndSleep() in power.c. The SDK's
+ * own LPTMR implementation, freertos/fsl_tickless_lptmr.c, is left out of
+ * the build in .cproject, and the tick is set up by fsl_tickless_systick.c.
+ * When idle:
+ *
+ * - If the system clock is parked in VLPR (see clock_policy.h), the motors
+ *   are stopped and UART0 has nothing left to send and has been quiet for
+ *   a tick, SysTick is stopped and the core enters VLPS through fsl_smc.
+ *   LPTMR0, clocked from the 1 kHz LPO (one count per RTOS tick), ends the
+ *   sleep when the next task timeout is due and tells the kernel how many
+ *   ticks passed.
+ * - Otherwise the core only waits for the next interrupt (WAIT mode) with the
+ *   tick running, since TPM0 must keep driving the motors.
+ *
+ * UART0 is clocked from MCGIRCLK, which keeps running in VLPS, so incoming
+ * bytes are received whole. The receive active-edge interrupt is armed during
+ * sleep so the start bit of the first byte already wakes the core.
+ *
+ * In VLPR the TPMs count MCGIRCLK and TPM0/TPM2 keep generating the LED PWM
+ * in VLPS. The ramp generator is parked and TPM1 frozen, so neither wakes
+ * the core. VLPS is not entered from RUN, where the PLL would stop and have
+ * to relock on every wake-up; the clock policy parks within CLOCK_PARK_MS of
+ * the motors stopping.
+ *
+ * LLS is not used: UART0 stops in LLS, so the byte whose start bit woke the
+ * core through the LLWU (UART0 RX on PTD6 is LLWU_P15) would be lost.
+ */
+
+// Set to 0 to keep the core in WAIT mode when idle, e.g. while debugging
+#define POWER_DEEP_SLEEP (1)
+
+typedef struct {
+	uint32_t wait_sleeps;      // Idle periods spent in WAIT with the tick running
+	uint32_t deep_sleeps;      // Idle periods spent in VLPS
+	uint32_t deep_aborts;      // VLPS entries abandoned by a pending interrupt
+	uint32_t deep_ticks;       // RTOS ticks spent in VLPS
+	uint32_t max_wake_cycles;  // Worst VLPS exit to interrupts re-enabled, in core cycles
+} power_stats_t;
+
+/**
+ * @brief Set up LPTMR0 and allow the very low power modes.
+ *
+ * Call after Init_Sysclock() and before starting the scheduler.
+ */
+void Init_Power(void);
+
+/**
+ * @brief Get a snapshot of the idle residency and wake-up statistics.
+ *
+ * Residency in VLPS is deep_ticks out of xTaskGetTickCount(). The worst
+ * wake-to-actuation latency is max_wake_cycles plus the VLPS recovery time
+ * of the KL25Z (about 4.6 us) plus the normal receive-to-actuation path.
+ *
+ * @param stats Destination for the statistics.
+ */
+void Power_Get_Stats(power_stats_t *stats);
+
+#endif // POWER_H
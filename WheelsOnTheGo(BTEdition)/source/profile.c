@@ -0,0 +1,231 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    profile.c
+ * @brief   FreeRTOS run-time statistics and periodic profiling snapshots.
+ *
+ * CPU shares are computed from the difference between two snapshots, so they
+ * describe the last PROFILE_PERIOD_MS rather than the whole uptime. The
+ * snapshot task only holds the scheduler while uxTaskGetSystemState() walks
+ * the task lists; encoding and queuing the frames run preemptibly at low
+ * priority.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <string.h>
+#include "profile.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "sysclock.h"
+
+#ifdef PROFILE_SNAPSHOTS
+#include "uart.h"
+#include "protocol.h"
+#include "command_queue.h"
+#include "kernel_objects.h"
+#endif
+
+// PIT channel 0 divides the bus clock, channel 1 counts its expiries
+#define PIT_PRESCALER  (0)
+#define PIT_COUNTER    (1)
+
+#ifdef PROFILE_SNAPSHOTS
+
+#define NAME_BYTES     (8)
+#define PERMILLE       (1000U)
+
+typedef struct {
+	TaskHandle_t handle;
+	uint32_t run_time;
+} previous_t;
+
+static TaskStatus_t status[PROFILE_MAX_TASKS];
+static previous_t previous[PROFILE_MAX_TASKS];
+static uint32_t previous_total;
+static uint8_t tx_seq;
+
+/**
+ * @brief Store a 16-bit value little-endian.
+ *
+ * @param out   Destination.
+ * @param value Value to store.
+ *
+ * @return Pointer just past the stored bytes.
+ */
+static uint8_t *put16(uint8_t *out, uint32_t value) {
+	out[0] = (uint8_t) value;
+	out[1] = (uint8_t) (value >> 8);
+	return out + 2;
+}
+
+/**
+ * @brief Store a 32-bit value little-endian.
+ *
+ * @param out   Destination.
+ * @param value Value to store.
+ *
+ * @return Pointer just past the stored bytes.
+ */
+static uint8_t *put32(uint8_t *out, uint32_t value) {
+	out = put16(out, value);
+	return put16(out, value >> 16);
+}
+
+/**
+ * @brief Frame a payload and queue it for transmission.
+ *
+ * @param type Frame type.
+ * @param data Payload.
+ * @param len  Payload length.
+ */
+static void send_frame(uint8_t type, const uint8_t *data, uint32_t len) {
+	uint8_t frame[PROTOCOL_MAX_PAYLOAD + PROTOCOL_FRAME_OVERHEAD];
+
+	len = Protocol_Encode(tx_seq++, type, data, len, frame);
+	UART0_Transmit(frame, len);
+}
+
+/**
+ * @brief Find a task's run time at the previous snapshot and update it.
+ *
+ * @param handle   Task.
+ * @param run_time Task's run time now.
+ *
+ * @return Run time accumulated since the previous snapshot.
+ */
+static uint32_t run_time_delta(TaskHandle_t handle, uint32_t run_time) {
+	uint32_t i;
+	uint32_t delta;
+
+	for (i = 0; i < PROFILE_MAX_TASKS; i++) {
+		if (previous[i].handle == handle || previous[i].handle == NULL)
+			break;
+	}
+	if (i == PROFILE_MAX_TASKS)
+		return 0;
+
+	// A task seen for the first time is charged from the previous snapshot
+	delta = run_time - previous[i].run_time;
+	previous[i].handle = handle;
+	previous[i].run_time = run_time;
+	return delta;
+}
+
+/**
+ * @brief Send one snapshot: a FRAME_SYS_STATS followed by a FRAME_TASK_STATS
+ *        per task.
+ */
+static void send_snapshot(void) {
+	uint8_t payload[PROTOCOL_MAX_PAYLOAD - 1];
+	uint8_t *p;
+	command_stats_t commands;
+	uint32_t tasks;
+	uint32_t total;
+	uint32_t elapsed;
+	uint32_t delta;
+	uint32_t i;
+	size_t name_len;
+
+	tasks = uxTaskGetSystemState(status, PROFILE_MAX_TASKS, &total);
+	elapsed = total - previous_total;
+	previous_total = total;
+	Command_Get_Stats(&commands);
+
+	p = put32(payload, xTaskGetTickCount() * portTICK_PERIOD_MS);
+#if configSUPPORT_DYNAMIC_ALLOCATION
+	p = put16(p, xPortGetFreeHeapSize());
+	p = put16(p, xPortGetMinimumEverFreeHeapSize());
+#else
+	// No heap in STATIC_KERNEL builds
+	p = put16(p, 0);
+	p = put16(p, 0);
+#endif
+	*p++ = (uint8_t) tasks;
+	*p++ = (uint8_t) commands.depth;
+	*p++ = (uint8_t) commands.max_depth;
+	p = put16(p, UART0_Tx_Pending());
+	send_frame(FRAME_SYS_STATS, payload, p - payload);
+
+	for (i = 0; i < tasks; i++) {
+		delta = run_time_delta(status[i].xHandle, status[i].ulRunTimeCounter);
+
+		p = payload;
+		*p++ = (uint8_t) status[i].xTaskNumber;
+		*p++ = (uint8_t) status[i].eCurrentState;
+		*p++ = (uint8_t) status[i].uxCurrentPriority;
+		p = put16(p, (elapsed == 0) ? 0 : delta * PERMILLE / elapsed);
+		p = put16(p, status[i].usStackHighWaterMark);
+		name_len = strlen(status[i].pcTaskName);
+		if (name_len > NAME_BYTES)
+			name_len = NAME_BYTES;
+		memcpy(p, status[i].pcTaskName, name_len);
+		p += name_len;
+		send_frame(FRAME_TASK_STATS, payload, p - payload);
+	}
+}
+
+/**
+ * @brief Task that sends a profiling snapshot every PROFILE_PERIOD_MS.
+ *
+ * @param pvParameter Task parameters (unused).
+ */
+static void task_profile(void *pvParameter) {
+	TickType_t wake = xTaskGetTickCount();
+
+	while (1) {
+		vTaskDelayUntil(&wake, pdMS_TO_TICKS(PROFILE_PERIOD_MS));
+
+		// Never displace other output or wait for the UART
+		if (UART0_Tx_Pending() == 0)
+			send_snapshot();
+	}
+}
+
+#endif // PROFILE_SNAPSHOTS
+
+// Refer profile.h file for function brief and description
+void Profile_Init_Counter(void) {
+	SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+
+	// Enable the PIT and freeze it while the debugger halts the core
+	PIT->MCR = PIT_MCR_FRZ_MASK;
+
+	PIT->CHANNEL[PIT_COUNTER].TCTRL = 0;
+	PIT->CHANNEL[PIT_COUNTER].LDVAL = 0xFFFFFFFFUL;
+	PIT->CHANNEL[PIT_COUNTER].TCTRL = PIT_TCTRL_CHN_MASK | PIT_TCTRL_TEN_MASK;
+
+	PIT->CHANNEL[PIT_PRESCALER].TCTRL = 0;
+	PIT->CHANNEL[PIT_PRESCALER].LDVAL = BUSCLOCK_FREQUENCY / PROFILE_COUNTER_HZ - 1;
+	PIT->CHANNEL[PIT_PRESCALER].TCTRL = PIT_TCTRL_TEN_MASK;
+}
+
+// Refer profile.h file for function brief and description
+uint32_t Profile_Get_Counter(void) {
+	// Channel 1 counts down from 0xFFFFFFFF
+	return ~PIT->CHANNEL[PIT_COUNTER].CVAL;
+}
+
+// Refer profile.h file for function brief and description
+void Profile_Set_Counter_Reload(uint32_t reload) {
+	if (SIM->SCGC6 & SIM_SCGC6_PIT_MASK)
+		PIT->CHANNEL[PIT_PRESCALER].LDVAL = reload;
+}
+
+// Refer profile.h file for function brief and description
+void Init_Profile(uint32_t priority) {
+#ifdef PROFILE_SNAPSHOTS
+	Kernel_Create_Task(KERNEL_TASK_PROFILE, task_profile, priority);
+#else
+	(void) priority;
+#endif
+}
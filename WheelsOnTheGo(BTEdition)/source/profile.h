@@ -0,0 +1,79 @@
+// profile.h
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/**
+ * @file    profile.h
+ * @brief   FreeRTOS run-time statistics and periodic profiling snapshots.
+ *
+ * The run-time stats counter is fed from the PIT: channel 0 divides the
+ * bus clock (24 MHz in RUN, 800 kHz in VLPR) down to PROFILE_COUNTER_HZ,
+ * and channel 1 is chained to it as a free-running 32-bit counter. Reading
+ * it is a single register load and it needs no interrupts. The PIT stops in VLPS, so time spent in deep sleep
+ * is not counted towards any task.
+ *
+ * When PROFILE_SNAPSHOTS is defined (e.g. in a dedicated build
+ * configuration), Init_Profile() creates a low-priority task. Every
+ * PROFILE_PERIOD_MS it sends one snapshot over UART0 as protocol frames
+ * (see protocol.h):
+ * - one FRAME_SYS_STATS with uptime, heap_4 free and minimum-ever-free
+ *   (zero in STATIC_KERNEL builds), command queue depth and transmit FIFO
+ *   backlog;
+ * - one FRAME_TASK_STATS per task with CPU share over the last period,
+ *   stack high-water mark, state and priority.
+ *
+ * A snapshot is skipped unless the transmit FIFO is empty, so it never
+ * displaces other output or waits for the UART. tools/profile_decode.py
+ * renders the frames on the host.
+ */
+
+// Run-time stats counter rate, 20x the tick rate
+#define PROFILE_COUNTER_HZ (20000)
+
+// Interval between snapshots
+#define PROFILE_PERIOD_MS  (1000)
+
+// Most tasks reported in one snapshot
+#define PROFILE_MAX_TASKS  (8)
+
+/**
+ * @brief Start the run-time stats counter.
+ *
+ * Called by the kernel through portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+ * when the scheduler starts.
+ */
+void Profile_Init_Counter(void);
+
+/**
+ * @brief Read the run-time stats counter.
+ *
+ * Called by the kernel through portGET_RUN_TIME_COUNTER_VALUE() on every
+ * context switch.
+ *
+ * @return Counts of 1 / PROFILE_COUNTER_HZ seconds since the scheduler started.
+ */
+uint32_t Profile_Get_Counter(void);
+
+/**
+ * @brief Reload the counter prescaler for a new bus clock.
+ *
+ * Takes effect at the end of the current count, so no count is lost or
+ * shortened. Does nothing before the counter has been started.
+ *
+ * @param reload Bus clocks per count minus one.
+ */
+void Profile_Set_Counter_Reload(uint32_t reload);
+
+/**
+ * @brief Create the snapshot task if PROFILE_SNAPSHOTS is defined.
+ *
+ * Call before starting the scheduler.
+ *
+ * @param priority Priority of the snapshot task, normally just above idle.
+ */
+void Init_Profile(uint32_t priority);
+
+#endif // PROFILE_H
@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    protocol.c
+ * @brief   Framed binary command protocol over the RN-41 Bluetooth link.
+ *
+ * The parser keeps the bytes of the frame in progress, starting at its SYNC
+ * byte, and re-evaluates the buffer after every byte. When the buffer holds
+ * an invalid frame, everything up to the next SYNC inside the buffer is
+ * dropped and evaluation continues from there, so a frame that began inside
+ * a corrupted one is still found. Bytes are timestamped as they arrive, and
+ * a buffer left incomplete for longer than PROTOCOL_GAP_MS is dropped whole.
+ *
+ * The module has no dependency on the MCU or on FreeRTOS.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <string.h>
+#include "protocol.h"
+
+// Bytes framing the payload: SYNC, LEN, SEQ and CRC
+#define FRAME_OVERHEAD  (4)
+#define LEN_OFFSET      (1)
+#define SEQ_OFFSET      (2)
+#define TYPE_OFFSET     (3)
+#define CRC8_POLY       (0x07)
+// SEQ gaps larger than this are treated as duplicates or reordering
+#define MAX_SEQ_GAP     (127)
+
+// Refer protocol.h file for function brief and description
+uint8_t Protocol_CRC8(const uint8_t *data, uint32_t len) {
+	uint8_t crc = 0;
+	uint32_t i;
+	uint8_t bit;
+
+	for (i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ CRC8_POLY) : (uint8_t) (crc << 1);
+	}
+	return crc;
+}
+
+// Refer protocol.h file for function brief and description
+uint32_t Protocol_Encode(uint8_t seq, uint8_t type, const uint8_t *data,
+		uint32_t len, uint8_t *out) {
+	if (len > PROTOCOL_MAX_PAYLOAD - 1)
+		return 0;
+
+	out[0] = PROTOCOL_SYNC;
+	out[LEN_OFFSET] = (uint8_t) (len + 1);
+	out[SEQ_OFFSET] = seq;
+	out[TYPE_OFFSET] = type;
+	memcpy(&out[TYPE_OFFSET + 1], data, len);
+	out[TYPE_OFFSET + 1 + len] = Protocol_CRC8(&out[LEN_OFFSET], len + 3);
+	return len + PROTOCOL_FRAME_OVERHEAD;
+}
+
+// Refer protocol.h file for function brief and description
+void Protocol_Init(protocol_parser_t *parser) {
+	memset(parser, 0, sizeof(*parser));
+}
+
+/**
+ * @brief Drop the buffered bytes up to the next SYNC after the first byte.
+ *
+ * @param parser Parser instance.
+ */
+static void resync(protocol_parser_t *parser) {
+	uint8_t i;
+
+	for (i = 1; i < parser->count; i++) {
+		if (parser->buf[i] == PROTOCOL_SYNC)
+			break;
+	}
+	parser->count -= i;
+	memmove(parser->buf, &parser->buf[i], parser->count);
+}
+
+/**
+ * @brief Try to decode a frame from the buffered bytes.
+ *
+ * @param parser Parser instance.
+ * @param frame  Destination for a decoded frame.
+ *
+ * @return PROTO_FRAME if a frame was decoded, PROTO_NONE otherwise.
+ */
+static protocol_result_t evaluate(protocol_parser_t *parser,
+		protocol_frame_t *frame) {
+	uint8_t len;
+	uint8_t total;
+	uint8_t gap;
+
+	while (parser->count > 1) {
+		len = parser->buf[LEN_OFFSET];
+		if (len == 0 || len > PROTOCOL_MAX_PAYLOAD) {
+			parser->stats.len_errors++;
+			resync(parser);
+			continue;
+		}
+
+		total = len + FRAME_OVERHEAD;
+		if (parser->count < total)
+			return PROTO_NONE;
+
+		if (Protocol_CRC8(&parser->buf[LEN_OFFSET], len + 2)
+				!= parser->buf[total - 1]) {
+			parser->stats.crc_errors++;
+			resync(parser);
+			continue;
+		}
+
+		frame->seq = parser->buf[SEQ_OFFSET];
+		frame->type = parser->buf[TYPE_OFFSET];
+		frame->len = len - 1;
+		memcpy(frame->data, &parser->buf[TYPE_OFFSET + 1], frame->len);
+
+		if (parser->seq_valid) {
+			gap = (uint8_t) (frame->seq - parser->last_seq - 1);
+			if (gap <= MAX_SEQ_GAP)
+				parser->stats.lost += gap;
+		}
+		parser->last_seq = frame->seq;
+		parser->seq_valid = true;
+		parser->stats.frames++;
+
+		parser->count -= total;
+		memmove(parser->buf, &parser->buf[total], parser->count);
+		return PROTO_FRAME;
+	}
+	return PROTO_NONE;
+}
+
+// Refer protocol.h file for function brief and description
+protocol_result_t Protocol_Parse(protocol_parser_t *parser, uint32_t now,
+		const uint8_t *data, uint32_t len, uint32_t *consumed,
+		protocol_frame_t *frame, uint8_t *legacy) {
+	protocol_result_t result;
+	uint8_t byte;
+
+	*consumed = 0;
+
+	// Bytes left over from a resync may already hold a complete frame
+	result = evaluate(parser, frame);
+	if (result != PROTO_NONE)
+		return result;
+
+	// A frame cut short by the sender never completes; what follows is new
+	if (parser->count > 0 && len > 0 && now - parser->last_byte > PROTOCOL_GAP_MS) {
+		parser->stats.timeouts++;
+		parser->count = 0;
+	}
+
+	while (*consumed < len) {
+		byte = data[(*consumed)++];
+
+		if (parser->count == 0 && byte != PROTOCOL_SYNC) {
+			*legacy = byte;
+			return PROTO_LEGACY;
+		}
+
+		parser->buf[parser->count++] = byte;
+		parser->last_byte = now;
+		result = evaluate(parser, frame);
+		if (result != PROTO_NONE)
+			return result;
+	}
+	return PROTO_NONE;
+}
@@ -0,0 +1,179 @@
+// protocol.h
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    protocol.h
+ * @brief   Framed binary command protocol over the RN-41 Bluetooth link.
+ *
+ * Frame layout (all fields one byte unless noted):
+ *
+ *   | SYNC 0xA5 | LEN | SEQ | TYPE | DATA (LEN - 1 bytes) | CRC-8 |
+ *
+ * - LEN counts TYPE and DATA, so it is at least 1 and at most
+ *   PROTOCOL_MAX_PAYLOAD.
+ * - SEQ increments by one per frame; gaps are counted as lost frames.
+ * - CRC-8 uses polynomial 0x07 with initial value 0 and covers LEN, SEQ,
+ *   TYPE and DATA.
+ *
+ * Frame types:
+ * - FRAME_DRIVE: DATA = throttle (int8), steer (int8). Positive throttle
+ *   drives forward and positive steer turns right; +/-127 is full scale.
+ * - FRAME_TRACE_DUMP: no DATA. Asks for the trace recorder contents (see
+ *   trace.h).
+ * - FRAME_MTB_DUMP: no DATA. Asks for the Micro Trace Buffer contents (see
+ *   mtb_trace.h).
+ * - FRAME_CONFIG_SET: key (u8), value (u32). Changes a setting (see
+ *   config.h).
+ * - FRAME_CONFIG_GET: key (u8). Reads a setting.
+ * - FRAME_HEARTBEAT: no DATA. Keeps the link supervised while idle (see
+ *   failsafe.h).
+ *
+ * Types with the top bit set are sent by the robot; multi-byte fields are
+ * little-endian:
+ * - FRAME_SYS_STATS: uptime_ms (u32), heap_free (u16), heap_min_free (u16),
+ *   tasks (u8), cmd_depth (u8), cmd_max_depth (u8), tx_pending (u16).
+ * - FRAME_TASK_STATS: task_number (u8), state (u8), priority (u8),
+ *   cpu_permille (u16), stack_free_words (u16), name (up to 8 chars).
+ *   One per task, following the FRAME_SYS_STATS of the same snapshot.
+ * - FRAME_TRACE_INFO: events (u16), cycles_per_tick (u32), overwritten (u32).
+ *   Starts a trace dump.
+ * - FRAME_TRACE_NAME: kind (u8, 0 = task, 1 = queue), id (u8),
+ *   name (up to 8 chars).
+ * - FRAME_TRACE_EVENT: time_cycles (u32), type (u8), task_id (u8), arg (u16).
+ *   One per event, oldest first.
+ * - FRAME_MTB_INFO: packets (u16), buffer_bytes (u16). Starts an MTB dump.
+ * - FRAME_MTB_PACKET: source (u32), destination (u32). One per packet,
+ *   oldest first.
+ * - FRAME_CONFIG_VALUE: key (u8), value (u32), status (u8, config_status_t).
+ *   Answers FRAME_CONFIG_SET and FRAME_CONFIG_GET with the current value.
+ * - FRAME_LOG: tick (u16), then tokenized log records (see log_codec.h).
+ *   Sent unprompted.
+ *
+ * Any byte received outside a frame is handed back as a legacy
+ * single-character command, so the original '1'..'4' controller app still
+ * works alongside framed clients. A frame must arrive without a pause of
+ * PROTOCOL_GAP_MS between its bytes: a partial frame is dropped after such
+ * a pause, so a stray SYNC on the link cannot hold on to the legacy
+ * characters that follow it.
+ *
+ * The parser is a byte-at-a-time state machine over a fixed buffer: it never
+ * allocates, and after a CRC or length error it rescans the bytes it has
+ * already consumed for the next SYNC, so it resynchronizes without losing a
+ * frame that started inside the corrupted one.
+ */
+
+#define PROTOCOL_SYNC        (0xA5)
+#define PROTOCOL_MAX_PAYLOAD (16)
+// Longest pause inside a frame; a 20-byte frame takes 21 ms at 9600 baud
+#define PROTOCOL_GAP_MS      (50)
+
+typedef enum {
+	FRAME_DRIVE = 0x01,
+	FRAME_TRACE_DUMP = 0x02,
+	FRAME_MTB_DUMP = 0x03,
+	FRAME_CONFIG_SET = 0x04,
+	FRAME_CONFIG_GET = 0x05,
+	FRAME_HEARTBEAT = 0x06,
+	FRAME_SYS_STATS = 0x81,
+	FRAME_TASK_STATS = 0x82,
+	FRAME_TRACE_INFO = 0x83,
+	FRAME_TRACE_NAME = 0x84,
+	FRAME_TRACE_EVENT = 0x85,
+	FRAME_MTB_INFO = 0x86,
+	FRAME_MTB_PACKET = 0x87,
+	FRAME_CONFIG_VALUE = 0x88,
+	FRAME_LOG = 0x89
+} frame_type_t;
+
+// Bytes added around the payload by Protocol_Encode(): SYNC, LEN, SEQ, TYPE, CRC
+#define PROTOCOL_FRAME_OVERHEAD (5)
+
+typedef struct {
+	uint8_t seq;
+	uint8_t type;
+	uint8_t len;                            // Bytes in data
+	uint8_t data[PROTOCOL_MAX_PAYLOAD - 1];
+} protocol_frame_t;
+
+typedef enum {
+	PROTO_NONE = 0,   // Byte consumed, nothing complete yet
+	PROTO_FRAME,      // A valid frame was decoded
+	PROTO_LEGACY      // A byte outside any frame, returned as-is
+} protocol_result_t;
+
+typedef struct {
+	uint32_t frames;       // Valid frames decoded
+	uint32_t crc_errors;   // Frames rejected on CRC
+	uint32_t len_errors;   // Frames rejected on an impossible length
+	uint32_t lost;         // Frames missing according to SEQ gaps
+	uint32_t timeouts;     // Partial frames dropped after PROTOCOL_GAP_MS
+} protocol_stats_t;
+
+typedef struct {
+	uint8_t count;                          // Bytes held in buf
+	uint8_t buf[PROTOCOL_MAX_PAYLOAD + 4];  // SYNC, LEN, SEQ, payload, CRC
+	uint8_t last_seq;
+	bool seq_valid;
+	uint32_t last_byte;                     // Tick of the last byte buffered
+	protocol_stats_t stats;
+} protocol_parser_t;
+
+/**
+ * @brief Reset a parser to its initial state and clear its statistics.
+ *
+ * @param parser Parser instance.
+ */
+void Protocol_Init(protocol_parser_t *parser);
+
+/**
+ * @brief Feed received bytes to the parser.
+ *
+ * Stops at the first complete frame or legacy byte and reports how many
+ * input bytes were consumed; call again with the remaining bytes. A partial
+ * frame whose last byte is more than PROTOCOL_GAP_MS older than now is
+ * dropped before the new bytes are parsed.
+ *
+ * @param parser   Parser instance.
+ * @param now      Time the bytes were received, in milliseconds.
+ * @param data     Received bytes.
+ * @param len      Number of received bytes.
+ * @param consumed Destination for the number of bytes consumed.
+ * @param frame    Destination for a decoded frame (PROTO_FRAME).
+ * @param legacy   Destination for a legacy byte (PROTO_LEGACY).
+ *
+ * @return What, if anything, was produced.
+ */
+protocol_result_t Protocol_Parse(protocol_parser_t *parser, uint32_t now,
+		const uint8_t *data, uint32_t len, uint32_t *consumed, protocol_frame_t *frame,
+		uint8_t *legacy);
+
+/**
+ * @brief Build a frame.
+ *
+ * @param seq  Sequence number to send.
+ * @param type Frame type.
+ * @param data Payload after TYPE.
+ * @param len  Payload length, at most PROTOCOL_MAX_PAYLOAD - 1.
+ * @param out  Destination, at least len + PROTOCOL_FRAME_OVERHEAD bytes.
+ *
+ * @return Frame length in bytes, or 0 if the payload is too long.
+ */
+uint32_t Protocol_Encode(uint8_t seq, uint8_t type, const uint8_t *data,
+		uint32_t len, uint8_t *out);
+
+/**
+ * @brief Compute the protocol CRC-8 (polynomial 0x07, initial value 0).
+ *
+ * @param data Bytes to checksum.
+ * @param len  Number of bytes.
+ *
+ * @return CRC-8 of data.
+ */
+uint8_t Protocol_CRC8(const uint8_t *data, uint32_t len);
+
+#endif // PROTOCOL_H
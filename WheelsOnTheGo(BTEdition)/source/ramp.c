@@ -0,0 +1,299 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    ramp.c
+ * @brief   Soft-start PWM ramp generator for the drive motors on TPM0.
+ *
+ * The TPM0 overflow interrupt advances each wheel once per PWM period. CnV
+ * writes in PWM mode only take effect at the next overflow, so every period
+ * gets a whole pulse of either the old or the new duty.
+ *
+ * The progress through a ramp is a Q24 phase, which is converted to a Q15
+ * profile value by interpolating a table. The per-period phase step is
+ * computed when a target is set, in task context, so the interrupt does no
+ * division (the Cortex-M0+ has no hardware divider).
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "ramp.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "tpm.h"
+#include "board_pins.h"
+
+// PWM periods per second on TPM0
+#define MS_TO_PERIODS(ms) ((ms) * TPM_PWM_FREQUENCY / 1000U)
+#define DEAD_PERIODS      (MS_TO_PERIODS(RAMP_DEAD_TIME_MS))
+
+// Longest accepted full-scale ramp, keeps the step computation within 32 bits
+#define MAX_RAMP_MS       (5000)
+
+// Ramp length of a retarget scaled from the full-scale time
+#define RAMP_PROPORTIONAL (UINT32_MAX)
+
+// Ramp phase in Q24 and its split into table segments. The step per period
+// is truncated, so the phase is fine enough for a 5000 ms ramp to end
+// within 0.1% of its time
+#define PHASE_END         (1UL << 24)
+#define SEGMENT_SHIFT     (19)
+#define SEGMENTS          (PHASE_END >> SEGMENT_SHIFT)
+#define SEGMENT_MASK      ((1UL << SEGMENT_SHIFT) - 1)
+
+// TPM0 channels of the two motors
+#define CH0               (0)
+#define CH5               (5)
+
+#define TPM0_IRQ_PRIORITY (1)
+
+// The H-bridge inputs are written through FPTB
+_Static_assert(BOARD_PORT_OF_MOTORA_CW == BOARD_PORT_B
+		&& BOARD_PORT_OF_MOTORA_CCW == BOARD_PORT_B
+		&& BOARD_PORT_OF_MOTORB_CW == BOARD_PORT_B
+		&& BOARD_PORT_OF_MOTORB_CCW == BOARD_PORT_B,
+		"H-bridge inputs must be on port B");
+
+typedef struct {
+	uint32_t channel;      // TPM0 channel driving the wheel's PWM input
+	hbridge_t bridge;      // Direction state of the wheel's H-bridge inputs
+	int32_t duty;          // Duty output this period
+	int32_t from;          // Duty at the start of the ramp
+	int32_t to;            // Target duty
+	uint32_t phase;        // Q24 progress through the ramp
+	uint32_t step;         // Phase advance per period
+} wheel_t;
+
+// Profile shapes from 0 to 1 in Q15, sampled at SEGMENTS + 1 points
+static const uint16_t profiles[RAMP_PROFILES][SEGMENTS + 1] = {
+	// RAMP_LINEAR
+	{ 0, 1024, 2048, 3072, 4096, 5120, 6144, 7168, 8192, 9216, 10240, 11264,
+	  12288, 13312, 14336, 15360, 16384, 17408, 18432, 19456, 20480, 21504,
+	  22528, 23552, 24576, 25600, 26624, 27648, 28672, 29696, 30720, 31744,
+	  32768 },
+	// RAMP_S_CURVE: smoothstep, 3t^2 - 2t^3
+	{ 0, 94, 368, 810, 1408, 2150, 3024, 4018, 5120, 6318, 7600, 8954, 10368,
+	  11830, 13328, 14850, 16384, 17918, 19440, 20938, 22400, 23814, 25168,
+	  26450, 27648, 28750, 29744, 30618, 31360, 31958, 32400, 32674, 32768 }
+};
+
+static wheel_t wheels[RAMP_MOTORS] = {
+	[RAMP_MOTOR_A] = { .channel = CH5, .phase = PHASE_END },
+	[RAMP_MOTOR_B] = { .channel = CH0, .phase = PHASE_END }
+};
+
+static const uint16_t *profile = profiles[RAMP_S_CURVE];
+static uint32_t full_scale_periods = MS_TO_PERIODS(RAMP_DEFAULT_MS);
+
+/**
+ * @brief Evaluate the active profile at a ramp phase.
+ *
+ * @param phase Q24 progress, 0..PHASE_END.
+ *
+ * @return Profile value in Q15, 0..32768.
+ */
+static int32_t shape(uint32_t phase) {
+	uint32_t i = phase >> SEGMENT_SHIFT;
+	int32_t frac = (int32_t) (phase & SEGMENT_MASK);
+
+	if (i >= SEGMENTS)
+		return profile[SEGMENTS];
+	return profile[i]
+			+ ((((int32_t) profile[i + 1] - profile[i]) * frac) >> SEGMENT_SHIFT);
+}
+
+/**
+ * @brief Restart a wheel's ramp towards its target. Call with interrupts masked.
+ *
+ * If a direction change is pending the ramp will start from zero once the
+ * new direction is applied.
+ *
+ * @param w       Wheel to retarget.
+ * @param periods PWM periods the ramp takes, or RAMP_PROPORTIONAL for the
+ *                full-scale time scaled by the size of the change.
+ */
+static void retarget(wheel_t *w, uint32_t periods) {
+	int32_t from = (w->bridge.applied == w->bridge.target) ? w->duty : 0;
+	uint32_t delta = (uint32_t) ((w->to > from) ? w->to - from : from - w->to);
+
+	if (periods == RAMP_PROPORTIONAL)
+		periods = full_scale_periods * delta / TPM_PWM_PERIOD;
+
+	w->from = from;
+	w->phase = 0;
+	w->step = (periods == 0) ? PHASE_END : PHASE_END / periods;
+	if (w->step == 0)
+		w->step = 1;
+}
+
+/**
+ * @brief Advance one wheel by one PWM period.
+ *
+ * @param w     Wheel to advance.
+ * @param write H-bridge input changes of this period.
+ */
+static void advance(wheel_t *w, hbridge_write_t *write) {
+	switch (Hbridge_Step(&w->bridge, DEAD_PERIODS, write)) {
+	case HBRIDGE_RELEASED:
+		// Cut the duty together with the inputs
+		w->duty = 0;
+		break;
+	case HBRIDGE_ENGAGED:
+		w->from = 0;
+		w->phase = 0;
+		break;
+	default:
+		break;
+	}
+
+	if (w->bridge.applied != HBRIDGE_COAST && w->phase < PHASE_END) {
+		w->phase += w->step;
+		if (w->phase > PHASE_END)
+			w->phase = PHASE_END;
+		w->duty = w->from + (((w->to - w->from) * shape(w->phase)) >> 15);
+	}
+
+	// Low-true PWM: a higher CnV gives a lower speed
+	TPM0->CONTROLS[w->channel].CnV = TPM_PWM_PERIOD - w->duty;
+}
+
+/**
+ * @brief TPM0 overflow: advance both wheels once per PWM period.
+ */
+void TPM0_IRQHandler(void) {
+	hbridge_write_t write = { 0, 0 };
+
+	TPM0->SC |= TPM_SC_TOF_MASK;
+
+	advance(&wheels[RAMP_MOTOR_A], &write);
+	advance(&wheels[RAMP_MOTOR_B], &write);
+
+	// Clear before set, so a wheel only ever passes through coast
+	if (write.clear != 0)
+		FPTB->PCOR = write.clear;
+	if (write.set != 0)
+		FPTB->PSOR = write.set;
+}
+
+// Refer ramp.h file for function brief and description
+void Init_Ramp(void) {
+	Hbridge_Init(&wheels[RAMP_MOTOR_A].bridge, BOARD_MASK(MOTORA_CW),
+			BOARD_MASK(MOTORA_CCW));
+	Hbridge_Init(&wheels[RAMP_MOTOR_B].bridge, BOARD_MASK(MOTORB_CW),
+			BOARD_MASK(MOTORB_CCW));
+	FPTB->PCOR = BOARD_MASK(MOTORA_CW) | BOARD_MASK(MOTORA_CCW)
+			| BOARD_MASK(MOTORB_CW) | BOARD_MASK(MOTORB_CCW);
+
+	NVIC_SetPriority(TPM0_IRQn, TPM0_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(TPM0_IRQn);
+	NVIC_EnableIRQ(TPM0_IRQn);
+
+	TPM0->SC |= TPM_SC_TOIE_MASK;
+}
+
+// Refer ramp.h file for function brief and description
+void Ramp_Set_Profile(ramp_profile_t new_profile, uint32_t full_scale_ms) {
+	if (new_profile >= RAMP_PROFILES)
+		return;
+	if (full_scale_ms > MAX_RAMP_MS)
+		full_scale_ms = MAX_RAMP_MS;
+
+	taskENTER_CRITICAL();
+	profile = profiles[new_profile];
+	full_scale_periods = MS_TO_PERIODS(full_scale_ms);
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Request a wheel's direction. Call with interrupts masked.
+ *
+ * @param w   Wheel to change.
+ * @param dir New direction.
+ */
+static void set_direction(wheel_t *w, hbridge_dir_t dir) {
+	if (dir != w->bridge.target) {
+		Hbridge_Set(&w->bridge, dir);
+		retarget(w, RAMP_PROPORTIONAL);
+	}
+}
+
+// Refer ramp.h file for function brief and description
+void Ramp_Set_Directions(hbridge_dir_t dir_a, hbridge_dir_t dir_b) {
+	taskENTER_CRITICAL();
+	set_direction(&wheels[RAMP_MOTOR_A], dir_a);
+	set_direction(&wheels[RAMP_MOTOR_B], dir_b);
+	taskEXIT_CRITICAL();
+}
+
+// Refer ramp.h file for function brief and description
+void Ramp_Set_Duty(ramp_motor_t motor, uint32_t duty) {
+	wheel_t *w = &wheels[motor];
+
+	if (duty > TPM_PWM_PERIOD)
+		duty = TPM_PWM_PERIOD;
+
+	taskENTER_CRITICAL();
+	if ((int32_t) duty != w->to) {
+		w->to = (int32_t) duty;
+		retarget(w, RAMP_PROPORTIONAL);
+	}
+	taskEXIT_CRITICAL();
+}
+
+// Refer ramp.h file for function brief and description
+void Ramp_Set_Duty_In(ramp_motor_t motor, uint32_t duty, uint32_t ramp_ms) {
+	wheel_t *w = &wheels[motor];
+
+	if (duty > TPM_PWM_PERIOD)
+		duty = TPM_PWM_PERIOD;
+	if (ramp_ms > MAX_RAMP_MS)
+		ramp_ms = MAX_RAMP_MS;
+
+	taskENTER_CRITICAL();
+	w->to = (int32_t) duty;
+	retarget(w, MS_TO_PERIODS(ramp_ms));
+	taskEXIT_CRITICAL();
+}
+
+// Refer ramp.h file for function brief and description
+void Ramp_Get_State(ramp_motor_t motor, ramp_state_t *state) {
+	const wheel_t *w = &wheels[motor];
+
+	taskENTER_CRITICAL();
+	state->target = (uint16_t) w->to;
+	state->duty = (uint16_t) w->duty;
+	state->requested = w->bridge.target;
+	state->applied = w->bridge.applied;
+	taskEXIT_CRITICAL();
+}
+
+// Refer ramp.h file for function brief and description
+bool Ramp_Is_Idle(void) {
+	uint32_t i;
+
+	for (i = 0; i < RAMP_MOTORS; i++)
+		if (!Hbridge_Is_Idle(&wheels[i].bridge))
+			return false;
+	return true;
+}
+
+// Refer ramp.h file for function brief and description
+void Ramp_Park(bool park) {
+	taskENTER_CRITICAL();
+	if (park) {
+		TPM0->SC &= ~(TPM_SC_TOIE_MASK | TPM_SC_TOF_MASK);
+	} else {
+		// Drop the overflow seen while parked, the wheels did not move
+		TPM0->SC |= TPM_SC_TOF_MASK;
+		TPM0->SC |= TPM_SC_TOIE_MASK;
+	}
+	taskEXIT_CRITICAL();
+}
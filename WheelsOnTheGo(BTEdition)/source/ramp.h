@@ -0,0 +1,146 @@
+// ramp.h
+
+#ifndef RAMP_H
+#define RAMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hbridge.h"
+
+/**
+ * @file    ramp.h
+ * @brief   Soft-start PWM ramp generator for the drive motors on TPM0.
+ *
+ * Motor duty and H-bridge direction are no longer written directly. Callers
+ * set a target, and the TPM0 overflow interrupt moves towards it once per
+ * PWM period (5 kHz). The motor current then rises gradually instead of
+ * spiking and browning out the shared 5 V rail.
+ *
+ * - Duty follows the selected acceleration profile (linear or S-curve). The
+ *   profile shape comes from a 33-entry table and is linearly interpolated.
+ *   A full-scale change takes the configured ramp time; smaller changes take
+ *   proportionally less.
+ * - A direction reversal first drops the duty to zero and puts the wheel in
+ *   coast (see hbridge.h). It stays there for RAMP_DEAD_TIME_MS. Only then is
+ *   the new direction applied and the duty ramped up from zero.
+ * - Stopping (coast) releases the inputs and zeroes the duty on the next
+ *   period, without a ramp.
+ * - The input changes of both wheels in a period are applied with one FPTB
+ *   clear write followed by one set write.
+ *
+ * The ramp generator only runs in the RUN clock mode, where the PWM period
+ * is TPM_PWM_PERIOD counts, so the interrupt writes CnV without scaling.
+ * The clock policy parks it (see Ramp_Park()) while the system clock is in
+ * VLPR.
+ *
+ * Every retarget restarts the profile from the current duty. An S-curve
+ * starts with zero slope, so closed-loop control that retargets every
+ * period should use RAMP_LINEAR, which acts as a slew-rate limit.
+ */
+
+// Minimum time both H-bridge inputs of a wheel are released before reversing
+#define RAMP_DEAD_TIME_MS   (20)
+
+// Default time for a full-scale duty change
+#define RAMP_DEFAULT_MS     (300)
+
+typedef enum {
+	RAMP_MOTOR_A = 0,   // Right wheel, TPM0_CH5
+	RAMP_MOTOR_B,       // Left wheel, TPM0_CH0
+	RAMP_MOTORS
+} ramp_motor_t;
+
+// Snapshot of a wheel, see Ramp_Get_State()
+typedef struct {
+	uint16_t target;          // Duty set by Ramp_Set_Duty(), in TPM counts
+	uint16_t duty;            // Duty output this PWM period
+	hbridge_dir_t requested;  // Direction set by Ramp_Set_Directions()
+	hbridge_dir_t applied;    // Direction on the H-bridge inputs
+} ramp_state_t;
+
+typedef enum {
+	RAMP_LINEAR = 0,
+	RAMP_S_CURVE,
+	RAMP_PROFILES
+} ramp_profile_t;
+
+/**
+ * @brief Start the ramp generator on the TPM0 overflow interrupt.
+ *
+ * Call after Init_TPM(). Both wheels start in coast with zero duty. The
+ * H-bridge inputs are the MOTORx_CW/CCW pins of board_pins.h.
+ */
+void Init_Ramp(void);
+
+/**
+ * @brief Select the acceleration profile used by later retargets.
+ *
+ * @param profile      Profile shape.
+ * @param full_scale_ms Time for a change from zero to full duty.
+ */
+void Ramp_Set_Profile(ramp_profile_t profile, uint32_t full_scale_ms);
+
+/**
+ * @brief Set the H-bridge direction of both wheels at once.
+ *
+ * Both requests are seen by the same PWM period.
+ *
+ * @param dir_a Direction of motor A, HBRIDGE_COAST to stop it.
+ * @param dir_b Direction of motor B, HBRIDGE_COAST to stop it.
+ */
+void Ramp_Set_Directions(hbridge_dir_t dir_a, hbridge_dir_t dir_b);
+
+/**
+ * @brief Set a wheel's target duty.
+ *
+ * @param motor Wheel to change.
+ * @param duty  Target on-time in TPM counts, 0..TPM_PWM_PERIOD.
+ */
+void Ramp_Set_Duty(ramp_motor_t motor, uint32_t duty);
+
+/**
+ * @brief Set a wheel's target duty, reached after a given time whatever
+ *        the size of the change.
+ *
+ * Restarts the ramp even if the target is unchanged, so it also re-times a
+ * ramp in progress. The duty keeps the wheel's direction: ramping to 0
+ * brakes gradually without coasting.
+ *
+ * @param motor   Wheel to change.
+ * @param duty    Target on-time in TPM counts, 0..TPM_PWM_PERIOD.
+ * @param ramp_ms Time to reach it along the active profile, at most 5000 ms.
+ *                If a direction change is pending, the time counts from
+ *                when the new direction is applied.
+ */
+void Ramp_Set_Duty_In(ramp_motor_t motor, uint32_t duty, uint32_t ramp_ms);
+
+/**
+ * @brief Get a consistent snapshot of a wheel's duty and direction.
+ *
+ * Safe to call from any task; interrupts are masked for the copy.
+ *
+ * @param motor Wheel to read.
+ * @param state Destination for the snapshot.
+ */
+void Ramp_Get_State(ramp_motor_t motor, ramp_state_t *state);
+
+/**
+ * @brief Check whether both wheels are stopped and settled.
+ *
+ * @return true when no direction is applied or pending and no dead time is
+ *         running, so TPM0 may be stopped without affecting the motors.
+ */
+bool Ramp_Is_Idle(void);
+
+/**
+ * @brief Park or resume the ramp generator.
+ *
+ * While parked the TPM0 overflow interrupt is disabled, so it neither runs
+ * at the VLPR PWM period nor wakes the core from VLPS. Targets set while
+ * parked are applied once resumed. Only park while Ramp_Is_Idle().
+ *
+ * @param park true to park, false to resume.
+ */
+void Ramp_Park(bool park);
+
+#endif // RAMP_H
@@ -68,8 +68,11 @@ void HardFault_Handler(void){
             "LDR    R3,=0xBEAB       \n"
             "CMP    R2,R3            \n"
             "BEQ    _semihost_return \n"
-        // Wasn't semihosting instruction so enter infinite loop
-            "B .                     \n"
+        // Wasn't semihosting instruction so log the fault and reset
+        // (R0 still points at the stacked registers)
+            "MOV    R1, LR           \n"
+            "LDR    R2,=Fault_Capture\n"
+            "BX     R2               \n"
         // Was semihosting instruction, so adjust location to
         // return to by 1 instruction (2 bytes), then exit function
             "_semihost_return:       \n"
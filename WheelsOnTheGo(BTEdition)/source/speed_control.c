@@ -0,0 +1,293 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    speed_control.c
+ * @brief   Closed-loop wheel speed control using encoder capture on TPM1.
+ *
+ * TPM1 Configuration:
+ * - Clock Source: 48 MHz, Prescaler: Divide by 4 (12 MHz count rate)
+ * - Period: 12000 counts (1 kHz overflow, wakes the control task)
+ * - CH0/CH1: Input capture on rising edges
+ *
+ * TPM1 shares its clock source with the PWM TPMs and is frozen by
+ * TPM_Set_Mode() while the system clock is parked in VLPR, when the motors
+ * are idle anyway.
+ *
+ * The overflow interrupt is only enabled while the controller is enabled
+ * and has a wheel to drive. The task turns it off once it has written the
+ * stopped duty, and the setters turn it back on, so an open-loop or stopped
+ * car takes no 1 kHz wakeups. Edges are still captured meanwhile, but
+ * without the overflow count they have no time base, so both wheels start
+ * over from an unknown period when the interrupt is turned back on.
+ *
+ * Edge timestamps are extended to 32 bits with a software overflow counter,
+ * which gives a usable range of several minutes between edges. A wheel that
+ * produces no edge for STALL_TIMEOUT_MS is reported as stopped.
+ *
+ * The PI controller is ctl_pid_q15() from control_math: the error is scaled
+ * so that RPM_FULL_SCALE maps to 1.0, and the output fraction 0 .. 1.0 maps
+ * to 0 .. TPM_PWM_PERIOD duty counts. The output is clamped to that range
+ * together with the controller state, so it cannot wind up while a wheel is
+ * blocked.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "speed_control.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "tpm.h"
+#include "sysclock.h"
+#include "motor_control.h"
+#include "control_math.h"
+#include "ramp.h"
+#include "failsafe.h"
+#include "kernel_objects.h"
+
+// TPM1 channels for each wheel
+#define CH0               (0)
+#define CH1               (1)
+
+// TPM1 timing
+#define TPM1_PRESCALE     (2)        // Divide by 4
+#define TPM1_CLOCK_HZ     (TPMCLOCK_FREQUENCY / 4)
+#define TPM1_PERIOD       (TPM1_CLOCK_HZ / SPEED_CONTROL_RATE_HZ)
+#define DEBUG_MODE        (3)
+#define TPM1_IRQ_PRIORITY (1)
+
+// A wheel with no edge for this long is considered stopped
+#define STALL_TIMEOUT_MS  (100)
+#define STALL_COUNTS      (TPM1_CLOCK_HZ / 1000U * STALL_TIMEOUT_MS)
+
+// Speed error that maps to a full-scale Q15 controller input
+#define RPM_FULL_SCALE    (256)
+#define RPM_TO_Q15        (32768 / RPM_FULL_SCALE)
+#define Q15_SHIFT         (15)
+
+// Q15 controller gains: full-scale duty per full-scale error
+#define KP                Q15(0.5)
+#define KI                Q15(0.003)
+#define KD                (0)
+
+typedef struct {
+	volatile uint32_t last_edge;  // Timestamp of the latest edge in TPM1 counts
+	volatile uint32_t period;     // Counts between the two latest edges, 0 if unknown
+	volatile uint16_t target_rpm;
+	volatile uint16_t rpm;        // Latest measured speed
+	arm_pid_instance_q15 pid;
+	uint16_t duty;                // Latest controller output in duty counts
+} wheel_t;
+
+static wheel_t wheels[2];
+static volatile uint32_t overflows;
+static volatile bool closed_loop;
+static TaskHandle_t control_task;
+
+/**
+ * @brief Record an input-capture edge for a wheel. Called from the TPM1 ISR.
+ *
+ * @param wheel   Wheel that produced the edge.
+ * @param capture Captured counter value.
+ * @param status  TPM1 STATUS read at ISR entry.
+ */
+static void capture_edge(wheel_t *wheel, uint32_t capture, uint32_t status) {
+	uint32_t base = overflows;
+	uint32_t stamp;
+
+	// A capture just after an overflow that has not been serviced yet belongs
+	// to the next period
+	if ((status & TPM_STATUS_TOF_MASK) && capture < TPM1_PERIOD / 2)
+		base++;
+
+	stamp = base * TPM1_PERIOD + capture;
+	wheel->period = (wheel->last_edge != 0) ? stamp - wheel->last_edge : 0;
+	wheel->last_edge = stamp;
+}
+
+/**
+ * @brief TPM1 interrupt service routine.
+ *
+ * Timestamps encoder edges and, on every overflow, wakes the speed control task.
+ */
+void TPM1_IRQHandler(void) {
+	BaseType_t higher_priority_woken = pdFALSE;
+	uint32_t status = TPM1->STATUS;
+
+	if (status & TPM_STATUS_CH0F_MASK)
+		capture_edge(&wheels[0], TPM1->CONTROLS[CH0].CnV, status);
+	if (status & TPM_STATUS_CH1F_MASK)
+		capture_edge(&wheels[1], TPM1->CONTROLS[CH1].CnV, status);
+
+	if (status & TPM_STATUS_TOF_MASK) {
+		overflows++;
+		if (control_task != NULL)
+			vTaskNotifyGiveFromISR(control_task, &higher_priority_woken);
+	}
+
+	// Flags are write-one-to-clear
+	TPM1->STATUS = status;
+	portYIELD_FROM_ISR(higher_priority_woken);
+}
+
+/**
+ * @brief Convert the latest capture period of a wheel into RPM.
+ *
+ * @param wheel Wheel to measure.
+ * @param now   Current time in TPM1 counts.
+ *
+ * @return Wheel speed in RPM, 0 if stalled or unknown.
+ */
+static uint16_t measure_rpm(const wheel_t *wheel, uint32_t now) {
+	uint32_t period = wheel->period;
+
+	if (period == 0 || now - wheel->last_edge > STALL_COUNTS)
+		return 0;
+
+	return (uint16_t) (60U * TPM1_CLOCK_HZ / ENCODER_PULSES_PER_REV / period);
+}
+
+/**
+ * @brief Run one PI step for a wheel.
+ *
+ * @param wheel Wheel to control.
+ *
+ * @return New PWM duty in counts (0 .. TPM_PWM_PERIOD).
+ */
+static uint16_t pi_step(wheel_t *wheel) {
+	q15_t error;
+	q15_t out;
+
+	if (wheel->target_rpm == 0) {
+		ctl_pid_init_q15(&wheel->pid, KP, KI, KD);
+		return 0;
+	}
+
+	error = clip_q31_to_q15(
+			((q31_t) wheel->target_rpm - wheel->rpm) * RPM_TO_Q15);
+	out = ctl_pid_q15(&wheel->pid, error, 0, Q15_ONE);
+
+	return (uint16_t) (((uint32_t) out * TPM_PWM_PERIOD) >> Q15_SHIFT);
+}
+
+/**
+ * @brief Whether the controller has a wheel to drive.
+ *
+ * @return true if closed-loop control is enabled and a target is not 0.
+ */
+static bool controlling(void) {
+	return closed_loop && (wheels[0].target_rpm != 0 || wheels[1].target_rpm != 0);
+}
+
+/**
+ * @brief Turn the overflow interrupt, and so the control task, back on if
+ *        the controller has a wheel to drive.
+ */
+static void wake_control(void) {
+	taskENTER_CRITICAL();
+	if (controlling() && !(TPM1->SC & TPM_SC_TOIE_MASK)) {
+		wheels[0].last_edge = wheels[1].last_edge = 0;
+		wheels[0].period = wheels[1].period = 0;
+		TPM1->SC = (TPM1->SC & ~TPM_SC_TOF_MASK) | TPM_SC_TOIE_MASK;
+	}
+	taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Fixed-rate speed control task, woken by every TPM1 overflow.
+ *
+ * Also wakes every FAILSAFE_CHECKIN_MS without an overflow, such as while
+ * TPM1 is stopped or its overflow interrupt is off, to check in with the
+ * failsafe.
+ *
+ * @param pvParameter Task parameters (unused in this case).
+ */
+static void task_speed_control(void *pvParameter) {
+	uint32_t woken;
+	uint32_t now;
+	uint32_t i;
+
+	while (1) {
+		woken = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(FAILSAFE_CHECKIN_MS));
+		Failsafe_Check_In(FAILSAFE_TASK_SPEED_CONTROL);
+		if (woken == 0)
+			continue;
+		now = overflows * TPM1_PERIOD + TPM1->CNT;
+
+		for (i = 0; i < 2; i++) {
+			wheels[i].rpm = measure_rpm(&wheels[i], now);
+			wheels[i].duty = pi_step(&wheels[i]);
+		}
+
+		if (closed_loop) {
+			// Low-true PWM: a higher CnV gives a lower speed
+			Start_Motors(TPM_PWM_PERIOD - wheels[0].duty,
+					TPM_PWM_PERIOD - wheels[1].duty);
+		}
+
+		// Nothing left to drive: block until a setter wakes the controller
+		taskENTER_CRITICAL();
+		if (!controlling())
+			TPM1->SC &= ~(TPM_SC_TOIE_MASK | TPM_SC_TOF_MASK);
+		taskEXIT_CRITICAL();
+	}
+}
+
+// Refer speed_control.h file for function brief and description
+void Init_Speed_Control(uint32_t priority) {
+	// Enable clock to TPM1, its encoder inputs are muxed by Init_Board_Pins()
+	SIM->SCGC6 |= SIM_SCGC6_TPM1_MASK;
+
+	ctl_pid_init_q15(&wheels[0].pid, KP, KI, KD);
+	ctl_pid_init_q15(&wheels[1].pid, KP, KI, KD);
+
+	control_task = Kernel_Create_Task(KERNEL_TASK_SPEED_CONTROL,
+			task_speed_control, priority);
+
+	// Stop TPM1 while configuring it, then load the period
+	TPM1->SC = 0;
+	TPM1->CNT = 0;
+	TPM1->MOD = TPM1_PERIOD - 1;
+	TPM1->CONF |= TPM_CONF_DBGMODE(DEBUG_MODE);
+
+	// Input capture on rising edges with interrupts
+	TPM1->CONTROLS[CH0].CnSC = TPM_CnSC_ELSA_MASK | TPM_CnSC_CHIE_MASK;
+	TPM1->CONTROLS[CH1].CnSC = TPM_CnSC_ELSA_MASK | TPM_CnSC_CHIE_MASK;
+
+	NVIC_SetPriority(TPM1_IRQn, TPM1_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(TPM1_IRQn);
+	NVIC_EnableIRQ(TPM1_IRQn);
+
+	// Start TPM1; the overflow interrupt waits for a target to control
+	TPM1->SC = TPM_SC_PS(TPM1_PRESCALE) | TPM_SC_CMOD(1);
+}
+
+// Refer speed_control.h file for function brief and description
+void Speed_Control_Enable(bool enable) {
+	// The controller retargets the duty every period, so limit its slew
+	// linearly rather than restarting an S-curve each time
+	Ramp_Set_Profile(enable ? RAMP_LINEAR : RAMP_S_CURVE, RAMP_DEFAULT_MS);
+	closed_loop = enable;
+	wake_control();
+}
+
+// Refer speed_control.h file for function brief and description
+void Speed_Control_Set_Target(uint16_t rpm_a, uint16_t rpm_b) {
+	wheels[0].target_rpm = rpm_a;
+	wheels[1].target_rpm = rpm_b;
+	wake_control();
+}
+
+// Refer speed_control.h file for function brief and description
+void Speed_Control_Get_Speed(uint16_t *rpm_a, uint16_t *rpm_b) {
+	*rpm_a = wheels[0].rpm;
+	*rpm_b = wheels[1].rpm;
+}
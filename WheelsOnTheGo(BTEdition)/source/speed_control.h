@@ -0,0 +1,80 @@
+// speed_control.h
+
+#ifndef SPEED_CONTROL_H
+#define SPEED_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    speed_control.h
+ * @brief   Closed-loop wheel speed control using encoder capture on TPM1.
+ *
+ * One hall/encoder pulse train per wheel is captured on TPM1:
+ * - Motor A encoder: TPM1_CH0 on PTA12 (Mux Alt 3)
+ * - Motor B encoder: TPM1_CH1 on PTA13 (Mux Alt 3)
+ *
+ * TPM1 also overflows at SPEED_CONTROL_RATE_HZ and its ISR wakes the speed
+ * control task, so the control loop runs at a fixed rate from a hardware
+ * timer. The task measures each wheel's speed from the capture period and
+ * runs a fixed-point PI controller that writes the TPM0 PWM duty through
+ * Start_Motors().
+ *
+ * While disabled, or with both targets at 0, the overflow interrupt is off
+ * and the task blocks: the motors stay under open-loop control and the
+ * measured speeds are not updated.
+ */
+
+// Control loop rate in Hz
+#define SPEED_CONTROL_RATE_HZ  (1000)
+
+// Encoder pulses per wheel revolution
+#define ENCODER_PULSES_PER_REV (20)
+
+// Wheel speed held while driving, in RPM
+#define CRUISE_RPM             (120)
+
+// Wheel speed commanded by a full-scale proportional drive command, in RPM
+#define MAX_RPM                (2 * CRUISE_RPM)
+
+// Set to 1 on a chassis fitted with wheel encoders
+#define SPEED_CONTROL_CLOSED_LOOP (0)
+
+/**
+ * @brief Initialize encoder capture on TPM1 and create the control task.
+ *
+ * Call after Init_TPM() and before starting the scheduler.
+ *
+ * @param priority Priority of the speed control task.
+ */
+void Init_Speed_Control(uint32_t priority);
+
+/**
+ * @brief Enable or disable closed-loop control.
+ *
+ * Enabling selects the linear ramp profile; disabling restores the S-curve.
+ *
+ * @param enable true to let the controller drive the PWM duty.
+ */
+void Speed_Control_Enable(bool enable);
+
+/**
+ * @brief Set the wheel speeds to hold.
+ *
+ * A target of 0 stops the wheel and clears its controller state; the task
+ * blocks once both are 0.
+ *
+ * @param rpm_a Target speed of motor A in RPM.
+ * @param rpm_b Target speed of motor B in RPM.
+ */
+void Speed_Control_Set_Target(uint16_t rpm_a, uint16_t rpm_b);
+
+/**
+ * @brief Get the most recent measured wheel speeds.
+ *
+ * @param rpm_a Destination for the speed of motor A in RPM.
+ * @param rpm_b Destination for the speed of motor B in RPM.
+ */
+void Speed_Control_Get_Speed(uint16_t *rpm_a, uint16_t *rpm_b);
+
+#endif // SPEED_CONTROL_H
@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    supervisor.c
+ * @brief   Link-loss detection and watchdog check-in bookkeeping.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "supervisor.h"
+
+// Refer supervisor.h file for function brief and description
+void Supervisor_Init(supervisor_t *supervisor, uint32_t tasks) {
+	uint32_t task;
+
+	supervisor->tasks = (tasks < SUPERVISOR_MAX_TASKS) ? tasks : SUPERVISOR_MAX_TASKS;
+	for (task = 0; task < SUPERVISOR_MAX_TASKS; task++)
+		supervisor->checked_in[task] = 0;
+	supervisor->last_activity = 0;
+	supervisor->activities = 0;
+	supervisor->armed = false;
+	supervisor->framed = false;
+	supervisor->lost = false;
+	supervisor->lost_activities = 0;
+}
+
+// Refer supervisor.h file for function brief and description
+void Supervisor_Activity(supervisor_t *supervisor, uint32_t now, bool frame) {
+	supervisor->last_activity = now;
+	supervisor->activities++;
+	if (frame)
+		supervisor->framed = true;
+	supervisor->armed = true;
+}
+
+// Refer supervisor.h file for function brief and description
+void Supervisor_Check_In(supervisor_t *supervisor, uint32_t task) {
+	if (task < SUPERVISOR_MAX_TASKS)
+		supervisor->checked_in[task] = 1;
+}
+
+// Refer supervisor.h file for function brief and description
+supervisor_event_t Supervisor_Poll(supervisor_t *supervisor, uint32_t now,
+		uint32_t timeout, uint32_t legacy_timeout, bool *service) {
+	uint32_t task;
+
+	*service = true;
+	for (task = 0; task < supervisor->tasks; task++)
+		if (!supervisor->checked_in[task])
+			*service = false;
+	if (*service)
+		for (task = 0; task < supervisor->tasks; task++)
+			supervisor->checked_in[task] = 0;
+
+	if (supervisor->lost) {
+		if (supervisor->activities == supervisor->lost_activities)
+			return SUPERVISOR_NO_CHANGE;
+		supervisor->lost = false;
+		return SUPERVISOR_LINK_RESTORED;
+	}
+
+	if (!supervisor->framed)
+		timeout = legacy_timeout;
+	if (supervisor->armed && timeout != 0
+			&& (int32_t) (now - supervisor->last_activity) >= (int32_t) timeout) {
+		supervisor->lost = true;
+		supervisor->lost_activities = supervisor->activities;
+		return SUPERVISOR_LINK_LOST;
+	}
+	return SUPERVISOR_NO_CHANGE;
+}
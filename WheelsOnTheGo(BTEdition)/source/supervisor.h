@@ -0,0 +1,97 @@
+// supervisor.h
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    supervisor.h
+ * @brief   Link-loss detection and watchdog check-in bookkeeping.
+ *
+ * Link: every valid frame or command stamps the time of the last activity.
+ * Supervisor_Poll(), called periodically, reports the link lost once when
+ * nothing has arrived for the timeout, and restored once when activity
+ * resumes. The link is supervised from the first frame or command. A client
+ * speaking the framed protocol is expected to send at least one frame per
+ * timeout (FRAME_HEARTBEAT if it has nothing else to say). A client that
+ * has only sent single-character commands has no heartbeat, so its silence
+ * is judged against a longer legacy timeout until its first frame.
+ *
+ * Watchdog: each critical task sets its own check-in flag, a single byte
+ * store. Supervisor_Poll() asks for the watchdog to be serviced only when
+ * every flag has been set since the last service, then clears them all. A
+ * task that stops running therefore lets the watchdog expire.
+ *
+ * Times are in ticks and compared by signed difference, so the tick counter
+ * may wrap and an activity stamped after the poll read the time is never
+ * taken for a silence. Activity may be recorded by one task only.
+ *
+ * The module has no RTOS or hardware access, so it builds and runs
+ * unchanged in tools/failsafe_sim.c.
+ */
+
+#define SUPERVISOR_MAX_TASKS (4)
+
+typedef enum {
+	SUPERVISOR_NO_CHANGE = 0,
+	SUPERVISOR_LINK_LOST,      // Nothing received for the timeout
+	SUPERVISOR_LINK_RESTORED   // Activity after a loss
+} supervisor_event_t;
+
+typedef struct {
+	uint32_t tasks;                                 // Tasks that must check in
+	volatile uint8_t checked_in[SUPERVISOR_MAX_TASKS];
+	volatile uint32_t last_activity;                // Time of the last frame or command
+	volatile uint32_t activities;                   // Frames and commands received
+	volatile bool armed;                            // A frame or command has been received
+	volatile bool framed;                           // A frame has been received
+	bool lost;                                      // Loss reported, not yet restored
+	uint32_t lost_activities;                       // activities when the loss was reported
+} supervisor_t;
+
+/**
+ * @brief Reset the supervisor: link not yet armed, no task checked in.
+ *
+ * @param supervisor Supervisor.
+ * @param tasks      Number of tasks that must check in, at most
+ *                   SUPERVISOR_MAX_TASKS.
+ */
+void Supervisor_Init(supervisor_t *supervisor, uint32_t tasks);
+
+/**
+ * @brief Record a valid frame or command.
+ *
+ * @param supervisor Supervisor.
+ * @param now        Current time.
+ * @param frame      true for a frame, false for a single-character command.
+ */
+void Supervisor_Activity(supervisor_t *supervisor, uint32_t now, bool frame);
+
+/**
+ * @brief Record that a task is running.
+ *
+ * @param supervisor Supervisor.
+ * @param task       Task index, below the tasks given to Supervisor_Init().
+ */
+void Supervisor_Check_In(supervisor_t *supervisor, uint32_t task);
+
+/**
+ * @brief Check the link and the check-ins.
+ *
+ * @param supervisor Supervisor.
+ * @param now        Current time.
+ * @param timeout    Time without activity after which the link is lost once
+ *                   a frame has been received, 0 to never report a loss.
+ * @param legacy_timeout The same before the first frame, when only
+ *                   single-character commands have been received.
+ * @param service    Set to true if every task checked in since the last
+ *                   service, false otherwise.
+ *
+ * @return A change of the link state, reported once.
+ */
+supervisor_event_t Supervisor_Poll(supervisor_t *supervisor, uint32_t now,
+		uint32_t timeout, uint32_t legacy_timeout, bool *service);
+
+#endif // SUPERVISOR_H
@@ -1,6 +1,6 @@
-/* 
+/*
  * sysclock.c - configuration routines for KL25Z system clock
- * 
+ *
  * Author Howdy Pierce, howdy.pierce@colorado.edu
  *
  * See section 24 of the KL25Z Reference Manual to understand this code
@@ -8,31 +8,70 @@
  * Inspired by https://learningmicro.wordpress.com/configuring-device-clock-and-using-systick-system-tick-timer-module-to-generate-software-timings/
  * Reused by Suhas Srinivasa Reddy
  *
+ * The MCG, SIM and OSC settings of both modes are the MCUXpresso ones in
+ * board/clock_config.c, applied through fsl_clock and fsl_smc.
+ *
  */
 
 #include "MKL25Z4.h"
 #include "sysclock.h"
+#include "fsl_clock.h"
+#include "fsl_smc.h"
+#include "clock_config.h"
+
+static sysclock_mode_t mode = SYSCLOCK_RUN;
 
 
 void
 Init_Sysclock()
 {
-  // Corresponds to FEI mode as shown in sec 24.4.1 
-
-  // Select PLL/FLL as clock source 
-  MCG->C1 &= ~(MCG_C1_CLKS_MASK);
-  MCG->C1 |= MCG_C1_CLKS(0);
-	
-  // Use internal reference clock as source for the FLL
-  MCG->C1 |= MCG_C1_IREFS(1);
-
-  // Select the FLL (by setting "PLL select" to 0)
-  MCG->C6 &= ~(MCG_C6_PLLS_MASK);
-  MCG->C6 |= MCG_C6_PLLS(0);
-
-  // Select 24 MHz - see table for MCG_C4[DMX32]
-  MCG->C4 &= ~(MCG_C4_DRST_DRS_MASK & MCG_C4_DMX32_MASK);
-  MCG->C4 |= MCG_C4_DRST_DRS(0);
-  MCG->C4 |= MCG_C4_DMX32(1);
+  // PEE at 48 MHz, with the fast IRC as MCGIRCLK enabled in stop modes
+  BOARD_BootClockRUN();
+  mode = SYSCLOCK_RUN;
 }
 
+
+void
+Sysclock_Set_Mode(sysclock_mode_t new_mode)
+{
+  if (new_mode == mode)
+    return;
+
+  // Keep the core, bus and flash clocks in range while the MCG moves
+  CLOCK_SetSimSafeDivs();
+
+  if (new_mode == SYSCLOCK_VLPR) {
+    // PEE -> PBE -> FBE -> FBI -> BLPI, the crystal keeps running for the
+    // way back
+    CLOCK_SetMcgConfig(&mcgConfig_BOARD_BootClockVLPR);
+    CLOCK_SetSimConfig(&simConfig_BOARD_BootClockVLPR);
+
+    // VLPR is allowed by Init_Power(); stay in RUN if it is not
+#if (defined(FSL_FEATURE_SMC_HAS_LPWUI) && FSL_FEATURE_SMC_HAS_LPWUI)
+    if (SMC_SetPowerModeVlpr(SMC, false) == kStatus_Success)
+#else
+    if (SMC_SetPowerModeVlpr(SMC) == kStatus_Success)
+#endif
+      while (SMC_GetPowerModeState(SMC) != kSMC_PowerStateVlpr)
+        ;
+    SystemCoreClock = VLPR_SYSCLOCK_FREQUENCY;
+  } else {
+    // The MCG may only leave BLPI in RUN
+    SMC_SetPowerModeRun(SMC);
+    while (SMC_GetPowerModeState(SMC) != kSMC_PowerStateRun)
+      ;
+
+    // BLPI -> FEI -> FBE -> PBE -> PEE, waiting for the PLL to lock
+    CLOCK_SetMcgConfig(&mcgConfig_BOARD_BootClockRUN);
+    CLOCK_SetSimConfig(&simConfig_BOARD_BootClockRUN);
+    SystemCoreClock = SYSCLOCK_FREQUENCY;
+  }
+  mode = new_mode;
+}
+
+
+sysclock_mode_t
+Sysclock_Get_Mode(void)
+{
+  return mode;
+}
@@ -1,20 +1,66 @@
-/* 
+/*
  * sysclock.h - configuration routines for KL25Z system clock
- * 
+ *
  * Author Howdy Pierce, howdy.pierce@colorado.edu
  * Reused by Suhas Srinivasa Reddy
  *
+ * Two clock modes are supported, see board/clock_config.c:
+ * - SYSCLOCK_RUN: PEE from the 8 MHz crystal, 48 MHz core, 24 MHz bus, and
+ *   the TPMs counting MCGPLLCLK/2 (48 MHz). Used while driving.
+ * - SYSCLOCK_VLPR: BLPI from the fast IRC in VLPR, 4 MHz core, 800 kHz bus,
+ *   and the TPMs counting MCGIRCLK (4 MHz). Used while parked.
+ * In both modes MCGIRCLK is the 4 MHz fast IRC and keeps running in stop
+ * modes, so UART0, which counts it, never sees its baud clock change.
+ *
+ * This header has no hardware dependencies so that tools/clock_sim.c can use
+ * it on the host.
  */
 
 #ifndef _SYSCLOCK_H_
 #define _SYSCLOCK_H_
 
-#define SYSCLOCK_FREQUENCY (24000000U)
+// Core clock in RUN
+#define SYSCLOCK_FREQUENCY (48000000U)
+
+// Bus clock in RUN, core clock divided by SIM_CLKDIV1[OUTDIV4] = 2
+#define BUSCLOCK_FREQUENCY (SYSCLOCK_FREQUENCY / 2U)
+
+// TPM counter input in RUN, MCGPLLCLK/2 through PLLFLLSEL
+#define TPMCLOCK_FREQUENCY (48000000U)
+
+// Core, bus and TPM counter input clocks in VLPR
+#define VLPR_SYSCLOCK_FREQUENCY (4000000U)
+#define VLPR_BUSCLOCK_FREQUENCY (VLPR_SYSCLOCK_FREQUENCY / 5U)
+#define VLPR_TPMCLOCK_FREQUENCY (IRCLK_FREQUENCY)
+
+// Fast internal reference clock (MCGIRCLK); it keeps running in VLPS
+#define IRCLK_FREQUENCY (4000000U)
+
+typedef enum {
+  SYSCLOCK_RUN = 0,
+  SYSCLOCK_VLPR,
+  SYSCLOCK_MODES
+} sysclock_mode_t;
 
 /*
- * Initializes the system clock. You should call this first in your
- * program.
+ * Initializes the system clock in SYSCLOCK_RUN. You should call this first
+ * in your program. Also enables the 4 MHz MCGIRCLK, including in stop modes,
+ * for peripherals that must keep running in VLPS, and sets SystemCoreClock.
  */
 void Init_Sysclock();
 
+/*
+ * Moves the MCG and the power mode to a clock mode and updates
+ * SystemCoreClock. Only the clock sources change: the peripherals counting
+ * the core, bus or TPM clocks must be rescaled by the caller (see
+ * clock_policy.h). Runs for up to a couple of milliseconds while the PLL
+ * locks when returning to SYSCLOCK_RUN.
+ */
+void Sysclock_Set_Mode(sysclock_mode_t mode);
+
+/*
+ * Returns the current clock mode.
+ */
+sysclock_mode_t Sysclock_Get_Mode(void);
+
 #endif  // _SYSCLOCK_H_
@@ -0,0 +1,212 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    telemetry.c
+ * @brief   Fixed-rate binary telemetry on UART1.
+ *
+ * The telemetry task is the only producer of the transmit FIFO and the
+ * UART1 interrupt its only consumer, so the FIFO needs no locking (see
+ * cbfifo.h). The battery ADC conversion is started at the end of each
+ * sample and read at the next one, so the task never waits on the ADC.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "telemetry.h"
+#include "telemetry_codec.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cbfifo.h"
+#include "sysclock.h"
+#include "ramp.h"
+#include "command_queue.h"
+#include "uart.h"
+#include "config.h"
+#include "kernel_objects.h"
+#include "boot.h"
+
+#define TX_FIFO_SIZE        (64)   // Must be a power of two
+#define UART1_IRQ_PRIORITY  (3)
+
+// UART1 divides the bus clock by 16 * SBR
+#define UART1_SBR ((BUSCLOCK_FREQUENCY + 8U * TELEMETRY_BAUD) / (16U * TELEMETRY_BAUD))
+
+// Battery on ADC0_SE8, 12-bit single-ended, ADCK = bus / 8, 8-sample average
+#define BATTERY_ADC_CHANNEL (8)
+#define ADC_FULL_SCALE      (4096U)
+
+// How often an idle task looks for the setting to change
+#define TELEMETRY_OFF_POLL_MS (500)
+
+// Stack words the task must have left after its first sample
+#define STACK_MARGIN_WORDS  (16)
+
+_Static_assert(TELEMETRY_FRAME_BYTES * 2 <= TX_FIFO_SIZE,
+		"the FIFO must hold a frame while the previous one is sent");
+
+// The FIFO only reads what was enqueued, so FAST_BOOT skips zeroing it
+static uint8_t tx_storage[TX_FIFO_SIZE] FAST_BOOT_NOINIT;
+static cbfifo_t tx_fifo;
+static volatile uint32_t dropped;
+static uint8_t frame[TELEMETRY_FRAME_BYTES];
+static uint16_t battery_mv;
+static TaskHandle_t telemetry_task;
+static volatile bool parked;
+
+/**
+ * @brief UART1 interrupt: send the next queued byte.
+ */
+void UART1_IRQHandler(void) {
+	uint8_t byte;
+
+	if ((UART1->C2 & UART_C2_TIE_MASK) && (UART1->S1 & UART_S1_TDRE_MASK)) {
+		if (cbfifo_get(&tx_fifo, &byte))
+			UART1->D = byte;
+		else
+			UART1->C2 &= ~UART_C2_TIE_MASK;
+	}
+}
+
+/**
+ * @brief Read the last battery conversion, if done, and start the next one.
+ *
+ * The ADC is not calibrated, which costs a few LSB: ample for a battery
+ * gauge.
+ */
+static void sample_battery(void) {
+	uint32_t raw;
+
+	if (ADC0->SC1[0] & ADC_SC1_COCO_MASK) {
+		raw = ADC0->R[0];
+		battery_mv = (uint16_t) (raw * TELEMETRY_VREF_MV * TELEMETRY_BATTERY_DIVIDER
+				/ ADC_FULL_SCALE);
+	}
+	ADC0->SC1[0] = ADC_SC1_ADCH(BATTERY_ADC_CHANNEL);
+}
+
+/**
+ * @brief Take a snapshot of the vehicle state.
+ *
+ * @param sample Destination, sample counter excluded.
+ */
+static void take_sample(telemetry_sample_t *sample) {
+	command_stats_t commands;
+	ramp_state_t wheel;
+
+	sample->tick = (uint16_t) xTaskGetTickCount();
+
+	Ramp_Get_State(RAMP_MOTOR_A, &wheel);
+	sample->pwm_cmd_a = wheel.target;
+	sample->pwm_out_a = wheel.duty;
+	sample->dir_a = (uint8_t) (wheel.requested << 4 | wheel.applied);
+	Ramp_Get_State(RAMP_MOTOR_B, &wheel);
+	sample->pwm_cmd_b = wheel.target;
+	sample->pwm_out_b = wheel.duty;
+	sample->dir_b = (uint8_t) (wheel.requested << 4 | wheel.applied);
+
+	Command_Get_Stats(&commands);
+	sample->cmd_seq = commands.last_seq;
+	sample->cmd_depth = (uint8_t) commands.depth;
+	sample->bt_tx_depth = (uint16_t) UART0_Tx_Pending();
+
+	sample_battery();
+	sample->battery_mv = battery_mv;
+	sample->dropped = (dropped > UINT16_MAX) ? UINT16_MAX : (uint16_t) dropped;
+}
+
+/**
+ * @brief Queue a frame whole, or drop it.
+ *
+ * @param len Frame length.
+ */
+static void send_frame(size_t len) {
+	if (cbfifo_capacity(&tx_fifo) - cbfifo_length(&tx_fifo) < len) {
+		dropped++;
+		return;
+	}
+	cbfifo_enqueue(&tx_fifo, frame, len);
+	UART1->C2 |= UART_C2_TIE_MASK;
+}
+
+/**
+ * @brief Task that samples and sends at the CONFIG_TELEMETRY_HZ rate.
+ *
+ * @param pvParameter Task parameters (unused).
+ */
+static void task_telemetry(void *pvParameter) {
+	TickType_t wake = xTaskGetTickCount();
+	telemetry_sample_t sample = { 0 };
+	uint32_t hz;
+
+	while (1) {
+		hz = Config_Get(CONFIG_TELEMETRY_HZ);
+		if (hz == 0) {
+			vTaskDelay(pdMS_TO_TICKS(TELEMETRY_OFF_POLL_MS));
+			wake = xTaskGetTickCount();
+			continue;
+		}
+		if (hz < TELEMETRY_MIN_HZ)
+			hz = TELEMETRY_MIN_HZ;
+		vTaskDelayUntil(&wake, configTICK_RATE_HZ / hz);
+
+		// UART1 and the ADC count the bus clock, which only suits RUN
+		if (parked) {
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			wake = xTaskGetTickCount();
+			continue;
+		}
+		take_sample(&sample);
+		send_frame(Telemetry_Encode(&sample, frame));
+		if (sample.sample++ == 0)
+			configASSERT(uxTaskGetStackHighWaterMark(NULL) >= STACK_MARGIN_WORDS);
+	}
+}
+
+// Refer telemetry.h file for function brief and description
+void Telemetry_Park(bool park) {
+	parked = park;
+	if (!park && telemetry_task != NULL)
+		xTaskNotifyGive(telemetry_task);
+}
+
+// Refer telemetry.h file for function brief and description
+void Init_Telemetry(uint32_t priority) {
+	// Clock gating for UART1 and ADC0, their pins are muxed by Init_Board_Pins()
+	SIM->SCGC4 |= SIM_SCGC4_UART1_MASK;
+	SIM->SCGC6 |= SIM_SCGC6_ADC0_MASK;
+
+	// 8N1 at TELEMETRY_BAUD from the RUN bus clock, transmit only
+	UART1->C2 = 0;
+	UART1->BDH = UART_BDH_SBR(UART1_SBR >> 8);
+	UART1->BDL = UART_BDL_SBR(UART1_SBR);
+	UART1->C1 = 0;
+	UART1->C3 = 0;
+	cbfifo_init(&tx_fifo, tx_storage, TX_FIFO_SIZE);
+
+	NVIC_SetPriority(UART1_IRQn, UART1_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(UART1_IRQn);
+	NVIC_EnableIRQ(UART1_IRQn);
+	UART1->C2 = UART_C2_TE_MASK;
+
+	// Software trigger, long sample time for the divider's source impedance
+	ADC0->CFG1 = ADC_CFG1_ADIV(3) | ADC_CFG1_ADLSMP_MASK | ADC_CFG1_MODE(1);
+	ADC0->SC2 = 0;
+	ADC0->SC3 = ADC_SC3_AVGE_MASK | ADC_SC3_AVGS(1);
+	ADC0->SC1[0] = ADC_SC1_ADCH(BATTERY_ADC_CHANNEL);
+
+	telemetry_task = Kernel_Create_Task(KERNEL_TASK_TELEMETRY, task_telemetry, priority);
+}
+
+// Refer telemetry.h file for function brief and description
+uint32_t Telemetry_Get_Dropped(void) {
+	return dropped;
+}
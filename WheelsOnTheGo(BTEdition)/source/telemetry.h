@@ -0,0 +1,135 @@
+// telemetry.h
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file    telemetry.h
+ * @brief   Fixed-rate binary telemetry on UART1, and its frame schema.
+ *
+ * The telemetry task samples the vehicle state at the CONFIG_TELEMETRY_HZ
+ * setting (TELEMETRY_MIN_HZ..TELEMETRY_MAX_HZ, 0 = off), rounded to whole
+ * ticks. It packs each sample into a frame and queues it for UART1 TX on
+ * PTE0 at TELEMETRY_BAUD, 8N1. The Bluetooth link on UART0 is not used.
+ *
+ * The frame layout is the TELEMETRY_FIELDS table below, and nothing else:
+ * - the C sample struct and packer are expanded from it here and in
+ *   telemetry_codec.c;
+ * - tools/telemetry_decode.py reads the same table to decode, print and
+ *   plot a capture, and to report the per-field bandwidth budget (a
+ *   post-build step prints it for every firmware build).
+ *
+ * Frame on the wire (see telemetry_codec.h):
+ *   COBS(fields, little-endian in table order | CRC-8) 0x00
+ *
+ * Sending never blocks: a frame that does not fit whole in the transmit
+ * FIFO is dropped and counted. The sample counter shows the gap, and the
+ * dropped field of the next frame sent carries the count. The
+ * UART1 interrupt sends the FIFO one byte per interrupt, about 4800
+ * interrupts per second at the highest rate.
+ *
+ * UART1 counts the bus clock, so frames are only sent in the RUN clock
+ * mode. The clock policy calls Telemetry_Park() on each transition; while
+ * the car is parked in VLPR the task stays blocked, and sampling resumes
+ * on the next tick back in RUN. A frame being sent at the switch is
+ * garbled and fails the CRC on the host.
+ *
+ * Append new fields at the end of the table and keep the bandwidth check
+ * below passing.
+ */
+
+// Sample rate range of CONFIG_TELEMETRY_HZ, and its default
+#define TELEMETRY_MIN_HZ       (10)
+#define TELEMETRY_MAX_HZ       (200)
+#define TELEMETRY_DEFAULT_HZ   (50)
+
+// UART1 baud rate, from the 24 MHz RUN bus clock with SBR 13 (+0.16 %)
+#define TELEMETRY_BAUD         (115200)
+
+// Share of the link the frames may take at TELEMETRY_MAX_HZ, in percent
+#define TELEMETRY_LINK_SHARE   (80)
+
+// Battery voltage divider ratio and ADC reference
+#define TELEMETRY_BATTERY_DIVIDER (3)
+#define TELEMETRY_VREF_MV      (3300)
+
+// X(name, type, unit, description); type is U8, I8, U16, I16 or U32
+#define TELEMETRY_FIELDS(X) \
+	X(sample,      U16, "",      "Sample counter, a gap is a lost frame") \
+	X(tick,        U16, "ms",    "Low 16 bits of the RTOS tick") \
+	X(pwm_cmd_a,   U16, "counts", "Motor A target duty, 0..TPM_PWM_PERIOD") \
+	X(pwm_out_a,   U16, "counts", "Motor A duty output by the ramp") \
+	X(pwm_cmd_b,   U16, "counts", "Motor B target duty") \
+	X(pwm_out_b,   U16, "counts", "Motor B duty output by the ramp") \
+	X(dir_a,       U8,  "",      "Motor A requested << 4 | applied, hbridge_dir_t") \
+	X(dir_b,       U8,  "",      "Motor B requested << 4 | applied, hbridge_dir_t") \
+	X(cmd_seq,     U16, "",      "Seq of the last command handed to motor control") \
+	X(cmd_depth,   U8,  "cmds",  "Commands waiting in the command queue") \
+	X(bt_tx_depth, U16, "bytes", "Bytes waiting to be sent on the Bluetooth UART") \
+	X(battery_mv,  U16, "mV",    "Battery voltage, one sample period old") \
+	X(dropped,     U16, "frames", "Frames dropped for a full FIFO, saturating")
+
+#define TELEMETRY_TYPE_U8   uint8_t
+#define TELEMETRY_TYPE_I8   int8_t
+#define TELEMETRY_TYPE_U16  uint16_t
+#define TELEMETRY_TYPE_I16  int16_t
+#define TELEMETRY_TYPE_U32  uint32_t
+
+#define TELEMETRY_SIZE_U8   (1)
+#define TELEMETRY_SIZE_I8   (1)
+#define TELEMETRY_SIZE_U16  (2)
+#define TELEMETRY_SIZE_I16  (2)
+#define TELEMETRY_SIZE_U32  (4)
+
+#define TELEMETRY_MEMBER(name, type, unit, description) TELEMETRY_TYPE_##type name;
+#define TELEMETRY_ADD_SIZE(name, type, unit, description) + TELEMETRY_SIZE_##type
+
+typedef struct {
+	TELEMETRY_FIELDS(TELEMETRY_MEMBER)
+} telemetry_sample_t;
+
+// Packed fields, then the CRC-8
+#define TELEMETRY_SAMPLE_BYTES (0 TELEMETRY_FIELDS(TELEMETRY_ADD_SIZE))
+#define TELEMETRY_BLOCK_BYTES  (TELEMETRY_SAMPLE_BYTES + 1)
+
+// Bytes on the wire per frame: COBS overhead and the zero delimiter
+#define TELEMETRY_FRAME_BYTES  (TELEMETRY_BLOCK_BYTES + TELEMETRY_BLOCK_BYTES / 254 + 1 + 1)
+
+// 8N1: ten bit times per byte
+#define TELEMETRY_BPS_AT(hz)   (TELEMETRY_FRAME_BYTES * 10 * (hz))
+
+_Static_assert(TELEMETRY_BPS_AT(TELEMETRY_MAX_HZ)
+		<= TELEMETRY_BAUD / 100 * TELEMETRY_LINK_SHARE,
+		"telemetry frame too large for TELEMETRY_MAX_HZ, see tools/telemetry_decode.py --budget");
+
+/**
+ * @brief Set up UART1 and the battery ADC, and start the telemetry task.
+ *
+ * Call after Init_Config() and Init_Ramp(), before starting the scheduler.
+ *
+ * @param priority Priority of the telemetry task.
+ */
+void Init_Telemetry(uint32_t priority);
+
+/**
+ * @brief Pause or resume sampling around a clock mode change.
+ *
+ * Call with the scheduler suspended, from the clock mode transition.
+ *
+ * @param park true when leaving RUN, false when back in RUN.
+ */
+void Telemetry_Park(bool park);
+
+/**
+ * @brief Number of frames dropped because the transmit FIFO was full.
+ *
+ * Also sent in the dropped field of every frame.
+ *
+ * @return Dropped frame count.
+ */
+uint32_t Telemetry_Get_Dropped(void);
+
+#endif // TELEMETRY_H
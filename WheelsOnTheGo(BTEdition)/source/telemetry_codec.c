@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    telemetry_codec.c
+ * @brief   Wire encoding of telemetry samples.
+ *
+ * The packer and unpacker are expanded from TELEMETRY_FIELDS, one
+ * put()/get() per field, so they cannot disagree with the table. Signed
+ * fields are sent as their two's complement and narrowed back on decode.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include "telemetry_codec.h"
+#include "cobs.h"
+#include "protocol.h"
+
+// Below one full COBS run, every frame has the same length
+_Static_assert(TELEMETRY_BLOCK_BYTES < 254, "telemetry frames must stay below 254 bytes");
+
+#define PUT_FIELD(name, type, unit, description) \
+	pos = put(block, pos, (uint32_t) sample->name, TELEMETRY_SIZE_##type);
+#define GET_FIELD(name, type, unit, description) \
+	sample->name = (TELEMETRY_TYPE_##type) get(block, &pos, TELEMETRY_SIZE_##type);
+
+/**
+ * @brief Write a field, least significant byte first.
+ *
+ * @return Position after the field.
+ */
+static size_t put(uint8_t *out, size_t pos, uint32_t value, uint32_t size) {
+	uint32_t i;
+
+	for (i = 0; i < size; i++)
+		out[pos + i] = (uint8_t) (value >> (8 * i));
+	return pos + size;
+}
+
+/**
+ * @brief Read a field, least significant byte first, and advance past it.
+ */
+static uint32_t get(const uint8_t *in, size_t *pos, uint32_t size) {
+	uint32_t value = 0;
+	uint32_t i;
+
+	for (i = 0; i < size; i++)
+		value |= (uint32_t) in[*pos + i] << (8 * i);
+	*pos += size;
+	return value;
+}
+
+// Refer telemetry_codec.h file for function brief and description
+size_t Telemetry_Encode(const telemetry_sample_t *sample, uint8_t *out) {
+	uint8_t block[TELEMETRY_BLOCK_BYTES];
+	size_t pos = 0;
+	size_t len;
+
+	TELEMETRY_FIELDS(PUT_FIELD)
+	block[pos] = Protocol_CRC8(block, pos);
+	len = Cobs_Encode(block, sizeof(block), out);
+	out[len++] = 0;
+	return len;
+}
+
+// Refer telemetry_codec.h file for function brief and description
+int Telemetry_Decode(const uint8_t *in, size_t len, telemetry_sample_t *sample) {
+	uint8_t block[TELEMETRY_FRAME_BYTES];
+	size_t pos = 0;
+
+	if (len == TELEMETRY_FRAME_BYTES && in[len - 1] == 0)
+		len--;
+	if (len != TELEMETRY_FRAME_BYTES - 1
+			|| Cobs_Decode(in, len, block) != TELEMETRY_BLOCK_BYTES
+			|| Protocol_CRC8(block, TELEMETRY_SAMPLE_BYTES) != block[TELEMETRY_SAMPLE_BYTES])
+		return 0;
+
+	TELEMETRY_FIELDS(GET_FIELD)
+	return 1;
+}
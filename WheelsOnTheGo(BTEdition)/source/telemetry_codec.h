@@ -0,0 +1,45 @@
+// telemetry_codec.h
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry.h"
+
+/**
+ * @file    telemetry_codec.h
+ * @brief   Wire encoding of telemetry samples.
+ *
+ * The fields of TELEMETRY_FIELDS (see telemetry.h) are packed in table
+ * order, little-endian, with no padding, followed by Protocol_CRC8() of
+ * the packed fields. The block is then COBS-encoded (see cobs.h) and ended
+ * with a zero byte, so every frame is exactly TELEMETRY_FRAME_BYTES.
+ *
+ * The module does no I/O, so it is also built into the host model in
+ * tools/telemetry_sim.c.
+ */
+
+/**
+ * @brief Encode a sample into a frame, delimiter included.
+ *
+ * @param sample Sample to encode.
+ * @param out    Destination of TELEMETRY_FRAME_BYTES bytes.
+ *
+ * @return Frame length, TELEMETRY_FRAME_BYTES.
+ */
+size_t Telemetry_Encode(const telemetry_sample_t *sample, uint8_t *out);
+
+/**
+ * @brief Decode a frame, with or without its delimiter.
+ *
+ * @param in     Frame.
+ * @param len    Frame length.
+ * @param sample Destination for the sample.
+ *
+ * @return 1 if the frame decoded, 0 if it has the wrong length or fails the
+ *         CRC.
+ */
+int Telemetry_Decode(const uint8_t *in, size_t len, telemetry_sample_t *sample);
+
+#endif // TELEMETRY_CODEC_H
@@ -18,9 +18,9 @@
  * debug mode, and multiple channels are configured for edge-aligned low-true PWM.
  *
  * Configuration:
- * - Clock Source: 24 MHz
- * - Prescaler: Divide by 1000
- * - Period: 4800 (adjustable as needed)
+ * - Clock Source: MCGPLLCLK/2, 48 MHz (RUN) or MCGIRCLK, 4 MHz (VLPR)
+ * - Prescaler: Divide by 2 (RUN) or 1 (VLPR), from Clock_Div_Tpm()
+ * - Period: 4800 (RUN) or 800 (VLPR) counts, 5 kHz in both modes
  *
  * Channels Configuration:
  * - TPM0_CH0 and TPM0_CH1: Edge-aligned low-true PWM
@@ -32,14 +32,15 @@
  */
 #include "tpm.h"
 
-// Period value for the TPM module
-#define PERIOD      (4800)
-
 // TPM channels
 #define CH0         (0)
 #define CH1         (1)
 #define CH5         (5)
 
+// Channels per TPM
+#define TPM0_CHANNELS (6)
+#define TPM2_CHANNELS (2)
+
 // Numeric constants
 #define ZERO        (0)
 #define ONE         (1)
@@ -47,20 +48,42 @@
 // Debug mode configuration for the TPM module
 #define DEBUG_MODE  (3)
 
-// Time delay constant (in milliseconds)
-#define MS1000      (1000)
+// SIM_SOPT2[TPMSRC] selections
+#define TPMSRC_PLLFLLSEL (1)
+#define TPMSRC_MCGIRCLK  (3)
+
+// Stop window at the end of a period, in eighths of the period
+#define WRAP_WINDOW (8)
+
+static const uint32_t sources[SYSCLOCK_MODES] = {
+	[SYSCLOCK_RUN] = TPMSRC_PLLFLLSEL,
+	[SYSCLOCK_VLPR] = TPMSRC_MCGIRCLK
+};
+
+// Counts per PWM period, and core cycles per count
+static uint32_t period = TPM_PWM_PERIOD;
+static uint32_t cycles_per_count = SYSCLOCK_FREQUENCY / (TPMCLOCK_FREQUENCY / 2);
+
+// TPM1 was counting when it was frozen for VLPR
+static bool tpm1_frozen;
 
 // Refer tpm.h file for function brief and description
 void Init_TPM(void) {
-	// Enable Clock to TPM0 and TPM1
+	clock_div_tpm_t div;
+
+	// In RUN the PWM period is exactly TPM_PWM_PERIOD counts
+	Clock_Div_Tpm(clock_trees[SYSCLOCK_RUN].tpm_hz, TPM_PWM_FREQUENCY,
+			TPM_PWM_PERIOD, &div);
+
+	// Enable Clock to TPM0 and TPM2
 	SIM->SCGC6 |= SIM_SCGC6_TPM0_MASK | SIM_SCGC6_TPM2_MASK;
-	//set clock source for tpm: 24 MHz
-	SIM->SOPT2 |= (SIM_SOPT2_TPMSRC(ONE));
+	//set clock source for tpm: MCGPLLCLK/2, 48 MHz
+	SIM->SOPT2 |= (SIM_SOPT2_TPMSRC(TPMSRC_PLLFLLSEL));
 
 	//load the counter and mod
-	TPM0->MOD = PERIOD - 1;
+	TPM0->MOD = div.period - 1;
 	//set TPM count direction to up with a divide by 2 prescaler
-	TPM0->SC = TPM_SC_PS(MS1000);
+	TPM0->SC = TPM_SC_PS(div.ps);
 	// Continue operation in debug mode
 	TPM0->CONF |= TPM_CONF_DBGMODE(DEBUG_MODE);
 	// Set channel 1 to edge-aligned low-true PWM
@@ -79,9 +102,9 @@ void Init_TPM(void) {
 	TPM0->SC |= TPM_SC_CMOD(ONE);
 
 	// Configure TPM2 and Load the counter and MOD
-	TPM2->MOD = PERIOD - 1;
+	TPM2->MOD = div.period - 1;
 	//set TPM count direction to up with a divide by 2 prescaler
-	TPM2->SC = TPM_SC_PS(MS1000);
+	TPM2->SC = TPM_SC_PS(div.ps);
 	// Continue operation in debug mode
 	TPM2->CONF |= TPM_CONF_DBGMODE(DEBUG_MODE);
 	// Set channel 1 to edge-aligned low-true PWM
@@ -95,3 +118,105 @@ void Init_TPM(void) {
 	// Start TPM
 	TPM2->SC |= TPM_SC_CMOD(ONE);
 }
+
+/**
+ * @brief Stop a TPM on the first count of its next PWM period.
+ *
+ * Interrupts stay enabled until the counter is in the last eighth of the
+ * period and are masked only from there to the wrap. A pending overflow
+ * flag is left for the TPM's interrupt handler.
+ *
+ * @param tpm TPM to stop.
+ */
+static void stop_at_wrap(TPM_Type *tpm) {
+	uint32_t window = tpm->MOD - tpm->MOD / WRAP_WINDOW;
+	uint32_t prev;
+	uint32_t cnt;
+
+	do {
+		__enable_irq();
+		while (tpm->CNT < window)
+			;
+		__disable_irq();
+		cnt = tpm->CNT;
+	} while (cnt < window);
+
+	// The count drops back to zero at the wrap
+	do {
+		prev = cnt;
+		cnt = tpm->CNT;
+	} while (cnt >= prev);
+
+	// Writing zero to TOF leaves it set
+	tpm->SC &= ~(TPM_SC_CMOD_MASK | TPM_SC_TOF_MASK);
+	while (tpm->SC & TPM_SC_CMOD_MASK)
+		;
+	__enable_irq();
+}
+
+/**
+ * @brief Load a stopped PWM TPM with a new prescaler and period.
+ *
+ * @param tpm      TPM to load.
+ * @param channels Number of channels to rescale.
+ * @param pwm      New prescaler and period.
+ */
+static void load(TPM_Type *tpm, uint32_t channels, const clock_div_tpm_t *pwm) {
+	uint32_t ch;
+
+	tpm->SC = (tpm->SC & ~(TPM_SC_PS_MASK | TPM_SC_TOF_MASK))
+			| TPM_SC_PS(pwm->ps);
+	tpm->MOD = pwm->period - 1;
+	// With the counter stopped CnV writes take effect at once
+	for (ch = 0; ch < channels; ch++)
+		tpm->CONTROLS[ch].CnV = Clock_Div_Rescale(tpm->CONTROLS[ch].CnV,
+				period, pwm->period);
+	tpm->CNT = 0;
+}
+
+// Refer tpm.h file for function brief and description
+void TPM_Set_Mode(sysclock_mode_t mode, const clock_div_tpm_t *pwm) {
+	if (mode == SYSCLOCK_VLPR && (TPM1->SC & TPM_SC_CMOD_MASK)) {
+		TPM1->SC &= ~(TPM_SC_CMOD_MASK | TPM_SC_TOF_MASK);
+		while (TPM1->SC & TPM_SC_CMOD_MASK)
+			;
+		tpm1_frozen = true;
+	}
+
+	stop_at_wrap(TPM0);
+	stop_at_wrap(TPM2);
+
+	SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_TPMSRC_MASK)
+			| SIM_SOPT2_TPMSRC(sources[mode]);
+	load(TPM0, TPM0_CHANNELS, pwm);
+	load(TPM2, TPM2_CHANNELS, pwm);
+	period = pwm->period;
+	cycles_per_count = clock_trees[mode].core_hz
+			/ (clock_trees[mode].tpm_hz >> pwm->ps);
+
+	// Restart both in step
+	__disable_irq();
+	TPM0->SC = (TPM0->SC & ~TPM_SC_TOF_MASK) | TPM_SC_CMOD(ONE);
+	TPM2->SC = (TPM2->SC & ~TPM_SC_TOF_MASK) | TPM_SC_CMOD(ONE);
+	__enable_irq();
+
+	if (mode == SYSCLOCK_RUN && tpm1_frozen) {
+		TPM1->SC = (TPM1->SC & ~TPM_SC_TOF_MASK) | TPM_SC_CMOD(ONE);
+		tpm1_frozen = false;
+	}
+}
+
+// Refer tpm.h file for function brief and description
+uint32_t TPM_Scale(uint32_t cnv) {
+	return Clock_Div_Rescale(cnv, TPM_PWM_PERIOD, period);
+}
+
+// Refer tpm.h file for function brief and description
+uint32_t TPM_Get_Period(void) {
+	return period;
+}
+
+// Refer tpm.h file for function brief and description
+uint32_t TPM_Get_Cycles_Per_Count(void) {
+	return cycles_per_count;
+}
@@ -4,6 +4,13 @@
 #define TPM_H
 
 #include <MKL25Z4.h>
+#include "clock_div.h"
+
+// PWM period of TPM0 and TPM2 in counts; a channel's CnV ranges over 0..TPM_PWM_PERIOD
+#define TPM_PWM_PERIOD (4800)
+
+// PWM frequency of TPM0 and TPM2 in every clock mode
+#define TPM_PWM_FREQUENCY (5000U)
 
 /**
  * @brief Initialize the TPM (Timer/PWM) module for controlling RGB LEDs.
@@ -13,4 +20,47 @@
  */
 void Init_TPM(void);
 
+/**
+ * @brief Move TPM0, TPM1 and TPM2 to the counter clock of a clock mode.
+ *
+ * TPM0 and TPM2 are each stopped on the first count of a PWM period, then
+ * get the mode's clock source, prescaler and period, have their compare
+ * values rescaled and restart together. No pulse is cut short; the outputs
+ * hold their level for at most one PWM period. Interrupts are only masked
+ * for the last eighth of a period at a time, so UART0 does not overrun.
+ *
+ * TPM1 shares the clock source. It is frozen in SYSCLOCK_VLPR, where it
+ * cannot reach its encoder timebase, and resumes in SYSCLOCK_RUN.
+ *
+ * Call from a task with interrupts enabled. In SYSCLOCK_RUN the PLL must
+ * already be locked.
+ *
+ * @param mode New clock mode.
+ * @param pwm  TPM0 and TPM2 prescaler and period of the mode.
+ */
+void TPM_Set_Mode(sysclock_mode_t mode, const clock_div_tpm_t *pwm);
+
+/**
+ * @brief Convert a compare value to the current PWM period.
+ *
+ * Callers keep compare values in TPM_PWM_PERIOD counts and pass them through
+ * here when writing CnV. In SYSCLOCK_RUN the period is TPM_PWM_PERIOD and
+ * the value is returned unchanged.
+ *
+ * @param cnv Compare value, 0..TPM_PWM_PERIOD.
+ *
+ * @return The compare value to write.
+ */
+uint32_t TPM_Scale(uint32_t cnv);
+
+/**
+ * @brief Current PWM period of TPM0 and TPM2 in counts, MOD + 1.
+ */
+uint32_t TPM_Get_Period(void);
+
+/**
+ * @brief Core cycles per TPM0 count in the current clock mode.
+ */
+uint32_t TPM_Get_Cycles_Per_Count(void);
+
 #endif // TPM_H
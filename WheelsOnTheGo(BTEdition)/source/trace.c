@@ -0,0 +1,250 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    trace.c
+ * @brief   Binary trace recorder driven by the FreeRTOS trace hooks.
+ *
+ * The hooks run inside the kernel: context switches with interrupts masked,
+ * queue operations in a critical section and delays with the scheduler
+ * suspended. Recording masks interrupts itself anyway, so a hook may also be
+ * reached from an ISR without corrupting the ring.
+ *
+ * Task ids are stored in the TCB with vTaskSetTaskNumber() and queue ids in
+ * the queue with vQueueSetQueueNumber(), so looking them up costs one call.
+ *
+ * @author  Suhas Reddy S
+ * @date    12th Dec 2023
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "trace.h"
+#include "MKL25Z4.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "uart.h"
+#include "protocol.h"
+#include "latency.h"
+#include "boot.h"
+
+// Frames queued between waits for the transmit FIFO to drain
+#define DUMP_BATCH        (16)
+
+static uint8_t tx_seq;
+static uint32_t batch;
+
+/**
+ * @brief Frame a payload and queue it, waiting for the transmit FIFO to
+ *        drain after every DUMP_BATCH frames so none are dropped.
+ *
+ * @param type Frame type.
+ * @param data Payload.
+ * @param len  Payload length.
+ */
+static void send_frame(uint8_t type, const uint8_t *data, uint32_t len) {
+	uint8_t frame[PROTOCOL_MAX_PAYLOAD + PROTOCOL_FRAME_OVERHEAD];
+
+	if (batch++ % DUMP_BATCH == 0) {
+		while (UART0_Tx_Pending() != 0)
+			vTaskDelay(1);
+	}
+	len = Protocol_Encode(tx_seq++, type, data, len, frame);
+	UART0_Transmit(frame, len);
+}
+
+#ifdef TRACE_RECORDER
+
+#define TRACE_INDEX(n)    ((n) & (TRACE_EVENTS - 1))
+
+// FRAME_TRACE_NAME kinds
+#define NAME_TASK         (0)
+#define NAME_QUEUE        (1)
+
+// Only the last head events are ever read, so FAST_BOOT skips zeroing it
+static trace_event_t events[TRACE_EVENTS] FAST_BOOT_NOINIT;
+static uint32_t head;                       // Events recorded since boot
+static volatile bool paused;
+
+static char task_names[TRACE_MAX_TASKS][TRACE_NAME_BYTES];
+static uint32_t task_count;
+static uint32_t quiet_tasks;                // Bit n - 1 set: task n, see trace.h
+
+static char queue_names[TRACE_MAX_QUEUES][TRACE_NAME_BYTES];
+static uint32_t queue_count;
+
+/**
+ * @brief Append an event to the ring.
+ *
+ * @param type Event type.
+ * @param task Task id.
+ * @param arg  Event argument.
+ */
+static void record(trace_event_type_t type, uint32_t task, uint32_t arg) {
+	uint32_t primask;
+	trace_event_t *event;
+
+	if (paused)
+		return;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	event = &events[TRACE_INDEX(head)];
+	head++;
+	event->time = Latency_Now();
+	event->type = (uint8_t) type;
+	event->task = (uint8_t) task;
+	event->arg = (uint16_t) arg;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Copy a name, truncated to TRACE_NAME_BYTES without a terminator.
+ *
+ * @param dst  Destination, TRACE_NAME_BYTES long.
+ * @param name Null-terminated name, or NULL.
+ */
+static void keep_name(char *dst, const char *name) {
+	if (name != NULL)
+		strncpy(dst, name, TRACE_NAME_BYTES);
+}
+
+// Refer trace.h file for function brief and description
+void Trace_Task_Create(void *task) {
+	static const char *const quiet[] = TRACE_QUIET_TASKS;
+	const char *name = pcTaskGetName((TaskHandle_t) task);
+	uint32_t i;
+
+	task_count++;
+	vTaskSetTaskNumber((TaskHandle_t) task, task_count);
+	if (task_count <= TRACE_MAX_TASKS)
+		keep_name(task_names[task_count - 1], name);
+#ifndef TRACE_ALL_SWITCHES
+	for (i = 0; i < sizeof(quiet) / sizeof(quiet[0]); i++) {
+		if (task_count <= 32 && strcmp(name, quiet[i]) == 0)
+			quiet_tasks |= 1UL << (task_count - 1);
+	}
+#else
+	(void) i;
+	(void) quiet;
+#endif
+}
+
+// Refer trace.h file for function brief and description
+void Trace_Task_Event(trace_event_type_t type, void *task, uint32_t arg) {
+	UBaseType_t id = uxTaskGetTaskNumber((TaskHandle_t) task);
+
+	if ((type == TRACE_SWITCH_IN || type == TRACE_SWITCH_OUT)
+			&& id != 0 && id <= 32 && (quiet_tasks & (1UL << (id - 1))))
+		return;
+	record(type, id, arg);
+}
+
+// Refer trace.h file for function brief and description
+void Trace_Queue_Event(trace_event_type_t type, void *queue) {
+	UBaseType_t id = uxQueueGetQueueNumber((QueueHandle_t) queue);
+
+	if (id == 0) {
+		// First time this queue is seen; registered names are known by now
+		id = ++queue_count;
+		vQueueSetQueueNumber((QueueHandle_t) queue, id);
+		if (id <= TRACE_MAX_QUEUES)
+			keep_name(queue_names[id - 1], pcQueueGetName((QueueHandle_t) queue));
+	}
+	record(type, uxTaskGetTaskNumber(xTaskGetCurrentTaskHandle()), id);
+}
+
+/**
+ * @brief Send the FRAME_TRACE_NAME frames of one kind.
+ *
+ * @param kind  NAME_TASK or NAME_QUEUE.
+ * @param names Name table.
+ * @param count Ids handed out so far.
+ * @param max   Names kept in the table.
+ */
+static void send_names(uint8_t kind, char names[][TRACE_NAME_BYTES],
+		uint32_t count, uint32_t max) {
+	uint8_t payload[2 + TRACE_NAME_BYTES];
+	const char *end;
+	uint32_t i;
+
+	if (count > max)
+		count = max;
+	for (i = 0; i < count; i++) {
+		if (names[i][0] == '\0')
+			continue;
+		end = memchr(names[i], '\0', TRACE_NAME_BYTES);
+		payload[0] = kind;
+		payload[1] = (uint8_t) (i + 1);
+		memcpy(&payload[2], names[i], TRACE_NAME_BYTES);
+		send_frame(FRAME_TRACE_NAME, payload,
+				2 + ((end != NULL) ? end - names[i] : TRACE_NAME_BYTES));
+	}
+}
+
+#endif // TRACE_RECORDER
+
+// Refer trace.h file for function brief and description
+uint32_t Trace_Last_Events(trace_event_t *out, uint32_t max) {
+#ifdef TRACE_RECORDER
+	uint32_t last = head;
+	uint32_t count = (last < TRACE_EVENTS) ? last : TRACE_EVENTS;
+	uint32_t i;
+
+	if (count > max)
+		count = max;
+	for (i = 0; i < count; i++)
+		out[i] = events[TRACE_INDEX(last - count + i)];
+	return count;
+#else
+	(void) out;
+	(void) max;
+	return 0;
+#endif
+}
+
+// Refer trace.h file for function brief and description
+void Trace_Dump(void) {
+	uint8_t payload[10] = { 0 };
+#ifdef TRACE_RECORDER
+	trace_event_t *event;
+	uint32_t first;
+	uint32_t last;
+	uint32_t cycles_per_tick;
+
+	paused = true;
+	batch = 0;
+
+	last = head;
+	first = (last > TRACE_EVENTS) ? last - TRACE_EVENTS : 0;
+	cycles_per_tick = LATENCY_HZ / configTICK_RATE_HZ;
+
+	payload[0] = (uint8_t) (last - first);
+	payload[1] = (uint8_t) ((last - first) >> 8);
+	memcpy(&payload[2], &cycles_per_tick, sizeof(cycles_per_tick));
+	memcpy(&payload[6], &first, sizeof(first));
+	send_frame(FRAME_TRACE_INFO, payload, sizeof(payload));
+
+	send_names(NAME_TASK, task_names, task_count, TRACE_MAX_TASKS);
+	send_names(NAME_QUEUE, queue_names, queue_count, TRACE_MAX_QUEUES);
+
+	// The Cortex-M0+ is little-endian, like the protocol
+	for (; first != last; first++) {
+		event = &events[TRACE_INDEX(first)];
+		send_frame(FRAME_TRACE_EVENT, (const uint8_t *) event, sizeof(*event));
+	}
+
+	paused = false;
+#else
+	// No events and no clock: recording is compiled out
+	batch = 0;
+	send_frame(FRAME_TRACE_INFO, payload, sizeof(payload));
+#endif
+}
@@ -0,0 +1,121 @@
+// trace.h
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/**
+ * @file    trace.h
+ * @brief   Binary trace recorder driven by the FreeRTOS trace hooks.
+ *
+ * When TRACE_RECORDER is defined (e.g. in a dedicated build configuration),
+ * FreeRTOSConfig.h points the kernel trace macros at this module. Every
+ * context switch, queue/semaphore/mutex send and receive, task delay and
+ * priority inheritance is stored as an 8-byte event in a RAM ring of
+ * TRACE_EVENTS entries; the oldest events are overwritten.
+ *
+ * The context switches of TRACE_QUIET_TASKS are not recorded: the idle
+ * task runs whenever nothing else does, and speed_control wakes at 1 kHz
+ * while closed-loop, so between them they filled the ring in about 30 ms.
+ * Without them, an idle car with telemetry at 50 Hz records about 130
+ * events a second and the ring covers about a second; a gap between a
+ * task's switch out and the next switch in is idle time. Define
+ * TRACE_ALL_SWITCHES to record them too.
+ *
+ * Timestamps come from Latency_Now() and have core-cycle resolution. An
+ * event costs about 80 cycles (1.7 us at 48 MHz), all with interrupts
+ * masked. Without TRACE_RECORDER the hooks expand to nothing and
+ * Trace_Dump() only sends a FRAME_TRACE_INFO with no events and 0 cycles
+ * per tick, which tells the host that recording is compiled out.
+ *
+ * A FRAME_TRACE_DUMP frame from the host makes the Bluetooth polling task
+ * send the ring over UART0 (see protocol.h), oldest event first:
+ * - one FRAME_TRACE_INFO with the event count, core cycles per RTOS tick and
+ *   the number of events lost to overwriting;
+ * - one FRAME_TRACE_NAME per task and per named queue;
+ * - one FRAME_TRACE_EVENT per event.
+ *
+ * Recording is paused for the length of the dump, which takes about 150 ms;
+ * commands are not read meanwhile, so stop the robot first.
+ * tools/trace_to_perfetto.py converts a capture to Chrome/Perfetto JSON.
+ */
+
+// Events kept in RAM, a power of two
+#define TRACE_EVENTS     (128)
+
+// Tasks whose context switches are not recorded, see above
+#define TRACE_QUIET_TASKS { "IDLE", "speed_control" }
+
+// Tasks and queues whose names are kept for the dump
+#define TRACE_MAX_TASKS  (8)
+#define TRACE_MAX_QUEUES (8)
+
+// Bytes of a task or queue name kept for the dump
+#define TRACE_NAME_BYTES (8)
+
+typedef enum {
+	TRACE_SWITCH_IN = 1,   // Task starts running
+	TRACE_SWITCH_OUT,      // Task stops running
+	TRACE_QUEUE_SEND,      // Task posted to a queue or gave a semaphore; arg = queue id
+	TRACE_QUEUE_RECEIVE,   // Task took from a queue or semaphore; arg = queue id
+	TRACE_DELAY,           // Task blocks in vTaskDelay(); arg = ticks
+	TRACE_DELAY_UNTIL,     // Task blocks until a tick; arg = wake tick (low 16 bits)
+	TRACE_PRIORITY_INHERIT // Mutex holder raised; arg = new priority
+} trace_event_type_t;
+
+typedef struct {
+	uint32_t time;   // Latency_Now() core cycles
+	uint8_t type;    // trace_event_type_t
+	uint8_t task;    // Task id, 0 if unknown
+	uint16_t arg;
+} trace_event_t;
+
+#ifdef TRACE_RECORDER
+/**
+ * @brief Hook for traceTASK_CREATE: give the task an id and keep its name.
+ *
+ * @param task Task control block of the new task.
+ */
+void Trace_Task_Create(void *task);
+
+/**
+ * @brief Hook for the task trace macros: record an event for a task.
+ *
+ * @param type Event type.
+ * @param task Task control block the event is about.
+ * @param arg  Event argument.
+ */
+void Trace_Task_Event(trace_event_type_t type, void *task, uint32_t arg);
+
+/**
+ * @brief Hook for the queue trace macros: record an event for the running
+ *        task on a queue.
+ *
+ * @param type  TRACE_QUEUE_SEND or TRACE_QUEUE_RECEIVE.
+ * @param queue Queue, semaphore or mutex.
+ */
+void Trace_Queue_Event(trace_event_type_t type, void *queue);
+#endif
+
+/**
+ * @brief Copy the most recent events, oldest first.
+ *
+ * Does not lock or allocate, so it may be called from a fault handler.
+ *
+ * @param out Destination.
+ * @param max Most events to copy.
+ *
+ * @return Number of events copied, 0 without TRACE_RECORDER.
+ */
+uint32_t Trace_Last_Events(trace_event_t *out, uint32_t max);
+
+/**
+ * @brief Send the recorded events over UART0 if TRACE_RECORDER is defined.
+ *
+ * Blocks until the whole dump has been queued for transmission. Call from a
+ * task.
+ */
+void Trace_Dump(void);
+
+#endif // TRACE_H
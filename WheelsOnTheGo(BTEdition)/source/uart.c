@@ -6,6 +6,15 @@
  * and managing UART communication. It includes functions for initializing UART0,
  * sending null-terminated strings, and transmitting arrays of bytes.
  *
+ * Reception is interrupt driven: the UART0 ISR moves each byte into a lock-free
+ * FIFO (see cbfifo.h) and wakes the reading task with a task notification.
+ * Overrun, framing, noise and parity errors are counted by the ISR.
+ *
+ * Transmission is queued: the transmit functions copy into a second FIFO and
+ * enable the transmit interrupt, which drains the FIFO one byte per TDRE. The
+ * producer side is guarded by masking interrupts so tasks and ISRs may all
+ * transmit, and so the drop-oldest policy may advance the consumer index.
+ *
  * @author  Suhas Reddy S
  * @date    17th November 2023
  */
@@ -13,10 +22,16 @@
 #include <MKL25Z4.h>
 #include "uart.h"
 #include "sysclock.h"
+#include "clock_div.h"
 #include "stdio.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "cbfifo.h"
+#include "latency.h"
+#include "config.h"
+#include "boot.h"
 
-#define BAUD_RATE 	(115200)
-#define UART_OVERSAMPLE_RATE  (16)
+#define UART_BOTHEDGE_OSR  (8)  // 4x..7x need sampling on both edges
 #define DATA_BITS  (0)     // 1 for 8 bits and 0 for 9 bits
 #define STOP_BITS (0)      // 0 for 1 stop bit and 1 for 2 stop bits
 #define PARITY_ENABLE (0)  // 1 to enable parity
@@ -25,6 +40,25 @@
 #define ZERO (0)
 #define ONE (1)
 #define TWO (2)
+#define RX_FIFO_SIZE (64)  // Must be a power of two
+#define TX_FIFO_SIZE (256) // Must be a power of two
+#define UART0_IRQ_PRIORITY (2)
+#define UART0_S1_ERROR_MASK (UART0_S1_OR_MASK | UART0_S1_NF_MASK \
+		| UART0_S1_FE_MASK | UART0_S1_PF_MASK)
+
+// The FIFOs only read what was enqueued, so FAST_BOOT skips zeroing them
+static uint8_t rx_storage[RX_FIFO_SIZE] FAST_BOOT_NOINIT;
+static cbfifo_t rx_fifo;
+static volatile uart_rx_stats_t rx_stats;
+// Task blocked in UART0_Receive(), NULL when nobody is waiting
+static TaskHandle_t volatile rx_waiting_task;
+// Tick of the latest received byte
+static volatile TickType_t rx_tick;
+
+static uint8_t tx_storage[TX_FIFO_SIZE] FAST_BOOT_NOINIT;
+static cbfifo_t tx_fifo;
+static uart_tx_policy_t tx_policy = UART_TX_DROP_NEWEST;
+static volatile uint32_t tx_dropped;
 
 /**
  * @brief   Initialize UART0 for serial communication.
@@ -34,11 +68,13 @@
  * and enables the UART receiver and transmitter. Additionally, it configures interrupts
  * for UART receive and clears any error flags.
  *
- * @note    The function uses a 24 MHz clock source for UART0 and supports an 8-bit data format,
- *          one stop bit, and optional parity.
- * @note    The baud rate is calculated based on the system clock frequency and the specified
- *          baud rate constant.
- * @note    The function enables UART interrupts for receive and initializes the NVIC.
+ * @note    The function clocks UART0 from the 4 MHz MCGIRCLK, which keeps running in VLPS,
+ *          so bytes are still received while the core is in deep sleep. It supports an
+ *          8-bit data format, one stop bit, and optional parity.
+ * @note    The baud rate divider and oversampling ratio are chosen by Clock_Div_Uart() from
+ *          the 4 MHz MCGIRCLK and the configured baud rate.
+ * @note    The function enables UART interrupts for receive and receive errors
+ *          and initializes the NVIC.
  *
  * Author Prof. Dean
  *
@@ -46,33 +82,29 @@
  *
  */
 void Init_UART0() {
-	uint16_t sbr;
+	clock_div_uart_t div;
 
-	// Enable clock gating for UART0 and Port A
+	// Enable clock gating for UART0, its pins are muxed by Init_Board_Pins()
 	SIM->SCGC4 |= SIM_SCGC4_UART0_MASK;
-	SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK | SIM_SCGC5_PORTD_MASK;
 
 	// Make sure transmitter and receiver are disabled before init
 	UART0->C2 &= ~UART0_C2_TE_MASK & ~UART0_C2_RE_MASK;
 
-	// Set UART clock to 24 MHz clock
-	SIM->SOPT2 |= SIM_SOPT2_UART0SRC(1);
+	// Set UART clock to MCGIRCLK, which keeps running in VLPS
+	SIM->SOPT2 &= ~SIM_SOPT2_UART0SRC_MASK;
+	SIM->SOPT2 |= SIM_SOPT2_UART0SRC(3);
 
-	// Set pins to UART0 Rx and Tx
-	PORTA->PCR[1] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(TWO); // Rx
-	PORTA->PCR[2] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(TWO); // Tx
-
-	PORTD->PCR[6] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(3); // Rx
-	PORTD->PCR[7] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(3); // Tx
-
-	// Set baud rate and oversampling ratio
-	sbr =
-			(uint16_t) ((SYSCLOCK_FREQUENCY)
-					/ (BAUD_RATE * UART_OVERSAMPLE_RATE));
+	// Set the baud rate divider and oversampling ratio closest to the baud
+	// rate. MCGIRCLK is the same in every clock mode, so they never change.
+	Clock_Div_Uart(IRCLK_FREQUENCY, Config_Get(CONFIG_BAUD_RATE), &div);
 	UART0->BDH &= ~UART0_BDH_SBR_MASK;
-	UART0->BDH |= UART0_BDH_SBR(sbr >> SBR_MSBYTE);
-	UART0->BDL = UART0_BDL_SBR(sbr);
-	UART0->C4 |= UART0_C4_OSR(UART_OVERSAMPLE_RATE-ONE);
+	UART0->BDH |= UART0_BDH_SBR(div.sbr >> SBR_MSBYTE);
+	UART0->BDL = UART0_BDL_SBR(div.sbr);
+	UART0->C4 = (UART0->C4 & ~UART0_C4_OSR_MASK) | UART0_C4_OSR(div.osr - ONE);
+	if (div.osr < UART_BOTHEDGE_OSR)
+		UART0->C5 |= UART0_C5_BOTHEDGE(ONE);
+	else
+		UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK;
 
 	// Disable interrupts for RX active edge and LIN break detect, select two stop bit
 	UART0->BDH |=
@@ -81,9 +113,9 @@ void Init_UART0() {
 	// Don't enable loopback mode, use 8 data bit mode, use parity and odd parity type
 	UART0->C1 = UART0_C1_LOOPS(
 			ZERO) | UART0_C1_M(DATA_BITS) | UART0_C1_PE(PARITY_ENABLE); //| UART0_C1_PT(PARITY_TYPE);
-	// Don't invert transmit data, don't enable interrupts for errors
-	UART0->C3 = UART0_C3_TXINV(ZERO) | UART0_C3_ORIE(ZERO)| UART0_C3_NEIE(ZERO)
-	| UART0_C3_FEIE(ZERO) | UART0_C3_PEIE(ZERO);
+	// Don't invert transmit data, enable interrupts for errors so they are counted
+	UART0->C3 = UART0_C3_TXINV(ZERO) | UART0_C3_ORIE(ONE)| UART0_C3_NEIE(ONE)
+	| UART0_C3_FEIE(ONE) | UART0_C3_PEIE(PARITY_ENABLE);
 
 	// Clear error flags
 	UART0->S1 = UART0_S1_OR(
@@ -92,27 +124,176 @@ void Init_UART0() {
 	// Send LSB first, do not invert received data
 	UART0->S2 = UART0_S2_MSBF(ZERO) | UART0_S2_RXINV(ZERO);
 
-	// Enable UART receiver and transmitter
-	UART0->C2 |= UART0_C2_RE(ONE) | UART0_C2_TE(ONE);
+	// Reset the FIFOs before any byte can move
+	cbfifo_init(&rx_fifo, rx_storage, RX_FIFO_SIZE);
+	cbfifo_init(&tx_fifo, tx_storage, TX_FIFO_SIZE);
+	rx_waiting_task = NULL;
+
+	NVIC_SetPriority(UART0_IRQn, UART0_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(UART0_IRQn);
+	NVIC_EnableIRQ(UART0_IRQn);
+
+	// Enable UART receiver, transmitter and receive interrupt
+	UART0->C2 |= UART0_C2_RE(ONE) | UART0_C2_TE(ONE) | UART0_C2_RIE(ONE);
 
 }
 
+/**
+ * @brief   UART0 interrupt service routine.
+ *
+ * Counts and clears receive errors, moves the received byte into the receive
+ * FIFO and notifies the task blocked in UART0_Receive(), if any. Feeds the
+ * transmitter from the transmit FIFO and disables the transmit interrupt once
+ * the FIFO runs empty.
+ */
+void UART0_IRQHandler(void) {
+	BaseType_t higher_priority_woken = pdFALSE;
+	uint8_t status = UART0->S1;
+	uint8_t byte;
+
+	// A start bit woke the core from deep sleep; the byte follows via RDRF
+	if (UART0->S2 & UART0_S2_RXEDGIF_MASK)
+		UART0->S2 |= UART0_S2_RXEDGIF_MASK;
+
+	if (status & UART0_S1_ERROR_MASK) {
+		if (status & UART0_S1_OR_MASK)
+			rx_stats.overrun++;
+		if (status & UART0_S1_FE_MASK)
+			rx_stats.framing++;
+		if (status & UART0_S1_NF_MASK)
+			rx_stats.noise++;
+		if (status & UART0_S1_PF_MASK)
+			rx_stats.parity++;
+		// Error flags are write-one-to-clear
+		UART0->S1 = status & UART0_S1_ERROR_MASK;
+	}
+
+	if (status & UART0_S1_RDRF_MASK) {
+		byte = UART0->D;
+		LATENCY_BYTE_RECEIVED();
+		rx_tick = xTaskGetTickCountFromISR();
+		if (!cbfifo_put(&rx_fifo, byte))
+			rx_stats.dropped++;
+		if (rx_waiting_task != NULL)
+			vTaskNotifyGiveFromISR(rx_waiting_task, &higher_priority_woken);
+	}
+
+	if ((UART0->C2 & UART0_C2_TIE_MASK) && (status & UART0_S1_TDRE_MASK)) {
+		if (cbfifo_get(&tx_fifo, &byte))
+			UART0->D = byte;
+		else
+			UART0->C2 &= ~UART0_C2_TIE_MASK;
+	}
+
+	portYIELD_FROM_ISR(higher_priority_woken);
+}
+
 // refer uart.h for function brief
 void UART0_Transmit_String(const char *str) {
-	while (*str != '\0') {
-		UART0_Transmit_Char(*str);
-		str++;
-	}
+	size_t len = ZERO;
+
+	while (str[len] != '\0')
+		len++;
+	UART0_Transmit((const uint8_t *) str, len);
 }
 
 // refer uart.h for function brief
 void UART0_Transmit_Char(char val) {
-	while (!(UART0->S1 & UART_S1_TDRE_MASK));
-	UART0->D = val;
+	UART0_Transmit((const uint8_t *) &val, ONE);
+}
+
+// refer uart.h for function brief
+size_t UART0_Transmit(const uint8_t *buf, size_t len) {
+	size_t queued;
+	size_t space;
+	uint32_t primask;
+
+	// Mask interrupts: there may be several producers, and drop-oldest moves
+	// the tail that the ISR otherwise owns
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	space = cbfifo_capacity(&tx_fifo) - cbfifo_length(&tx_fifo);
+	if (tx_policy == UART_TX_DROP_OLDEST && len > space) {
+		if (len > cbfifo_capacity(&tx_fifo)) {
+			// Only the tail end of an oversized message can be kept
+			tx_dropped += len - cbfifo_capacity(&tx_fifo);
+			buf += len - cbfifo_capacity(&tx_fifo);
+			len = cbfifo_capacity(&tx_fifo);
+		}
+		tx_dropped += cbfifo_discard(&tx_fifo, len - space);
+	}
+	queued = cbfifo_enqueue(&tx_fifo, buf, len);
+	tx_dropped += len - queued;
+
+	// Let the ISR drain the FIFO
+	UART0->C2 |= UART0_C2_TIE_MASK;
+
+	__set_PRIMASK(primask);
+	return queued;
+}
+
+// refer uart.h for function brief
+void UART0_Set_Tx_Policy(uart_tx_policy_t policy) {
+	tx_policy = policy;
+}
+
+// refer uart.h for function brief
+uint32_t UART0_Get_Tx_Dropped(void) {
+	return tx_dropped;
+}
+
+// refer uart.h for function brief
+size_t UART0_Tx_Pending(void) {
+	return cbfifo_length(&tx_fifo);
 }
 
 // refer uart.h for function brief
 char UART0_Receive_Byte(void) {
-	while (!(UART0->S1 & UART_S1_RDRF_MASK));
-	return UART0->D;
+	uint8_t byte;
+
+	while (UART0_Receive(&byte, ONE, portMAX_DELAY) == ZERO)
+		;
+	return (char) byte;
+}
+
+// refer uart.h for function brief
+size_t UART0_Receive(uint8_t *buf, size_t len, TickType_t timeout) {
+	size_t count = cbfifo_dequeue(&rx_fifo, buf, len);
+
+	if (count != ZERO || len == ZERO)
+		return count;
+
+	// Discard any stale notification, then publish ourselves before re-checking
+	// so a byte that lands in between leaves a pending notification
+	(void) ulTaskNotifyTake(pdTRUE, ZERO);
+	rx_waiting_task = xTaskGetCurrentTaskHandle();
+	count = cbfifo_dequeue(&rx_fifo, buf, len);
+	if (count == ZERO && ulTaskNotifyTake(pdTRUE, timeout) != ZERO)
+		count = cbfifo_dequeue(&rx_fifo, buf, len);
+	rx_waiting_task = NULL;
+
+	return count;
+}
+
+// refer uart.h for function brief
+void UART0_Get_Rx_Stats(uart_rx_stats_t *stats) {
+	taskENTER_CRITICAL();
+	*stats = rx_stats;
+	taskEXIT_CRITICAL();
+}
+
+// refer uart.h for function brief
+bool UART0_Rx_Quiet(void) {
+	return xTaskGetTickCount() - rx_tick > ONE;
+}
+
+// refer uart.h for function brief
+void UART0_Set_Rx_Wake(bool enable) {
+	if (enable) {
+		UART0->S2 |= UART0_S2_RXEDGIF_MASK;
+		UART0->BDH |= UART0_BDH_RXEDGIE_MASK;
+	} else {
+		UART0->BDH &= ~UART0_BDH_RXEDGIE_MASK;
+	}
 }
@@ -2,6 +2,9 @@
 #define UART_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
 
 /**
  * @file    uart.h
@@ -23,11 +26,18 @@
  */
 void Init_UART0(void);
 
+// Behaviour of the transmit FIFO when a message does not fit
+typedef enum {
+	UART_TX_DROP_NEWEST,  // Keep queued data, discard what does not fit
+	UART_TX_DROP_OLDEST   // Discard queued data to make room for the new message
+} uart_tx_policy_t;
+
 /**
  * @brief Send a null-terminated string over UART0.
  *
- * This function sends the specified null-terminated string over UART0.
- * The string is transmitted character by character until the null terminator is encountered.
+ * This function copies the specified null-terminated string into the transmit
+ * FIFO and returns immediately; the UART0 ISR drains the FIFO in the background.
+ * If the FIFO is full, bytes are dropped according to the transmit policy.
  *
  * @param str The null-terminated string to be transmitted.
  */
@@ -36,19 +46,106 @@ void UART0_Transmit_String(const char *str);
 /**
  * @brief Transmit a single character over UART0.
  *
- * This function transmits a single character over UART0.
+ * This function queues a single character for transmission over UART0.
  *
  * @param val The character to be transmitted.
  */
 void UART0_Transmit_Char(char val);
 
+/**
+ * @brief Queue an array of bytes for transmission over UART0.
+ *
+ * Safe to call from tasks and ISRs. Never blocks.
+ *
+ * @param buf Bytes to be transmitted.
+ * @param len Number of bytes.
+ *
+ * @return Number of bytes of buf that were queued.
+ */
+size_t UART0_Transmit(const uint8_t *buf, size_t len);
+
+/**
+ * @brief Select what happens when the transmit FIFO overflows.
+ *
+ * @param policy UART_TX_DROP_NEWEST (default) or UART_TX_DROP_OLDEST.
+ */
+void UART0_Set_Tx_Policy(uart_tx_policy_t policy);
+
+/**
+ * @brief Number of bytes dropped from the transmit path since initialization.
+ *
+ * @return Dropped byte count.
+ */
+uint32_t UART0_Get_Tx_Dropped(void);
+
+/**
+ * @brief Number of bytes waiting in the transmit FIFO.
+ *
+ * @return Queued byte count.
+ */
+size_t UART0_Tx_Pending(void);
+
 /**
  * @brief Receive a byte from UART0.
  *
- * This function receives a byte from UART0.
+ * This function takes the next byte from the interrupt-fed receive FIFO. If the
+ * FIFO is empty the calling task is blocked on a task notification until the
+ * receive ISR delivers a byte, so no CPU time is spent waiting.
  *
  * @return The received byte.
  */
 char UART0_Receive_Byte(void);
 
+/**
+ * @brief Receive up to len bytes from UART0.
+ *
+ * Copies whatever is already buffered into buf. If nothing is buffered the
+ * calling task blocks on a task notification for at most timeout ticks.
+ * Only one task may read from UART0 at a time.
+ *
+ * @param buf     Destination buffer.
+ * @param len     Maximum number of bytes to copy.
+ * @param timeout Maximum number of ticks to wait for the first byte.
+ *
+ * @return Number of bytes copied, 0 on timeout.
+ */
+size_t UART0_Receive(uint8_t *buf, size_t len, TickType_t timeout);
+
+// Receive error counters maintained by the UART0 ISR
+typedef struct {
+	uint32_t overrun;   // Bytes lost in hardware because D was not read in time
+	uint32_t framing;   // Stop bit missing
+	uint32_t noise;     // Noise detected while sampling a byte
+	uint32_t parity;    // Parity mismatch
+	uint32_t dropped;   // Bytes discarded because the receive FIFO was full
+} uart_rx_stats_t;
+
+/**
+ * @brief Get a snapshot of the UART0 receive error counters.
+ *
+ * @param stats Destination for the counters.
+ */
+void UART0_Get_Rx_Stats(uart_rx_stats_t *stats);
+
+/**
+ * @brief Check that UART0 received nothing in the current or the last tick.
+ *
+ * Each byte ends a deep sleep within the tick and LPTMR0 only counts whole
+ * ticks, so deep sleeps between the bytes of a stream would stop the
+ * kernel's time.
+ *
+ * @return true if the last byte arrived two or more ticks ago.
+ */
+bool UART0_Rx_Quiet(void);
+
+/**
+ * @brief Enable or disable the receive active-edge interrupt.
+ *
+ * Enabled around deep sleep so the start bit of an incoming byte wakes the
+ * core before the byte is complete.
+ *
+ * @param enable true to interrupt on the next receive edge.
+ */
+void UART0_Set_Rx_Wake(bool enable);
+
 #endif // UART_H
@@ -183,6 +183,11 @@ extern void __main(void);
 #endif
 extern int main(void);
 
+//*****************************************************************************
+// Runs before the C runtime is initialized, see boot.h
+//*****************************************************************************
+extern void Boot_Early(void);
+
 //*****************************************************************************
 // External declaration for the pointer to the stack top from the Linker Script
 //*****************************************************************************
@@ -310,6 +315,10 @@ void ResetISR(void) {
     *((volatile unsigned int *)0x40048100) = 0x00u;
 #endif // (__USE_CMSIS)
 
+    // Coast the motors and start the boot profiler. Must not touch .data
+    // or .bss, which are not initialized yet.
+    Boot_Early();
+
     //
     // Copy the data sections from flash to SRAM.
     //
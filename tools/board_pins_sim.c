@@ -0,0 +1,234 @@
+/*
+ * Host model of the pin setup, before and after the board table.
+ *
+ * Runs source/board_pins.c unchanged against a RAM model of SIM, the five
+ * PORT blocks and the five GPIO blocks. Every register reference goes
+ * through the model, which counts it, picks up the registers it changed and
+ * applies the PORT global pin control (GPCLR/GPCHR) and GPIO clear (PCOR)
+ * writes the way the hardware does.
+ *
+ * The same model runs the pin setup the tree had before the table, copied
+ * from Init_Motors(), Init_LEDs(), Init_Encoders() and Init_UART0().
+ *
+ * - Checks that every table entry ends with its mux value, that outputs
+ *   are GPIO, low and in PDDR, and that the clock of every port in use is
+ *   on.
+ * - Checks that every pin the old code muxed has the same mux value, apart
+ *   from the unwired PTA1/PTA2 UART0 pair the table dropped.
+ * - Prints the register references of both. Each old
+ *   reference is a read-modify-write, so it costs two bus accesses; flash
+ *   size and boot time follow the access count, and the drivers phase of
+ *   BOOT_PROFILE (see boot.h) measures the latter on the target.
+ *
+ * Build and run from the repository root:
+ *     cc -std=gnu99 -Wall -I"WheelsOnTheGo(BTEdition)/source" \
+ *         -I"WheelsOnTheGo(BTEdition)/CMSIS" -o board_pins_sim \
+ *         tools/board_pins_sim.c
+ *     ./board_pins_sim
+ */
+#include <stdio.h>
+#include <string.h>
+#include "MKL25Z4.h"
+#include "sim_check.h"
+
+enum {
+	BLOCK_SIM = 0,
+	BLOCK_PORT,                // Five blocks, A to E
+	BLOCK_GPIO = BLOCK_PORT + 5,
+	BLOCKS = BLOCK_GPIO + 5
+};
+
+typedef union {
+	SIM_Type sim;
+	PORT_Type port;
+	GPIO_Type gpio;
+	uint32_t word[sizeof(SIM_Type) / sizeof(uint32_t)];
+} block_t;
+
+_Static_assert(sizeof(SIM_Type) >= sizeof(PORT_Type) && sizeof(SIM_Type) >= sizeof(GPIO_Type),
+		"SIM is the largest block");
+
+static block_t state[BLOCKS];
+static block_t scratch;
+static int open_block = -1;
+static unsigned long references;
+
+/**
+ * Apply what the last reference changed in its copy of a block.
+ */
+static void flush(void) {
+	block_t *regs;
+	uint32_t i;
+	uint32_t pin;
+	uint32_t select;
+
+	if (open_block < 0)
+		return;
+	regs = &state[open_block];
+	for (i = 0; i < sizeof(block_t) / sizeof(uint32_t); i++) {
+		if (scratch.word[i] != regs->word[i])
+			regs->word[i] = scratch.word[i];
+	}
+
+	if (open_block >= BLOCK_PORT && open_block < BLOCK_GPIO) {
+		// Global pin control: write GPWD to the low half of the selected PCRs
+		for (i = 0; i < 2; i++) {
+			select = (i ? regs->port.GPCHR : regs->port.GPCLR) >> 16;
+			for (pin = 0; pin < 16; pin++) {
+				if (select & (1UL << pin))
+					regs->port.PCR[16 * i + pin] = (regs->port.PCR[16 * i + pin] & 0xFFFF0000UL)
+							| ((i ? regs->port.GPCHR : regs->port.GPCLR) & 0xFFFFUL);
+			}
+		}
+		regs->port.GPCLR = regs->port.GPCHR = 0;
+		// Interrupt status flags are write-one-to-clear
+		for (pin = 0; pin < 32; pin++)
+			regs->port.PCR[pin] &= ~PORT_PCR_ISF_MASK;
+	} else if (open_block >= BLOCK_GPIO) {
+		regs->gpio.PDOR |= regs->gpio.PSOR;
+		regs->gpio.PDOR &= ~regs->gpio.PCOR;
+		regs->gpio.PDOR ^= regs->gpio.PTOR;
+		regs->gpio.PSOR = regs->gpio.PCOR = regs->gpio.PTOR = 0;
+	}
+	open_block = -1;
+}
+
+/**
+ * One register reference: hand out a copy of the block to read or write.
+ */
+static block_t *reference(int block) {
+	flush();
+	references++;
+	memcpy(&scratch, &state[block], sizeof(scratch));
+	open_block = block;
+	return &scratch;
+}
+
+#undef SIM
+#undef PORTA
+#undef PORTB
+#undef PORTC
+#undef PORTD
+#undef PORTE
+#undef PTA
+#undef PTB
+#undef PTC
+#undef PTD
+#undef PTE
+#define SIM   (&reference(BLOCK_SIM)->sim)
+#define PORTA (&reference(BLOCK_PORT + 0)->port)
+#define PORTB (&reference(BLOCK_PORT + 1)->port)
+#define PORTC (&reference(BLOCK_PORT + 2)->port)
+#define PORTD (&reference(BLOCK_PORT + 3)->port)
+#define PORTE (&reference(BLOCK_PORT + 4)->port)
+#define PTA   (&reference(BLOCK_GPIO + 0)->gpio)
+#define PTB   (&reference(BLOCK_GPIO + 1)->gpio)
+#define PTC   (&reference(BLOCK_GPIO + 2)->gpio)
+#define PTD   (&reference(BLOCK_GPIO + 3)->gpio)
+#define PTE   (&reference(BLOCK_GPIO + 4)->gpio)
+
+#include "board_pins.c"
+
+#define MASK(x) (1UL << (x))
+
+// Registers Init_Board_Pins() reads: SCGC5, to set the port clocks
+#define NEW_READS (1)
+
+/**
+ * The pin setup before the board table, as it was spread over the drivers.
+ */
+static void old_pin_setup(void) {
+	// Init_Motors()
+	SIM->SCGC5 |= SIM_SCGC5_PORTD_MASK | SIM_SCGC5_PORTB_MASK;
+	PORTD->PCR[0] &= ~PORT_PCR_MUX_MASK;
+	PORTD->PCR[0] |= PORT_PCR_MUX(4);
+	PORTD->PCR[5] &= ~PORT_PCR_MUX_MASK;
+	PORTD->PCR[5] |= PORT_PCR_MUX(4);
+	PORTB->PCR[8] &= ~PORT_PCR_MUX_MASK;
+	PORTB->PCR[8] |= PORT_PCR_MUX(1);
+	PORTB->PCR[9] &= ~PORT_PCR_MUX_MASK;
+	PORTB->PCR[9] |= PORT_PCR_MUX(1);
+	PORTB->PCR[10] &= ~PORT_PCR_MUX_MASK;
+	PORTB->PCR[10] |= PORT_PCR_MUX(1);
+	PORTB->PCR[11] &= ~PORT_PCR_MUX_MASK;
+	PORTB->PCR[11] |= PORT_PCR_MUX(1);
+	PTB->PDDR |= MASK(8) | MASK(9) | MASK(10) | MASK(11);
+	PTB->PCOR |= MASK(8) | MASK(9) | MASK(10) | MASK(11);
+
+	// Init_LEDs()
+	PORTD->PCR[1] &= ~PORT_PCR_MUX_MASK;
+	PORTD->PCR[1] |= PORT_PCR_MUX(4);
+	PORTB->PCR[18] &= ~PORT_PCR_MUX_MASK;
+	PORTB->PCR[18] |= PORT_PCR_MUX(3);
+	PORTB->PCR[19] &= ~PORT_PCR_MUX_MASK;
+	PORTB->PCR[19] |= PORT_PCR_MUX(3);
+
+	// Init_Encoders()
+	SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK;
+	PORTA->PCR[12] &= ~PORT_PCR_MUX_MASK;
+	PORTA->PCR[12] |= PORT_PCR_MUX(3);
+	PORTA->PCR[13] &= ~PORT_PCR_MUX_MASK;
+	PORTA->PCR[13] |= PORT_PCR_MUX(3);
+
+	// Init_UART0()
+	SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK | SIM_SCGC5_PORTD_MASK;
+	PORTA->PCR[1] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(2);
+	PORTA->PCR[2] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(2);
+	PORTD->PCR[6] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(3);
+	PORTD->PCR[7] |= PORT_PCR_ISF_MASK | PORT_PCR_MUX(3);
+	flush();
+}
+
+static uint32_t mux_of(const block_t *blocks, int port, uint32_t pin) {
+	return (blocks[BLOCK_PORT + port].port.PCR[pin] & PORT_PCR_MUX_MASK) >> PORT_PCR_MUX_SHIFT;
+}
+
+static const uint32_t port_clocks[5] = {
+	SIM_SCGC5_PORTA_MASK, SIM_SCGC5_PORTB_MASK, SIM_SCGC5_PORTC_MASK,
+	SIM_SCGC5_PORTD_MASK, SIM_SCGC5_PORTE_MASK
+};
+
+#define CHECK_ENTRY(a, b, name, port, pin, mux, signal, out) \
+	check(mux_of(state, BOARD_PORT_##port, pin) == (mux), #name ": mux"); \
+	check((state[BOARD_GPIO_##port].gpio.PDDR >> (pin) & 1) == (out), #name ": direction"); \
+	check(!(state[BOARD_GPIO_##port].gpio.PDOR >> (pin) & 1), #name ": starts low"); \
+	check(state[BLOCK_SIM].sim.SCGC5 & port_clocks[BOARD_PORT_##port], #name ": port clock");
+
+#define BOARD_GPIO_A (BLOCK_GPIO + 0)
+#define BOARD_GPIO_B (BLOCK_GPIO + 1)
+#define BOARD_GPIO_C (BLOCK_GPIO + 2)
+#define BOARD_GPIO_D (BLOCK_GPIO + 3)
+#define BOARD_GPIO_E (BLOCK_GPIO + 4)
+
+int main(void) {
+	block_t before[BLOCKS];
+	unsigned long old_references;
+	uint32_t port, pin;
+
+	old_pin_setup();
+	memcpy(before, state, sizeof(state));
+	old_references = references;
+
+	memset(state, 0, sizeof(state));
+	references = 0;
+	Init_Board_Pins();
+	flush();
+
+	BOARD_PINS(CHECK_ENTRY, 0, 0)
+	for (port = 0; port < 5; port++) {
+		for (pin = 0; pin < 32; pin++) {
+			if (mux_of(before, port, pin) == 0 || (port == 0 && (pin == 1 || pin == 2)))
+				continue;
+			check_value(mux_of(state, port, pin) == mux_of(before, port, pin),
+					"same mux as before the table, port and pin", port * 100 + pin);
+		}
+	}
+	check(mux_of(state, 0, 1) == 0 && mux_of(state, 0, 2) == 0, "PTA1/PTA2 left unmuxed");
+
+	printf("before: %2lu register references, each a read-modify-write: %2lu bus accesses\n",
+			old_references, 2 * old_references);
+	printf("after:  %2lu register references, %lu a read-modify-write: %2lu bus accesses\n",
+			references, (unsigned long) NEW_READS, references + NEW_READS);
+	check(references + NEW_READS < 2 * old_references, "fewer bus accesses than before");
+	return sim_result();
+}
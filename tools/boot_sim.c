@@ -0,0 +1,109 @@
+/*
+ * Host model of the boot-time budget, reset to the first command.
+ *
+ * Adds up a cost for each piece of work in the BOOT_PHASES of boot.h, in
+ * the order main() runs them, at the core clock each runs at. Every cost is
+ * one of:
+ *
+ * - a bound from the part: the C runtime and the FreeRTOS stack fill
+ *   cannot touch more than the 16 KB of SRAM, at the cycle rates below;
+ * - a data sheet figure: PLL lock time and the crystal start-up allowance;
+ * - an estimate, in core cycles, for the flash reads, the register set-up
+ *   and the kernel.
+ *
+ * - Checks that the budget is under BOOT_TARGET_US and that the bounded and
+ *   data sheet items alone leave room for the estimates.
+ *
+ * This is a budget, not a measurement: the target counts as met once a
+ * BOOT_PROFILE build prints boot_total_us on a board (see boot.h).
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" \
+ *         -I"WheelsOnTheGo(BTEdition)/CMSIS" -o boot_sim tools/boot_sim.c
+ *     ./boot_sim
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "system_MKL25Z4.h"
+#include "sysclock.h"
+#include "config_store.h"
+#include "boot.h"
+#include "sim_check.h"
+
+#define BOOT_TARGET_US   (10000)
+
+#define SRAM_BYTES       (16 * 1024)
+#define SECTOR_BYTES     (1024)         // Read at about a byte per cycle
+#define XTAL_HZ          (8000000U)     // BOARD_XTAL0_CLK_HZ
+#define PLL_REF_HZ       (XTAL_HZ / 2)  // PRDIV of the RUN configuration
+
+// data_init() and bss_init() in the startup code: load, store, loop
+#define STARTUP_CYCLES_PER_WORD (6)
+// memset() of a new task stack to 0xa5
+#define FILL_CYCLES_PER_BYTE    (2)
+
+typedef enum {
+	BOUND = 0,
+	DATA_SHEET,
+	ESTIMATE
+} basis_t;
+
+static const char *const basis_names[] = { "bound", "data sheet", "estimate" };
+
+typedef struct {
+	boot_phase_t phase;
+	const char *what;
+	basis_t basis;
+	uint32_t us;
+} item_t;
+
+#define PHASE_NAME(id, name) [id] = name,
+static const char *const phase_names[BOOT_PHASE_COUNT] = { BOOT_PHASES(PHASE_NAME) };
+
+static uint32_t cycles_us(uint32_t cycles, uint32_t hz) {
+	return (uint32_t) ((uint64_t) cycles * 1000000U / hz + 1);
+}
+
+int main(void) {
+	const item_t items[] = {
+		{ BOOT_PHASE_STARTUP, ".data copy and .bss zeroing of all SRAM", BOUND,
+				cycles_us(SRAM_BYTES / 4 * STARTUP_CYCLES_PER_WORD, DEFAULT_SYSTEM_CLOCK) },
+		{ BOOT_PHASE_SYSCLOCK, "8 MHz crystal start-up allowance", DATA_SHEET, 1000 },
+		{ BOOT_PHASE_SYSCLOCK, "PLL lock: 150 us + 1075 reference cycles", DATA_SHEET,
+				150 + cycles_us(1075, PLL_REF_HZ) },
+		{ BOOT_PHASE_DRIVERS, "config and fault log sectors read", ESTIMATE,
+				cycles_us((CONFIG_STORE_SECTORS + 1) * SECTOR_BYTES, SYSCLOCK_FREQUENCY) },
+		{ BOOT_PHASE_DRIVERS, "peripheral register set-up: 20000 cycles", ESTIMATE,
+				cycles_us(20000, SYSCLOCK_FREQUENCY) },
+		{ BOOT_PHASE_KERNEL, "task stacks filled with 0xa5: all of SRAM", BOUND,
+				cycles_us(SRAM_BYTES * FILL_CYCLES_PER_BYTE, SYSCLOCK_FREQUENCY) },
+		{ BOOT_PHASE_KERNEL, "kernel objects created: 30000 cycles", ESTIMATE,
+				cycles_us(30000, SYSCLOCK_FREQUENCY) },
+		{ BOOT_PHASE_SCHEDULER, "scheduler start and task set-up: 10000 cycles", ESTIMATE,
+				cycles_us(10000, SYSCLOCK_FREQUENCY) },
+	};
+	uint32_t phase_us[BOOT_PHASE_COUNT] = { 0 };
+	uint32_t basis_us[3] = { 0 };
+	uint32_t total = 0;
+	uint32_t i;
+
+	printf("boot_phase,item,basis,us\n");
+	for (i = 0; i < sizeof(items) / sizeof(items[0]); i++) {
+		printf("%s,%s,%s,%lu\n", phase_names[items[i].phase], items[i].what,
+				basis_names[items[i].basis], (unsigned long) items[i].us);
+		phase_us[items[i].phase] += items[i].us;
+		basis_us[items[i].basis] += items[i].us;
+		total += items[i].us;
+	}
+	for (i = 0; i < BOOT_PHASE_COUNT; i++)
+		check_value(phase_us[i] > 0, "every phase budgeted", i);
+
+	printf("budget_total_us,%lu (target %u, %lu from bounds and the data sheet)\n",
+			(unsigned long) total, BOOT_TARGET_US,
+			(unsigned long) (basis_us[BOUND] + basis_us[DATA_SHEET]));
+	check(basis_us[BOUND] + basis_us[DATA_SHEET] < BOOT_TARGET_US / 2,
+			"bounds and data sheet items leave half the target to the estimates");
+	check(total < BOOT_TARGET_US, "budget under the target");
+	printf("not measured: run a BOOT_PROFILE build on a board for boot_total_us\n");
+	return sim_result();
+}
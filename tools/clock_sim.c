@@ -0,0 +1,184 @@
+/*
+ * Host model of the clock-mode divider math.
+ *
+ * Runs source/clock_div.c unchanged against the clock trees of both system
+ * clock modes (48 MHz RUN and 4 MHz VLPR).
+ *
+ * - Checks that every mode has a plan, that the SysTick and PIT reloads
+ *   give the RTOS tick and the run-time stats counter exactly, and that the
+ *   PWM is within 0.1% of TPM_PWM_FREQUENCY with at least 1% duty
+ *   resolution. RUN must keep exactly TPM_PWM_PERIOD counts.
+ * - Checks the UART0 divider at every supported baud rate in every mode:
+ *   error under 2% (the receiver tolerates about 3%), no better SBR/OSR
+ *   pair exists, and the divider is the same in both modes, so a
+ *   transition never touches UART0.
+ * - Rescales every compare value from RUN to VLPR and back and checks the
+ *   duty error, that constant outputs stay constant and that toggling
+ *   outputs keep toggling.
+ * - Sweeps TPM input clocks from 1 to 48 MHz and checks every PWM divider
+ *   found fits the period and is the finest one within 0.5 counts.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" \
+ *         -I"WheelsOnTheGo(BTEdition)/CMSIS" -o clock_sim tools/clock_sim.c \
+ *         "WheelsOnTheGo(BTEdition)/source/clock_div.c"
+ *     ./clock_sim
+ */
+#include <stdio.h>
+#include "clock_div.h"
+#include "tpm.h"
+#include "profile.h"
+#include "sim_check.h"
+
+#define TICK_HZ        (1000)      // configTICK_RATE_HZ
+#define MAX_BAUD_ERROR (0.02)
+#define MAX_PWM_ERROR  (0.001)
+#define MIN_PERIOD     (100)       // 1% duty resolution
+
+static const uint32_t bauds[] = { 9600, 19200, 38400, 57600, 115200 };
+static const char *const names[SYSCLOCK_MODES] = { "RUN", "VLPR" };
+
+static clock_plan_t plans[SYSCLOCK_MODES];
+
+static double fabs_diff(double a, double b) {
+	return (a > b) ? a - b : b - a;
+}
+
+static double baud_error(uint32_t clock_hz, uint32_t sbr, uint32_t osr,
+		uint32_t baud) {
+	return fabs_diff((double) clock_hz / (sbr * osr), baud) / baud;
+}
+
+static void plans_per_mode(void) {
+	const clock_tree_t *tree;
+	double error;
+	int mode;
+
+	for (mode = 0; mode < SYSCLOCK_MODES; mode++) {
+		tree = &clock_trees[mode];
+		check_value(Clock_Div_Plan(mode, TICK_HZ, 115200, &plans[mode]),
+				"plan for every mode", mode);
+
+		check_value((plans[mode].systick_reload + 1) * TICK_HZ == tree->core_hz,
+				"exact SysTick reload", plans[mode].systick_reload);
+		check_value((plans[mode].pit_reload + 1) * PROFILE_COUNTER_HZ == tree->bus_hz,
+				"exact PIT reload", plans[mode].pit_reload);
+
+		error = fabs_diff((double) (tree->tpm_hz >> plans[mode].pwm.ps)
+				/ plans[mode].pwm.period, TPM_PWM_FREQUENCY) / TPM_PWM_FREQUENCY;
+		check_value(error < MAX_PWM_ERROR, "PWM frequency", plans[mode].pwm.pwm_hz);
+		check_value(plans[mode].pwm.period >= MIN_PERIOD
+				&& plans[mode].pwm.period <= TPM_PWM_PERIOD, "PWM resolution",
+				plans[mode].pwm.period);
+
+		printf("%-4s core %8lu Hz  bus %8lu Hz  SysTick %6lu  PIT %5lu  "
+				"PWM ps %u period %4u = %lu Hz (%.3f%%)\n", names[mode],
+				(unsigned long) tree->core_hz, (unsigned long) tree->bus_hz,
+				(unsigned long) plans[mode].systick_reload,
+				(unsigned long) plans[mode].pit_reload, plans[mode].pwm.ps,
+				plans[mode].pwm.period, (unsigned long) plans[mode].pwm.pwm_hz,
+				100.0 * error);
+	}
+	check_value(plans[SYSCLOCK_RUN].pwm.period == TPM_PWM_PERIOD,
+			"RUN keeps TPM_PWM_PERIOD", plans[SYSCLOCK_RUN].pwm.period);
+}
+
+static void uart_per_baud(void) {
+	clock_div_uart_t div[SYSCLOCK_MODES];
+	double error, best;
+	uint32_t osr, sbr;
+	unsigned i;
+	int mode;
+
+	for (i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+		for (mode = 0; mode < SYSCLOCK_MODES; mode++) {
+			const uint32_t clock_hz = clock_trees[mode].uart0_hz;
+
+			check_value(Clock_Div_Uart(clock_hz, bauds[i], &div[mode]),
+					"UART divider found", bauds[i]);
+			error = baud_error(clock_hz, div[mode].sbr, div[mode].osr, bauds[i]);
+			check_value(error < MAX_BAUD_ERROR, "baud error", bauds[i]);
+
+			// Exhaustive search for a closer divider
+			best = 1.0;
+			for (osr = 4; osr <= 32; osr++)
+				for (sbr = 1; sbr <= 0x1FFF; sbr++)
+					if (baud_error(clock_hz, sbr, osr, bauds[i]) < best)
+						best = baud_error(clock_hz, sbr, osr, bauds[i]);
+			check_value(error <= best + 1e-9, "closest divider", bauds[i]);
+
+			printf("%-4s %6lu baud: SBR %4u OSR %2u = %6lu baud (%.2f%%)\n",
+					names[mode], (unsigned long) bauds[i], div[mode].sbr,
+					div[mode].osr, (unsigned long) div[mode].baud, 100.0 * error);
+		}
+		check_value(div[SYSCLOCK_RUN].sbr == div[SYSCLOCK_VLPR].sbr
+				&& div[SYSCLOCK_RUN].osr == div[SYSCLOCK_VLPR].osr,
+				"UART0 divider unchanged across modes", bauds[i]);
+	}
+}
+
+static void rescale(void) {
+	const uint32_t run = plans[SYSCLOCK_RUN].pwm.period;
+	const uint32_t vlpr = plans[SYSCLOCK_VLPR].pwm.period;
+	uint32_t cnv, down, back;
+	double error, worst_down = 0, worst_back = 0;
+
+	for (cnv = 0; cnv <= run + 10; cnv++) {
+		down = Clock_Div_Rescale(cnv, run, vlpr);
+		back = Clock_Div_Rescale(down, vlpr, run);
+
+		if (cnv == 0) {
+			check_value(down == 0 && back == 0, "zero stays zero", cnv);
+		} else if (cnv >= run) {
+			check_value(down == vlpr && back == run, "constant stays constant", cnv);
+		} else {
+			check_value(down > 0 && down < vlpr, "toggling keeps toggling", cnv);
+			check_value(back > 0 && back < run, "toggling keeps toggling back", cnv);
+			// Half a count, or one count where a clamp kept it toggling
+			error = fabs_diff((double) down / vlpr, (double) cnv / run) * vlpr;
+			check_value(error <= 1.0, "duty error after rescale", cnv);
+			if (error > worst_down)
+				worst_down = error;
+			error = fabs_diff((double) back / run, (double) cnv / run) * vlpr;
+			check_value(error <= 1.0, "duty error after round trip", cnv);
+			if (error > worst_back)
+				worst_back = error;
+		}
+	}
+	printf("rescale %lu -> %lu counts: worst duty error %.2f VLPR counts, "
+			"%.2f after the round trip\n", (unsigned long) run,
+			(unsigned long) vlpr, worst_down, worst_back);
+}
+
+static void sweep(void) {
+	clock_div_tpm_t div;
+	uint32_t clock_hz, period;
+	unsigned long found = 0;
+
+	for (clock_hz = 1000000; clock_hz <= 48000000; clock_hz += 250000) {
+		if (!Clock_Div_Tpm(clock_hz, TPM_PWM_FREQUENCY, TPM_PWM_PERIOD, &div))
+			continue;
+		found++;
+		check_value(div.period <= TPM_PWM_PERIOD, "period fits", clock_hz);
+		check_value(fabs_diff((double) (clock_hz >> div.ps) / TPM_PWM_FREQUENCY,
+				div.period) <= 0.5, "period within half a count", clock_hz);
+		// A smaller prescaler would not have fitted
+		if (div.ps > 0) {
+			period = ((clock_hz >> (div.ps - 1)) + TPM_PWM_FREQUENCY / 2)
+					/ TPM_PWM_FREQUENCY;
+			check_value(period > TPM_PWM_PERIOD, "finest prescaler", clock_hz);
+		}
+	}
+	check_value(found == (48000000 - 1000000) / 250000 + 1, "divider at every clock",
+			found);
+	printf("%lu TPM input clocks from 1 to 48 MHz all reach %u Hz\n", found,
+			TPM_PWM_FREQUENCY);
+}
+
+int main(void) {
+	plans_per_mode();
+	uart_per_baud();
+	rescale();
+	sweep();
+	return sim_result();
+}
@@ -0,0 +1,193 @@
+/*
+ * Host simulation of the configuration store flash sectors.
+ *
+ * Runs source/config_store.c unchanged against a RAM model of two KL25Z
+ * flash sectors that enforces the FTFA rules: erase sets every byte to
+ * 0xFF, and a longword may only be programmed while it is erased.
+ *
+ * - Measures sector erases per 10k updates.
+ * - Cuts the power after every possible number of flash operations during
+ *   updates, including the ones that copy into the other sector, reloads
+ *   the store and checks that the interrupted key holds its old or new value
+ *   and every other key its last stored value.
+ * - Keeps updating on top of the torn records and sectors those cuts leave.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o config_store_sim \
+ *         tools/config_store_sim.c "WheelsOnTheGo(BTEdition)/source/config_store.c" \
+ *         "WheelsOnTheGo(BTEdition)/source/protocol.c"
+ *     ./config_store_sim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config_store.h"
+#include "sim_check.h"
+
+#define SECTOR_SIZE  (1024)
+#define KEYS         (6)
+#define UPDATES      (10000)
+#define CRASH_RUNS   (300)
+
+static uint32_t flash[CONFIG_STORE_SECTORS][SECTOR_SIZE / sizeof(uint32_t)];
+static unsigned long erases;
+static unsigned long violations;
+static long budget = -1;          // Flash operations left before power loss
+
+static bool power_lost(void) {
+	if (budget == 0)
+		return true;
+	if (budget > 0)
+		budget--;
+	return false;
+}
+
+static bool sim_erase(uint32_t sector) {
+	if (power_lost()) {
+		// An interrupted erase leaves the sector partly erased
+		memset(flash[sector], 0xFF, SECTOR_SIZE / 2);
+		return false;
+	}
+	memset(flash[sector], 0xFF, SECTOR_SIZE);
+	erases++;
+	return true;
+}
+
+static bool sim_program(uint32_t sector, uint32_t offset, const uint32_t *data,
+		uint32_t len) {
+	uint32_t i;
+
+	if (offset % 4 != 0 || len % 4 != 0 || offset + len > SECTOR_SIZE) {
+		violations++;
+		return false;
+	}
+	for (i = 0; i < len / 4; i++) {
+		if (power_lost())
+			return false;
+		if (flash[sector][offset / 4 + i] != 0xFFFFFFFFUL) {
+			violations++;
+			return false;
+		}
+		flash[sector][offset / 4 + i] = data[i];
+	}
+	return true;
+}
+
+// Boot: a fresh store loaded from the flash contents
+static void boot(config_store_t *store, uint32_t *values) {
+	uint32_t k;
+
+	memset(store, 0, sizeof(*store));
+	store->base[0] = (const uint8_t *) flash[0];
+	store->base[1] = (const uint8_t *) flash[1];
+	store->size = SECTOR_SIZE;
+	store->erase = sim_erase;
+	store->program = sim_program;
+	store->keys = KEYS;
+	store->values = values;
+	for (k = 0; k < KEYS; k++)
+		values[k] = 1000 + k;
+	Config_Store_Load(store);
+}
+
+static void erase_counts(void) {
+	config_store_t store;
+	uint32_t values[KEYS];
+	uint32_t i;
+
+	memset(flash, 0xFF, sizeof(flash));
+	boot(&store, values);
+	erases = 0;
+	for (i = 0; i < UPDATES; i++)
+		check(Config_Store_Set(&store, rand() % KEYS, (uint32_t) rand()), "set");
+	printf("%u updates: %lu sector erases, %u records per sector\n", UPDATES,
+			erases, (unsigned) ((SECTOR_SIZE - 8) / 8));
+}
+
+static void power_loss(void) {
+	config_store_t store;
+	uint32_t values[KEYS];
+	uint32_t committed[KEYS];
+	uint32_t key, value, k;
+	unsigned long cuts = 0;
+	long ops;
+	int run;
+	bool done;
+
+	memset(flash, 0xFF, sizeof(flash));
+	boot(&store, values);
+	memcpy(committed, values, sizeof(committed));
+
+	for (run = 0; run < CRASH_RUNS; run++) {
+		key = rand() % KEYS;
+		value = (uint32_t) rand();
+
+		// Cut the power after 0, 1, 2... operations until the update completes
+		for (ops = 0, done = false; !done; ops++) {
+			uint32_t saved[CONFIG_STORE_SECTORS][SECTOR_SIZE / sizeof(uint32_t)];
+
+			memcpy(saved, flash, sizeof(flash));
+			boot(&store, values);
+			budget = ops;
+			done = Config_Store_Set(&store, key, value);
+			budget = -1;
+
+			boot(&store, values);
+			check(values[key] == committed[key] || values[key] == value,
+					"interrupted key holds its old or new value");
+			check(!done || values[key] == value, "completed update kept");
+			for (k = 0; k < KEYS; k++) {
+				if (k != key)
+					check(values[k] == committed[k], "other keys unchanged");
+			}
+			if (!done) {
+				cuts++;
+				memcpy(flash, saved, sizeof(flash));
+			}
+		}
+		committed[key] = value;
+	}
+	printf("%lu power cuts over %u updates, every key consistent after each\n",
+			cuts, CRASH_RUNS);
+}
+
+static void torn_history(void) {
+	config_store_t store;
+	uint32_t values[KEYS];
+	uint32_t committed[KEYS];
+	uint32_t key, value, k;
+	int run;
+
+	memset(flash, 0xFF, sizeof(flash));
+	boot(&store, values);
+	memcpy(committed, values, sizeof(committed));
+
+	for (run = 0; run < UPDATES; run++) {
+		key = rand() % KEYS;
+		value = (uint32_t) rand();
+
+		// Lose power in one update out of four
+		budget = (rand() % 4 == 0) ? rand() % 20 : -1;
+		Config_Store_Set(&store, key, value);
+		budget = -1;
+
+		boot(&store, values);
+		check(values[key] == committed[key] || values[key] == value,
+				"key holds its old or new value after a torn history");
+		for (k = 0; k < KEYS; k++) {
+			if (k != key)
+				check(values[k] == committed[k], "other keys unchanged after a torn history");
+		}
+		committed[key] = values[key];
+	}
+	printf("%u updates on top of torn writes, every key consistent\n", UPDATES);
+}
+
+int main(void) {
+	srand(1);
+	erase_counts();
+	power_loss();
+	torn_history();
+	check(violations == 0, "no program of a non-erased word");
+	return sim_result();
+}
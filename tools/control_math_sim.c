@@ -0,0 +1,226 @@
+/*
+ * Host simulation of the fixed-point control kernels.
+ *
+ * Runs source/control_math.c unchanged with the CMSIS reference C code of
+ * arm_math.h for the Cortex-M0 family, the same code the part runs, so the
+ * results here are the part's bit for bit.
+ *
+ * - Checks the saturating Q15 add, subtract and multiply against exact
+ *   integer arithmetic over a grid of operands, limits included.
+ * - Checks that ctl_pid_q15() is arm_pid_q15() with the gains of
+ *   arm_pid_init_q15() while inside its limits, and ctl_pid_q31() the same,
+ *   that a PI loop on a first-order plant tracks a float version, that the
+ *   output stays within the limits and that it leaves a limit on the first
+ *   sample the error changes sign (no windup).
+ * - Checks that the slew limiter never moves more than max_step and lands
+ *   on the target, that the low-pass filter follows the float step response
+ *   and settles within 1 LSB of its input, and that the mixer is exact
+ *   unless a side saturates, then keeps the larger side at full scale and
+ *   the turn ratio.
+ *
+ * Nothing here is timed: the host has an FPU and the part does not, so
+ * host timings say nothing of the part. Control_Math_Benchmark() of a
+ * CONTROL_MATH_BENCHMARK build prints the Cortex-M0+ cycle counts.
+ *
+ * Build and run from the repository root:
+ *     cc -std=gnu99 -Wall -O2 -Wno-int-to-pointer-cast -Wno-pointer-to-int-cast \
+ *         -I"WheelsOnTheGo(BTEdition)/source" -I"WheelsOnTheGo(BTEdition)/CMSIS" \
+ *         -o control_math_sim tools/control_math_sim.c \
+ *         "WheelsOnTheGo(BTEdition)/source/control_math.c" -lm
+ *     ./control_math_sim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "control_math.h"
+#include "sim_check.h"
+
+#define GRID_STEP     (97)        // Operand stride over the whole Q15 range
+#define PID_STEPS     (5000)
+#define PLANT_ALPHA   (0.02)      // First-order plant per sample
+#define LPF_STEPS     (2000)
+
+static q15_t clamp_q15(int64_t x) {
+	return (q15_t) (x > 32767 ? 32767 : x < -32768 ? -32768 : x);
+}
+
+// Every multiple of GRID_STEP from -32768, and the limits
+static int next_operand(int x) {
+	if (x == 32767)
+		return 32768;
+	return x + GRID_STEP > 32767 ? 32767 : x + GRID_STEP;
+}
+
+static void saturating(void) {
+	int a, b;
+	int64_t p;
+
+	for (a = -32768; a <= 32767; a = next_operand(a)) {
+		for (b = -32768; b <= 32767; b = next_operand(b)) {
+			check_value(ctl_add_q15(a, b) == clamp_q15(a + b), "saturating add", a);
+			check_value(ctl_sub_q15(a, b) == clamp_q15(a - b), "saturating subtract", a);
+			// Round half up, as (a * b + 2^14) >> 15
+			p = (int64_t) a * b;
+			check_value(ctl_mul_q15(a, b) == clamp_q15((p + 16384) >> 15),
+					"rounded multiply", a);
+		}
+	}
+	check(ctl_mul_q15(-32768, -32768) == Q15_ONE, "-1 * -1 saturates to +1");
+}
+
+/*
+ * Within its limits the controller is the CMSIS one, with the gain set-up
+ * of arm_pid_init_q15(): A0 = Kp + Ki + Kd, A1 = -(Kp + 2 Kd), A2 = Kd.
+ */
+static void pid_matches_cmsis(void) {
+	arm_pid_instance_q15 ctl, ref;
+	arm_pid_instance_q31 ctl31, ref31;
+	q15_t error, kp = Q15(0.5), ki = Q15(0.01), kd = Q15(0.05);
+	q31_t error31;
+	uint32_t i, seed = 1;
+
+	ctl_pid_init_q15(&ctl, kp, ki, kd);
+	check(ctl.A0 == kp + ki + kd && ctl.A1 == -(kp + 2 * kd) && ctl.A2 == kd,
+			"Q15 gains of arm_pid_init_q15()");
+	ref = ctl;
+	ctl_pid_init_q31(&ctl31, Q31(0.5), Q31(0.01), Q31(0.05));
+	check(ctl31.A0 == Q31(0.5) + Q31(0.01) + Q31(0.05)
+			&& ctl31.A1 == -(Q31(0.5) + 2 * Q31(0.05)) && ctl31.A2 == Q31(0.05),
+			"Q31 gains of arm_pid_init_q31()");
+	ref31 = ctl31;
+	for (i = 0; i < PID_STEPS; i++) {
+		seed = seed * 1103515245u + 12345u;
+		error = (q15_t) ((int16_t) (seed >> 16) / 64);
+		error31 = (q31_t) error << 16;
+		check_value(ctl_pid_q15(&ctl, error, -32768, 32767) == arm_pid_q15(&ref, error),
+				"ctl_pid_q15() is arm_pid_q15()", i);
+		check_value(ctl_pid_q31(&ctl31, error31, INT32_MIN, INT32_MAX)
+				== arm_pid_q31(&ref31, error31), "ctl_pid_q31() is arm_pid_q31()", i);
+	}
+}
+
+/*
+ * The PI loop of speed_control.c on a first-order plant, against a float PI
+ * whose integral is clamped the same way.
+ */
+static void pid_loop(void) {
+	arm_pid_instance_q15 pid;
+	q15_t out, min = 0, max = Q15(0.8), last = 0;
+	double speed = 0.0, fspeed = 0.0, target, fout, integral = 0.0, diff, worst = 0.0;
+	double kp = 0.5, ki = 0.01;
+	uint32_t i;
+	int at_max = 0;
+
+	ctl_pid_init_q15(&pid, Q15(0.5), Q15(0.01), 0);
+	for (i = 0; i < PID_STEPS; i++) {
+		// 0.5, then out of reach so the output saturates, then 0.3
+		target = i < PID_STEPS / 3 ? 0.5 : i < 2 * PID_STEPS / 3 ? 0.95 : 0.3;
+
+		out = ctl_pid_q15(&pid, (q15_t) ((target - speed) * 32768.0), min, max);
+		check_value(out >= min && out <= max, "output within the limits", i);
+		if (at_max && target - speed < 0.0)
+			check_value(out < max, "leaves the limit as the error turns", i);
+		at_max = out == max;
+		if (i == 2 * PID_STEPS / 3)
+			check_value(last == max, "saturated on an unreachable target", last);
+		last = out;
+		speed += (out / 32768.0 - speed) * PLANT_ALPHA;
+
+		integral += ki * (target - fspeed);
+		fout = kp * (target - fspeed) + integral;
+		if (fout > max / 32768.0)
+			fout = max / 32768.0;
+		else if (fout < 0.0)
+			fout = 0.0;
+		integral = fout - kp * (target - fspeed);   // Clamped state, as ctl_pid_q15()
+		fspeed += (fout - fspeed) * PLANT_ALPHA;
+
+		diff = fabs(speed - fspeed);
+		if (diff > worst)
+			worst = diff;
+	}
+	printf("PI loop: worst distance from float %.5f, final speed %.4f (target 0.3)\n",
+			worst, speed);
+	check(worst < 0.01, "PI loop tracks float within 1% of full scale");
+	check(fabs(speed - 0.3) < 0.005, "PI loop settles on the target");
+}
+
+static void slew(void) {
+	static const q15_t targets[] = { 32767, -32768, 0, 1000, 999, -32768 };
+	ctl_slew_q15_t limiter = { 0, Q15(0.01) };
+	q15_t before, after;
+	uint32_t t, steps, expected;
+
+	for (t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+		before = limiter.value;
+		expected = (abs(targets[t] - before) + limiter.max_step - 1) / limiter.max_step;
+		for (steps = 0; limiter.value != targets[t] && steps <= expected; steps++) {
+			after = ctl_slew_q15(&limiter, targets[t]);
+			check_value(abs(after - before) <= limiter.max_step, "at most max_step", t);
+			check_value((after - before) * (targets[t] - before) > 0, "towards the target", t);
+			before = after;
+		}
+		check_value(steps == expected, "lands on the target in the fewest steps", t);
+		check_value(ctl_slew_q15(&limiter, targets[t]) == targets[t], "stays on the target", t);
+	}
+}
+
+static void lpf(void) {
+	static const double alphas[] = { 0.01, 0.1, 0.5 };
+	static const q15_t inputs[] = { 20000, -20000, 1 };
+	ctl_lpf_q15_t filter;
+	double diff, worst = 0.0, y;
+	uint32_t a, s, n;
+	q15_t out = 0;
+
+	for (a = 0; a < sizeof(alphas) / sizeof(alphas[0]); a++) {
+		filter.alpha = Q15(alphas[a]);
+		filter.state = 0;
+		y = 0.0;
+		for (s = 0; s < sizeof(inputs) / sizeof(inputs[0]); s++) {
+			for (n = 0; n < LPF_STEPS; n++) {
+				out = ctl_lpf_q15(&filter, inputs[s]);
+				y += filter.alpha / 32768.0 * (inputs[s] - y);
+				diff = fabs(out - y);
+				if (diff > worst)
+					worst = diff;
+			}
+			check_value(abs(out - inputs[s]) <= 1, "settles within 1 LSB", s);
+		}
+	}
+	printf("low-pass step responses: worst distance from float %.2f LSB\n", worst);
+	check(worst <= 2.0, "step response within 2 LSB of float");
+}
+
+static void mix(void) {
+	int throttle, steer, l, r, peak;
+	q15_t left, right;
+
+	for (throttle = -32768; throttle <= 32767; throttle = next_operand(throttle)) {
+		for (steer = -32768; steer <= 32767; steer = next_operand(steer)) {
+			ctl_mix_q15(throttle, steer, &left, &right);
+			l = throttle + steer;
+			r = throttle - steer;
+			peak = abs(l) > abs(r) ? abs(l) : abs(r);
+			if (peak <= 32767) {
+				check_value(left == l && right == r, "exact within range", throttle);
+				continue;
+			}
+			check_value((abs(left) > abs(right) ? abs(left) : abs(right)) == 32767,
+					"larger side at full scale", throttle);
+			// left / right == l / r, to the truncation of each side
+			check_value(llabs((long long) left * r - (long long) right * l) <= 2LL * peak,
+					"turn ratio kept", throttle);
+		}
+	}
+}
+
+int main(void) {
+	saturating();
+	pid_matches_cmsis();
+	pid_loop();
+	slew();
+	lpf();
+	mix();
+	return sim_result();
+}
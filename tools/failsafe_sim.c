@@ -0,0 +1,203 @@
+/*
+ * Host simulation of the Bluetooth link-loss failsafe.
+ *
+ * Runs source/supervisor.c unchanged on a 1 ms tick, polled every
+ * FAILSAFE_PERIOD_MS as the failsafe timer does. A simulated client sends
+ * frames at random intervals and drops the link for random lengths of time.
+ * The tick counter starts just before it wraps.
+ *
+ * - Checks that every drop longer than the timeout posts exactly one stop,
+ *   no earlier than the timeout and no later than the timeout plus one poll
+ *   period after the last frame, and that no stop is posted while frames
+ *   arrive within the timeout.
+ * - Checks that the link is reported restored once by the next frame.
+ * - Checks that legacy commands before the first frame arm the supervision
+ *   with the legacy timeout: one stop no earlier than the legacy timeout
+ *   and no later than one poll period after it, and none while commands
+ *   keep arriving within it.
+ * - Runs the critical tasks checking in every FAILSAFE_CHECKIN_MS or sooner
+ *   and checks that the COP (1024 ms) is always serviced in time, then
+ *   stalls one task and checks that the COP expires.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o failsafe_sim \
+ *         tools/failsafe_sim.c "WheelsOnTheGo(BTEdition)/source/supervisor.c"
+ *     ./failsafe_sim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "failsafe.h"
+#include "supervisor.h"
+#include "sim_check.h"
+
+#define TIMEOUT_MS    (1000)       // CONFIG_LINK_TIMEOUT_MS default
+#define LEGACY_MS     (30000)      // CONFIG_LEGACY_TIMEOUT_MS default
+#define COP_MS        (1024)
+#define START_TICK    (0xFFFF0000UL)
+#define LINK_MS       (20000000UL) // Simulated time for the link checks
+#define DROPS         (2000)
+#define COP_RUN_MS    (2000000UL)
+
+static supervisor_t supervisor;
+static uint32_t now;
+
+// Milliseconds since a tick, across the wrap
+static uint32_t since(uint32_t tick) {
+	return now - tick;
+}
+
+/*
+ * A client sending only single-character commands, with pauses longer than
+ * the frame timeout but shorter than the legacy one, then going silent.
+ */
+static void legacy_commands(uint32_t phase) {
+	uint32_t last_command = now, next_command = now, stopped_after = 0;
+	unsigned long ms, stops = 0;
+	bool service;
+
+	for (ms = 0; ms < 20 * LEGACY_MS; ms++, now++) {
+		if (ms < 10 * LEGACY_MS && now == next_command) {
+			Supervisor_Activity(&supervisor, now, false);
+			last_command = now;
+			next_command = now + 1 + (uint32_t) rand() % (LEGACY_MS - 1);
+		}
+		if (ms % FAILSAFE_PERIOD_MS != phase)
+			continue;
+		switch (Supervisor_Poll(&supervisor, now, TIMEOUT_MS, LEGACY_MS, &service)) {
+		case SUPERVISOR_LINK_LOST:
+			check_value(since(last_command) >= LEGACY_MS, "no stop within the legacy timeout", now);
+			check_value(since(last_command) < LEGACY_MS + FAILSAFE_PERIOD_MS,
+					"stop within the legacy timeout and one poll period", now);
+			stopped_after = since(last_command);
+			stops++;
+			break;
+		case SUPERVISOR_LINK_RESTORED:
+			check_value(0, "no restore without a command", now);
+			break;
+		default:
+			break;
+		}
+	}
+	check_value(stops == 1, "one stop once the legacy commands end", stops);
+	printf("legacy commands: %lu stop, %lu ms after the last command (deadline %u ms)\n",
+			stops, (unsigned long) stopped_after, LEGACY_MS + FAILSAFE_PERIOD_MS);
+}
+
+static void link_drops(void) {
+	uint32_t last_frame, next_frame, phase, worst = 0;
+	unsigned long ms, drops = 0, stops = 0, restores = 0;
+	int lost = 1;
+	bool service;
+
+	Supervisor_Init(&supervisor, 0);
+	now = START_TICK;
+	phase = (uint32_t) rand() % FAILSAFE_PERIOD_MS;
+
+	// Legacy commands arm the supervision with the legacy timeout; the link
+	// is lost when the first frame arrives below
+	legacy_commands(phase);
+
+	last_frame = now;
+	next_frame = now;
+	for (ms = 0; ms < LINK_MS; ms++, now++) {
+		if (now == next_frame) {
+			Supervisor_Activity(&supervisor, now, true);
+			last_frame = now;
+			if (rand() % 500 == 0 && drops < DROPS) {
+				// Drop the link for up to three timeouts
+				next_frame = now + 1 + (uint32_t) rand() % (3 * TIMEOUT_MS);
+				drops++;
+			} else {
+				// Frames keep coming, sometimes just within the timeout
+				next_frame = now + 1 + (uint32_t) rand()
+						% ((rand() % 20 == 0) ? TIMEOUT_MS - 1 : 100);
+			}
+		}
+
+		if (ms % FAILSAFE_PERIOD_MS != phase)
+			continue;
+		switch (Supervisor_Poll(&supervisor, now, TIMEOUT_MS, LEGACY_MS, &service)) {
+		case SUPERVISOR_LINK_LOST:
+			check_value(!lost, "one stop per drop", now);
+			check_value(since(last_frame) >= TIMEOUT_MS, "no stop within the timeout", now);
+			check_value(since(last_frame) < TIMEOUT_MS + FAILSAFE_PERIOD_MS,
+					"stop within the timeout and one poll period", now);
+			if (since(last_frame) > worst)
+				worst = since(last_frame);
+			lost = 1;
+			stops++;
+			break;
+		case SUPERVISOR_LINK_RESTORED:
+			check_value(lost, "restored only after a loss", now);
+			lost = 0;
+			restores++;
+			break;
+		default:
+			// A silence past the deadline must already have been reported
+			check_value(lost || since(last_frame) < TIMEOUT_MS, "stop not missed", now);
+			break;
+		}
+	}
+	printf("%lu drops, %lu stops, %lu restores, worst stop %lu ms after the last frame"
+			" (deadline %u ms)\n", drops, stops, restores, (unsigned long) worst,
+			TIMEOUT_MS + FAILSAFE_PERIOD_MS);
+}
+
+static void cop(void) {
+	uint32_t next_check_in[FAILSAFE_TASKS];
+	uint32_t last_service, worst = 0, task, stalled;
+	unsigned long ms;
+	bool service;
+
+	Supervisor_Init(&supervisor, FAILSAFE_TASKS);
+	now = START_TICK;
+	last_service = now;
+	for (task = 0; task < FAILSAFE_TASKS; task++)
+		next_check_in[task] = now + (uint32_t) rand() % FAILSAFE_CHECKIN_MS;
+
+	// Tasks wake on their own events or at the latest every FAILSAFE_CHECKIN_MS
+	for (ms = 0; ms < COP_RUN_MS; ms++, now++) {
+		for (task = 0; task < FAILSAFE_TASKS; task++) {
+			if (now == next_check_in[task]) {
+				Supervisor_Check_In(&supervisor, task);
+				next_check_in[task] = now + 1 + (uint32_t) rand() % FAILSAFE_CHECKIN_MS;
+			}
+		}
+		if (ms % FAILSAFE_PERIOD_MS == 0) {
+			Supervisor_Poll(&supervisor, now, 0, 0, &service);
+			if (service)
+				last_service = now;
+		}
+		if (since(last_service) > worst)
+			worst = since(last_service);
+		check_value(since(last_service) < COP_MS, "COP serviced in time", now);
+	}
+	printf("%lu ms of running tasks, longest COP service gap %lu ms (COP %u ms)\n",
+			COP_RUN_MS, (unsigned long) worst, COP_MS);
+
+	// A stalled task stops the service
+	stalled = (uint32_t) rand() % FAILSAFE_TASKS;
+	for (ms = 0; ms < 2 * COP_MS; ms++, now++) {
+		for (task = 0; task < FAILSAFE_TASKS; task++) {
+			if (task != stalled && now == next_check_in[task]) {
+				Supervisor_Check_In(&supervisor, task);
+				next_check_in[task] = now + 1 + (uint32_t) rand() % FAILSAFE_CHECKIN_MS;
+			}
+		}
+		if (ms % FAILSAFE_PERIOD_MS == 0) {
+			Supervisor_Poll(&supervisor, now, 0, 0, &service);
+			if (service)
+				last_service = now;
+		}
+	}
+	check_value(since(last_service) >= COP_MS, "COP expires when a task stalls", now);
+	printf("task %lu stalled, no COP service for %lu ms\n",
+			(unsigned long) stalled, (unsigned long) since(last_service));
+}
+
+int main(void) {
+	srand(1);
+	link_drops();
+	cop();
+	return sim_result();
+}
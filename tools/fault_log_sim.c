@@ -0,0 +1,161 @@
+/*
+ * Host simulation of the fault log flash sector.
+ *
+ * Runs source/fault_log.c unchanged against a RAM model of one KL25Z flash
+ * sector that enforces the FTFA rules: erase sets every byte to 0xFF, and a
+ * longword may only be programmed while it is erased. Checks the record
+ * format, ordering, reporting, torn writes and how often the sector is
+ * erased, and that a crash loop keeps its first records rather than its
+ * last.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o fault_log_sim \
+ *         tools/fault_log_sim.c "WheelsOnTheGo(BTEdition)/source/fault_log.c"
+ *     ./fault_log_sim
+ */
+#include <stdio.h>
+#include <string.h>
+#include "fault_log.h"
+#include "sim_check.h"
+
+#define SECTOR_SIZE    (1024)
+#define ENDURANCE      (50000UL)  // KL25Z program/erase cycles per sector
+#define FAULTS         (1000)
+
+static uint32_t sector[SECTOR_SIZE / sizeof(uint32_t)];
+static unsigned long erases;
+static unsigned long violations;
+static long torn_after = -1;      // Words to program before a simulated reset
+
+static bool sim_erase(void) {
+	memset(sector, 0xFF, sizeof(sector));
+	erases++;
+	return true;
+}
+
+static bool sim_program(uint32_t offset, const uint32_t *data, uint32_t len) {
+	uint32_t i;
+
+	if (offset % 4 != 0 || len % 4 != 0 || offset + len > SECTOR_SIZE) {
+		violations++;
+		return false;
+	}
+	for (i = 0; i < len / 4; i++) {
+		if (torn_after == 0)
+			return false;
+		if (torn_after > 0)
+			torn_after--;
+		if (sector[offset / 4 + i] != FAULT_LOG_ERASED) {
+			violations++;
+			return false;
+		}
+		sector[offset / 4 + i] = data[i];
+	}
+	return true;
+}
+
+static const fault_log_t sim_log = {
+	(const uint8_t *) sector, SECTOR_SIZE, sim_erase, sim_program
+};
+
+static fault_record_t make_record(uint32_t pc) {
+	fault_record_t record;
+
+	memset(&record, 0, sizeof(record));
+	record.pc = pc;
+	strncpy(record.task, "motor", FAULT_TASK_NAME);
+	record.events = 1;
+	record.trace[0].time = pc * 3;
+	return record;
+}
+
+// Every fault is reported on the following boot
+static void reported_faults(void) {
+	const fault_record_t *stored;
+	fault_record_t record;
+	uint32_t i;
+
+	sim_erase();
+	erases = 0;
+	for (i = 0; i < FAULTS; i++) {
+		record = make_record(i);
+		check(Fault_Log_Append(&sim_log, &record), "append");
+		stored = Fault_Log_Unreported(&sim_log);
+		check(stored != NULL && stored->pc == i && stored->seq == i
+				&& stored->trace[0].time == i * 3, "record read back");
+		check(Fault_Log_Mark_Reported(&sim_log, stored), "mark reported");
+		check(Fault_Log_Unreported(&sim_log) == NULL, "nothing left to report");
+	}
+	printf("%u faults, %u records per sector: %lu erases, sector worn out after"
+			" about %lu faults\n", FAULTS, (unsigned) FAULT_LOG_SLOTS(SECTOR_SIZE),
+			erases, ENDURANCE * FAULTS / erases);
+	check(erases == (FAULTS - 1) / FAULT_LOG_SLOTS(SECTOR_SIZE), "one erase per full sector");
+}
+
+// Crash loop: the device faults again before it can report
+static void unreported_faults(void) {
+	const fault_record_t *stored;
+	fault_record_t record;
+	uint32_t slots = FAULT_LOG_SLOTS(SECTOR_SIZE);
+	uint32_t i;
+
+	sim_erase();
+	erases = 0;
+	for (i = 0; i < slots + 2; i++) {
+		record = make_record(100 + i);
+		check(Fault_Log_Append(&sim_log, &record) == (i < slots),
+				"records past a full sector of unreported ones dropped");
+	}
+	check(erases == 0, "unreported records never erased");
+
+	// The first faults of the loop are kept, and reported in order
+	for (i = 0; i < slots; i++) {
+		stored = Fault_Log_Unreported(&sim_log);
+		check(stored != NULL && stored->seq == i && stored->pc == 100 + i,
+				"oldest unreported record first");
+		if (stored == NULL)
+			return;
+		Fault_Log_Mark_Reported(&sim_log, stored);
+	}
+	check(Fault_Log_Unreported(&sim_log) == NULL, "dropped records not reported");
+
+	// Once reported, the sector makes room again
+	record = make_record(200);
+	check(Fault_Log_Append(&sim_log, &record), "append once all are reported");
+	stored = Fault_Log_Unreported(&sim_log);
+	check(erases == 1 && stored != NULL && stored->seq == slots && stored->pc == 200,
+			"sector reused after the report");
+}
+
+// Reset in the middle of writing a record
+static void torn_write(void) {
+	const fault_record_t *stored;
+	fault_record_t record;
+
+	sim_erase();
+	record = make_record(1);
+	Fault_Log_Append(&sim_log, &record);
+	Fault_Log_Mark_Reported(&sim_log, Fault_Log_Unreported(&sim_log));
+
+	torn_after = 10;
+	record = make_record(2);
+	check(!Fault_Log_Append(&sim_log, &record), "torn write reported as failed");
+	torn_after = -1;
+	check(Fault_Log_Unreported(&sim_log) == NULL, "torn record ignored");
+
+	record = make_record(3);
+	check(Fault_Log_Append(&sim_log, &record), "append after torn write");
+	stored = Fault_Log_Unreported(&sim_log);
+	check(stored != NULL && stored->pc == 3 && stored->seq == 1
+			&& (const uint8_t *) stored - (const uint8_t *) sector
+					== 2 * sizeof(fault_record_t), "torn slot skipped");
+}
+
+int main(void) {
+	printf("record %u bytes\n", (unsigned) sizeof(fault_record_t));
+	reported_faults();
+	unreported_faults();
+	torn_write();
+	check(violations == 0, "no program of a non-erased word");
+	return sim_result();
+}
@@ -0,0 +1,149 @@
+/*
+ * Host simulation of the H-bridge direction states on a GPIO port.
+ *
+ * Runs source/hbridge.c unchanged for two wheels sharing a simulated PTB,
+ * applying each period's changes the way ramp.c does: one PCOR write, then
+ * one PSOR write. After every write it checks that
+ * - no wheel has both inputs high;
+ * - the inputs match a state of the wheel;
+ * - a wheel only changes direction after coasting for the dead time;
+ * - no pin outside the wheels' inputs changes.
+ *
+ * The checks run for every pair of start and end states of both wheels, then
+ * for random direction requests made at random periods.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o hbridge_sim \
+ *         tools/hbridge_sim.c "WheelsOnTheGo(BTEdition)/source/hbridge.c"
+ *     ./hbridge_sim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "hbridge.h"
+#include "sim_check.h"
+
+#define WHEELS        (2)
+#define DEAD_PERIODS  (100)
+#define RANDOM_STEPS  (1000000)
+#define OTHER_PINS    (0x000C0001UL)  // Unrelated pins already high on the port
+
+static const uint32_t cw_pin[WHEELS] = { 1UL << 11, 1UL << 8 };
+static const uint32_t ccw_pin[WHEELS] = { 1UL << 10, 1UL << 9 };
+
+static hbridge_t bridges[WHEELS];
+static uint32_t port;                     // Simulated PDOR
+static uint32_t coast_periods[WHEELS];    // Periods each wheel spent in coast
+static hbridge_dir_t last_dir[WHEELS];    // Last direction seen on the inputs
+static unsigned long writes;
+
+// Check the port after a write
+static void observe(void) {
+	uint32_t w, high;
+
+	check((port & ~(cw_pin[0] | ccw_pin[0] | cw_pin[1] | ccw_pin[1])) == OTHER_PINS,
+			"other pins untouched");
+	for (w = 0; w < WHEELS; w++) {
+		high = port & (cw_pin[w] | ccw_pin[w]);
+		check(high != (cw_pin[w] | ccw_pin[w]), "never both inputs high");
+		if (high == cw_pin[w] || high == ccw_pin[w]) {
+			hbridge_dir_t dir = (high == cw_pin[w]) ? HBRIDGE_CW : HBRIDGE_CCW;
+
+			if (dir != last_dir[w])
+				check(coast_periods[w] >= DEAD_PERIODS,
+						"direction changes only after the dead time in coast");
+			last_dir[w] = dir;
+		}
+	}
+}
+
+// One PWM period, as in the TPM0 interrupt of ramp.c
+static void period(void) {
+	hbridge_write_t write = { 0, 0 };
+	uint32_t w;
+
+	for (w = 0; w < WHEELS; w++)
+		Hbridge_Step(&bridges[w], DEAD_PERIODS, &write);
+
+	if (write.clear != 0) {
+		port &= ~write.clear;
+		writes++;
+		observe();
+	}
+	if (write.set != 0) {
+		port |= write.set;
+		writes++;
+		observe();
+	}
+
+	for (w = 0; w < WHEELS; w++) {
+		if ((port & (cw_pin[w] | ccw_pin[w])) == 0)
+			coast_periods[w]++;
+		else
+			coast_periods[w] = 0;
+		check(((port & (cw_pin[w] | ccw_pin[w])) == bridges[w].pins[bridges[w].applied]),
+				"inputs match the applied state");
+	}
+}
+
+static void reset(void) {
+	uint32_t w;
+
+	port = OTHER_PINS;
+	for (w = 0; w < WHEELS; w++) {
+		Hbridge_Init(&bridges[w], cw_pin[w], ccw_pin[w]);
+		coast_periods[w] = DEAD_PERIODS;
+		last_dir[w] = HBRIDGE_COAST;
+	}
+}
+
+// Run until both wheels reach their requested state
+static void settle(void) {
+	uint32_t i;
+
+	for (i = 0; i < 2 * DEAD_PERIODS + 2; i++)
+		period();
+	check(bridges[0].applied == bridges[0].target
+			&& bridges[1].applied == bridges[1].target, "requested state reached");
+}
+
+static void every_transition(void) {
+	unsigned from, to, pairs = 0;
+
+	for (from = 0; from < HBRIDGE_STATES * HBRIDGE_STATES; from++) {
+		for (to = 0; to < HBRIDGE_STATES * HBRIDGE_STATES; to++) {
+			reset();
+			Hbridge_Set(&bridges[0], (hbridge_dir_t) (from % HBRIDGE_STATES));
+			Hbridge_Set(&bridges[1], (hbridge_dir_t) (from / HBRIDGE_STATES));
+			settle();
+			Hbridge_Set(&bridges[0], (hbridge_dir_t) (to % HBRIDGE_STATES));
+			Hbridge_Set(&bridges[1], (hbridge_dir_t) (to / HBRIDGE_STATES));
+			settle();
+			check(Hbridge_Is_Idle(&bridges[0]) == (to % HBRIDGE_STATES == HBRIDGE_COAST),
+					"idle only when coasting");
+			pairs++;
+		}
+	}
+	printf("%u transitions of both wheels, all through legal states\n", pairs);
+}
+
+static void random_requests(void) {
+	unsigned long i;
+
+	reset();
+	writes = 0;
+	for (i = 0; i < RANDOM_STEPS; i++) {
+		// Requests land between periods at any time, often mid dead time
+		if (rand() % 50 == 0)
+			Hbridge_Set(&bridges[rand() % WHEELS], (hbridge_dir_t) (rand() % HBRIDGE_STATES));
+		period();
+	}
+	printf("%lu random periods, %lu port writes, all through legal states\n",
+			(unsigned long) RANDOM_STEPS, writes);
+}
+
+int main(void) {
+	srand(1);
+	every_transition();
+	random_requests();
+	return sim_result();
+}
@@ -0,0 +1,203 @@
+/*
+ * Host test of the command pipeline between the polling task and
+ * Motor_Control().
+ *
+ * Runs source/command_queue.c unchanged on the host kernel. A consumer task
+ * above the poster takes the commands as task_motor_control does. The
+ * throughput is timed with clock_gettime() on the host, so only its order
+ * of magnitude carries over to the part; the latencies are counted in
+ * kernel ticks by command_queue.c itself and do carry over.
+ *
+ * - Checks that a repeated idempotent command is coalesced while pending,
+ *   that a ninth command into the 8-slot queue is dropped and counted, and
+ *   that the rest come out in order with a gap in the sequence numbers
+ *   where the dropped one was.
+ * - Measures the throughput of the pipeline, posting and taking back in
+ *   one task, and checks it beats one command per byte at 115200 baud.
+ *   Prints it too with each post taken by the waiting consumer.
+ * - Fills the queue while the consumer spends 10 ms on each command, as
+ *   a turn would, and checks that the worst post-to-delivery latency is
+ *   the time to work through the queue ahead.
+ *
+ * Built and run by ctest, see CMakeLists.txt.
+ */
+#include <stdlib.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "system_MKL25Z4.h"
+#include "sysclock.h"
+#include "config.h"
+#include "power.h"
+#include "command_queue.h"
+#include "sim_check.h"
+
+#define ROUND_TRIPS   (2000)
+#define LINK_RATE     (11520)    // Command bytes a second at 115200 baud
+#define WORK_MS       (10)
+
+static volatile uint32_t consumed;
+static volatile TickType_t work_ticks;
+
+/*
+ * Take commands as task_motor_control does, spending work_ticks on each.
+ */
+static void consumer(void *unused) {
+	command_t cmd;
+
+	(void) unused;
+	for (;;) {
+		if (!Command_Receive(&cmd, portMAX_DELAY))
+			continue;
+		consumed++;
+		if (work_ticks > 0)
+			vTaskDelay(work_ticks);
+	}
+}
+
+/*
+ * With nobody taking commands: coalescing, the full queue and the order.
+ */
+static void coalesce_and_drop(void) {
+	static const command_type_t burst[] = {
+		CMD_STOP_BACKWARD, CMD_RIGHT, CMD_LEFT, CMD_STOP_BACKWARD,
+		CMD_RIGHT, CMD_LEFT, CMD_STOP
+	};
+	command_stats_t stats;
+	command_t cmd;
+	uint16_t first_seq;
+	uint32_t i;
+
+	for (i = 0; i < 5; i++)
+		check(Command_Send(CMD_FORWARD), "repeated forward accepted");
+	for (i = 0; i < sizeof(burst) / sizeof(burst[0]); i++)
+		check(Command_Send(burst[i]), "command queued");
+	check(!Command_Send(CMD_RIGHT), "ninth command dropped");
+	check(Command_Send_Drive(0, 0) == false, "drive dropped while full");
+	Command_Get_Stats(&stats);
+	check_value(stats.posted == COMMAND_QUEUE_LENGTH, "posted", stats.posted);
+	check_value(stats.coalesced == 4, "forward coalesced while pending", stats.coalesced);
+	check_value(stats.dropped == 2, "dropped", stats.dropped);
+	check_value(stats.max_depth == COMMAND_QUEUE_LENGTH, "max depth", stats.max_depth);
+
+	check(Command_Receive(&cmd, 0) && cmd.type == CMD_FORWARD, "forward first");
+	first_seq = cmd.seq;
+	for (i = 0; i < sizeof(burst) / sizeof(burst[0]); i++) {
+		check_value(Command_Receive(&cmd, 0) && cmd.type == burst[i], "in order", i);
+		check_value(cmd.seq == (uint16_t) (first_seq + 1 + i), "sequence", cmd.seq);
+	}
+	check(!Command_Receive(&cmd, 0), "queue empty");
+
+	// The drops took sequence numbers, so the next command shows the gap
+	Command_Send(CMD_STOP);
+	Command_Receive(&cmd, 0);
+	check_value(cmd.seq == (uint16_t) (first_seq + COMMAND_QUEUE_LENGTH + 2),
+			"gap where commands were dropped", cmd.seq);
+}
+
+static uint64_t host_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/*
+ * Print the rate of ROUND_TRIPS commands that took ns, and return it.
+ */
+static uint32_t report(const char *what, uint64_t ns) {
+	uint32_t rate = (uint32_t) ((uint64_t) ROUND_TRIPS * 1000000000u / ns);
+
+	printf("%s: %lu ns each, %lu commands/s\n", what,
+			(unsigned long) (ns / ROUND_TRIPS), (unsigned long) rate);
+	return rate;
+}
+
+/*
+ * Posts taken back by the same task: the cost of the pipeline itself.
+ */
+static void throughput(void) {
+	command_t cmd;
+	uint64_t start;
+	uint32_t rate, i;
+
+	start = host_ns();
+	for (i = 0; i < ROUND_TRIPS; i++) {
+		Command_Send((i & 1) ? CMD_RIGHT : CMD_LEFT);
+		Command_Receive(&cmd, 0);
+	}
+	rate = report("post and take", host_ns() - start);
+#if !defined(LATENCY_BENCHMARK) && !defined(TRACE_RECORDER)
+	// The marks of latency.h and the events of trace.h read SysTick, a
+	// register trap on the host each
+	check_value(rate > LINK_RATE, "faster than the link", rate);
+#else
+	(void) rate;
+#endif
+}
+
+/*
+ * Posts each taken by the waiting consumer. Adds two context switches,
+ * which the host port makes with signals, so only printed.
+ */
+static void handoff(void) {
+	uint64_t start;
+	uint32_t i;
+
+	consumed = 0;
+	start = host_ns();
+	for (i = 0; i < ROUND_TRIPS; i++)
+		Command_Send((i & 1) ? CMD_RIGHT : CMD_LEFT);
+	report("post to the consumer", host_ns() - start);
+	check_value(consumed == ROUND_TRIPS, "each post taken by the consumer", consumed);
+}
+
+static void worst_case_latency(void) {
+	command_stats_t before, after;
+	TickType_t bound = COMMAND_QUEUE_LENGTH * pdMS_TO_TICKS(WORK_MS);
+	uint32_t i;
+
+	Command_Get_Stats(&before);
+	consumed = 0;
+	work_ticks = pdMS_TO_TICKS(WORK_MS);
+	// The consumer takes the first at once, the other eight wait behind it
+	for (i = 0; i <= COMMAND_QUEUE_LENGTH; i++)
+		check_value(Command_Send((i & 1) ? CMD_RIGHT : CMD_LEFT), "burst queued", i);
+	vTaskDelay(bound + pdMS_TO_TICKS(WORK_MS) * 2);
+	Command_Get_Stats(&after);
+	printf("burst of %u with %u ms per command: worst latency %lu ticks, mean %lu\n",
+			COMMAND_QUEUE_LENGTH + 1, WORK_MS, (unsigned long) after.max_latency,
+			(unsigned long) ((after.total_latency - before.total_latency)
+					/ (after.delivered - before.delivered)));
+	check_value(consumed == COMMAND_QUEUE_LENGTH + 1, "burst delivered", consumed);
+	check_value(after.dropped == before.dropped, "nothing dropped", after.dropped);
+	check_value(after.max_latency >= bound - 1 && after.max_latency <= bound + 1,
+			"worst latency is the queue ahead", (unsigned long) after.max_latency);
+}
+
+static void tester(void *unused) {
+	(void) unused;
+	coalesce_and_drop();
+	throughput();
+	xTaskCreate(consumer, "consumer", configMINIMAL_STACK_SIZE * 2, NULL,
+			configMAX_PRIORITIES - 1, NULL);
+	handoff();
+	worst_case_latency();
+	exit(sim_result());
+}
+
+int main(void) {
+	model_options_t options = { -1, -1, -1, NULL, 7400, 0 };
+
+	Model_Init(&options);
+	Model_Start();
+	SystemInit();
+	Init_Sysclock();
+	Init_Config();
+	Init_Power();
+	Init_Command_Queue();
+	xTaskCreate(tester, "tester", configMINIMAL_STACK_SIZE * 2, NULL,
+			configMAX_PRIORITIES - 2, NULL);
+	vTaskStartScheduler();
+	return EXIT_FAILURE;
+}
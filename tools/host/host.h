@@ -0,0 +1,85 @@
+// host.h
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kl25z_model.h"
+
+/**
+ * @file    host.h
+ * @brief   Included ahead of every source of the host build (-include).
+ *
+ * Stands in for cmsis_gcc.h, whose intrinsics are Cortex-M instructions:
+ * PRIMASK and IPSR come from the interrupt model, WFI sleeps in it, the
+ * barriers are compiler barriers. Then takes FreeRTOSConfig.h with an
+ * assert that reports, and the host portmacro.h ahead of the one in
+ * freertos/, which shares its include guard.
+ */
+
+#define __CMSIS_GCC_H
+
+#define __ASM            __asm
+#define __INLINE         inline
+#define __STATIC_INLINE  static inline
+
+static inline void __enable_irq(void) { Model_Enable_Irq(); }
+static inline void __disable_irq(void) { Model_Disable_Irq(); }
+static inline uint32_t __get_PRIMASK(void) { return Model_Get_Primask(); }
+static inline void __set_PRIMASK(uint32_t primask) { Model_Set_Primask(primask); }
+static inline uint32_t __get_IPSR(void) { return Model_Get_Ipsr(); }
+static inline uint32_t __get_xPSR(void) { return Model_Get_Ipsr(); }
+static inline uint32_t __get_APSR(void) { return 0; }
+static inline uint32_t __get_CONTROL(void) { return 0; }
+static inline void __set_CONTROL(uint32_t control) { (void) control; }
+static inline uint32_t __get_MSP(void) { return 0; }
+static inline void __set_MSP(uint32_t msp) { (void) msp; }
+static inline uint32_t __get_PSP(void) { return 0; }
+static inline void __set_PSP(uint32_t psp) { (void) psp; }
+
+static inline void __NOP(void) { }
+static inline void __WFI(void) { Model_Wait_For_Interrupt(); }
+static inline void __WFE(void) { Model_Wait_For_Interrupt(); }
+static inline void __SEV(void) { }
+static inline void __ISB(void) { __asm volatile ("" ::: "memory"); }
+static inline void __DSB(void) { __sync_synchronize(); }
+static inline void __DMB(void) { __sync_synchronize(); }
+
+static inline uint32_t __REV(uint32_t value) { return __builtin_bswap32(value); }
+static inline uint32_t __REV16(uint32_t value) {
+	return ((value & 0xFF00FF00U) >> 8) | ((value & 0x00FF00FFU) << 8);
+}
+static inline int32_t __REVSH(int32_t value) {
+	return (int16_t) __builtin_bswap16((uint16_t) value);
+}
+static inline uint32_t __ROR(uint32_t value, uint32_t shift) {
+	shift &= 31;
+	return shift ? (value >> shift) | (value << (32 - shift)) : value;
+}
+static inline uint32_t __RBIT(uint32_t value) {
+	uint32_t result = 0;
+	int i;
+
+	for (i = 0; i < 32; i++, value >>= 1)
+		result = (result << 1) | (value & 1);
+	return result;
+}
+static inline uint8_t __CLZ(uint32_t value) {
+	return value ? (uint8_t) __builtin_clz(value) : 32;
+}
+
+// __SSAT and __USAT come from arm_math.h, as for any Cortex-M0 build
+
+void vAssertCalled(const char *file, int line);
+
+#include "FreeRTOSConfig.h"
+#undef configASSERT
+#define configASSERT(x) if ((x) == 0) vAssertCalled(__FILE__, __LINE__)
+// Pointers are twice the size: the TCBs, queues and lists outgrow 11 KB
+#undef configTOTAL_HEAP_SIZE
+#define configTOTAL_HEAP_SIZE ((size_t)(32 * 1024))
+
+#include "portmacro.h"
+
+#endif // HOST_H
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    host_main.c
+ * @brief   Entry of the host build: wires the model and runs the reset path.
+ *
+ * Does what ResetISR() does on the part (SystemInit(), Boot_Early(), then
+ * main()) on top of kl25z_model.c. The RN-41 end of UART0 is a pseudo
+ * terminal by default, whose path is printed on stderr: connect a terminal
+ * to it and type commands as over Bluetooth. With --input, UART0 reads a
+ * file instead, at the baud rate, and the line goes idle at its end; what
+ * the firmware sends back goes to stdout.
+ *
+ *     wheels_host [--input FILE] [--telemetry FILE] [--flash FILE]
+ *                 [--battery-mv MV] [--slowdown N] [--run-ms MS]
+ *
+ * --slowdown keeps the model N times slower than real time while the
+ * firmware sleeps, 1 by default, and 0 runs it as fast as the host can
+ * (see kl25z_model.h). --run-ms stops the run after MS milliseconds of
+ * model time and prints the pin, PWM and interrupt state on stdout. Exits
+ * with MODEL_EXIT_RESET on a modeled reset (COP timeout, SYSRESETREQ).
+ */
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "system_MKL25Z4.h"
+#include "boot.h"
+#include "kl25z_model.h"
+
+#define DEFAULT_BATTERY_MV (7400)   // Two Li-ion cells
+
+int firmware_main(void);
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [--input FILE] [--telemetry FILE] [--flash FILE]"
+			" [--battery-mv MV] [--slowdown N] [--run-ms MS]\n", name);
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * A raw pseudo terminal for the RN-41 side of UART0. Keeps the slave open,
+ * so the master does not see a hang-up before a terminal connects.
+ */
+static int open_pty(void) {
+	struct termios raw;
+	int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	int slave;
+
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+		perror("pty");
+		exit(EXIT_FAILURE);
+	}
+	slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if (slave < 0 || tcgetattr(slave, &raw) != 0) {
+		perror("pty");
+		exit(EXIT_FAILURE);
+	}
+	cfmakeraw(&raw);
+	tcsetattr(slave, TCSANOW, &raw);
+	fprintf(stderr, "UART0 on %s\n", ptsname(master));
+	return master;
+}
+
+int main(int argc, char **argv) {
+	model_options_t options = { -1, -1, -1, NULL, DEFAULT_BATTERY_MV, 1 };
+	const char *input = NULL;
+	long run_ms = 0;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (i + 1 >= argc)
+			usage(argv[0]);
+		if (strcmp(argv[i], "--input") == 0)
+			input = argv[++i];
+		else if (strcmp(argv[i], "--telemetry") == 0) {
+			options.uart1_tx_fd = open(argv[++i], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (options.uart1_tx_fd < 0) {
+				perror(argv[i]);
+				return EXIT_FAILURE;
+			}
+		} else if (strcmp(argv[i], "--flash") == 0)
+			options.flash = argv[++i];
+		else if (strcmp(argv[i], "--battery-mv") == 0)
+			options.battery_mv = (uint32_t) strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "--slowdown") == 0)
+			options.slowdown = (uint32_t) strtoul(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "--run-ms") == 0)
+			run_ms = strtol(argv[++i], NULL, 0);
+		else
+			usage(argv[0]);
+	}
+	if (input != NULL) {
+		options.uart0_rx_fd = open(input, O_RDONLY);
+		if (options.uart0_rx_fd < 0) {
+			perror(input);
+			return EXIT_FAILURE;
+		}
+		options.uart0_tx_fd = STDOUT_FILENO;
+	} else {
+		options.uart0_rx_fd = open_pty();
+		options.uart0_tx_fd = options.uart0_rx_fd;
+	}
+
+	Model_Init(&options);
+	Model_Start();
+	if (run_ms > 0)
+		Model_Exit_After((uint32_t) run_ms);
+
+	// ResetISR()
+	SystemInit();
+	Boot_Early();
+	return firmware_main();
+}
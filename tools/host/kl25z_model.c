@@ -0,0 +1,1696 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    kl25z_model.c
+ * @brief   Register and interrupt model of the KL25Z, see kl25z_model.h.
+ *
+ * The registers are shared memory mapped twice: at the firmware's addresses,
+ * read-only or inaccessible so that the accesses trap, and once more
+ * read-write at an address of the model's choosing. The model only ever
+ * touches the second view. A trapped access is single-stepped with the page
+ * opened, under the model lock, and the hook of the register then makes the
+ * value what the hardware would leave there.
+ *
+ * Modeled: the MCG clock tree and its status, SIM clock selection and the
+ * COP, SMC power modes, SysTick, NVIC and SCB, TPM0-2 counting and overflow,
+ * LPTMR0, PIT with chaining, UART0 and UART1 at their baud rate, ADC0
+ * completion, FTFA erase and program on the top 4 KB of flash, GPIO set,
+ * clear and toggle, PORT pin control. Not modeled: pin inputs and TPM
+ * channel events, so the encoders and buttons stay idle; DMA; the other
+ * peripherals are plain memory.
+ */
+#include <errno.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <ucontext.h>
+#include "MKL25Z4.h"
+#include "kl25z_model.h"
+
+#define PAGE_BYTES       (0x1000UL)
+#define PAGE_OF(address) ((address) & ~(PAGE_BYTES - 1))
+#define SIG_IRQ          (SIGUSR1)
+#define TRAP_FLAG        (0x100)        // EFLAGS.TF
+#define PAGE_FAULT_WRITE (0x2)          // Page fault error code: write access
+
+#define NS_PER_S         (1000000000ULL)
+#define STEP_NS          (20000)        // Step of a sleeping core
+#define MAX_STEP_NS      (10000000)     // Longest time one step may cover
+#define ACCESS_NS        (1000)         // A register access and the code around it
+#define EXCEPTION_NS     (1000)         // Exception entry and return
+#define SPIN_CHECK_NS    (100000)       // Host time between checks for a spinning core
+#define SPIN_CPU_NS      (200000)       // CPU time of the idle task that is a spin
+#define SPIN_STEPS       (50)           // Steps for a spinning core at a check
+#define PACE_NS          (1000000)      // Lead over the host a slowdown allows
+
+#define OSC_HZ           (8000000UL)    // BOARD_XTAL0_CLK_HZ
+#define IRC_SLOW_HZ      (32768UL)
+#define IRC_FAST_HZ      (4000000UL)
+#define LPO_HZ           (1000UL)
+#define ERCLK32K_HZ      (32768UL)
+
+#define FLASH_BASE       (0x1F000UL)    // Config sectors and fault log
+#define FLASH_BYTES      (0x1000UL)
+#define FLASH_SECTOR     (1024UL)
+
+#define ADC_CONVERSION_NS (100000)      // 8-sample average, long sample time
+#define ADC_FULL_SCALE   (4096U)
+#define VREF_MV          (3300U)        // VREFH of the board
+#define BATTERY_DIVIDER  (3U)
+
+// Exception numbers
+#define EXC_PENDSV       (14)
+#define EXC_SYSTICK      (15)
+#define EXC_IRQ(irq)     (16 + (irq))
+#define EXCEPTIONS       (48)
+
+// SMC values, as the smc_power_state_t and smc_stop_mode_t of fsl_smc.h
+#define PMSTAT_RUN       (0x01)
+#define PMSTAT_VLPR      (0x04)
+#define STOPM_VLPS       (2)
+
+// Mapped address ranges, each at an offset of one shared memory file
+typedef struct {
+	const char *name;
+	uintptr_t base;
+	size_t bytes;
+	size_t offset;
+	int prot;               // Of the firmware view
+} region_t;
+
+static const region_t regions[] = {
+	{ "flash",                     FLASH_BASE,  FLASH_BYTES, 0x00000, PROT_READ },
+	{ "peripherals",               0x40000000,  0x80000,     0x01000, PROT_READ },
+	{ "GPIO",                      0x400FF000,  0x1000,      0x81000, PROT_READ },
+	{ "FGPIO",                     0xF80FF000,  0x1000,      0x81000, PROT_READ },
+	{ "system control space",      0xE000E000,  0x1000,      0x82000, PROT_NONE },
+	{ "MTB, MTBDWT, ROM and MCM",  0xF0000000,  0x4000,      0x83000, PROT_READ | PROT_WRITE },
+};
+
+#define REGIONS       (sizeof(regions) / sizeof(regions[0]))
+#define BACKING_BYTES (0x87000UL)
+
+// Peripheral pages whose reads trap too, since a read has an effect or
+// must see the counter as of now
+static const uintptr_t read_trap_pages[] = {
+	UART0_BASE, UART1_BASE, UART2_BASE, TPM0_BASE, TPM1_BASE, TPM2_BASE, PIT_BASE
+};
+
+#define READ_TRAP_PAGES (sizeof(read_trap_pages) / sizeof(read_trap_pages[0]))
+
+// UART register offsets, common to UART0 and UART1/2
+enum {
+	UART_BDH = 0, UART_BDL, UART_C1, UART_C2, UART_S1, UART_S2, UART_C3, UART_D,
+	UART0_C4 = 0x0A
+};
+
+typedef struct {
+	const char *name;
+	uintptr_t base;
+	bool low_power;         // UART0: oversampling and write-one-to-clear flags
+	IRQn_Type irq;
+	int rx_fd;              // Line into the receiver
+	int tx_fd;              // Line out of the transmitter
+	bool eof;
+	// Receiver: byte on the line until rx_done
+	bool rx_busy;
+	uint8_t rx_byte;
+	uint64_t rx_done;
+	uint8_t rx_data;        // Last byte received, what D reads
+	// Transmitter: shift register until tx_done, then the buffer
+	bool tx_busy;
+	bool tx_full;
+	uint8_t tx_shift;
+	uint8_t tx_buffer;
+	uint64_t tx_done;
+	// Counts
+	uint32_t rx_bytes;
+	uint32_t tx_bytes;
+	uint32_t overruns;
+} uart_t;
+
+typedef struct {
+	uint32_t core;
+	uint32_t bus;
+	uint32_t pllfll;        // MCGPLLCLK/2 or MCGFLLCLK, as SOPT2 selects
+	uint32_t irclk;         // MCGIRCLK
+	uint32_t oscer;         // OSCERCLK
+} clocks_t;
+
+enum {
+	SLEEP_NONE = 0,
+	SLEEP_WAIT,
+	SLEEP_VLPS,
+	SLEEP_STATES
+};
+
+static const char *const sleep_names[SLEEP_STATES] = { "RUN", "WAIT", "VLPS" };
+
+// The model's view of the registers
+static uint8_t *backing;
+static SIM_Type *sim;
+static MCG_Type *mcg;
+static OSC_Type *osc;
+static SMC_Type *smc;
+static RCM_Type *rcm;
+static TPM_Type *tpms[3];
+static LPTMR_Type *lptmr;
+static PIT_Type *pit;
+static ADC_Type *adc;
+static FTFA_Type *ftfa;
+static GPIO_Type *gpios[5];
+static SysTick_Type *systick;
+static NVIC_Type *nvic;
+static SCB_Type *scb;
+static uint8_t *flash;
+
+static uart_t uarts[2] = {
+	{ "UART0", UART0_BASE, true, UART0_IRQn, -1, -1 },
+	{ "UART1", UART1_BASE, false, UART1_IRQn, -1, -1 },
+};
+
+// Model state, under the lock
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t last_ns;                // Model time
+static uint64_t exit_ns;                // Model time to stop at, 0 for none
+static uint64_t host_start_ns;
+static uint32_t slowdown;
+static uint32_t nvic_enabled;
+static uint32_t nvic_pending;
+static bool systick_pending;
+static uint64_t systick_rest;
+static uint64_t tpm_rest[3];
+static uint32_t lptmr_count;
+static uint64_t lptmr_rest;
+static uint64_t pit_rest[2];
+static uint64_t adc_done;
+static uint32_t cop_ms;          // Timeout, 0 with the COP disabled
+static uint32_t cop_left_ms;
+static uint64_t cop_rest;
+static bool cop_written;
+static bool cop_armed;
+static int flash_fd = -1;
+static uint32_t battery_mv;
+static model_plant_t plant;
+
+// Single-stepped access
+static struct {
+	bool active;
+	uintptr_t address;
+	bool write;
+	uint32_t old;           // Aligned word holding the register, before
+	sigset_t mask;
+} step;
+
+// The core, written by the thread running the firmware only
+static struct {
+	pthread_t thread;
+	volatile uint32_t primask;
+	volatile uint32_t ipsr;
+	volatile bool pendsv;
+	volatile int sleep;
+	volatile bool idle;     // Running the idle task
+	clockid_t clock;        // CPU time of the thread
+	uint64_t sleep_ns[SLEEP_STATES];
+	uint32_t taken[EXCEPTIONS];
+	uint32_t traps;
+} cpu;
+
+static sigset_t irq_set;
+
+// Handlers the firmware defines
+#define IRQ_HANDLERS(X) X(ADC0) X(LPTMR0) X(PIT) X(PORTA) X(PORTD) X(TPM0) X(TPM1) \
+		X(TPM2) X(UART0) X(UART1)
+#define WEAK_HANDLER(name) void name##_IRQHandler(void) __attribute__((weak));
+IRQ_HANDLERS(WEAK_HANDLER)
+void PendSV_Handler(void);
+void SysTick_Handler(void);
+
+static void (*handlers[EXCEPTIONS])(void);
+static const char *exception_names[EXCEPTIONS];
+
+static uint64_t host_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * NS_PER_S + (uint64_t) now.tv_nsec;
+}
+
+static const region_t *region_of(uintptr_t address) {
+	uint32_t i;
+
+	for (i = 0; i < REGIONS; i++) {
+		if (address >= regions[i].base && address < regions[i].base + regions[i].bytes)
+			return &regions[i];
+	}
+	return NULL;
+}
+
+/*
+ * The model's view of a firmware address.
+ */
+static void *alias(uintptr_t address) {
+	const region_t *region = region_of(address);
+
+	return backing + region->offset + (address - region->base);
+}
+
+static int page_prot(uintptr_t page) {
+	uint32_t i;
+
+	for (i = 0; i < READ_TRAP_PAGES; i++) {
+		if (read_trap_pages[i] == page)
+			return PROT_NONE;
+	}
+	return region_of(page)->prot;
+}
+
+static uint32_t word_at(uintptr_t address) {
+	return *(volatile uint32_t *) alias(address & ~3UL);
+}
+
+static uint8_t *reg8(uintptr_t address) {
+	return (uint8_t *) alias(address);
+}
+
+static volatile uint32_t *reg32(uintptr_t address) {
+	return (volatile uint32_t *) alias(address);
+}
+
+static void set_ro8(volatile uint8_t *reg, uint32_t value) {
+	*reg = (uint8_t) value;
+}
+
+static void set_ro32(volatile uint32_t *reg, uint32_t value) {
+	*reg = value;
+}
+
+// Set a register that MKL25Z4.h declares read-only (__I)
+#define SET_RO(reg, value) _Generic((reg), uint8_t: set_ro8, uint32_t: set_ro32) \
+		((void *) &(reg), (value))
+
+/*
+ * Value after a write: write-one-to-clear bits cleared where written with
+ * one and kept where written with zero, the other read-only bits kept.
+ */
+static uint32_t written(uint32_t old, uint32_t new, uint32_t w1c, uint32_t ro) {
+	return (new & ~(w1c | ro)) | (old & ro & ~w1c) | (old & w1c & ~new);
+}
+
+//
+// Clocks
+//
+
+static void get_clocks(clocks_t *c, bool stopped) {
+	uint32_t ref, fll, pll, irc, out;
+	uint32_t drs = (mcg->C4 & MCG_C4_DRST_DRS_MASK) >> MCG_C4_DRST_DRS_SHIFT;
+
+	irc = (mcg->C2 & MCG_C2_IRCS_MASK)
+			? IRC_FAST_HZ >> ((mcg->SC & MCG_SC_FCRDIV_MASK) >> MCG_SC_FCRDIV_SHIFT)
+			: IRC_SLOW_HZ;
+	ref = (mcg->C1 & MCG_C1_IREFS_MASK) ? IRC_SLOW_HZ
+			: OSC_HZ >> (((mcg->C1 & MCG_C1_FRDIV_MASK) >> MCG_C1_FRDIV_SHIFT)
+					+ ((mcg->C2 & MCG_C2_RANGE0_MASK) ? 5 : 0));
+	fll = ref * ((mcg->C4 & MCG_C4_DMX32_MASK) ? 732 : 640) * (drs + 1);
+	pll = OSC_HZ / ((mcg->C5 & MCG_C5_PRDIV0_MASK) + 1)
+			* ((mcg->C6 & MCG_C6_VDIV0_MASK) + 24);
+
+	switch ((mcg->C1 & MCG_C1_CLKS_MASK) >> MCG_C1_CLKS_SHIFT) {
+	case 0:
+		out = (mcg->C6 & MCG_C6_PLLS_MASK) ? pll : fll;
+		break;
+	case 1:
+		out = irc;
+		break;
+	default:
+		out = OSC_HZ;
+		break;
+	}
+
+	if (stopped) {
+		// VLPS: only MCGIRCLK may run, if enabled in stop
+		memset(c, 0, sizeof(*c));
+		if ((mcg->C1 & MCG_C1_IRCLKEN_MASK) && (mcg->C1 & MCG_C1_IREFSTEN_MASK))
+			c->irclk = irc;
+		return;
+	}
+	c->core = out / (((sim->CLKDIV1 & SIM_CLKDIV1_OUTDIV1_MASK) >> SIM_CLKDIV1_OUTDIV1_SHIFT) + 1);
+	c->bus = c->core / (((sim->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT) + 1);
+	c->pllfll = (sim->SOPT2 & SIM_SOPT2_PLLFLLSEL_MASK) ? pll / 2 : fll;
+	c->irclk = (mcg->C1 & MCG_C1_IRCLKEN_MASK) ? irc : 0;
+	c->oscer = (osc->CR & OSC_CR_ERCLKEN_MASK) ? OSC_HZ : 0;
+}
+
+/*
+ * Clock of a peripheral that selects PLLFLL, OSCERCLK or MCGIRCLK with 1 to 3.
+ */
+static uint32_t selected_clock(const clocks_t *c, uint32_t select) {
+	switch (select) {
+	case 1:
+		return c->pllfll;
+	case 2:
+		return c->oscer;
+	case 3:
+		return c->irclk;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Counts of a clock in ns, carrying the fraction over in rest.
+ */
+static uint64_t counts(uint64_t *rest, uint64_t ns, uint32_t hz) {
+	uint64_t total = *rest + ns * hz;
+
+	*rest = total % NS_PER_S;
+	return total / NS_PER_S;
+}
+
+/*
+ * Count down n from val, reloading load after zero. Returns the number of
+ * times the count reached zero.
+ */
+static uint64_t count_down(uint32_t *val, uint32_t load, uint64_t n) {
+	uint64_t period = (uint64_t) load + 1;
+
+	if (n == 0)
+		return 0;
+	if (*val == 0) {
+		*val = load;
+		n--;
+	}
+	if (load == 0)
+		return 0;
+	if (n < *val) {
+		*val -= (uint32_t) n;
+		return 0;
+	}
+	n -= *val;
+	*val = (n % period == 0) ? 0 : (uint32_t) (period - n % period);
+	return 1 + n / period;
+}
+
+/*
+ * Count up n from cnt, wrapping after mod. Returns the number of wraps.
+ */
+static uint64_t count_up(uint32_t *cnt, uint32_t mod, uint64_t n) {
+	uint64_t period = (uint64_t) mod + 1;
+	uint64_t total;
+
+	if (*cnt > mod)
+		*cnt = 0;
+	total = *cnt + n;
+	*cnt = (uint32_t) (total % period);
+	return total / period;
+}
+
+//
+// Interrupts
+//
+
+static uint32_t uart_line(const uart_t *u) {
+	uint8_t *r = reg8(u->base);
+	uint8_t s1 = r[UART_S1], c2 = r[UART_C2], c3 = r[UART_C3];
+
+	return ((c2 & UART_C2_TIE_MASK) && (s1 & UART_S1_TDRE_MASK))
+			|| ((c2 & UART_C2_TCIE_MASK) && (s1 & UART_S1_TC_MASK))
+			|| ((c2 & UART_C2_RIE_MASK) && (s1 & UART_S1_RDRF_MASK))
+			|| ((c2 & UART_C2_ILIE_MASK) && (s1 & UART_S1_IDLE_MASK))
+			|| ((c3 & UART_C3_ORIE_MASK) && (s1 & UART_S1_OR_MASK))
+			|| ((c3 & UART_C3_NEIE_MASK) && (s1 & UART_S1_NF_MASK))
+			|| ((c3 & UART_C3_FEIE_MASK) && (s1 & UART_S1_FE_MASK))
+			|| ((c3 & UART_C3_PEIE_MASK) && (s1 & UART_S1_PF_MASK))
+			|| ((r[UART_BDH] & UART_BDH_RXEDGIE_MASK) && (r[UART_S2] & UART_S2_RXEDGIF_MASK))
+			|| ((r[UART_BDH] & UART_BDH_LBKDIE_MASK) && (r[UART_S2] & UART_S2_LBKDIF_MASK));
+}
+
+/*
+ * Interrupt requests of the peripherals, by IRQ number.
+ */
+static uint32_t lines(void) {
+	uint32_t lines = 0;
+	uint32_t i, ch;
+
+	for (i = 0; i < 2; i++) {
+		if (uart_line(&uarts[i]))
+			lines |= 1U << uarts[i].irq;
+	}
+	for (i = 0; i < 3; i++) {
+		bool line = (tpms[i]->SC & TPM_SC_TOIE_MASK) && (tpms[i]->SC & TPM_SC_TOF_MASK);
+
+		for (ch = 0; ch < 6; ch++)
+			line = line || ((tpms[i]->CONTROLS[ch].CnSC & TPM_CnSC_CHIE_MASK)
+					&& (tpms[i]->CONTROLS[ch].CnSC & TPM_CnSC_CHF_MASK));
+		if (line)
+			lines |= 1U << (TPM0_IRQn + i);
+	}
+	if ((lptmr->CSR & LPTMR_CSR_TIE_MASK) && (lptmr->CSR & LPTMR_CSR_TCF_MASK))
+		lines |= 1U << LPTMR0_IRQn;
+	for (i = 0; i < 2; i++) {
+		if ((pit->CHANNEL[i].TCTRL & PIT_TCTRL_TIE_MASK) && (pit->CHANNEL[i].TFLG & PIT_TFLG_TIF_MASK))
+			lines |= 1U << PIT_IRQn;
+	}
+	if ((adc->SC1[0] & ADC_SC1_AIEN_MASK) && (adc->SC1[0] & ADC_SC1_COCO_MASK))
+		lines |= 1U << ADC0_IRQn;
+	return lines;
+}
+
+static bool exception_pending(void) {
+	return (nvic_pending & nvic_enabled) != 0 || systick_pending || cpu.pendsv;
+}
+
+/*
+ * Latch the requests into NVIC pending, refresh the status registers and
+ * signal the core if an exception became pending.
+ */
+static void update(void) {
+	uint32_t before = nvic_pending & nvic_enabled;
+	uint32_t active = 0;
+	uint32_t icsr;
+
+	// A line held by its own handler pends again only once the handler
+	// returns, as on the NVIC, or its flag read before the clear would
+	// take the interrupt twice
+	if (cpu.ipsr >= EXC_IRQ(0))
+		active = 1U << (cpu.ipsr - EXC_IRQ(0));
+	nvic_pending |= lines() & ~active;
+	nvic->ISER[0] = nvic_enabled;
+	nvic->ICER[0] = nvic_enabled;
+	nvic->ISPR[0] = nvic_pending;
+	nvic->ICPR[0] = nvic_pending;
+
+	icsr = cpu.ipsr & SCB_ICSR_VECTACTIVE_Msk;
+	if (cpu.pendsv)
+		icsr |= SCB_ICSR_PENDSVSET_Msk;
+	if (systick_pending)
+		icsr |= SCB_ICSR_PENDSTSET_Msk;
+	if (exception_pending())
+		icsr |= SCB_ICSR_ISRPENDING_Msk;
+	scb->ICSR = icsr;
+
+	if ((nvic_pending & nvic_enabled & ~before) != 0)
+		pthread_kill(cpu.thread, SIG_IRQ);
+}
+
+static void pend_systick(void) {
+	if (!systick_pending) {
+		systick_pending = true;
+		pthread_kill(cpu.thread, SIG_IRQ);
+	}
+}
+
+/*
+ * Highest priority pending exception, PendSV only when nothing else is.
+ */
+static int next_exception(void) {
+	uint32_t ready = nvic_pending & nvic_enabled;
+	uint32_t best_priority = 0x100, priority;
+	int best = 0;
+	int irq;
+
+	if (systick_pending) {
+		best = EXC_SYSTICK;
+		best_priority = (scb->SHP[1] >> 24) & 0xC0;
+	}
+	for (irq = 0; irq < 32; irq++) {
+		if (!(ready & (1U << irq)))
+			continue;
+		priority = (nvic->IP[irq / 4] >> (8 * (irq % 4))) & 0xC0;
+		if (priority < best_priority) {
+			best = EXC_IRQ(irq);
+			best_priority = priority;
+		}
+	}
+	if (best == 0 && cpu.pendsv)
+		best = EXC_PENDSV;
+	return best;
+}
+
+static void take(int exception) {
+	if (exception == EXC_PENDSV)
+		cpu.pendsv = false;
+	else if (exception == EXC_SYSTICK)
+		systick_pending = false;
+	else
+		nvic_pending &= ~(1U << (exception - 16));
+	cpu.taken[exception]++;
+}
+
+//
+// Peripherals moving with time
+//
+
+static void advance(uint64_t now);
+
+static uint64_t uart_byte_ns(const uart_t *u, const clocks_t *c) {
+	uint8_t *r = reg8(u->base);
+	uint32_t sbr = ((r[UART_BDH] & UART_BDH_SBR_MASK) << 8) | r[UART_BDL];
+	uint32_t bits = 1 + 8 + 1;
+	uint32_t clock, osr;
+
+	if (u->low_power) {
+		clock = selected_clock(c, (sim->SOPT2 & SIM_SOPT2_UART0SRC_MASK) >> SIM_SOPT2_UART0SRC_SHIFT);
+		osr = (r[UART0_C4] & UART0_C4_OSR_MASK) + 1;
+		if (r[UART0_C4] & UART0_C4_M10_MASK)
+			bits++;
+	} else {
+		clock = c->bus;
+		osr = 16;
+	}
+	if (r[UART_C1] & UART_C1_M_MASK)
+		bits++;
+	if (r[UART_BDH] & UART_BDH_SBNS_MASK)
+		bits++;
+	if (clock == 0 || sbr == 0)
+		return 0;
+	return (uint64_t) bits * osr * sbr * NS_PER_S / clock;
+}
+
+static void uart_step(uart_t *u, const clocks_t *c, uint64_t now) {
+	uint8_t *r = reg8(u->base);
+	uint64_t byte_ns = uart_byte_ns(u, c);
+	uint64_t start;
+	ssize_t n;
+
+	if (byte_ns == 0)
+		return;
+
+	// Transmitter: bytes leave in order, back to back
+	while (u->tx_busy && now >= u->tx_done) {
+		if (u->tx_fd >= 0 && write(u->tx_fd, &u->tx_shift, 1) < 0 && errno != EAGAIN)
+			u->tx_fd = -1;
+		u->tx_bytes++;
+		if (u->tx_full) {
+			u->tx_shift = u->tx_buffer;
+			u->tx_full = false;
+			u->tx_done += byte_ns;
+			r[UART_S1] |= UART_S1_TDRE_MASK;
+		} else {
+			u->tx_busy = false;
+			r[UART_S1] |= UART_S1_TC_MASK;
+		}
+	}
+
+	// Receiver: the line is read while the receiver is on; a byte that was
+	// waiting follows the last one back to back
+	while (r[UART_C2] & UART_C2_RE_MASK) {
+		if (!u->rx_busy) {
+			if (u->rx_fd < 0 || u->eof)
+				break;
+			n = read(u->rx_fd, &u->rx_byte, 1);
+			if (n == 0)
+				u->eof = true;
+			if (n != 1)
+				break;
+			start = (u->rx_done + 2 * STEP_NS >= now) ? u->rx_done : now;
+			u->rx_busy = true;
+			u->rx_done = start + byte_ns;
+			r[UART_S2] |= UART_S2_RXEDGIF_MASK;
+		}
+		if (now < u->rx_done)
+			break;
+		u->rx_busy = false;
+		u->rx_bytes++;
+		if (r[UART_S1] & UART_S1_RDRF_MASK) {
+			r[UART_S1] |= UART_S1_OR_MASK;
+			u->overruns++;
+		} else {
+			u->rx_data = u->rx_byte;
+			r[UART_D] = u->rx_byte;
+			r[UART_S1] |= UART_S1_RDRF_MASK;
+		}
+	}
+}
+
+static void tpm_step(uint32_t i, const clocks_t *c, uint64_t ns) {
+	TPM_Type *tpm = tpms[i];
+	uint32_t clock = selected_clock(c, (sim->SOPT2 & SIM_SOPT2_TPMSRC_MASK) >> SIM_SOPT2_TPMSRC_SHIFT);
+	uint32_t cnt = tpm->CNT;
+	uint32_t mod = tpm->MOD & 0xFFFF;
+
+	if (((tpm->SC & TPM_SC_CMOD_MASK) >> TPM_SC_CMOD_SHIFT) != 1 || clock == 0)
+		return;
+	clock >>= (tpm->SC & TPM_SC_PS_MASK);
+	if (count_up(&cnt, mod ? mod : 0xFFFF, counts(&tpm_rest[i], ns, clock)) > 0) {
+		tpm->SC |= TPM_SC_TOF_MASK;
+		tpm->STATUS |= TPM_STATUS_TOF_MASK;
+	}
+	tpm->CNT = cnt;
+}
+
+static void lptmr_step(const clocks_t *c, uint64_t ns) {
+	uint32_t psr = lptmr->PSR;
+	uint32_t clock;
+
+	if (!(lptmr->CSR & LPTMR_CSR_TEN_MASK))
+		return;
+	switch ((psr & LPTMR_PSR_PCS_MASK) >> LPTMR_PSR_PCS_SHIFT) {
+	case 0:
+		clock = c->irclk;
+		break;
+	case 1:
+		clock = LPO_HZ;
+		break;
+	case 2:
+		clock = ERCLK32K_HZ;
+		break;
+	default:
+		clock = c->oscer;
+		break;
+	}
+	if (!(psr & LPTMR_PSR_PBYP_MASK))
+		clock >>= ((psr & LPTMR_PSR_PRESCALE_MASK) >> LPTMR_PSR_PRESCALE_SHIFT) + 1;
+	if (clock == 0)
+		return;
+	// The flag is set as the counter goes from CMR back to zero
+	if (count_up(&lptmr_count, lptmr->CMR & 0xFFFF, counts(&lptmr_rest, ns, clock)) > 0)
+		lptmr->CSR |= LPTMR_CSR_TCF_MASK;
+}
+
+static void pit_step(const clocks_t *c, uint64_t ns) {
+	uint64_t expiries[2] = { 0, 0 };
+	uint32_t i, cval;
+
+	if ((pit->MCR & PIT_MCR_MDIS_MASK) || c->bus == 0)
+		return;
+	for (i = 0; i < 2; i++) {
+		uint64_t n;
+
+		if (!(pit->CHANNEL[i].TCTRL & PIT_TCTRL_TEN_MASK))
+			continue;
+		if (i > 0 && (pit->CHANNEL[i].TCTRL & PIT_TCTRL_CHN_MASK))
+			n = expiries[i - 1];
+		else
+			n = counts(&pit_rest[i], ns, c->bus);
+		cval = pit->CHANNEL[i].CVAL;
+		expiries[i] = count_down(&cval, pit->CHANNEL[i].LDVAL, n);
+		SET_RO(pit->CHANNEL[i].CVAL, cval);
+		if (expiries[i] > 0)
+			pit->CHANNEL[i].TFLG = PIT_TFLG_TIF_MASK;
+	}
+}
+
+static void systick_step(const clocks_t *c, uint64_t ns) {
+	uint32_t ctrl = systick->CTRL;
+	uint32_t clock = (ctrl & SysTick_CTRL_CLKSOURCE_Msk) ? c->core : c->core / 16;
+	uint32_t val = systick->VAL & SysTick_VAL_CURRENT_Msk;
+
+	if (!(ctrl & SysTick_CTRL_ENABLE_Msk) || clock == 0)
+		return;
+	if (count_down(&val, systick->LOAD & SysTick_LOAD_RELOAD_Msk,
+			counts(&systick_rest, ns, clock)) > 0) {
+		systick->CTRL = ctrl | SysTick_CTRL_COUNTFLAG_Msk;
+		if (ctrl & SysTick_CTRL_TICKINT_Msk)
+			pend_systick();
+	}
+	systick->VAL = val;
+}
+
+static void cop_step(uint64_t ns, bool stopped) {
+	uint64_t elapsed;
+
+	// The COP counts the LPO, in RUN and WAIT only
+	if (cop_ms == 0 || stopped)
+		return;
+	elapsed = counts(&cop_rest, ns, LPO_HZ);
+	if (elapsed >= cop_left_ms)
+		Model_Reset("COP timeout");
+	cop_left_ms -= (uint32_t) elapsed;
+}
+
+/*
+ * Bring every counter up to now. Call with the lock held.
+ */
+static void advance(uint64_t now) {
+	clocks_t c;
+	uint64_t ns;
+	uint32_t i;
+
+	if (now <= last_ns)
+		return;
+	ns = now - last_ns;
+	if (ns > MAX_STEP_NS)
+		ns = MAX_STEP_NS;
+	last_ns = now;
+
+	get_clocks(&c, cpu.sleep == SLEEP_VLPS);
+	systick_step(&c, ns);
+	for (i = 0; i < 3; i++)
+		tpm_step(i, &c, ns);
+	lptmr_step(&c, ns);
+	pit_step(&c, ns);
+	for (i = 0; i < 2; i++)
+		uart_step(&uarts[i], &c, now);
+	if (plant != NULL)
+		plant(ns);
+	if (adc_done != 0 && now >= adc_done) {
+		adc_done = 0;
+		SET_RO(adc->R[0], battery_mv * ADC_FULL_SCALE / (VREF_MV * BATTERY_DIVIDER));
+		adc->SC1[0] |= ADC_SC1_COCO_MASK;
+	}
+	cop_step(ns, cpu.sleep == SLEEP_VLPS);
+	update();
+	if (exit_ns != 0 && now >= exit_ns) {
+		Model_Dump(stdout);
+		fflush(stdout);
+		exit(EXIT_SUCCESS);
+	}
+}
+
+/*
+ * Move model time on by ns. Call with the lock held.
+ */
+static void spend(uint64_t ns) {
+	advance(last_ns + ns);
+}
+
+//
+// Register accesses
+//
+
+static void mcg_status(void) {
+	uint8_t clks = (mcg->C1 & MCG_C1_CLKS_MASK) >> MCG_C1_CLKS_SHIFT;
+	uint8_t s = 0;
+
+	if (mcg->C2 & MCG_C2_EREFS0_MASK)
+		s |= MCG_S_OSCINIT0_MASK;
+	if (mcg->C1 & MCG_C1_IREFS_MASK)
+		s |= MCG_S_IREFST_MASK;
+	if (mcg->C2 & MCG_C2_IRCS_MASK)
+		s |= MCG_S_IRCST_MASK;
+	if (mcg->C6 & MCG_C6_PLLS_MASK)
+		s |= MCG_S_PLLST_MASK;
+	if ((mcg->C6 & MCG_C6_PLLS_MASK) || (mcg->C5 & MCG_C5_PLLCLKEN0_MASK))
+		s |= MCG_S_LOCK0_MASK;
+	if (clks == 0 && (mcg->C6 & MCG_C6_PLLS_MASK))
+		clks = 3;
+	mcg->S = s | MCG_S_CLKST(clks);
+	// Auto trim is not modeled: it completes at once
+	mcg->SC &= ~(MCG_SC_ATME_MASK | MCG_SC_LOCS0_MASK);
+}
+
+static void flash_command(void) {
+	uint32_t command = word_at(FTFA_BASE + 4);
+	uint32_t address = command & 0xFFFFFF;
+	uint32_t data = word_at(FTFA_BASE + 8);
+	uint32_t expected = word_at(FTFA_BASE + 12);
+	uint8_t status = 0;
+	uint32_t i, longwords;
+	uint32_t *word;
+
+	if (address < FLASH_BASE || address >= FLASH_BASE + FLASH_BYTES) {
+		ftfa->FSTAT = FTFA_FSTAT_CCIF_MASK | FTFA_FSTAT_ACCERR_MASK;
+		return;
+	}
+	word = (uint32_t *) &flash[(address - FLASH_BASE) & ~3UL];
+	switch (command >> 24) {
+	case 0x01:              // Read 1s section
+		longwords = data >> 16;
+		for (i = 0; i < longwords && (uint8_t *) &word[i] < flash + FLASH_BYTES; i++) {
+			if (word[i] != 0xFFFFFFFF)
+				status |= FTFA_FSTAT_MGSTAT0_MASK;
+		}
+		break;
+	case 0x02:              // Program check
+		if (*word != expected)
+			status |= FTFA_FSTAT_MGSTAT0_MASK;
+		break;
+	case 0x06:              // Program longword: bits can only be cleared
+		if (address & 3)
+			status |= FTFA_FSTAT_ACCERR_MASK;
+		else
+			*word &= data;
+		break;
+	case 0x09:              // Erase sector
+		if (address & (FLASH_SECTOR - 1))
+			status |= FTFA_FSTAT_ACCERR_MASK;
+		else
+			memset(&flash[address - FLASH_BASE], 0xFF, FLASH_SECTOR);
+		break;
+	default:
+		status |= FTFA_FSTAT_ACCERR_MASK;
+		break;
+	}
+	if (flash_fd >= 0 && pwrite(flash_fd, flash, FLASH_BYTES, 0) != (ssize_t) FLASH_BYTES)
+		fprintf(stderr, "model: flash file not written: %s\n", strerror(errno));
+	ftfa->FSTAT = FTFA_FSTAT_CCIF_MASK | status;
+}
+
+static void uart_write(uart_t *u, uint32_t offset, uint8_t old, uint64_t now) {
+	uint8_t *r = reg8(u->base);
+	uint8_t value;
+	clocks_t c;
+
+	switch (offset) {
+	case UART_S1:
+		// UART0 clears its error flags by writing one, the others by reading
+		r[UART_S1] = u->low_power ? (uint8_t) written(old, r[UART_S1],
+				UART0_S1_IDLE_MASK | UART0_S1_OR_MASK | UART0_S1_NF_MASK
+				| UART0_S1_FE_MASK | UART0_S1_PF_MASK, 0xFF) : old;
+		break;
+	case UART_S2:
+		r[UART_S2] = (uint8_t) written(old, r[UART_S2],
+				UART_S2_LBKDIF_MASK | UART_S2_RXEDGIF_MASK, UART_S2_RAF_MASK);
+		break;
+	case UART_D:
+		// D reads back the last byte received
+		value = r[UART_D];
+		r[UART_D] = u->rx_data;
+		if (!(r[UART_C2] & UART_C2_TE_MASK))
+			break;
+		get_clocks(&c, false);
+		if (!u->tx_busy) {
+			u->tx_shift = value;
+			u->tx_busy = true;
+			u->tx_done = now + uart_byte_ns(u, &c);
+			r[UART_S1] &= ~UART_S1_TC_MASK;
+		} else {
+			// Writing while TDRE is clear overwrites the buffer
+			u->tx_buffer = value;
+			u->tx_full = true;
+			r[UART_S1] &= ~(UART_S1_TDRE_MASK | UART_S1_TC_MASK);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void uart_read(uart_t *u, uint32_t offset) {
+	uint8_t *r = reg8(u->base);
+
+	if (offset != UART_D)
+		return;
+	r[UART_S1] &= ~UART_S1_RDRF_MASK;
+	if (!u->low_power)
+		r[UART_S1] &= ~(UART_S1_OR_MASK | UART_S1_NF_MASK | UART_S1_FE_MASK | UART_S1_PF_MASK);
+}
+
+static void tpm_write(TPM_Type *tpm, uint32_t offset, uint32_t old) {
+	uint32_t ch;
+
+	if (offset == offsetof(TPM_Type, SC)) {
+		tpm->SC = written(old, tpm->SC, TPM_SC_TOF_MASK, 0);
+		if (!(tpm->SC & TPM_SC_TOF_MASK))
+			tpm->STATUS &= ~TPM_STATUS_TOF_MASK;
+	} else if (offset == offsetof(TPM_Type, CNT)) {
+		tpm->CNT = 0;
+	} else if (offset == offsetof(TPM_Type, STATUS)) {
+		tpm->STATUS = written(old, tpm->STATUS, 0x13F, 0);
+		if (!(tpm->STATUS & TPM_STATUS_TOF_MASK))
+			tpm->SC &= ~TPM_SC_TOF_MASK;
+		for (ch = 0; ch < 6; ch++) {
+			if (!(tpm->STATUS & (1U << ch)))
+				tpm->CONTROLS[ch].CnSC &= ~TPM_CnSC_CHF_MASK;
+		}
+	} else if (offset >= offsetof(TPM_Type, CONTROLS) && offset < offsetof(TPM_Type, CONTROLS[6])
+			&& (offset - offsetof(TPM_Type, CONTROLS)) % 8 == 0) {
+		ch = (offset - offsetof(TPM_Type, CONTROLS)) / 8;
+		tpm->CONTROLS[ch].CnSC = written(old, tpm->CONTROLS[ch].CnSC, TPM_CnSC_CHF_MASK, 0);
+		if (!(tpm->CONTROLS[ch].CnSC & TPM_CnSC_CHF_MASK))
+			tpm->STATUS &= ~(1U << ch);
+	}
+}
+
+static void lptmr_write(uint32_t offset, uint32_t old) {
+	if (offset == offsetof(LPTMR_Type, CSR)) {
+		lptmr->CSR = written(old, lptmr->CSR, LPTMR_CSR_TCF_MASK, 0);
+		// Disabling resets the counter and the flag
+		if (!(lptmr->CSR & LPTMR_CSR_TEN_MASK)) {
+			lptmr_count = 0;
+			lptmr_rest = 0;
+			lptmr->CSR &= ~LPTMR_CSR_TCF_MASK;
+		}
+	} else if (offset == offsetof(LPTMR_Type, CNR)) {
+		// A write latches the counter for reading
+		lptmr->CNR = lptmr_count;
+	}
+}
+
+static void pit_write(uint32_t offset, uint32_t old) {
+	uint32_t i = (offset - offsetof(PIT_Type, CHANNEL)) / 16;
+
+	if (offset < offsetof(PIT_Type, CHANNEL) || i >= 2)
+		return;
+	switch ((offset - offsetof(PIT_Type, CHANNEL)) % 16) {
+	case 4:                 // CVAL is read-only
+		SET_RO(pit->CHANNEL[i].CVAL, old);
+		break;
+	case 8:                 // Enabling loads the counter
+		if ((pit->CHANNEL[i].TCTRL & PIT_TCTRL_TEN_MASK) && !(old & PIT_TCTRL_TEN_MASK)) {
+			SET_RO(pit->CHANNEL[i].CVAL, pit->CHANNEL[i].LDVAL);
+			pit_rest[i] = 0;
+		}
+		break;
+	case 12:
+		pit->CHANNEL[i].TFLG = written(old, pit->CHANNEL[i].TFLG, PIT_TFLG_TIF_MASK, 0);
+		break;
+	default:
+		break;
+	}
+}
+
+static void gpio_write(uintptr_t address, uint32_t old) {
+	GPIO_Type *gpio = (GPIO_Type *) alias(address & ~0x3FUL);
+	uint32_t value = *reg32(address);
+
+	switch (address & 0x3F) {
+	case offsetof(GPIO_Type, PSOR):
+		gpio->PDOR |= value;
+		gpio->PSOR = 0;
+		break;
+	case offsetof(GPIO_Type, PCOR):
+		gpio->PDOR &= ~value;
+		gpio->PCOR = 0;
+		break;
+	case offsetof(GPIO_Type, PTOR):
+		gpio->PDOR ^= value;
+		gpio->PTOR = 0;
+		break;
+	case offsetof(GPIO_Type, PDIR):
+		SET_RO(gpio->PDIR, old);
+		break;
+	default:
+		break;
+	}
+	// Outputs read back as driven, inputs low
+	SET_RO(gpio->PDIR, gpio->PDOR & gpio->PDDR);
+}
+
+static void port_write(uintptr_t address, uint32_t old) {
+	PORT_Type *port = (PORT_Type *) alias(address & ~0xFFFUL);
+	uint32_t offset = address & 0xFFF;
+	uint32_t value = *reg32(address);
+	uint32_t pin, first;
+
+	if (offset < offsetof(PORT_Type, GPCLR)) {
+		port->PCR[offset / 4] = written(old, value, PORT_PCR_ISF_MASK, 0);
+	} else if (offset == offsetof(PORT_Type, GPCLR) || offset == offsetof(PORT_Type, GPCHR)) {
+		first = (offset == offsetof(PORT_Type, GPCLR)) ? 0 : 16;
+		for (pin = 0; pin < 16; pin++) {
+			if (value & (1U << (16 + pin)))
+				port->PCR[first + pin] = (port->PCR[first + pin] & ~0xFFFFU) | (value & 0xFFFFU);
+		}
+		*reg32(address) = 0;
+	} else if (offset == offsetof(PORT_Type, ISFR)) {
+		for (pin = 0; pin < 32; pin++) {
+			if (value & (1U << pin))
+				port->PCR[pin] &= ~PORT_PCR_ISF_MASK;
+		}
+		port->ISFR = old & ~value;
+	}
+}
+
+static void sim_write(uintptr_t address, uint32_t old) {
+	static const uint32_t cop_timeouts_ms[4] = { 0, 32, 256, 1024 };
+	uint32_t value = *reg32(address);
+
+	if (address == (uintptr_t) &SIM->COPC) {
+		// Write-once after reset
+		if (cop_written) {
+			sim->COPC = old;
+			return;
+		}
+		cop_written = true;
+		cop_ms = cop_timeouts_ms[(value & SIM_COPC_COPT_MASK) >> SIM_COPC_COPT_SHIFT];
+		cop_left_ms = cop_ms;
+		cop_rest = 0;
+	} else if (address == (uintptr_t) &SIM->SRVCOP) {
+		if ((value & 0xFF) == 0xAA && cop_armed) {
+			cop_left_ms = cop_ms;
+			cop_rest = 0;
+		}
+		cop_armed = ((value & 0xFF) == 0x55);
+		sim->SRVCOP = 0;
+	} else if (address == (uintptr_t) &SIM->SDID || address == (uintptr_t) &SIM->FCFG2) {
+		*reg32(address) = old;
+	}
+}
+
+static void scs_write(uintptr_t address, uint32_t old) {
+	uint32_t value = *reg32(address);
+
+	if (address == (uintptr_t) &SysTick->CTRL) {
+		systick->CTRL = (value & ~SysTick_CTRL_COUNTFLAG_Msk) | (old & SysTick_CTRL_COUNTFLAG_Msk);
+	} else if (address == (uintptr_t) &SysTick->VAL) {
+		// Any write clears the counter, which reloads on the next count
+		systick->VAL = 0;
+		systick->CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+		systick_rest = 0;
+	} else if (address == (uintptr_t) &NVIC->ISER[0]) {
+		nvic_enabled |= value;
+	} else if (address == (uintptr_t) &NVIC->ICER[0]) {
+		nvic_enabled &= ~value;
+	} else if (address == (uintptr_t) &NVIC->ISPR[0]) {
+		nvic_pending |= value;
+	} else if (address == (uintptr_t) &NVIC->ICPR[0]) {
+		nvic_pending &= ~value;
+	} else if (address == (uintptr_t) &SCB->ICSR) {
+		if (value & SCB_ICSR_PENDSVSET_Msk)
+			cpu.pendsv = true;
+		if (value & SCB_ICSR_PENDSVCLR_Msk)
+			cpu.pendsv = false;
+		if (value & SCB_ICSR_PENDSTSET_Msk)
+			pend_systick();
+		if (value & SCB_ICSR_PENDSTCLR_Msk)
+			systick_pending = false;
+		if (cpu.pendsv)
+			pthread_kill(cpu.thread, SIG_IRQ);
+	} else if (address == (uintptr_t) &SCB->AIRCR) {
+		if ((value >> SCB_AIRCR_VECTKEY_Pos) == 0x05FA && (value & SCB_AIRCR_SYSRESETREQ_Msk))
+			Model_Reset("SYSRESETREQ");
+		scb->AIRCR = old;
+	} else if (address == (uintptr_t) &SCB->CPUID) {
+		SET_RO(scb->CPUID, old);
+	}
+}
+
+static void scs_read(uintptr_t address) {
+	// Reading clears COUNTFLAG
+	if (address == (uintptr_t) &SysTick->CTRL)
+		systick->CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+}
+
+/*
+ * Apply what the hardware does on an access. Called with the lock held,
+ * after the access.
+ */
+static void on_access(uintptr_t address, bool write, uint32_t old_word, uint64_t now) {
+	uintptr_t page = PAGE_OF(address);
+	uint32_t offset = address & 0xFFF;
+	uint32_t old32 = old_word;
+	uint8_t old8 = (uint8_t) (old_word >> (8 * (address & 3)));
+	uint8_t value8;
+	uint32_t i;
+
+	if (!write) {
+		for (i = 0; i < 2; i++) {
+			if (page == uarts[i].base)
+				uart_read(&uarts[i], offset);
+		}
+		if (page == PAGE_OF(SCS_BASE))
+			scs_read(address);
+		return;
+	}
+
+	switch (page) {
+	case UART0_BASE:
+	case UART1_BASE:
+		uart_write(&uarts[page == UART1_BASE], offset, old8, now);
+		break;
+	case TPM0_BASE:
+	case TPM1_BASE:
+	case TPM2_BASE:
+		tpm_write(tpms[(page - TPM0_BASE) / PAGE_BYTES], offset, old32);
+		break;
+	case LPTMR0_BASE:
+		lptmr_write(offset, old32);
+		break;
+	case PIT_BASE:
+		pit_write(offset, old32);
+		break;
+	case ADC0_BASE:
+		if (offset == offsetof(ADC_Type, SC1[0])) {
+			adc->SC1[0] &= ~ADC_SC1_COCO_MASK;
+			if ((adc->SC1[0] & ADC_SC1_ADCH_MASK) != ADC_SC1_ADCH_MASK)
+				adc_done = now + ADC_CONVERSION_NS;
+		}
+		break;
+	case FTFA_BASE:
+		if (offset == offsetof(FTFA_Type, FSTAT)) {
+			value8 = ftfa->FSTAT;
+			ftfa->FSTAT = (uint8_t) written(old8, value8, FTFA_FSTAT_RDCOLERR_MASK
+					| FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK,
+					FTFA_FSTAT_CCIF_MASK | FTFA_FSTAT_MGSTAT0_MASK);
+			// Writing one to CCIF launches the command
+			if (value8 & FTFA_FSTAT_CCIF_MASK)
+				flash_command();
+		} else if (offset == offsetof(FTFA_Type, FSEC) || offset == offsetof(FTFA_Type, FOPT)) {
+			*reg8(address) = old8;
+		}
+		break;
+	case MCG_BASE:
+		if (offset == offsetof(MCG_Type, S))
+			mcg->S = old8;
+		mcg_status();
+		break;
+	case SMC_BASE:
+		if (offset == offsetof(SMC_Type, PMCTRL)) {
+			smc->PMCTRL &= ~SMC_PMCTRL_STOPA_MASK;
+			SET_RO(smc->PMSTAT, ((smc->PMCTRL & SMC_PMCTRL_RUNM_MASK) >> SMC_PMCTRL_RUNM_SHIFT) == 2
+					? PMSTAT_VLPR : PMSTAT_RUN);
+		} else if (offset == offsetof(SMC_Type, PMSTAT)) {
+			SET_RO(smc->PMSTAT, old8);
+		}
+		break;
+	case PAGE_OF(SIM_BASE):
+	case PAGE_OF(SIM_BASE) + PAGE_BYTES:
+		sim_write(address, old32);
+		break;
+	case PORTA_BASE:
+	case PORTB_BASE:
+	case PORTC_BASE:
+	case PORTD_BASE:
+	case PORTE_BASE:
+		port_write(address, old32);
+		break;
+	case PAGE_OF(GPIOA_BASE):
+	case PAGE_OF(FGPIOA_BASE):
+		gpio_write(address, old32);
+		break;
+	case PAGE_OF(SCS_BASE):
+		scs_write(address, old32);
+		break;
+	default:
+		break;
+	}
+}
+
+//
+// Traps and interrupts
+//
+
+static void fatal(int sig) {
+	struct sigaction action;
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = SIG_DFL;
+	sigaction(sig, &action, NULL);
+}
+
+/*
+ * An access to a trapping page: open it, single-step the access, and keep
+ * the interrupt signal and the hardware thread out until it is done.
+ */
+static void on_segv(int sig, siginfo_t *info, void *context) {
+	ucontext_t *uc = context;
+	uintptr_t address = (uintptr_t) info->si_addr;
+	const region_t *region = region_of(address);
+
+	// Outside the registers, or a store to flash: a fault of the firmware
+	if (region == NULL || info->si_code != SEGV_ACCERR || step.active
+			|| region->base == FLASH_BASE) {
+		fprintf(stderr, "model: fault at %#lx\n", (unsigned long) address);
+		fatal(sig);
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	spend(ACCESS_NS);
+	step.active = true;
+	step.address = address;
+	step.write = (uc->uc_mcontext.gregs[REG_ERR] & PAGE_FAULT_WRITE) != 0;
+	step.old = word_at(address);
+	step.mask = uc->uc_sigmask;
+	sigaddset(&uc->uc_sigmask, SIG_IRQ);
+	mprotect((void *) PAGE_OF(address), PAGE_BYTES, PROT_READ | PROT_WRITE);
+	uc->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+	cpu.traps++;
+}
+
+static void on_trap(int sig, siginfo_t *info, void *context) {
+	ucontext_t *uc = context;
+
+	(void) info;
+	if (!step.active) {
+		fatal(sig);
+		return;
+	}
+	uc->uc_mcontext.gregs[REG_EFL] &= ~TRAP_FLAG;
+	mprotect((void *) PAGE_OF(step.address), PAGE_BYTES, page_prot(PAGE_OF(step.address)));
+	uc->uc_sigmask = step.mask;
+	step.active = false;
+	on_access(step.address, step.write, step.old, last_ns);
+	update();
+	pthread_mutex_unlock(&lock);
+}
+
+/*
+ * Signal the core if an exception is pending, to be taken once unmasked.
+ */
+static void kick(void) {
+	bool pending;
+
+	pthread_mutex_lock(&lock);
+	pending = exception_pending();
+	pthread_mutex_unlock(&lock);
+	if (pending)
+		pthread_kill(cpu.thread, SIG_IRQ);
+}
+
+/*
+ * Exception entry: take the pending exceptions one after the other. A
+ * PendSV may switch tasks, which then resume from their own entry here.
+ */
+static void on_irq(int sig, siginfo_t *info, void *context) {
+	ucontext_t *uc = context;
+	int exception;
+
+	(void) sig;
+	(void) info;
+	if (cpu.primask || cpu.ipsr != 0) {
+		sigaddset(&uc->uc_sigmask, SIG_IRQ);
+		return;
+	}
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		exception = next_exception();
+		if (exception != 0)
+			take(exception);
+		pthread_mutex_unlock(&lock);
+		if (exception == 0)
+			break;
+		if (handlers[exception] == NULL) {
+			fprintf(stderr, "model: no handler for exception %d\n", exception);
+			abort();
+		}
+		cpu.ipsr = exception;
+		handlers[exception]();
+		pthread_mutex_lock(&lock);
+		// Entry and return, still in handler mode
+		spend(EXCEPTION_NS);
+		cpu.ipsr = 0;
+		update();
+		pthread_mutex_unlock(&lock);
+		// A handler returning with PRIMASK set masks the thread
+		if (cpu.primask) {
+			sigaddset(&uc->uc_sigmask, SIG_IRQ);
+			break;
+		}
+	}
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Disable_Irq(void) {
+	if (cpu.ipsr == 0)
+		pthread_sigmask(SIG_BLOCK, &irq_set, NULL);
+	cpu.primask = 1;
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Enable_Irq(void) {
+	cpu.primask = 0;
+	if (cpu.ipsr == 0)
+		pthread_sigmask(SIG_UNBLOCK, &irq_set, NULL);
+}
+
+// Refer kl25z_model.h file for function brief and description
+uint32_t Model_Get_Primask(void) {
+	return cpu.primask;
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Set_Primask(uint32_t primask) {
+	if (primask & 1)
+		Model_Disable_Irq();
+	else
+		Model_Enable_Irq();
+}
+
+// Refer kl25z_model.h file for function brief and description
+uint32_t Model_Set_Mask_From_Isr(void) {
+	uint32_t primask = cpu.primask;
+
+	Model_Disable_Irq();
+	return primask;
+}
+
+// Refer kl25z_model.h file for function brief and description
+uint32_t Model_Get_Ipsr(void) {
+	return cpu.ipsr;
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Pend_Sv(void) {
+	cpu.pendsv = true;
+	if (cpu.ipsr == 0)
+		pthread_kill(cpu.thread, SIG_IRQ);
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Set_Idle(bool idle) {
+	cpu.idle = idle;
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Start_Thread(void) {
+	cpu.ipsr = 0;
+	cpu.primask = 0;
+	kick();
+	pthread_sigmask(SIG_UNBLOCK, &irq_set, NULL);
+}
+
+/*
+ * Keep model time from running ahead of host time over the slowdown, while
+ * the core sleeps. Call with the lock held.
+ */
+static void pace(void) {
+	uint64_t due, now;
+	struct timespec until;
+
+	if (slowdown == 0)
+		return;
+	due = host_start_ns + last_ns * slowdown;
+	now = host_ns();
+	if (due < now + PACE_NS)
+		return;
+	until.tv_sec = (time_t) (due / NS_PER_S);
+	until.tv_nsec = (long) (due % NS_PER_S);
+	pthread_mutex_unlock(&lock);
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+	pthread_mutex_lock(&lock);
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Wait_For_Interrupt(void) {
+	sigset_t old;
+	uint64_t start;
+	int sleep;
+
+	pthread_sigmask(SIG_BLOCK, &irq_set, &old);
+	pthread_mutex_lock(&lock);
+	sleep = ((scb->SCR & SCB_SCR_SLEEPDEEP_Msk)
+			&& ((smc->PMCTRL & SMC_PMCTRL_STOPM_MASK) >> SMC_PMCTRL_STOPM_SHIFT) == STOPM_VLPS
+			&& (smc->PMPROT & SMC_PMPROT_AVLP_MASK)) ? SLEEP_VLPS : SLEEP_WAIT;
+	cpu.sleep = sleep;
+	start = last_ns;
+	// Any enabled exception wakes the core, masked or not
+	while (!exception_pending()) {
+		spend(STEP_NS);
+		pace();
+	}
+	cpu.sleep = SLEEP_NONE;
+	cpu.sleep_ns[sleep] += last_ns - start;
+	pthread_mutex_unlock(&lock);
+	// Raise the signal again for when the mask allows
+	pthread_kill(cpu.thread, SIG_IRQ);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+//
+// Set-up, reset and reports
+//
+
+/*
+ * Steps the model for the idle task when it spins because the next tick is
+ * less than two away, too close for tickless idle: it neither traps nor
+ * sleeps, so model time would stand still. Once the idle task has run for
+ * SPIN_CPU_NS of CPU time with interrupts enabled and without a trap, far
+ * longer than its way into tickless idle takes, the model steps on as in
+ * WFI until an exception is pending. CPU time rather than host time, so
+ * that a host holding the process up does not count.
+ */
+static void *hardware_thread(void *unused) {
+	struct timespec period = { 0, SPIN_CHECK_NS };
+	struct timespec now;
+	uint64_t seen = 0, since = 0, used;
+	uint32_t i;
+	bool spinning;
+
+	(void) unused;
+	prctl(PR_SET_TIMERSLACK, 1UL);
+	for (;;) {
+		nanosleep(&period, NULL);
+		clock_gettime(cpu.clock, &now);
+		used = (uint64_t) now.tv_sec * NS_PER_S + (uint64_t) now.tv_nsec;
+		pthread_mutex_lock(&lock);
+		spinning = cpu.idle && last_ns == seen && cpu.sleep == SLEEP_NONE
+				&& !cpu.primask && cpu.ipsr == 0;
+		if (!spinning || used - since < SPIN_CPU_NS) {
+			if (!spinning)
+				since = used;
+			seen = last_ns;
+			spinning = false;
+		} else {
+			for (i = 0; i < SPIN_STEPS && !exception_pending(); i++)
+				spend(STEP_NS);
+			seen = last_ns;
+			since = used;
+		}
+		pthread_mutex_unlock(&lock);
+		if (spinning)
+			kick();
+	}
+	return NULL;
+}
+
+/*
+ * Printed at exit: where the time went and what the interrupts did. Reads
+ * without the lock, which an exit from a trap may hold.
+ */
+static void summary(void) {
+	uint64_t total = last_ns;
+	uint64_t sleeping = cpu.sleep_ns[SLEEP_WAIT] + cpu.sleep_ns[SLEEP_VLPS];
+	uint32_t i;
+	int s;
+
+	cpu.sleep_ns[SLEEP_NONE] = (total > sleeping) ? total - sleeping : 0;
+	fprintf(stderr, "model: %.3f s,", (double) total / NS_PER_S);
+	for (s = 0; s < SLEEP_STATES; s++)
+		fprintf(stderr, " %s %.1f%%", sleep_names[s], 100.0 * cpu.sleep_ns[s] / total);
+	fprintf(stderr, ", %lu register traps\n", (unsigned long) cpu.traps);
+	fprintf(stderr, "model: exceptions");
+	for (i = 0; i < EXCEPTIONS; i++) {
+		if (cpu.taken[i] != 0)
+			fprintf(stderr, " %s %lu", exception_names[i] ? exception_names[i] : "?",
+					(unsigned long) cpu.taken[i]);
+	}
+	fprintf(stderr, "\n");
+	for (i = 0; i < 2; i++)
+		fprintf(stderr, "model: %s %lu bytes in, %lu out, %lu overruns\n", uarts[i].name,
+				(unsigned long) uarts[i].rx_bytes, (unsigned long) uarts[i].tx_bytes,
+				(unsigned long) uarts[i].overruns);
+}
+
+static void map_regions(void) {
+	int fd = memfd_create("kl25z", 0);
+	uint32_t i, p;
+	void *view;
+
+	if (fd < 0 || ftruncate(fd, BACKING_BYTES) != 0) {
+		perror("model: memfd");
+		exit(EXIT_FAILURE);
+	}
+	backing = mmap(NULL, BACKING_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (backing == MAP_FAILED) {
+		perror("model: mmap");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < REGIONS; i++) {
+		view = mmap((void *) regions[i].base, regions[i].bytes, regions[i].prot,
+				MAP_SHARED | MAP_FIXED_NOREPLACE, fd, (off_t) regions[i].offset);
+		if (view != (void *) regions[i].base) {
+			fprintf(stderr, "model: cannot map the %s at %#lx\n", regions[i].name,
+					(unsigned long) regions[i].base);
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (p = 0; p < READ_TRAP_PAGES; p++)
+		mprotect((void *) read_trap_pages[p], PAGE_BYTES, PROT_NONE);
+	close(fd);
+}
+
+/*
+ * Register values out of reset that the firmware depends on.
+ */
+static void reset_values(void) {
+	uint32_t i;
+
+	sim = alias(SIM_BASE);
+	mcg = alias(MCG_BASE);
+	osc = alias(OSC0_BASE);
+	smc = alias(SMC_BASE);
+	rcm = alias(RCM_BASE);
+	lptmr = alias(LPTMR0_BASE);
+	pit = alias(PIT_BASE);
+	adc = alias(ADC0_BASE);
+	ftfa = alias(FTFA_BASE);
+	systick = alias(SysTick_BASE);
+	nvic = alias(NVIC_BASE);
+	scb = alias(SCB_BASE);
+	flash = alias(FLASH_BASE);
+	for (i = 0; i < 3; i++)
+		tpms[i] = alias(TPM0_BASE + i * PAGE_BYTES);
+	for (i = 0; i < 5; i++)
+		gpios[i] = alias(GPIOA_BASE + i * 0x40);
+
+	memset(flash, 0xFF, FLASH_BYTES);
+	// FEI: FLL on the slow IRC, core at 20.97 MHz and bus at half of it
+	mcg->C1 = MCG_C1_IREFS_MASK;
+	mcg->C2 = MCG_C2_LOCRE0_MASK;
+	mcg->SC = MCG_SC_FCRDIV(1);
+	mcg_status();
+	sim->CLKDIV1 = SIM_CLKDIV1_OUTDIV4(1);
+	sim->SCGC4 = 0xF0000030;
+	sim->SCGC5 = 0x00000182;
+	sim->SCGC6 = SIM_SCGC6_FTF_MASK;
+	sim->SCGC7 = SIM_SCGC7_DMA_MASK;
+	// PFSIZE 0xF: the flash driver takes the size of the part from its features
+	sim->FCFG1 = SIM_FCFG1_PFSIZE(0xF);
+	sim->COPC = SIM_COPC_COPT(3);
+	cop_ms = 1024;
+	cop_left_ms = cop_ms;
+	SET_RO(smc->PMSTAT, PMSTAT_RUN);
+	SET_RO(rcm->SRS0, RCM_SRS0_POR_MASK | RCM_SRS0_LVD_MASK);
+	ftfa->FSTAT = FTFA_FSTAT_CCIF_MASK;
+	SET_RO(ftfa->FSEC, 0xFE);
+	pit->MCR = PIT_MCR_MDIS_MASK;
+	for (i = 0; i < 3; i++)
+		tpms[i]->MOD = 0xFFFF;
+	for (i = 0; i < 2; i++) {
+		reg8(uarts[i].base)[UART_BDL] = 0x04;
+		reg8(uarts[i].base)[UART_S1] = UART_S1_TDRE_MASK | UART_S1_TC_MASK;
+	}
+	reg8(UART0_BASE)[UART0_C4] = UART0_C4_OSR(15);
+	SET_RO(scb->CPUID, 0x410CC601);
+	scb->AIRCR = 0xFA050000;
+	SET_RO(systick->CALIB, 0x80000000);
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Init(const model_options_t *options) {
+	struct sigaction action;
+	ssize_t n;
+
+	cpu.thread = pthread_self();
+	sigemptyset(&irq_set);
+	sigaddset(&irq_set, SIG_IRQ);
+
+	map_regions();
+	reset_values();
+	uarts[0].rx_fd = options->uart0_rx_fd;
+	uarts[0].tx_fd = options->uart0_tx_fd;
+	uarts[1].tx_fd = options->uart1_tx_fd;
+	battery_mv = options->battery_mv;
+	if (options->flash != NULL) {
+		flash_fd = open(options->flash, O_RDWR | O_CREAT, 0644);
+		if (flash_fd < 0) {
+			perror(options->flash);
+			exit(EXIT_FAILURE);
+		}
+		n = pread(flash_fd, flash, FLASH_BYTES, 0);
+		if (n != (ssize_t) FLASH_BYTES)
+			memset(flash + (n > 0 ? n : 0), 0xFF, FLASH_BYTES - (n > 0 ? (size_t) n : 0));
+	}
+
+#define SET_HANDLER(name) handlers[EXC_IRQ(name##_IRQn)] = name##_IRQHandler; \
+		exception_names[EXC_IRQ(name##_IRQn)] = #name;
+	IRQ_HANDLERS(SET_HANDLER)
+	handlers[EXC_PENDSV] = PendSV_Handler;
+	exception_names[EXC_PENDSV] = "PendSV";
+	handlers[EXC_SYSTICK] = SysTick_Handler;
+	exception_names[EXC_SYSTICK] = "SysTick";
+
+	memset(&action, 0, sizeof(action));
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	sigaddset(&action.sa_mask, SIG_IRQ);
+	action.sa_sigaction = on_segv;
+	sigaction(SIGSEGV, &action, NULL);
+	action.sa_sigaction = on_trap;
+	sigaction(SIGTRAP, &action, NULL);
+	action.sa_flags = SA_SIGINFO | SA_RESTART;
+	action.sa_sigaction = on_irq;
+	sigaction(SIG_IRQ, &action, NULL);
+
+	slowdown = options->slowdown;
+	host_start_ns = host_ns();
+	atexit(summary);
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Start(void) {
+	pthread_t thread;
+	sigset_t old;
+
+	pthread_getcpuclockid(cpu.thread, &cpu.clock);
+	// The hardware thread never takes the interrupt signal
+	pthread_sigmask(SIG_BLOCK, &irq_set, &old);
+	if (pthread_create(&thread, NULL, hardware_thread, NULL) != 0) {
+		perror("model: hardware thread");
+		exit(EXIT_FAILURE);
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Exit_After(uint32_t ms) {
+	pthread_mutex_lock(&lock);
+	exit_ns = last_ns + (uint64_t) ms * 1000000;
+	pthread_mutex_unlock(&lock);
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Reset(const char *reason) {
+	fprintf(stderr, "model: reset by %s\n", reason);
+	exit(MODEL_EXIT_RESET);
+}
+
+// Refer kl25z_model.h file for function brief and description
+uint32_t Model_Get_Pins(uint32_t port) {
+	return gpios[port]->PDOR;
+}
+
+// Refer kl25z_model.h file for function brief and description
+uint32_t Model_Get_Cnv(uint32_t tpm, uint32_t channel) {
+	return tpms[tpm]->CONTROLS[channel].CnV;
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Set_Plant(model_plant_t step) {
+	pthread_mutex_lock(&lock);
+	plant = step;
+	pthread_mutex_unlock(&lock);
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Capture_Edge(uint32_t tpm, uint32_t channel) {
+	TPM_Type *t = tpms[tpm];
+	uint32_t cnsc = t->CONTROLS[channel].CnSC;
+
+	// Input capture: MSB:MSA 00, and an edge selected
+	if (((t->SC & TPM_SC_CMOD_MASK) >> TPM_SC_CMOD_SHIFT) != 1
+			|| (cnsc & (TPM_CnSC_MSA_MASK | TPM_CnSC_MSB_MASK))
+			|| !(cnsc & (TPM_CnSC_ELSA_MASK | TPM_CnSC_ELSB_MASK)))
+		return;
+	t->CONTROLS[channel].CnV = t->CNT;
+	t->CONTROLS[channel].CnSC |= TPM_CnSC_CHF_MASK;
+	t->STATUS |= 1U << channel;
+}
+
+// Refer kl25z_model.h file for function brief and description
+void Model_Dump(FILE *out) {
+	static const char ports[] = "ABCDE";
+	uint32_t i, ch;
+
+	for (i = 0; i < 5; i++)
+		fprintf(out, "PT%c PDOR 0x%08lx PDDR 0x%08lx\n", ports[i],
+				(unsigned long) gpios[i]->PDOR, (unsigned long) gpios[i]->PDDR);
+	for (i = 0; i < 3; i++) {
+		fprintf(out, "TPM%lu SC 0x%02lx MOD %lu", (unsigned long) i,
+				(unsigned long) tpms[i]->SC, (unsigned long) tpms[i]->MOD);
+		for (ch = 0; ch < 6; ch++)
+			fprintf(out, " C%luV %lu", (unsigned long) ch,
+					(unsigned long) tpms[i]->CONTROLS[ch].CnV);
+		fprintf(out, "\n");
+	}
+	fprintf(out, "NVIC enabled 0x%08lx pending 0x%08lx\n", (unsigned long) nvic_enabled,
+			(unsigned long) nvic_pending);
+	fprintf(out, "SMC PMSTAT 0x%02x, core %lu Hz\n", smc->PMSTAT,
+			(unsigned long) SystemCoreClock);
+}
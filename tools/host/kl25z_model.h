@@ -0,0 +1,185 @@
+// kl25z_model.h
+
+#ifndef KL25Z_MODEL_H
+#define KL25Z_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @file    kl25z_model.h
+ * @brief   Register and interrupt model of the KL25Z for the host build.
+ *
+ * The firmware keeps the peripheral addresses of MKL25Z4.h: the model maps
+ * RAM at them, along with the top flash sectors that hold the settings and
+ * the fault log. The pages are read-only to the firmware, so every register
+ * write traps; the model single-steps the store and then applies what the
+ * hardware does with it (write-one-to-clear flags, set and clear registers,
+ * flash commands, the clock and power mode status). The UART pages trap
+ * reads too, since reading D takes the received byte.
+ *
+ * The model steps what moves with time: SysTick, the TPM, LPTMR and PIT
+ * counters from the clock tree the registers select, the UART lines at
+ * their baud rate, ADC conversions and the COP watchdog. UART0 is wired to
+ * file descriptors standing in for the RN-41, UART1 to an optional
+ * telemetry capture.
+ *
+ * Model time is not host time: it moves on only as the firmware runs, by a
+ * fixed 1 us for each register access that traps and for each exception,
+ * and in 20 us steps while the core sleeps in WFI until an interrupt is
+ * pending. Code between two accesses takes no time. A run is then the same
+ * however loaded the host is, and a test may check timings to the
+ * microsecond. A hardware thread steps the model only for the idle task
+ * spinning until the next tick, see hardware_thread(). A slowdown keeps a
+ * sleeping core from running ahead of the host clock, for a terminal on
+ * the pseudo terminal of UART0.
+ *
+ * Interrupts are a signal to the thread running the firmware. PRIMASK
+ * masks the signal; the handler takes the pending exceptions in priority
+ * order, without nesting, and PendSV last. The FreeRTOS port switches
+ * tasks from PendSV, see port.c.
+ *
+ * Linux on x86-64 only: the traps single-step with the trap flag.
+ */
+
+/**
+ * @brief Model of what the pins drive, such as the motors and their
+ *        encoders, run at every step of the model.
+ *
+ * @param ns Model time since the last call.
+ */
+typedef void (*model_plant_t)(uint64_t ns);
+
+typedef struct {
+	int uart0_rx_fd;        // What the RN-41 sends to UART0, -1 for nothing
+	int uart0_tx_fd;        // What UART0 sends to the RN-41, -1 to drop it
+	int uart1_tx_fd;        // Telemetry capture from UART1, -1 to drop it
+	const char *flash;      // File holding the top flash sectors, NULL for erased
+	uint32_t battery_mv;    // Battery voltage at the ADC divider
+	uint32_t slowdown;      // Least host time per unit of model time asleep, 0 for none
+} model_options_t;
+
+// Exit status of a modeled reset
+#define MODEL_EXIT_RESET (3)
+
+/**
+ * @brief Map the registers and flash, and install the trap and interrupt
+ *        handlers. Call from the thread that will run the firmware.
+ *
+ * @param options Wiring of the model.
+ */
+void Model_Init(const model_options_t *options);
+
+/**
+ * @brief Start the hardware thread.
+ */
+void Model_Start(void);
+
+/**
+ * @brief Stop the run once some model time has passed: print the state as
+ *        Model_Dump() does on stdout and exit with EXIT_SUCCESS.
+ *
+ * @param ms Model time from now, in milliseconds.
+ */
+void Model_Exit_After(uint32_t ms);
+
+/**
+ * @brief Stop the firmware as a reset would, with the reason on stderr.
+ *
+ * @param reason What reset the part.
+ */
+void Model_Reset(const char *reason) __attribute__((noreturn));
+
+/**
+ * @brief Print the pin, PWM and interrupt state.
+ *
+ * @param out Stream to print to.
+ */
+void Model_Dump(FILE *out);
+
+/**
+ * @brief Read the output data register of a GPIO port.
+ *
+ * @param port Port number, 0 for A to 4 for E.
+ *
+ * @return PDOR of the port.
+ */
+uint32_t Model_Get_Pins(uint32_t port);
+
+/**
+ * @brief Read the CnV register of a TPM channel.
+ *
+ * @param tpm     TPM number.
+ * @param channel Channel number.
+ *
+ * @return CnV of the channel.
+ */
+uint32_t Model_Get_Cnv(uint32_t tpm, uint32_t channel);
+
+/**
+ * @brief Run a plant at every step of the model, with the model locked.
+ *
+ * The plant sees the outputs through Model_Get_Pins() and Model_Get_Cnv(),
+ * and drives the inputs through Model_Capture_Edge().
+ *
+ * @param step Plant to run, NULL for none.
+ */
+void Model_Set_Plant(model_plant_t step);
+
+/**
+ * @brief Edge on the input of a TPM channel, from a plant: the channel
+ *        latches CNT in CnV and sets CHF if it captures edges.
+ *
+ * @param tpm     TPM number.
+ * @param channel Channel number.
+ */
+void Model_Capture_Edge(uint32_t tpm, uint32_t channel);
+
+// PRIMASK and the exception state, for the CMSIS intrinsics in host.h and
+// the FreeRTOS port
+
+void Model_Disable_Irq(void);
+void Model_Enable_Irq(void);
+uint32_t Model_Get_Primask(void);
+void Model_Set_Primask(uint32_t primask);
+
+/**
+ * @brief Mask interrupts from a handler, for portSET_INTERRUPT_MASK_FROM_ISR().
+ *
+ * @return PRIMASK before.
+ */
+uint32_t Model_Set_Mask_From_Isr(void);
+
+/**
+ * @brief Get the number of the active exception, 0 in thread mode.
+ *
+ * @return IPSR.
+ */
+uint32_t Model_Get_Ipsr(void);
+
+/**
+ * @brief WFI: sleep until an interrupt is pending, in VLPS with SLEEPDEEP set.
+ */
+void Model_Wait_For_Interrupt(void);
+
+/**
+ * @brief Set PendSV pending; taken at once unless masked or in a handler.
+ */
+void Model_Pend_Sv(void);
+
+/**
+ * @brief Tell the model whether the task switched in is the idle task,
+ *        whose spin until the next tick the model steps through.
+ *
+ * @param idle True for the idle task.
+ */
+void Model_Set_Idle(bool idle);
+
+/**
+ * @brief Return to thread mode with interrupts enabled, for a task started
+ *        from PendSV.
+ */
+void Model_Start_Thread(void);
+
+#endif // KL25Z_MODEL_H
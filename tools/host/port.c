@@ -0,0 +1,172 @@
+/*******************************************************************************
+ * Copyright (C) 2023 by Suhas Srinivasa Reddy
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of embedded
+ * software. Suhas Srinivasa Reddy and the University of Colorado are not liable
+ * for any misuse of this material.
+ ******************************************************************************/
+
+/**
+ * @file    port.c
+ * @brief   FreeRTOS port of the host build, on the interrupt model of
+ *          kl25z_model.c.
+ *
+ * Works as the Cortex-M0 port does. Each task is a ucontext with a host
+ * stack of its own; its FreeRTOS stack holds only the index of that context
+ * (the host stack depth has nothing to do with the configured one). A yield
+ * pends PendSV, the tick is SysTick, and the PendSV handler switches tasks:
+ * the interrupt model runs it from the signal handler that stands in for
+ * exception entry, so a task is always switched out from there and resumes
+ * by returning from it. A new task starts in task_start() instead and
+ * leaves handler mode itself.
+ *
+ * The firmware runs on one host thread, the hardware thread of the model
+ * only raises interrupts: nothing here needs a lock.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MKL25Z4.h"
+
+#define HOST_STACK_BYTES (256 * 1024)
+#define MAX_THREADS      (32)
+#define IDLE_TASK_NAME   "IDLE"         // As prvIdleTask is created in tasks.c
+
+typedef struct {
+	ucontext_t context;
+	TaskFunction_t code;
+	void *parameters;
+	void *stack;
+} host_thread_t;
+
+extern void * volatile pxCurrentTCB;
+
+static host_thread_t *threads[MAX_THREADS];
+static volatile UBaseType_t critical_nesting = 0xaaaaaaaa;
+
+/*
+ * The first word of a TCB is its top of stack, where pxPortInitialiseStack()
+ * left the thread index.
+ */
+static host_thread_t *thread_of(void *tcb) {
+	return threads[**(StackType_t **) tcb];
+}
+
+/*
+ * Tell the model whether the idle task runs now, so that it steps through
+ * the spin of the idle task until the next tick.
+ */
+static void switched_in(void) {
+	Model_Set_Idle(strcmp(pcTaskGetName(NULL), IDLE_TASK_NAME) == 0);
+}
+
+static void task_start(void) {
+	host_thread_t *self = thread_of(pxCurrentTCB);
+
+	Model_Start_Thread();
+	self->code(self->parameters);
+	// A task must delete itself rather than return
+	configASSERT(0);
+}
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack, TaskFunction_t pxCode,
+		void *pvParameters) {
+	host_thread_t *thread;
+	uint32_t index, primask;
+
+	for (index = 0; index < MAX_THREADS && threads[index] != NULL; index++)
+		;
+	configASSERT(index < MAX_THREADS);
+	thread = calloc(1, sizeof(*thread));
+	configASSERT(thread != NULL);
+	thread->stack = malloc(HOST_STACK_BYTES);
+	configASSERT(thread->stack != NULL);
+	thread->code = pxCode;
+	thread->parameters = pvParameters;
+
+	// The context starts with the interrupt signal blocked, as the PendSV
+	// that switches to it; task_start() unblocks it
+	primask = Model_Get_Primask();
+	Model_Disable_Irq();
+	getcontext(&thread->context);
+	Model_Set_Primask(primask);
+	thread->context.uc_stack.ss_sp = thread->stack;
+	thread->context.uc_stack.ss_size = HOST_STACK_BYTES;
+	thread->context.uc_link = NULL;
+	makecontext(&thread->context, task_start, 0);
+	threads[index] = thread;
+
+	*--pxTopOfStack = index;
+	return pxTopOfStack;
+}
+
+void vPortCleanUpTCB(void *pxTCB) {
+	StackType_t index = **(StackType_t **) pxTCB;
+
+	free(threads[index]->stack);
+	free(threads[index]);
+	threads[index] = NULL;
+}
+
+BaseType_t xPortStartScheduler(void) {
+	// The tick, as prvSetupTimerInterrupt() of the Cortex-M0 port
+	SysTick->CTRL = 0;
+	SysTick->VAL = 0;
+	SysTick->LOAD = (configCPU_CLOCK_HZ / configTICK_RATE_HZ) - 1UL;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk
+			| SysTick_CTRL_ENABLE_Msk;
+
+	critical_nesting = 0;
+	switched_in();
+	setcontext(&thread_of(pxCurrentTCB)->context);
+	return 0;
+}
+
+void vPortEndScheduler(void) {
+	configASSERT(critical_nesting == 1000UL);
+}
+
+void vPortYield(void) {
+	Model_Pend_Sv();
+}
+
+void vPortEnterCritical(void) {
+	portDISABLE_INTERRUPTS();
+	critical_nesting++;
+}
+
+void vPortExitCritical(void) {
+	configASSERT(critical_nesting);
+	critical_nesting--;
+	if (critical_nesting == 0)
+		portENABLE_INTERRUPTS();
+}
+
+void xPortPendSVHandler(void) {
+	host_thread_t *from = thread_of(pxCurrentTCB);
+	host_thread_t *to;
+
+	vTaskSwitchContext();
+	to = thread_of(pxCurrentTCB);
+	switched_in();
+	if (to != from)
+		swapcontext(&from->context, &to->context);
+}
+
+void xPortSysTickHandler(void) {
+	uint32_t primask = Model_Set_Mask_From_Isr();
+
+	if (xTaskIncrementTick() != pdFALSE)
+		Model_Pend_Sv();
+	Model_Set_Primask(primask);
+}
+
+void vAssertCalled(const char *file, int line) {
+	fprintf(stderr, "assert failed: %s:%d\n", file, line);
+	abort();
+}
@@ -0,0 +1,71 @@
+// portmacro.h
+
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+/**
+ * @file    portmacro.h
+ * @brief   FreeRTOS port definitions of the host build, see port.c.
+ *
+ * The types are those of the Cortex-M0 port, but for pointers, which are 64
+ * bits on the host. Interrupt masking and PendSV go through the interrupt
+ * model of kl25z_model.h.
+ */
+
+#include <stdint.h>
+
+#define portCHAR		char
+#define portFLOAT		float
+#define portDOUBLE		double
+#define portLONG		long
+#define portSHORT		short
+#define portSTACK_TYPE	uint32_t
+#define portBASE_TYPE	long
+#define portPOINTER_SIZE_TYPE uintptr_t
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if (configUSE_16_BIT_TICKS == 1)
+	typedef uint16_t TickType_t;
+	#define portMAX_DELAY ((TickType_t) 0xffff)
+#else
+	typedef uint32_t TickType_t;
+	#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+	#define portTICK_TYPE_IS_ATOMIC 1
+#endif
+
+#define portSTACK_GROWTH			(-1)
+#define portTICK_PERIOD_MS			((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portBYTE_ALIGNMENT			8
+
+extern void vPortYield(void);
+#define portYIELD()					vPortYield()
+#define portEND_SWITCHING_ISR(xSwitchRequired) if (xSwitchRequired) Model_Pend_Sv()
+#define portYIELD_FROM_ISR(x)		portEND_SWITCHING_ISR(x)
+
+extern void vPortEnterCritical(void);
+extern void vPortExitCritical(void);
+
+#define portSET_INTERRUPT_MASK_FROM_ISR()		Model_Set_Mask_From_Isr()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)	Model_Set_Primask(x)
+#define portDISABLE_INTERRUPTS()				Model_Disable_Irq()
+#define portENABLE_INTERRUPTS()					Model_Enable_Irq()
+#define portENTER_CRITICAL()					vPortEnterCritical()
+#define portEXIT_CRITICAL()						vPortExitCritical()
+
+#define portTASK_FUNCTION_PROTO(vFunction, pvParameters) void vFunction(void *pvParameters)
+#define portTASK_FUNCTION(vFunction, pvParameters) void vFunction(void *pvParameters)
+
+#ifndef portSUPPRESS_TICKS_AND_SLEEP
+	extern void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime);
+	#define portSUPPRESS_TICKS_AND_SLEEP(xExpectedIdleTime) vPortSuppressTicksAndSleep(xExpectedIdleTime)
+#endif
+#define portNOP()
+
+// Each task runs on a host stack of its own, freed with the task
+extern void vPortCleanUpTCB(void *pxTCB);
+#define portCLEAN_UP_TCB(pxTCB)		vPortCleanUpTCB(pxTCB)
+
+#endif // PORTMACRO_H
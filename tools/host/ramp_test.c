@@ -0,0 +1,232 @@
+/*
+ * Host test of the soft-start ramp generator against a motor current model.
+ *
+ * Runs source/ramp.c and hbridge.c unchanged on the host build: the TPM0
+ * overflow interrupt moves the duty of both wheels once per 5 kHz period,
+ * and a plant in the model turns the TPM0 duty and the H-bridge inputs on
+ * PTB8-11 into motor current and speed.
+ *
+ * Each motor is a DC motor with the PWM on the enable input of its bridge:
+ * during the on-time it draws (V - back-EMF) / R from the battery, nothing
+ * in coast, and its speed follows the torque of that current with a 100 ms
+ * mechanical time constant. The inductance is left out; at 0.4 ms it
+ * settles within two PWM periods. The current of both motors is what the
+ * shared rail supplies.
+ *
+ * - Starts both wheels from rest to full duty as a step, as Start_Motors()
+ *   used to, then along the linear and S-curve profiles over 300 ms, and
+ *   checks that both profiles draw less than half the peak current of the
+ *   step.
+ * - Checks that the duty follows each profile within 1% of full scale.
+ * - Reverses both wheels at full speed, as a step and along the S-curve,
+ *   and checks that the inputs are released for the dead time first and
+ *   that the ramp draws less than half the peak current of the step, which
+ *   plugs the motors at nearly twice the stall current.
+ *
+ * Built and run by ctest, see CMakeLists.txt.
+ */
+#include <stdlib.h>
+#include <math.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MKL25Z4.h"
+#include "system_MKL25Z4.h"
+#include "sysclock.h"
+#include "board_pins.h"
+#include "config.h"
+#include "tpm.h"
+#include "ramp.h"
+#include "motor_control.h"
+#include "sim_check.h"
+
+#define VOLTS         (7.4)
+#define OHMS          (2.5)      // 3 A stall current at 7.4 V
+#define K_EMF         (0.02)     // V s/rad and N m/A
+#define INERTIA       (1.6e-5)   // kg m^2, 100 ms with R and K_EMF
+#define FRICTION      (4e-5)     // N m s/rad, coasts down in 0.4 s
+#define PROFILE_MS    (300)
+#define RUN_MS        (600)      // Time to reach full speed
+#define TOLERANCE     (TPM_PWM_PERIOD / 100)
+#define PERIOD_NS     (1000000000ULL / TPM_PWM_FREQUENCY)
+
+typedef struct {
+	uint32_t pwm_channel;      // TPM0, see ramp.c
+	uint32_t cw_pin;           // H-bridge inputs on PTB
+	uint32_t ccw_pin;
+	double omega;              // rad/s
+	double amps;
+	int dir;                   // Direction on the inputs, 0 in coast
+	uint64_t coast_ns;         // Time in coast before the inputs engaged
+	uint64_t changed_ns;       // When the inputs last changed
+} motor_t;
+
+static motor_t motors[2] = {
+	{ 5, BOARD_MASK(MOTORA_CW), BOARD_MASK(MOTORA_CCW) },
+	{ 0, BOARD_MASK(MOTORB_CW), BOARD_MASK(MOTORB_CCW) },
+};
+
+// Observations of the plant, reset by the tester
+static uint64_t now_ns;
+static volatile double peak_amps;          // Largest current from the rail
+static volatile double worst_shape;        // Largest duty error along a profile
+static volatile int shape_profile = -1;    // Profile checked, -1 for none
+static volatile bool at_rest;              // Stop both motors at the next step
+
+/*
+ * The profiles of ramp.c, exactly.
+ */
+static double expected_shape(double t) {
+	if (t >= 1.0)
+		return 1.0;
+	return shape_profile == RAMP_S_CURVE ? t * t * (3.0 - 2.0 * t) : t;
+}
+
+/*
+ * The motors, run by the model at every step.
+ */
+static void plant(uint64_t ns) {
+	uint32_t pins = Model_Get_Pins(1);
+	double duty, rail = 0.0, dt = ns / 1e9;
+	uint32_t cnv, i;
+	int dir;
+
+	now_ns += ns;
+	for (i = 0; i < 2; i++) {
+		motor_t *m = &motors[i];
+
+		if (at_rest)
+			m->omega = 0.0;
+		dir = (pins & m->cw_pin) ? 1 : (pins & m->ccw_pin) ? -1 : 0;
+		if (dir != m->dir) {
+			if (m->dir == 0)
+				m->coast_ns = now_ns - m->changed_ns;
+			m->changed_ns = now_ns;
+			m->dir = dir;
+		}
+
+		// Low-true PWM, see ramp.c
+		cnv = Model_Get_Cnv(0, m->pwm_channel);
+		duty = (dir != 0 && cnv < TPM_PWM_PERIOD) ?
+				(double) (TPM_PWM_PERIOD - cnv) / TPM_PWM_PERIOD : 0.0;
+		m->amps = duty * (dir * VOLTS - K_EMF * m->omega) / OHMS;
+		m->omega += (K_EMF * m->amps - FRICTION * m->omega) / INERTIA * dt;
+		rail += fabs(m->amps);
+
+		if (i == 0 && shape_profile >= 0 && dir != 0) {
+			double t = (now_ns - m->changed_ns) / (PROFILE_MS * 1e6);
+			double e = fabs(duty - expected_shape(t)) * TPM_PWM_PERIOD;
+
+			if (e > worst_shape)
+				worst_shape = e;
+		}
+	}
+	at_rest = false;
+	if (rail > peak_amps)
+		peak_amps = rail;
+}
+
+/*
+ * Change direction with a profile and return the peak rail current after.
+ */
+static double drive(hbridge_dir_t dir, ramp_profile_t profile, uint32_t ramp_ms) {
+	Ramp_Set_Profile(profile, ramp_ms);
+	peak_amps = 0.0;
+	worst_shape = 0.0;
+	shape_profile = ramp_ms > 0 ? (int) profile : -1;
+	Ramp_Set_Duty(RAMP_MOTOR_A, TPM_PWM_PERIOD);
+	Ramp_Set_Duty(RAMP_MOTOR_B, TPM_PWM_PERIOD);
+	Ramp_Set_Directions(dir, dir);
+	vTaskDelay(pdMS_TO_TICKS(RAMP_DEAD_TIME_MS + RUN_MS));
+	shape_profile = -1;
+	return peak_amps;
+}
+
+static void stop(void) {
+	Ramp_Set_Directions(HBRIDGE_COAST, HBRIDGE_COAST);
+	Ramp_Set_Duty(RAMP_MOTOR_A, 0);
+	Ramp_Set_Duty(RAMP_MOTOR_B, 0);
+	vTaskDelay(pdMS_TO_TICKS(RAMP_DEAD_TIME_MS));
+	at_rest = true;
+	vTaskDelay(pdMS_TO_TICKS(RAMP_DEAD_TIME_MS));
+}
+
+/*
+ * In whole PWM periods: the inputs change in the interrupt, whose latency
+ * varies by a few microseconds.
+ */
+static void check_reversal(const char *what) {
+	uint32_t i;
+
+	for (i = 0; i < 2; i++)
+		check_value(motors[i].coast_ns + PERIOD_NS / 2 >= RAMP_DEAD_TIME_MS * 1000000ULL,
+				what, (unsigned long) (motors[i].coast_ns / 1000));
+}
+
+static void start(void) {
+	double step, linear, s_curve;
+	double shape_linear, shape_s;
+
+	step = drive(HBRIDGE_CW, RAMP_LINEAR, 0);
+	stop();
+	linear = drive(HBRIDGE_CW, RAMP_LINEAR, PROFILE_MS);
+	shape_linear = worst_shape;
+	stop();
+	s_curve = drive(HBRIDGE_CW, RAMP_S_CURVE, PROFILE_MS);
+	shape_s = worst_shape;
+	stop();
+
+	printf("start from rest: peak %.2f A as a step, %.2f A linear, %.2f A S-curve\n",
+			step, linear, s_curve);
+	printf("duty along the profile: worst %.0f counts linear, %.0f S-curve\n",
+			shape_linear, shape_s);
+	check(step > 0.9 * 2 * VOLTS / OHMS, "step draws the stall current");
+	check(linear < step / 2, "linear start under half the step");
+	check(s_curve < step / 2, "S-curve start under half the step");
+	check_value(shape_linear <= TOLERANCE, "duty follows the linear profile",
+			(unsigned long) shape_linear);
+	check_value(shape_s <= TOLERANCE, "duty follows the S-curve",
+			(unsigned long) shape_s);
+}
+
+static void reverse(void) {
+	double step, s_curve;
+
+	drive(HBRIDGE_CW, RAMP_LINEAR, 0);
+	step = drive(HBRIDGE_CCW, RAMP_LINEAR, 0);
+	check_reversal("step reversal waits out the dead time");
+	stop();
+	drive(HBRIDGE_CW, RAMP_S_CURVE, PROFILE_MS);
+	s_curve = drive(HBRIDGE_CCW, RAMP_S_CURVE, PROFILE_MS);
+	check_reversal("S-curve reversal waits out the dead time");
+	stop();
+
+	printf("reversal at full speed: peak %.2f A as a step, %.2f A S-curve\n", step, s_curve);
+	check(step > 1.5 * 2 * VOLTS / OHMS, "step reversal plugs the motors");
+	check(s_curve < step / 2, "S-curve reversal under half the step");
+}
+
+static void tester(void *unused) {
+	(void) unused;
+	start();
+	reverse();
+	exit(sim_result());
+}
+
+int main(void) {
+	model_options_t options = { -1, -1, -1, NULL, 7400, 0 };
+
+	Model_Init(&options);
+	Model_Set_Plant(plant);
+	Model_Start();
+	SystemInit();
+	SIM->COPC = 0;    // No failsafe here to service the COP of a COP_WATCHDOG build
+	Init_Sysclock();
+	Init_Board_Pins();
+	Init_Config();
+	Init_TPM();
+	Init_Motors();
+	xTaskCreate(tester, "tester", configMINIMAL_STACK_SIZE * 2, NULL,
+			configMAX_PRIORITIES - 1, NULL);
+	vTaskStartScheduler();
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,197 @@
+/*
+ * Host test of closed-loop wheel speed control against DC motor models.
+ *
+ * Runs source/speed_control.c, ramp.c and control_math.c unchanged on the
+ * host build: TPM1 wakes the control task at 1 kHz, the PI controller sets
+ * the TPM0 duty through the ramp generator, and a plant in the model turns
+ * the duty and the H-bridge inputs into wheel speed and encoder edges on
+ * TPM1 CH0/CH1.
+ *
+ * Each motor is first order: its speed settles to the no-load speed of the
+ * supply voltage times the duty, with a 100 ms time constant. Motor B gives
+ * 15% less speed than motor A for the same duty, as a mismatched pair does.
+ *
+ * - Checks that both wheels settle within 5% of CRUISE_RPM, with motor B on
+ *   more duty, and that the measured speeds follow the wheels.
+ * - Drops the battery from 7.4 V to 6.0 V and checks that both wheels get
+ *   back within 5%.
+ * - Blocks wheel A for 1 s, long enough for an unclamped integral to ask for
+ *   twice full duty, and checks that it overshoots by less than 50% once
+ *   released and is back within 5% after 1.5 s, so the controller did not
+ *   wind up. Full duty would take it to 2.5 times CRUISE_RPM.
+ * - Sets both targets to 0 and checks that the wheels stop and the 1 kHz
+ *   interrupt is turned off.
+ *
+ * Built and run by ctest, see CMakeLists.txt.
+ */
+#include <stdlib.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "MKL25Z4.h"
+#include "system_MKL25Z4.h"
+#include "sysclock.h"
+#include "board_pins.h"
+#include "config.h"
+#include "tpm.h"
+#include "ramp.h"
+#include "motor_control.h"
+#include "speed_control.h"
+#include "sim_check.h"
+
+#define TAU_NS        (100e6)
+#define RPM_PER_VOLT_A (40.0)    // 296 RPM at 7.4 V and full duty
+#define RPM_PER_VOLT_B (34.0)
+#define SETTLE_MS     (2000)
+#define RECOVER_MS    (1500)
+#define BLOCK_MS      (1000)
+#define SAMPLE_MS     (10)
+#define TOLERANCE     (CRUISE_RPM / 20)
+
+typedef struct {
+	double rpm_per_volt;
+	uint32_t pwm_channel;      // TPM0, see ramp.c
+	uint32_t pins;             // H-bridge inputs on PTB
+	uint32_t encoder_channel;  // TPM1, see speed_control.h
+	volatile bool blocked;
+	volatile double rpm;
+	double pulses;
+} motor_t;
+
+static motor_t motors[2] = {
+	{ RPM_PER_VOLT_A, 5, BOARD_MASK(MOTORA_CW) | BOARD_MASK(MOTORA_CCW), 0 },
+	{ RPM_PER_VOLT_B, 0, BOARD_MASK(MOTORB_CW) | BOARD_MASK(MOTORB_CCW), 1 },
+};
+static volatile double volts = 7.4;
+
+/*
+ * The motors, run by the model at every step.
+ */
+static void plant(uint64_t ns) {
+	uint32_t pins = Model_Get_Pins(1);
+	uint32_t cnv, i;
+	double duty, target;
+
+	for (i = 0; i < 2; i++) {
+		motor_t *m = &motors[i];
+
+		// Low-true PWM, see ramp.c; no input high is coast
+		cnv = Model_Get_Cnv(0, m->pwm_channel);
+		duty = (cnv < TPM_PWM_PERIOD && (pins & m->pins)) ?
+				(double) (TPM_PWM_PERIOD - cnv) / TPM_PWM_PERIOD : 0.0;
+		target = m->blocked ? 0.0 : m->rpm_per_volt * volts * duty;
+		m->rpm += (target - m->rpm) * ((double) ns < TAU_NS ? ns / TAU_NS : 1.0);
+		m->pulses += m->rpm / 60.0 * ENCODER_PULSES_PER_REV * ns / 1e9;
+		while (m->pulses >= 1.0) {
+			m->pulses -= 1.0;
+			Model_Capture_Edge(1, m->encoder_channel);
+		}
+	}
+}
+
+/*
+ * Worst distance of each wheel from rpm over ms, and the highest speed.
+ */
+static void watch(uint32_t ms, double rpm, double error[2], double peak[2]) {
+	uint32_t t, i;
+	double e;
+
+	for (i = 0; i < 2; i++)
+		error[i] = peak[i] = 0.0;
+	for (t = 0; t < ms; t += SAMPLE_MS) {
+		vTaskDelay(pdMS_TO_TICKS(SAMPLE_MS));
+		for (i = 0; i < 2; i++) {
+			e = motors[i].rpm > rpm ? motors[i].rpm - rpm : rpm - motors[i].rpm;
+			if (e > error[i])
+				error[i] = e;
+			if (motors[i].rpm > peak[i])
+				peak[i] = motors[i].rpm;
+		}
+	}
+}
+
+static void settle(void) {
+	double error[2], peak[2];
+	uint16_t measured[2];
+	ramp_state_t a, b;
+	uint32_t i;
+
+	Ramp_Set_Directions(HBRIDGE_CW, HBRIDGE_CCW);
+	Speed_Control_Set_Target(CRUISE_RPM, CRUISE_RPM);
+	vTaskDelay(pdMS_TO_TICKS(SETTLE_MS - 500));
+	watch(500, CRUISE_RPM, error, peak);
+
+	Speed_Control_Get_Speed(&measured[0], &measured[1]);
+	Ramp_Get_State(RAMP_MOTOR_A, &a);
+	Ramp_Get_State(RAMP_MOTOR_B, &b);
+	printf("settled: A %.1f RPM (measured %u) at duty %u, B %.1f RPM (measured %u) at duty %u\n",
+			motors[0].rpm, measured[0], a.duty, motors[1].rpm, measured[1], b.duty);
+	for (i = 0; i < 2; i++) {
+		check_value(error[i] <= TOLERANCE, "wheel within 5% of the target", i);
+		check_value(abs((int) measured[i] - (int) (motors[i].rpm + 0.5)) <= TOLERANCE,
+				"measured speed follows the wheel", measured[i]);
+	}
+	check_value(b.duty > a.duty, "weaker motor B on more duty", b.duty);
+}
+
+static void battery_sag(void) {
+	double error[2], peak[2];
+	uint32_t i;
+
+	volts = 6.0;
+	vTaskDelay(pdMS_TO_TICKS(RECOVER_MS - 300));
+	watch(300, CRUISE_RPM, error, peak);
+	printf("at 6.0 V: A %.1f RPM, B %.1f RPM\n", motors[0].rpm, motors[1].rpm);
+	for (i = 0; i < 2; i++)
+		check_value(error[i] <= TOLERANCE, "wheel back within 5% after the sag", i);
+}
+
+static void block(void) {
+	double error[2], peak[2];
+
+	motors[0].blocked = true;
+	vTaskDelay(pdMS_TO_TICKS(BLOCK_MS));
+	motors[0].blocked = false;
+	watch(RECOVER_MS, CRUISE_RPM, error, peak);
+	printf("released after %u ms: A peaks at %.1f RPM\n", BLOCK_MS, peak[0]);
+	check_value(peak[0] <= CRUISE_RPM * 1.5, "no windup while blocked", (unsigned long) peak[0]);
+	watch(500, CRUISE_RPM, error, peak);
+	check_value(error[0] <= TOLERANCE, "wheel A back within 5%", (unsigned long) error[0]);
+}
+
+static void stop(void) {
+	Speed_Control_Set_Target(0, 0);
+	vTaskDelay(pdMS_TO_TICKS(1000));
+	printf("stopped: A %.1f RPM, B %.1f RPM\n", motors[0].rpm, motors[1].rpm);
+	check(motors[0].rpm < 1.0 && motors[1].rpm < 1.0, "wheels stopped");
+	check(!(TPM1->SC & TPM_SC_TOIE_MASK), "1 kHz interrupt off");
+}
+
+static void tester(void *unused) {
+	(void) unused;
+	settle();
+	battery_sag();
+	block();
+	stop();
+	exit(sim_result());
+}
+
+int main(void) {
+	model_options_t options = { -1, -1, -1, NULL, 7400, 0 };
+
+	Model_Init(&options);
+	Model_Set_Plant(plant);
+	Model_Start();
+	SystemInit();
+	SIM->COPC = 0;    // No failsafe here to service the COP of a COP_WATCHDOG build
+	Init_Sysclock();
+	Init_Board_Pins();
+	Init_Config();
+	Init_TPM();
+	Init_Motors();
+	Init_Speed_Control(configMAX_PRIORITIES - 2);
+	Speed_Control_Enable(true);
+	xTaskCreate(tester, "tester", configMINIMAL_STACK_SIZE * 2, NULL,
+			configMAX_PRIORITIES - 1, NULL);
+	vTaskStartScheduler();
+	return EXIT_FAILURE;
+}
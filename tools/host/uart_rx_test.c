@@ -0,0 +1,118 @@
+/*
+ * Host test of the UART0 receive path.
+ *
+ * Runs source/uart.c and source/cbfifo.c unchanged on the host build: the
+ * model shifts a byte stream into UART0 back to back at the configured
+ * 115200 baud, the UART0 ISR moves each byte into the receive FIFO, and a
+ * top-priority task reads them with UART0_Receive() as task_poll_BT does.
+ * The bytes count up modulo 256, so a lost byte shows as a gap. The stream
+ * and the reader's sleeps are in model time, so the run is the same
+ * whatever else the host runs.
+ *
+ * - Checks that every byte arrives, in order, while the reader takes them
+ *   as they come and while it sleeps up to 4 ms between reads (46 bytes at
+ *   115200 baud, the receive FIFO holds 64).
+ * - Checks that no receive error is counted while nothing is lost.
+ * - Stalls the reader for 10 ms once (115 bytes) and checks that the bytes
+ *   lost to the full FIFO are exactly the ones counted as dropped.
+ *
+ * Built and run by ctest, see CMakeLists.txt.
+ */
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "system_MKL25Z4.h"
+#include "sysclock.h"
+#include "config.h"
+#include "power.h"
+#include "uart.h"
+#include "sim_check.h"
+
+#define BYTES        (1500)     // 130 ms at 115200 baud
+#define STALL_AT     (1000)     // Reader stalls once past this byte
+#define STALL_MS     (10)
+#define MAX_SLEEP_MS (4)
+#define CHUNK        (64)       // The whole receive FIFO
+#define IDLE_MS      (50)       // Stream over once nothing arrives for this long
+
+/*
+ * The stream the RN-41 sends, in a file the model reads at the baud rate.
+ */
+static int stream(void) {
+	uint8_t bytes[BYTES];
+	int fd = memfd_create("uart_rx_test", 0);
+	uint32_t i;
+
+	for (i = 0; i < BYTES; i++)
+		bytes[i] = (uint8_t) i;
+	if (fd < 0 || write(fd, bytes, sizeof(bytes)) != (ssize_t) sizeof(bytes)) {
+		perror("stream");
+		exit(EXIT_FAILURE);
+	}
+	lseek(fd, 0, SEEK_SET);
+	return fd;
+}
+
+static void reader(void *unused) {
+	uint8_t rx[CHUNK];
+	uint8_t expected = 0;
+	uint32_t received = 0, lost = 0, gaps = 0, first_gap = 0;
+	uint32_t i, gap;
+	bool stalled = false;
+	uart_rx_stats_t stats;
+	size_t len;
+
+	(void) unused;
+	// The stream starts with the receiver, once the scheduler runs
+	Init_UART0();
+	while ((len = UART0_Receive(rx, sizeof(rx), pdMS_TO_TICKS(IDLE_MS))) != 0) {
+		for (i = 0; i < len; i++) {
+			gap = (uint8_t) (rx[i] - expected);
+			if (gap != 0) {
+				if (gaps++ == 0)
+					first_gap = received;
+				lost += gap;
+			}
+			expected = rx[i] + 1;
+			received++;
+		}
+		if (!stalled && received >= STALL_AT) {
+			stalled = true;
+			vTaskDelay(pdMS_TO_TICKS(STALL_MS));
+		} else if (received > BYTES / 3) {
+			// Second third and on: let the FIFO fill between reads
+			vTaskDelay(pdMS_TO_TICKS(rand() % (MAX_SLEEP_MS + 1)));
+		}
+	}
+	UART0_Get_Rx_Stats(&stats);
+
+	printf("%lu bytes received, %lu lost in %lu gaps, %lu dropped\n",
+			(unsigned long) received, (unsigned long) lost, (unsigned long) gaps,
+			(unsigned long) stats.dropped);
+	check(received + lost == BYTES, "every byte received or lost");
+	check_value(gaps == 0 || first_gap >= STALL_AT, "no byte lost before the stall", first_gap);
+	check_value(lost > 0 && gaps == 1, "the stall loses one run of bytes", gaps);
+	check_value(stats.dropped == lost, "lost bytes counted as dropped", stats.dropped);
+	check_value(stats.overrun == 0, "no overrun", stats.overrun);
+	check_value(stats.framing == 0 && stats.noise == 0 && stats.parity == 0,
+			"no framing, noise or parity error",
+			stats.framing + stats.noise + stats.parity);
+	exit(sim_result());
+}
+
+int main(void) {
+	model_options_t options = { stream(), -1, -1, NULL, 7400, 0 };
+
+	Model_Init(&options);
+	Model_Start();
+	SystemInit();
+	Init_Sysclock();
+	Init_Config();
+	Init_Power();
+	xTaskCreate(reader, "reader", configMINIMAL_STACK_SIZE * 2, NULL,
+			configMAX_PRIORITIES - 1, NULL);
+	vTaskStartScheduler();
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,200 @@
+/*
+ * Host test of the UART0 transmit queue.
+ *
+ * Runs source/uart.c and source/cbfifo.c unchanged on the host build, with
+ * what UART0 shifts out captured at 115200 baud. Times are read with
+ * Latency_Now(), the firmware's own core-cycle timestamps, in model time:
+ * they count the register accesses and exceptions at the fixed cost of the
+ * model, not Cortex-M0+ cycles, so only the order of magnitude carries over
+ * to the part.
+ *
+ * - Measures how long UART0_Transmit_String() takes to queue a 24-byte
+ *   status line (2.1 ms on the wire) and checks that it returns within the
+ *   time of one byte on the wire.
+ * - Checks that the lines go out whole and in order.
+ * - Queues 200 then 100 bytes at once into the 256-byte FIFO and checks
+ *   that drop-newest sends the 200 and the first 56, drop-oldest the last
+ *   56 of the 200 and the 100, and that the 44 bytes left out are counted.
+ * - Checks that drop-oldest keeps the last 256 bytes of a 300-byte message.
+ *
+ * Built and run by ctest, see CMakeLists.txt.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "system_MKL25Z4.h"
+#include "sysclock.h"
+#include "config.h"
+#include "power.h"
+#include "latency.h"
+#include "uart.h"
+#include "sim_check.h"
+
+#define LINES        (40)
+#define LINE         "speed,+100,+100,ramp,0\n\r"
+#define FIFO_BYTES   (256)      // TX_FIFO_SIZE of uart.c
+#define FIRST        (200)
+#define SECOND       (100)
+#define OVERSIZED    (300)
+#define BYTE_CYCLES  (LATENCY_HZ / 11520)   // 10 bits at 115200 baud
+#define CYCLES_PER_US (LATENCY_HZ / 1000000)
+#define CAPTURE      (8192)
+#define OVERHEAD_SAMPLES (16)
+
+static int capture_fd;
+static uint8_t expected[CAPTURE];
+static size_t expected_len;
+
+static void expect(const uint8_t *bytes, size_t len) {
+	memcpy(&expected[expected_len], bytes, len);
+	expected_len += len;
+}
+
+/*
+ * Wait until the FIFO and the shift register are empty.
+ */
+static void drain(void) {
+	while (UART0_Tx_Pending() != 0)
+		vTaskDelay(1);
+	vTaskDelay(2);
+}
+
+static int by_value(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Cost of the timestamps themselves: the least of several pairs, as one
+ * may be held up.
+ */
+static uint32_t timestamp_overhead(void) {
+	uint32_t least = UINT32_MAX, start, cycles, i;
+
+	for (i = 0; i < OVERHEAD_SAMPLES; i++) {
+		start = Latency_Now();
+		cycles = Latency_Now() - start;
+		if (cycles < least)
+			least = cycles;
+	}
+	return least;
+}
+
+static void enqueue_latency(void) {
+	static uint32_t cycles[LINES];
+	uint32_t overhead = timestamp_overhead();
+	uint32_t start, elapsed, i, p50, max;
+
+	for (i = 0; i < LINES; i++) {
+		start = Latency_Now();
+		UART0_Transmit_String(LINE);
+		elapsed = Latency_Now() - start;
+		cycles[i] = (elapsed > overhead) ? elapsed - overhead : 0;
+		expect((const uint8_t *) LINE, strlen(LINE));
+		drain();
+	}
+	qsort(cycles, LINES, sizeof(cycles[0]), by_value);
+	p50 = cycles[LINES / 2];
+	max = cycles[LINES - 1];
+	printf("enqueue of %u bytes: p50 %lu cycles (%lu us), max %lu cycles (%lu us),"
+			" %lu us on the wire\n", (unsigned) strlen(LINE),
+			(unsigned long) p50, (unsigned long) (p50 / CYCLES_PER_US),
+			(unsigned long) max, (unsigned long) (max / CYCLES_PER_US),
+			(unsigned long) (strlen(LINE) * BYTE_CYCLES / CYCLES_PER_US));
+	check_value(max < BYTE_CYCLES, "enqueue within one byte time", max);
+}
+
+/*
+ * Queue two messages with the transmitter held off, so that the second
+ * overflows the FIFO.
+ */
+static void overflow(uart_tx_policy_t policy) {
+	static uint8_t first[FIRST], second[SECOND];
+	uint32_t dropped = UART0_Get_Tx_Dropped();
+	size_t kept = FIFO_BYTES - FIRST;
+	uint32_t i;
+
+	for (i = 0; i < FIRST; i++)
+		first[i] = (uint8_t) ('a' + i % 26);
+	for (i = 0; i < SECOND; i++)
+		second[i] = (uint8_t) ('0' + i % 10);
+	UART0_Set_Tx_Policy(policy);
+	taskENTER_CRITICAL();
+	check(UART0_Transmit(first, FIRST) == FIRST, "first message queued whole");
+	check_value(UART0_Transmit(second, SECOND)
+			== (policy == UART_TX_DROP_OLDEST ? SECOND : kept),
+			"second message queued as the policy allows", policy);
+	taskEXIT_CRITICAL();
+	if (policy == UART_TX_DROP_OLDEST) {
+		expect(&first[SECOND - kept], FIRST - (SECOND - kept));
+		expect(second, SECOND);
+	} else {
+		expect(first, FIRST);
+		expect(second, kept);
+	}
+	check_value(UART0_Get_Tx_Dropped() - dropped == SECOND - kept,
+			"overflow counted as dropped", UART0_Get_Tx_Dropped() - dropped);
+	drain();
+}
+
+static void oversized(void) {
+	static uint8_t message[OVERSIZED];
+	uint32_t dropped = UART0_Get_Tx_Dropped();
+	uint32_t i;
+
+	for (i = 0; i < OVERSIZED; i++)
+		message[i] = (uint8_t) i;
+	UART0_Set_Tx_Policy(UART_TX_DROP_OLDEST);
+	taskENTER_CRITICAL();
+	check(UART0_Transmit(message, OVERSIZED) == FIFO_BYTES, "oversized message queued in part");
+	taskEXIT_CRITICAL();
+	expect(&message[OVERSIZED - FIFO_BYTES], FIFO_BYTES);
+	check_value(UART0_Get_Tx_Dropped() - dropped == OVERSIZED - FIFO_BYTES,
+			"head of an oversized message counted as dropped",
+			UART0_Get_Tx_Dropped() - dropped);
+	drain();
+}
+
+static void tester(void *unused) {
+	static uint8_t sent[CAPTURE];
+	ssize_t len;
+	size_t i;
+
+	(void) unused;
+	Init_UART0();
+	enqueue_latency();
+	overflow(UART_TX_DROP_NEWEST);
+	overflow(UART_TX_DROP_OLDEST);
+	oversized();
+
+	len = pread(capture_fd, sent, sizeof(sent), 0);
+	check_value(len == (ssize_t) expected_len, "every queued byte sent", (unsigned long) len);
+	for (i = 0; i < expected_len && i < (size_t) len; i++) {
+		if (sent[i] != expected[i]) {
+			check_value(0, "bytes sent in order", i);
+			break;
+		}
+	}
+	exit(sim_result());
+}
+
+int main(void) {
+	model_options_t options = { -1, -1, -1, NULL, 7400, 0 };
+
+	capture_fd = memfd_create("uart_tx_test", 0);
+	options.uart0_tx_fd = capture_fd;
+	Model_Init(&options);
+	Model_Start();
+	SystemInit();
+	Init_Sysclock();
+	Init_Config();
+	Init_Power();
+	xTaskCreate(tester, "tester", configMINIMAL_STACK_SIZE * 2, NULL,
+			configMAX_PRIORITIES - 1, NULL);
+	vTaskStartScheduler();
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,148 @@
+/*
+ * Golden-output test of the LED effects engine.
+ *
+ * Runs source/led_effects.c unchanged and prints the red, green and blue
+ * compare values it generates, frame by frame, for the solid colors used by
+ * the commands and for one and a half cycles of every status effect. The
+ * default intensities of config.c are used. The output is compared with
+ * tools/led_effects_golden.txt.
+ *
+ * It also checks that
+ * - no compare value exceeds its channel's intensity;
+ * - full white gives exactly the intensities and black gives zero;
+ * - a breathe ramp rises and falls monotonically.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o led_effects_sim \
+ *         tools/led_effects_sim.c "WheelsOnTheGo(BTEdition)/source/led_effects.c"
+ *     ./led_effects_sim tools/led_effects_golden.txt
+ * After an intended change, regenerate the golden file with
+ *     ./led_effects_sim --update tools/led_effects_golden.txt
+ */
+#include <stdio.h>
+#include <string.h>
+#include "led_effects.h"
+#include "sim_check.h"
+
+#define MAX_OUTPUT (64 * 1024)
+
+static const uint32_t intensity[LED_CHANNELS] = { 625, 1200, 1200 };
+
+// Colors of motor_control.c and main.c
+static const uint32_t colors[] = {
+	0x000000, 0xFFFFFF, 0x888888, 0xFF00, 0xFF0000, 0xFFFF00, 0xFFFF
+};
+
+static char output[MAX_OUTPUT];
+static size_t used;
+
+static void emit(const char *line) {
+	size_t len = strlen(line);
+
+	if (used + len < MAX_OUTPUT) {
+		memcpy(output + used, line, len);
+		used += len;
+	}
+}
+
+static void run(const char *name, const led_effect_t *effect, uint32_t frames) {
+	led_engine_t engine;
+	uint16_t cnv[LED_CHANNELS];
+	uint32_t frame, channel, last = 0;
+	int rising = 1;
+	char line[64];
+
+	snprintf(line, sizeof(line), "# %s\n", name);
+	emit(line);
+	Led_Engine_Start(&engine, effect, intensity);
+	for (frame = 0; frame < frames; frame++) {
+		Led_Engine_Step(&engine, cnv);
+		for (channel = 0; channel < LED_CHANNELS; channel++)
+			check(cnv[channel] <= intensity[channel], "compare value within intensity");
+
+		if (effect->mode == LED_BREATHE) {
+			// Red channel of a red breathe
+			if (frame % effect->slot_frames == 0 && frame != 0)
+				rising = !rising;
+			else if (frame != 0)
+				check(rising ? cnv[0] >= last : cnv[0] <= last, "breathe ramps monotonically");
+			last = cnv[0];
+		}
+
+		snprintf(line, sizeof(line), "%u %u %u %u\n", (unsigned) frame,
+				(unsigned) cnv[0], (unsigned) cnv[1], (unsigned) cnv[2]);
+		emit(line);
+	}
+}
+
+static void generate(void) {
+	led_effect_t solid = { LED_SOLID, 0, 1, 1, 0 };
+	const led_effect_t *effect;
+	led_engine_t engine;
+	uint16_t cnv[LED_CHANNELS];
+	char name[32];
+	unsigned i;
+
+	for (i = 0; i < sizeof(colors) / sizeof(colors[0]); i++) {
+		solid.color = colors[i];
+		snprintf(name, sizeof(name), "solid %06X", (unsigned) colors[i]);
+		run(name, &solid, 1);
+	}
+
+	solid.color = 0xFFFFFF;
+	Led_Engine_Start(&engine, &solid, intensity);
+	Led_Engine_Step(&engine, cnv);
+	check(cnv[0] == intensity[0] && cnv[1] == intensity[1] && cnv[2] == intensity[2],
+			"white is full intensity");
+	solid.color = 0;
+	Led_Engine_Start(&engine, &solid, intensity);
+	Led_Engine_Step(&engine, cnv);
+	check(cnv[0] == 0 && cnv[1] == 0 && cnv[2] == 0, "black is off");
+
+	for (i = LED_STATUS_NONE + 1; i < LED_STATUSES; i++) {
+		effect = Led_Status_Effect((led_status_t) i);
+		snprintf(name, sizeof(name), "status %u", i);
+		// A breathe cycle is two ramps, a pattern cycle is all of its slots
+		run(name, effect, effect->slot_frames
+				* (effect->mode == LED_BREATHE ? 3 : effect->slots * 3 / 2));
+	}
+}
+
+int main(int argc, char **argv) {
+	static char golden[MAX_OUTPUT];
+	const char *path;
+	size_t len;
+	FILE *file;
+	int update;
+
+	update = (argc == 3 && strcmp(argv[1], "--update") == 0);
+	if (argc != 2 && !update) {
+		printf("usage: %s [--update] golden.txt\n", argv[0]);
+		return 2;
+	}
+	path = argv[argc - 1];
+	generate();
+
+	if (update) {
+		file = fopen(path, "w");
+		if (file == NULL || fwrite(output, 1, used, file) != used) {
+			printf("cannot write %s\n", path);
+			return 2;
+		}
+		fclose(file);
+		printf("wrote %lu bytes to %s\n", (unsigned long) used, path);
+	} else {
+		file = fopen(path, "r");
+		if (file == NULL) {
+			printf("cannot read %s\n", path);
+			return 2;
+		}
+		len = fread(golden, 1, sizeof(golden), file);
+		fclose(file);
+		check(len == used && memcmp(golden, output, used) == 0,
+				"compare values match the golden file");
+		printf("%lu bytes of compare values checked\n", (unsigned long) used);
+	}
+
+	return sim_result();
+}
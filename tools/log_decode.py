@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Turn the tokenized log frames sent by the robot back into text.
+
+Picks the FRAME_LOG frames out of the byte stream (see source/log.h and
+source/log_codec.h) and prints one line per record with its time since boot
+and level. Other frames and text on the link are skipped. The dictionary is
+the log_dict.json written by the firmware build, or is read straight from
+log.h. It must come from the firmware that is running.
+
+Frames carry only the low 16 bits of the tick, so the time printed is since
+boot modulo 65.536 s as of the first record seen; the time between records
+is exact as long as the link never goes quiet for more than half that.
+
+Usage:
+    stty -F /dev/rfcomm0 115200 raw && log_decode.py /dev/rfcomm0 log_dict.json
+    log_decode.py capture.bin WheelsOnTheGo(BTEdition)/source/log.h
+"""
+
+import json
+import sys
+
+from profile_decode import frames
+from log_dict import load
+
+FRAME_LOG = 0x89
+HEADER = 2
+VARINT_MAX = 5
+
+
+def varint(data, pos):
+    """Return (value, next position), or (None, pos) if truncated."""
+    value = 0
+    for n in range(VARINT_MAX):
+        if pos + n >= len(data):
+            break
+        value |= (data[pos + n] & 0x7F) << (7 * n)
+        if not data[pos + n] & 0x80:
+            return value, pos + n + 1
+    return None, pos
+
+
+def records(data, messages):
+    """Yield (tick, message, args) for the records of a FRAME_LOG payload.
+
+    The tick is the low 16 bits of the boot tick plus the deltas.
+    """
+    if len(data) < HEADER:
+        return
+    tick = data[0] | (data[1] << 8)
+    pos = HEADER
+    while pos < len(data):
+        if data[pos] >= len(messages):
+            print("unknown log id %u, wrong dictionary?" % data[pos], file=sys.stderr)
+            return
+        message = messages[data[pos]]
+        delta, pos = varint(data, pos + 1)
+        if delta is None:
+            return
+        tick += delta
+        args = []
+        for _ in range(message["nargs"]):
+            value, pos = varint(data, pos)
+            if value is None:
+                return
+            args.append((value >> 1) ^ -(value & 1))
+        yield tick, message, args
+
+
+def render(message, args, messages):
+    """Format a record, printing %s arguments as message names."""
+    values = []
+    for arg, spec in zip(args, message["format"].split("%")[1:]):
+        if spec.lstrip("-+ #0123456789").startswith("s"):
+            values.append(messages[arg]["name"] if 0 <= arg < len(messages) else str(arg))
+        elif spec.lstrip("-+ #0123456789")[:1] in "uxX":
+            values.append(arg & 0xFFFFFFFF)
+        else:
+            values.append(arg)
+    return message["format"] % tuple(values)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    if sys.argv[2].endswith(".json"):
+        with open(sys.argv[2]) as dictionary:
+            messages = json.load(dictionary)["messages"]
+    else:
+        messages = load(sys.argv[2])
+
+    base = None        # Boot tick of the last record, for unwrapping
+    with open(sys.argv[1], "rb", buffering=0) as stream:
+        for kind, data in frames(stream):
+            if kind != FRAME_LOG:
+                continue
+            for tick, message, args in records(data, messages):
+                # The frame header only has the low 16 bits of the tick
+                if base is None:
+                    base = tick
+                else:
+                    step = (tick - base) & 0xFFFF
+                    base += step - 0x10000 if step >= 0x8000 else step
+                print("[%10.3f] %-5s %s" % (base / 1000.0, message["level"],
+                                            render(message, args, messages)))
+                sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
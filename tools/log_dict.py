@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Extract the tokenized log dictionary from source/log.h.
+
+Reads the LOG_MESSAGES table (see source/log.h) and writes it as JSON for
+log_decode.py: one entry per message id, in table order, with its name,
+level, argument count and format. The firmware project runs this as a
+post-build step, so log_dict.json sits next to the .axf it belongs to.
+
+Also reports the link bytes each message takes against sending it as
+text with a "\\n\\r" ending, sent alone in a frame and packed several to
+a frame. Each argument is assumed to print as 3 characters and to encode
+as a 2-byte varint.
+
+The flash cost is not estimated from the table: most messages never
+existed as strings (the motor ones held about 95 bytes of text), and the
+log task's code and stack count against it. With --size, the script
+compares the arm-none-eabi-size output of two builds instead, e.g. of the
+.axf before and after a logging change.
+
+Usage:
+    log_dict.py WheelsOnTheGo(BTEdition)/source/log.h log_dict.json
+    log_dict.py WheelsOnTheGo(BTEdition)/source/log.h
+    log_dict.py --size before.axf after.axf
+"""
+
+import json
+import re
+import subprocess
+import sys
+
+LEVELS = ["DEBUG", "INFO", "WARN", "ERROR"]
+FRAME_OVERHEAD = 5       # SYNC, LEN, SEQ, TYPE, CRC
+PAYLOAD = 15             # PROTOCOL_MAX_PAYLOAD - 1
+HEADER = 2               # LOG_CODEC_HEADER
+ARG_TEXT = 3
+ARG_BYTES = 2
+
+ENTRY = re.compile(r'X\(\s*(\w+)\s*,\s*(\w+)\s*,\s*(\d+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+SPEC = re.compile(r"%[-+ #0]*\d*[duxXcs]")
+
+
+def load(path):
+    """Return the message table of log.h as a list of dicts, by id."""
+    with open(path) as header:
+        text = header.read()
+    start = text.find("#define LOG_MESSAGES(X)")
+    if start < 0:
+        sys.exit("%s: no LOG_MESSAGES table" % path)
+    # The table ends at the first line without a continuation
+    lines = []
+    for line in text[start:].splitlines():
+        lines.append(line)
+        if not line.rstrip().endswith("\\"):
+            break
+    messages = []
+    for name, level, nargs, fmt in ENTRY.findall("\n".join(lines)):
+        fmt = bytes(fmt, "ascii").decode("unicode_escape")
+        if level not in LEVELS:
+            sys.exit("%s: %s has unknown level %s" % (path, name, level))
+        if len(SPEC.findall(fmt)) != int(nargs):
+            sys.exit("%s: %s format does not take %s arguments" % (path, name, nargs))
+        messages.append({"id": len(messages), "name": name, "level": level,
+                         "nargs": int(nargs), "format": fmt})
+    if not messages or len(messages) > 256:
+        sys.exit("%s: expected 1 to 256 messages, found %u" % (path, len(messages)))
+    return messages
+
+
+def size(path):
+    """Return (text, data, bss) of an image, from arm-none-eabi-size."""
+    try:
+        out = subprocess.run(["arm-none-eabi-size", path], check=True,
+                             stdout=subprocess.PIPE, universal_newlines=True).stdout
+    except (OSError, subprocess.CalledProcessError) as error:
+        sys.exit("arm-none-eabi-size %s: %s" % (path, error))
+    return tuple(int(field) for field in out.splitlines()[1].split()[:3])
+
+
+def compare(before, after):
+    old, new = size(before), size(after)
+    print("%-6s %8s %8s %8s" % ("", "before", "after", "delta"))
+    for name, a, b in zip(("text", "data", "bss"), old, new):
+        print("%-6s %8u %8u %+8d" % (name, a, b, b - a))
+    print("flash (text + data) %+d bytes, RAM (data + bss) %+d bytes"
+          % (new[0] + new[1] - old[0] - old[1], new[1] + new[2] - old[1] - old[2]))
+
+
+def report(messages):
+    print("%-16s %5s %7s %7s %6s" % ("message", "text", "alone", "packed", "saved"))
+    total_text = total_packed = 0
+    for m in messages:
+        text = len(SPEC.sub("x" * ARG_TEXT, m["format"])) + len("\n\r")
+        record = 1 + 1 + ARG_BYTES * m["nargs"]
+        alone = FRAME_OVERHEAD + HEADER + record
+        packed = record * (FRAME_OVERHEAD + PAYLOAD) / float(PAYLOAD - HEADER)
+        total_text += text
+        total_packed += packed
+        print("%-16s %5u %7u %7.1f %5.0f%%" % (m["name"][4:], text, alone, packed,
+                                             100.0 * (1 - packed / text)))
+    print("link: %.0f%% fewer bytes for one of each message, packed"
+          % (100.0 * (1 - total_packed / total_text)))
+
+
+def main():
+    if len(sys.argv) == 4 and sys.argv[1] == "--size":
+        compare(sys.argv[2], sys.argv[3])
+        return
+    if len(sys.argv) not in (2, 3):
+        sys.exit(__doc__)
+    messages = load(sys.argv[1])
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], "w") as out:
+            json.dump({"messages": messages}, out, indent=1)
+    report(messages)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,256 @@
+/*
+ * Host model of the tokenized log encoding.
+ *
+ * Runs source/log_codec.c unchanged, packing records into FRAME_LOG
+ * payloads the way the log task does.
+ *
+ * - Round-trips random records through whole payloads: every id of the
+ *   LOG_MESSAGES table with its argument count, arguments from small to
+ *   INT32_MIN/INT32_MAX, and tick gaps up to a minute. Checks every field
+ *   comes back, no payload exceeds the frame and no record is split, and
+ *   that the only records dropped, as drain() drops them, are those too
+ *   wide for any frame.
+ * - Checks the record sizes the savings in log.h rely on: 2 bytes for a
+ *   record without arguments within 127 ms of the previous one, 1 byte per
+ *   small argument of either sign, at most LOG_CODEC_MAX_RECORD bytes.
+ * - Checks that truncated records, unknown ids and over-long varints are
+ *   rejected rather than misread.
+ * - With a file argument, also writes a capture of FRAME_LOG frames for
+ *   tools/log_decode.py and prints the lines it should show.
+ *
+ * Build and run from the repository root:
+ *     cc -std=gnu99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o log_sim \
+ *         tools/log_sim.c "WheelsOnTheGo(BTEdition)/source/log_codec.c" \
+ *         "WheelsOnTheGo(BTEdition)/source/protocol.c"
+ *     ./log_sim [capture.bin]
+ *     python3 tools/log_decode.py capture.bin \
+ *         "WheelsOnTheGo(BTEdition)/source/log.h"
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "protocol.h"
+#include "sim_check.h"
+
+#define PAYLOAD       (PROTOCOL_MAX_PAYLOAD - 1)
+#define RECORDS       (20000)
+
+#define MESSAGE_NARGS(id, level, nargs, format) [id] = (nargs),
+static const uint8_t nargs[LOG_MESSAGE_COUNT] = { LOG_MESSAGES(MESSAGE_NARGS) };
+
+static log_record_t sent[RECORDS];
+
+static int32_t random_arg(void) {
+	static const int32_t edges[] = { 0, 1, -1, 63, -64, 64, -65, INT32_MAX,
+			INT32_MIN, 127, -128 };
+
+	switch (rand() % 4) {
+	case 0:
+		return edges[rand() % (sizeof(edges) / sizeof(edges[0]))];
+	case 1:
+		return (int32_t) ((uint32_t) rand() << 16 ^ (uint32_t) rand());
+	default:
+		return rand() % 256 - 128;
+	}
+}
+
+static void make_record(log_record_t *rec, uint32_t *tick) {
+	uint32_t i;
+
+	// Mostly close together, sometimes far apart
+	*tick += (rand() % 8 == 0) ? (uint32_t) (rand() % 60000) : (uint32_t) (rand() % 50);
+	rec->id = (uint8_t) (rand() % LOG_MESSAGE_COUNT);
+	rec->nargs = nargs[rec->id];
+	rec->tick = *tick;
+	for (i = 0; i < LOG_MAX_ARGS; i++)
+		rec->args[i] = (i < rec->nargs) ? random_arg() : 0;
+}
+
+/*
+ * Pack records from first on into one payload, as drain() in log.c does.
+ * Returns the number of records packed.
+ */
+static uint32_t pack(const log_record_t *first, uint32_t count, uint8_t *payload,
+		uint32_t *len) {
+	uint32_t prev = first->tick;
+	uint32_t packed = 0;
+	size_t used;
+
+	*len = Log_Codec_Header(payload, first->tick);
+	while (packed < count) {
+		used = Log_Codec_Put(&payload[*len], PAYLOAD - *len, prev, &first[packed]);
+		if (used == 0)
+			break;
+		*len += used;
+		prev = first[packed].tick;
+		packed++;
+	}
+	return packed;
+}
+
+static void round_trip(void) {
+	uint8_t payload[PAYLOAD];
+	log_record_t got;
+	uint32_t tick = 0xFFFF0000UL;     // Wraps on the way
+	uint32_t done = 0;
+	uint32_t frames = 0;
+	uint32_t bytes = 0;
+	uint32_t dropped = 0;
+	uint8_t wide[LOG_CODEC_MAX_RECORD];
+	uint32_t packed;
+	uint32_t len;
+	uint32_t pos;
+	uint32_t prev;
+	uint32_t i;
+	size_t used;
+
+	for (i = 0; i < RECORDS; i++)
+		make_record(&sent[i], &tick);
+
+	while (done < RECORDS) {
+		packed = pack(&sent[done], RECORDS - done, payload, &len);
+		check_value(len <= PAYLOAD, "payload fits the frame", len);
+		if (packed == 0) {
+			used = Log_Codec_Put(wide, sizeof(wide), sent[done].tick, &sent[done]);
+			check_value(used > PAYLOAD - LOG_CODEC_HEADER, "only wide records dropped", done);
+			dropped++;
+			done++;
+			continue;
+		}
+
+		// The header keeps the low half of the first tick
+		check_value((uint32_t) (payload[0] | payload[1] << 8) == (sent[done].tick & 0xFFFF),
+				"header tick", done);
+		prev = sent[done].tick;
+		for (pos = LOG_CODEC_HEADER, i = 0; i < packed; i++) {
+			used = Log_Codec_Get(&payload[pos], len - pos, prev, nargs,
+					LOG_MESSAGE_COUNT, &got);
+			check_value(used > 0, "record decodes", done + i);
+			if (used == 0)
+				break;
+			check_value(got.id == sent[done + i].id && got.tick == sent[done + i].tick
+					&& got.nargs == sent[done + i].nargs
+					&& memcmp(got.args, sent[done + i].args,
+							got.nargs * sizeof(got.args[0])) == 0,
+					"record round trip", done + i);
+			pos += used;
+			prev = got.tick;
+		}
+		check_value(pos == len, "no bytes left over", done);
+		done += packed;
+		frames++;
+		bytes += len + PROTOCOL_FRAME_OVERHEAD;
+	}
+	printf("%u random records in %lu frames, %lu too wide, %.1f link bytes per record\n",
+			RECORDS, (unsigned long) frames, (unsigned long) dropped,
+			(double) bytes / (RECORDS - dropped));
+}
+
+static void sizes(void) {
+	uint8_t out[LOG_CODEC_MAX_RECORD];
+	log_record_t rec = { LOG_FORWARD, 0, 1000, { 0 } };
+	size_t used;
+
+	used = Log_Codec_Put(out, sizeof(out), 1000 - 127, &rec);
+	check_value(used == 2, "no-argument record takes 2 bytes", used);
+
+	rec.id = LOG_DRIVE;
+	rec.nargs = nargs[LOG_DRIVE];
+	rec.args[0] = -64;
+	rec.args[1] = 63;
+	used = Log_Codec_Put(out, sizeof(out), 1000, &rec);
+	check_value(used == 4, "small arguments take a byte each", used);
+
+	rec.id = LOG_CONFIG_SET;
+	rec.nargs = nargs[LOG_CONFIG_SET];
+	rec.args[0] = INT32_MIN;
+	rec.args[1] = INT32_MAX;
+	rec.args[2] = -1;
+	used = Log_Codec_Put(out, sizeof(out), 1001, &rec);
+	check_value(used == 1 + 5 + 5 + 5 + 1, "widest values", used);
+	used = Log_Codec_Put(out, sizeof(out), 0, &rec);
+	check_value(used > 0 && used <= LOG_CODEC_MAX_RECORD, "LOG_CODEC_MAX_RECORD", used);
+	check_value(Log_Codec_Put(out, used - 1, 0, &rec) == 0, "too little space", used);
+}
+
+static void rejects(void) {
+	static const uint8_t over_long[] = { LOG_FORWARD, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+	uint8_t out[LOG_CODEC_MAX_RECORD];
+	log_record_t rec = { LOG_CONFIG_SET, 3, 5000, { 1, 300, -70000 } };
+	log_record_t got;
+	size_t used;
+	size_t cut;
+
+	used = Log_Codec_Put(out, sizeof(out), 0, &rec);
+	for (cut = 0; cut < used; cut++)
+		check_value(Log_Codec_Get(out, cut, 0, nargs, LOG_MESSAGE_COUNT, &got) == 0,
+				"truncated record rejected", cut);
+	check_value(Log_Codec_Get(out, used, 0, nargs, LOG_MESSAGE_COUNT, &got) == used,
+			"whole record accepted", used);
+
+	out[0] = LOG_MESSAGE_COUNT;
+	check_value(Log_Codec_Get(out, used, 0, nargs, LOG_MESSAGE_COUNT, &got) == 0,
+			"unknown id rejected", out[0]);
+	check_value(Log_Codec_Get(over_long, sizeof(over_long), 0, nargs, LOG_MESSAGE_COUNT,
+			&got) == 0, "over-long varint rejected", sizeof(over_long));
+}
+
+/*
+ * A short drive as the firmware would log it, for log_decode.py.
+ */
+static void capture(const char *path) {
+	static const log_record_t script[] = {
+		{ LOG_FORWARD, 0, 7000, { 0 } },
+		{ LOG_STOPPED, 0, 7250, { 0 } },
+		{ LOG_DRIVE, 2, 7300, { 100, -20 } },
+		{ LOG_DRIVE, 2, 7320, { -127, 127 } },
+		{ LOG_SUPPRESSED, 2, 8300, { LOG_DRIVE, 46 } },
+		{ LOG_CONFIG_SET, 3, 9000, { 1, 750, 0 } },
+		{ LOG_CLOCK_MODE, 1, 10000, { 1 } },
+		{ LOG_LINK_LOST, 0, 11000, { 0 } },
+		{ LOG_DROPPED, 1, 11000, { 3 } },
+	};
+	const uint32_t count = sizeof(script) / sizeof(script[0]);
+	uint8_t payload[PAYLOAD];
+	uint8_t frame[PROTOCOL_MAX_PAYLOAD + PROTOCOL_FRAME_OVERHEAD];
+	uint32_t done = 0;
+	uint32_t len;
+	uint8_t seq = 0;
+	FILE *out = fopen(path, "wb");
+
+	if (out == NULL) {
+		perror(path);
+		failures++;
+		return;
+	}
+	// Text on the link is skipped by the decoder
+	fputs("boot_phase,cycles,clock_hz,us\n\r", out);
+	while (done < count) {
+		done += pack(&script[done], count - done, payload, &len);
+		len = Protocol_Encode(seq++, FRAME_LOG, payload, len, frame);
+		fwrite(frame, 1, len, out);
+	}
+	fclose(out);
+
+	printf("wrote %s, log_decode.py should print:\n"
+			"[     7.000] INFO  Moving Forward...\n"
+			"[     7.250] INFO  Stopped...\n"
+			"[     7.300] DEBUG Drive throttle 100 steer -20\n"
+			"[     7.320] DEBUG Drive throttle -127 steer 127\n"
+			"[     8.300] WARN  LOG_DRIVE suppressed 46 times\n"
+			"[     9.000] INFO  Config key 1 set to 750, status 0\n"
+			"[    10.000] DEBUG Clock mode 1 (0 = RUN, 1 = VLPR)\n"
+			"[    11.000] WARN  Link lost, stopping\n"
+			"[    11.000] WARN  3 log records dropped\n", path);
+}
+
+int main(int argc, char **argv) {
+	srand(1);
+	round_trip();
+	sizes();
+	rejects();
+	if (argc > 1)
+		capture(argv[1]);
+	return sim_result();
+}
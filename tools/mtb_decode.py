@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Map a Micro Trace Buffer dump from the robot to symbols in the ELF file.
+
+The dump is requested with a FRAME_MTB_DUMP frame (see source/mtb_trace.h).
+When given a serial device, the script sends the request itself and stops
+once the dump is complete; when given a capture file, the last dump in it is
+decoded. The ELF must be the one flashed on the robot.
+
+Prints every branch oldest first, then the functions that branches landed in
+most often, which is where the traced code spent its loops.
+
+Usage:
+    stty -F /dev/rfcomm0 115200 raw && mtb_decode.py /dev/rfcomm0 WheelsOnTheGo.axf
+    mtb_decode.py capture.bin WheelsOnTheGo.axf
+"""
+
+import bisect
+import collections
+import os
+import stat
+import struct
+import sys
+
+from profile_decode import SYNC, crc8, frames
+
+FRAME_MTB_DUMP = 0x03
+FRAME_MTB_INFO = 0x86
+FRAME_MTB_PACKET = 0x87
+
+SHT_SYMTAB = 2
+STT_FUNC = 2
+HOT_FUNCTIONS = 15
+
+
+def load_symbols(path):
+    """Return sorted (address, size, name) of the functions in an ELF32 file."""
+    with open(path, "rb") as elf:
+        data = elf.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+        sys.exit("%s: not a little-endian ELF32 file" % path)
+    shoff, = struct.unpack_from("<I", data, 0x20)
+    shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+    sections = [struct.unpack_from("<IIIIIIIIII", data, shoff + i * shentsize)
+                for i in range(shnum)]
+    symbols = []
+    for section in sections:
+        if section[1] != SHT_SYMTAB:
+            continue
+        strtab = sections[section[6]]
+        for offset in range(section[4], section[4] + section[5], section[9]):
+            name, value, size, info = struct.unpack_from("<IIIB", data, offset)
+            if info & 0xF != STT_FUNC or value == 0:
+                continue
+            start = strtab[4] + name
+            symbols.append((value & ~1, size, data[start:data.index(b"\0", start)].decode()))
+    symbols.sort()
+    return symbols
+
+
+def describe(symbols, addresses, address):
+    index = bisect.bisect_right(addresses, address) - 1
+    if index < 0:
+        return "0x%08x" % address, None
+    start, size, name = symbols[index]
+    if size and address >= start + size:
+        return "0x%08x" % address, None
+    return "%s+0x%x" % (name, address - start), name
+
+
+def request_dump(stream):
+    body = bytes([1, 0, FRAME_MTB_DUMP])
+    stream.write(bytes([SYNC]) + body + bytes([crc8(body)]))
+
+
+def read_dump(stream, live):
+    """Return (count, packets) of the last complete or partial dump."""
+    dump = None
+    for kind, data in frames(stream):
+        if kind == FRAME_MTB_INFO and len(data) == 4:
+            dump = (struct.unpack("<HH", data)[0], [])
+        elif kind == FRAME_MTB_PACKET and len(data) == 8 and dump is not None:
+            dump[1].append(struct.unpack("<II", data))
+        if live and dump is not None and len(dump[1]) == dump[0]:
+            break
+    return dump
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    symbols = load_symbols(sys.argv[2])
+    addresses = [s[0] for s in symbols]
+    live = stat.S_ISCHR(os.stat(sys.argv[1]).st_mode)
+    with open(sys.argv[1], "r+b" if live else "rb", buffering=0) as stream:
+        if live:
+            request_dump(stream)
+        dump = read_dump(stream, live)
+    if dump is None:
+        sys.exit("no MTB dump found")
+
+    count, packets = dump
+    hot = collections.Counter()
+    for source, destination in packets:
+        flags = ("exception " if source & 1 else "") + ("start " if destination & 1 else "")
+        src, _ = describe(symbols, addresses, source & ~1)
+        dst, function = describe(symbols, addresses, destination & ~1)
+        hot[function or "?"] += 1
+        print("%-32s -> %-32s %s" % (src, dst, flags.strip()))
+
+    if count != len(packets):
+        print("warning: %u of %u packets received" % (len(packets), count))
+    print("\nbranches  function")
+    for function, hits in hot.most_common(HOT_FUNCTIONS):
+        print("%8u  %s" % (hits, function))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,215 @@
+/*
+ * Host model of the idle power states and the energy they take.
+ *
+ * Steps an hour of operation on a 1 ms tick for several shares of driving
+ * time. The car drives for part of every minute, with a command every
+ * COMMAND_MS, and sits connected but idle for the rest of it.
+ *
+ * - While driving the clock is in RUN at 48 MHz: the core runs the tick,
+ *   the commands and the telemetry, and waits (WAIT) in between.
+ * - Once the motors stop the clock stays in RUN for CLOCK_PARK_MS, until
+ *   the next CLOCK_POLL_MS park check, then parks in VLPR.
+ * - Parked, vPortSuppressTicksAndSleep() (power.c) keeps the core in VLPS
+ *   until the next timeout of a task or timer. The wakeups are those the
+ *   firmware still has with the motors stopped: the failsafe and clock
+ *   policy timers every FAILSAFE_PERIOD_MS and CLOCK_POLL_MS, and
+ *   task_poll_BT, task_motor_control and the speed control task checking
+ *   in every FAILSAFE_CHECKIN_MS. The telemetry task and the ramp
+ *   generator are parked, the log task waits for a record.
+ *
+ * The model prints the time spent in each state, the wakeups per parked
+ * second and the energy per hour, next to the firmware before tickless idle,
+ * whose busy-wait receive kept the core running at 48 MHz.
+ *
+ * - Checks that the residencies add up to the hour, that the parked
+ *   wakeups come at the rate of the sources above and that each profile
+ *   takes less energy than the core running all the time.
+ *
+ * The currents are typical KL25Z figures at 3 V and 25 C from the data
+ * sheet; the VLPS figure adds an allowance for the fast IRC, which keeps
+ * running for UART0 and the LED PWM. The cycle counts are estimates. Both
+ * are parameters to replace with measurements: Power_Get_Stats() gives the
+ * VLPS residency on the target and the PROFILE build the CPU load of each
+ * task. The MCU alone is modeled; the RN-41 and the motors are not.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o power_sim \
+ *         tools/power_sim.c
+ *     ./power_sim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "failsafe.h"
+#include "clock_policy.h"
+#include "telemetry.h"
+#include "sim_check.h"
+
+#define HOUR_MS        (3600000UL)
+#define MINUTE_MS      (60000UL)
+#define COMMAND_MS     (100)         // Drive commands while driving
+
+// Typical supply currents in microamps
+#define RUN_UA         (6400)        // 48 MHz, core running
+#define WAIT_UA        (3700)        // 48 MHz, core waiting for an interrupt
+#define VLPR_UA        (190)         // 4 MHz, core running
+#define VLPS_UA        (60)          // Deep sleep, fast IRC and TPMs running
+#define SUPPLY_MV      (3000)
+
+// Estimated core cycles of each piece of work
+#define TICK_CYCLES    (300)         // Tick interrupt and scheduler, RUN only
+#define COMMAND_CYCLES (4000)        // Receive, parse and apply a command
+#define SAMPLE_CYCLES  (6000)        // Take and send one telemetry sample
+#define WAKE_CYCLES    (1500)        // Wake from VLPS, run one task, sleep
+#define RUN_HZ         (48000000UL)
+#define VLPR_HZ        (4000000UL)
+
+enum {
+	STATE_RUN = 0,
+	STATE_WAIT,
+	STATE_VLPR,
+	STATE_VLPS,
+	STATES
+};
+
+static const char *const state_names[STATES] = { "RUN", "WAIT", "VLPR", "VLPS" };
+static const uint32_t state_ua[STATES] = { RUN_UA, WAIT_UA, VLPR_UA, VLPS_UA };
+
+// What still wakes the core while parked
+typedef struct {
+	const char *name;
+	uint32_t period_ms;
+	uint32_t next;
+} source_t;
+
+static source_t sources[] = {
+	{ "failsafe timer", FAILSAFE_PERIOD_MS, 0 },
+	{ "clock policy timer", CLOCK_POLL_MS, 0 },
+	{ "task_poll_BT", FAILSAFE_CHECKIN_MS, 0 },
+	{ "task_motor_control", FAILSAFE_CHECKIN_MS, 0 },
+	{ "speed control task", FAILSAFE_CHECKIN_MS, 0 },
+};
+
+#define SOURCES (sizeof(sources) / sizeof(sources[0]))
+
+typedef struct {
+	double seconds[STATES];
+	unsigned long parked_ms;
+	unsigned long wakes;
+	unsigned long woken;          // Sources run, several per wake if due together
+} residency_t;
+
+static double energy_mwh(const residency_t *r) {
+	double uah = 0;
+	int s;
+
+	for (s = 0; s < STATES; s++)
+		uah += state_ua[s] * r->seconds[s] / 3600.0;
+	return uah * SUPPLY_MV / 1e6;
+}
+
+/*
+ * One hour, driving for drive_ms of every minute.
+ */
+static void run_hour(uint32_t drive_ms, residency_t *r) {
+	double run_busy;
+	uint32_t ms, t, due, park_at = 0;
+	uint32_t i;
+	int parked = 0;
+
+	memset(r, 0, sizeof(*r));
+	for (i = 0; i < SOURCES; i++)
+		sources[i].next = (uint32_t) rand() % sources[i].period_ms;
+
+	for (ms = 0; ms < HOUR_MS; ms++) {
+		t = ms % MINUTE_MS;
+		if (t < drive_ms) {
+			// Clock_Policy_Run() before every command
+			parked = 0;
+			park_at = 0;
+			run_busy = TICK_CYCLES + (t % COMMAND_MS == 0 ? COMMAND_CYCLES : 0)
+					+ (t % (1000 / TELEMETRY_DEFAULT_HZ) == 0 ? SAMPLE_CYCLES : 0);
+		} else if (!parked) {
+			// RUN until a park check sees the motors idle for long enough
+			if (park_at == 0)
+				park_at = ms + CLOCK_PARK_MS + CLOCK_POLL_MS - 1
+						- (ms + CLOCK_PARK_MS) % CLOCK_POLL_MS;
+			run_busy = TICK_CYCLES;
+			if (ms >= park_at) {
+				parked = 1;
+				for (i = 0; i < SOURCES; i++)
+					sources[i].next = ms + (uint32_t) rand() % sources[i].period_ms;
+			}
+		}
+
+		if (!parked) {
+			r->seconds[STATE_RUN] += run_busy / RUN_HZ;
+			r->seconds[STATE_WAIT] += 0.001 - run_busy / RUN_HZ;
+			continue;
+		}
+
+		// Parked: the core sleeps in VLPS unless a timeout is due this tick
+		r->parked_ms++;
+		for (i = 0, due = 0; i < SOURCES; i++) {
+			if (sources[i].next == ms) {
+				sources[i].next += sources[i].period_ms;
+				due++;
+			}
+		}
+		if (due > 0) {
+			r->wakes++;
+			r->woken += due;
+			r->seconds[STATE_VLPR] += (double) due * WAKE_CYCLES / VLPR_HZ;
+			r->seconds[STATE_VLPS] += 0.001 - (double) due * WAKE_CYCLES / VLPR_HZ;
+		} else {
+			r->seconds[STATE_VLPS] += 0.001;
+		}
+	}
+}
+
+int main(void) {
+	static const uint32_t drive_shares[] = { 0, 5, 25, 50, 100 };
+	residency_t r;
+	double total, before, expected;
+	uint32_t n, i;
+	int s;
+
+	srand(1);
+
+	// Before tickless idle the core ran at 48 MHz all hour
+	memset(&r, 0, sizeof(r));
+	r.seconds[STATE_RUN] = HOUR_MS / 1000.0;
+	before = energy_mwh(&r);
+
+	for (i = 0, expected = 0; i < SOURCES; i++)
+		expected += 1000.0 / sources[i].period_ms;
+
+	printf("driving");
+	for (s = 0; s < STATES; s++)
+		printf("  %4s", state_names[s]);
+	printf("  wakes/s  mWh/h  mA avg  (before: %.1f mWh/h)\n", before);
+	for (n = 0; n < sizeof(drive_shares) / sizeof(drive_shares[0]); n++) {
+		run_hour(MINUTE_MS / 100 * drive_shares[n], &r);
+		for (s = 0, total = 0; s < STATES; s++)
+			total += r.seconds[s];
+		check_value(total > HOUR_MS / 1000.0 - 0.001 && total < HOUR_MS / 1000.0 + 0.001,
+				"residency adds up to the hour", drive_shares[n]);
+		if (r.parked_ms > 0)
+			check_value(r.woken > (expected - 0.1) * r.parked_ms / 1000.0
+					&& r.woken < (expected + 0.1) * r.parked_ms / 1000.0 + SOURCES * 60,
+					"parked wakeups are the timeouts", drive_shares[n]);
+		check_value(energy_mwh(&r) < before, "less energy than before", drive_shares[n]);
+
+		printf("%6lu%% ", (unsigned long) drive_shares[n]);
+		for (s = 0; s < STATES; s++)
+			printf(" %4.1f%%", 100.0 * r.seconds[s] / total);
+		printf("  %7.1f  %5.1f  %6.3f\n",
+				r.parked_ms ? 1000.0 * r.wakes / r.parked_ms : 0.0, energy_mwh(&r),
+				energy_mwh(&r) / SUPPLY_MV * 1000.0);
+	}
+	printf("parked wakeup sources (%.0f/s when none coincide):", expected);
+	for (i = 0; i < SOURCES; i++)
+		printf(" %s %lu ms%s", sources[i].name, (unsigned long) sources[i].period_ms,
+				i + 1 < SOURCES ? "," : "\n");
+	return sim_result();
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Render the profiling snapshots sent by the robot over the Bluetooth link.
+
+The firmware must be built with PROFILE_SNAPSHOTS defined (see
+source/profile.h). Frames are picked out of the byte stream by their SYNC byte
+and CRC, so the text messages sent on the same link are skipped.
+
+Usage:
+    stty -F /dev/rfcomm0 115200 raw && profile_decode.py /dev/rfcomm0
+    profile_decode.py capture.bin
+"""
+
+import struct
+import sys
+
+SYNC = 0xA5
+MAX_PAYLOAD = 16
+FRAME_SYS_STATS = 0x81
+FRAME_TASK_STATS = 0x82
+STATES = ["run", "ready", "blocked", "suspended", "deleted", "invalid"]
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def frames(stream):
+    """Yield (type, data) for every valid frame in a byte stream."""
+    buf = bytearray()
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            return
+        buf += chunk
+        while buf:
+            if buf[0] != SYNC:
+                del buf[0]
+                continue
+            if len(buf) < 2:
+                break
+            length = buf[1]
+            if length == 0 or length > MAX_PAYLOAD:
+                del buf[0]
+                continue
+            total = length + 4
+            if len(buf) < total:
+                break
+            if crc8(buf[1:total - 1]) != buf[total - 1]:
+                del buf[0]
+                continue
+            yield buf[3], bytes(buf[4:total - 1])
+            del buf[:total]
+
+
+def render(system, tasks):
+    uptime, heap_free, heap_min, count, depth, max_depth, tx = system
+    print("\033[2J\033[H", end="")
+    print("uptime %.1f s  heap free %u B (min %u B)  commands %u (max %u)  tx %u B"
+          % (uptime / 1000.0, heap_free, heap_min, depth, max_depth, tx))
+    print("%-3s %-10s %-9s %4s %7s %11s" % ("#", "task", "state", "prio", "cpu %", "free words"))
+    for number, state, prio, permille, stack, name in sorted(tasks, key=lambda t: -t[3]):
+        print("%-3u %-10s %-9s %4u %7.1f %11u" % (number, name, STATES[min(state, 5)],
+                                                  prio, permille / 10.0, stack))
+    if len(tasks) < count:
+        print("(%u of %u tasks received)" % (len(tasks), count))
+    sys.stdout.flush()
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+    system = None
+    tasks = []
+    with open(sys.argv[1], "rb", buffering=0) as stream:
+        for kind, data in frames(stream):
+            if kind == FRAME_SYS_STATS and len(data) == 13:
+                if system is not None:
+                    render(system, tasks)
+                system = struct.unpack("<IHHBBBH", data)
+                tasks = []
+            elif kind == FRAME_TASK_STATS and len(data) >= 7 and system is not None:
+                number, state, prio, permille, stack = struct.unpack("<BBBHH", data[:7])
+                tasks.append((number, state, prio, permille, stack,
+                              data[7:].decode("ascii", "replace")))
+                if len(tasks) == system[3]:
+                    render(system, tasks)
+                    system = None
+    if system is not None:
+        render(system, tasks)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,264 @@
+/*
+ * Host fuzz test of the framed command protocol.
+ *
+ * Runs source/protocol.c unchanged. Bytes reach the parser in chunks of 1
+ * to RX_CHUNK bytes, as UART0_Receive() hands them to task_poll_BT(), on a
+ * millisecond clock that starts just before it wraps.
+ *
+ * - Checks on every call that the parser consumes no more than it is given,
+ *   keeps its buffer in bounds, returns frames that fit their buffer and
+ *   always makes progress.
+ * - Sends random frames mixed with legacy characters and pauses. Checks
+ *   that every frame and every character comes out, once and in order, and
+ *   that no error or lost frame is counted.
+ * - Sends a stray SYNC, with every possible following byte, then pauses for
+ *   longer than PROTOCOL_GAP_MS before the legacy '1'..'4'. Checks that the
+ *   four characters come out.
+ * - Sends random frames with single bit flips and bursts of random bytes
+ *   between them. Checks that the frames left intact are decoded and that
+ *   few damaged ones pass the CRC; the rates are printed.
+ * - Feeds random bytes, then checks that a frame after a pause still decodes.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o protocol_sim \
+ *         tools/protocol_sim.c "WheelsOnTheGo(BTEdition)/source/protocol.c"
+ *     ./protocol_sim
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "protocol.h"
+#include "sim_check.h"
+
+#define RX_CHUNK      (16)          // task_poll_BT() receive buffer
+#define START_MS      (0xFFFFF000UL)
+#define MESSAGES      (200000)
+#define NOISE_BYTES   (1000000)
+#define MAX_FRAME     (PROTOCOL_MAX_PAYLOAD + 4)
+
+typedef struct {
+	bool legacy;
+	uint8_t byte;                   // Legacy character
+	protocol_frame_t frame;
+	bool damaged;                   // Bit flipped on the wire
+} message_t;
+
+static protocol_parser_t parser;
+static uint32_t now;
+
+// What came out of the parser, in order, legacy characters if asked
+static message_t out[MESSAGES];
+static uint32_t outputs;
+static bool keep_legacy;
+
+/*
+ * Hand bytes to the parser in random chunks, within PROTOCOL_GAP_MS.
+ */
+static void feed(const uint8_t *data, uint32_t len) {
+	protocol_frame_t frame;
+	protocol_result_t result;
+	uint32_t offset, chunk, used, idle;
+	uint8_t legacy;
+
+	for (offset = 0; offset < len; offset += chunk) {
+		chunk = 1 + (uint32_t) rand() % RX_CHUNK;
+		if (chunk > len - offset)
+			chunk = len - offset;
+		now += (uint32_t) rand() % 3;
+		for (used = 0, idle = 0; used < chunk; idle++) {
+			uint32_t n;
+
+			result = Protocol_Parse(&parser, now, &data[offset + used], chunk - used,
+					&n, &frame, &legacy);
+			used += n;
+			check_value(used <= chunk, "consumed no more than given", n);
+			check_value(parser.count <= sizeof(parser.buf), "buffer in bounds", parser.count);
+			check_value(n > 0 || (result != PROTO_NONE && idle < MAX_FRAME),
+					"progress", offset);
+			if (result == PROTO_NONE || (result == PROTO_LEGACY && !keep_legacy)
+					|| outputs >= MESSAGES)
+				continue;
+			memset(&out[outputs], 0, sizeof(out[outputs]));
+			out[outputs].legacy = (result == PROTO_LEGACY);
+			out[outputs].byte = legacy;
+			if (result == PROTO_FRAME) {
+				check_value(frame.len <= sizeof(frame.data), "frame fits", frame.len);
+				out[outputs].frame = frame;
+			}
+			outputs++;
+			if (n == 0 && used == chunk)
+				break;
+		}
+	}
+}
+
+static uint32_t encode(const message_t *m, uint8_t *bytes) {
+	if (m->legacy) {
+		bytes[0] = m->byte;
+		return 1;
+	}
+	return Protocol_Encode(m->frame.seq, m->frame.type, m->frame.data, m->frame.len, bytes);
+}
+
+static void random_message(message_t *m, uint8_t seq, bool legacy) {
+	uint32_t i;
+
+	memset(m, 0, sizeof(*m));
+	m->legacy = legacy;
+	if (legacy) {
+		do
+			m->byte = (uint8_t) rand();
+		while (m->byte == PROTOCOL_SYNC);
+		return;
+	}
+	m->frame.seq = seq;
+	m->frame.type = (uint8_t) rand();
+	m->frame.len = (uint8_t) (rand() % PROTOCOL_MAX_PAYLOAD);
+	for (i = 0; i < m->frame.len; i++)
+		m->frame.data[i] = (uint8_t) rand();
+}
+
+static bool same(const message_t *a, const message_t *b) {
+	if (a->legacy || b->legacy)
+		return a->legacy == b->legacy && a->byte == b->byte;
+	return a->frame.seq == b->frame.seq && a->frame.type == b->frame.type
+			&& a->frame.len == b->frame.len
+			&& memcmp(a->frame.data, b->frame.data, a->frame.len) == 0;
+}
+
+static void start(bool legacy) {
+	keep_legacy = legacy;
+	Protocol_Init(&parser);
+	now = START_MS;
+	outputs = 0;
+}
+
+/*
+ * Frames and legacy characters, some of them after a pause.
+ */
+static void clean(void) {
+	static message_t sent[MESSAGES];
+	uint8_t bytes[MAX_FRAME];
+	uint32_t n, len, frames = 0;
+
+	start(true);
+	for (n = 0; n < MESSAGES; n++) {
+		random_message(&sent[n], (uint8_t) frames, rand() % 4 == 0);
+		frames += !sent[n].legacy;
+		if (rand() % 10 == 0)
+			now += (uint32_t) rand() % (4 * PROTOCOL_GAP_MS);
+		len = encode(&sent[n], bytes);
+		feed(bytes, len);
+	}
+	check_value(outputs == MESSAGES, "every message out", outputs);
+	for (n = 0; n < outputs && n < MESSAGES; n++)
+		check_value(same(&out[n], &sent[n]), "same message, in order", n);
+	check_value(parser.stats.frames == frames, "frames counted", parser.stats.frames);
+	check(parser.stats.crc_errors == 0 && parser.stats.len_errors == 0
+			&& parser.stats.lost == 0 && parser.stats.timeouts == 0, "no error counted");
+	printf("clean: %lu frames and %lu legacy characters, all decoded\n",
+			(unsigned long) frames, (unsigned long) (MESSAGES - frames));
+}
+
+/*
+ * A stray SYNC, with each possible next byte, then the legacy commands.
+ */
+static void stray_sync(void) {
+	static const uint8_t commands[] = { '1', '2', '3', '4' };
+	uint8_t stray[2] = { PROTOCOL_SYNC, 0 };
+	uint32_t next, n;
+
+	for (next = 0; next <= 256; next++) {
+		start(true);
+		stray[1] = (uint8_t) next;
+		feed(stray, (next < 256) ? 2 : 1);
+		outputs = 0;
+		now += PROTOCOL_GAP_MS + 1;
+		feed(commands, sizeof(commands));
+		check_value(outputs == sizeof(commands), "legacy commands after a stray SYNC", next);
+		for (n = 0; n < outputs; n++)
+			check_value(out[n].legacy && out[n].byte == commands[n], "same command", next);
+	}
+	printf("stray SYNC: '1'..'4' come out after a %u ms pause, whatever follows it\n",
+			PROTOCOL_GAP_MS + 1);
+}
+
+/*
+ * Frames with single bit flips and bursts of noise between them.
+ */
+static void damaged(void) {
+	static message_t sent[MESSAGES];
+	uint8_t bytes[MAX_FRAME + RX_CHUNK];
+	uint32_t n, i, bit, len, flips = 0, bursts = 0, decoded = 0, wrong = 0, window;
+
+	start(false);
+	for (n = 0; n < MESSAGES; n++) {
+		random_message(&sent[n], (uint8_t) n, false);
+		len = encode(&sent[n], bytes);
+		if (rand() % 4 == 0) {
+			bit = (uint32_t) rand() % (8 * len);
+			bytes[bit / 8] ^= (uint8_t) (1U << (bit % 8));
+			sent[n].damaged = true;
+			flips++;
+		} else if (rand() % 4 == 0) {
+			for (i = 1 + (uint32_t) rand() % RX_CHUNK; i > 0; i--)
+				bytes[len++] = (rand() % 8 == 0) ? PROTOCOL_SYNC : (uint8_t) rand();
+			bursts++;
+		}
+		feed(bytes, len);
+	}
+
+	// Match each frame out with the next frame sent with the same content
+	for (n = 0, i = 0; n < outputs; n++) {
+		for (window = 0; window < 128 && i + window < MESSAGES; window++) {
+			if (same(&out[n], &sent[i + window]))
+				break;
+		}
+		if (i + window < MESSAGES && window < 128 && !sent[i + window].damaged) {
+			decoded++;
+			i += window + 1;
+		} else {
+			wrong++;
+		}
+	}
+	check_value(decoded >= (MESSAGES - flips) / 100 * 99, "intact frames decoded", decoded);
+	check_value(wrong <= (flips + bursts) / 100, "few false frames", wrong);
+	printf("damaged: %lu frames, %lu with a bit flipped, %lu followed by noise\n",
+			(unsigned long) MESSAGES, (unsigned long) flips, (unsigned long) bursts);
+	printf("         %.3f%% of the intact frames decoded, %lu false frames\n",
+			100.0 * decoded / (MESSAGES - flips), (unsigned long) wrong);
+}
+
+/*
+ * Random bytes, then a pause and a frame.
+ */
+static void noise(void) {
+	static uint8_t bytes[NOISE_BYTES];
+	message_t frame;
+	uint8_t encoded[MAX_FRAME];
+	uint32_t n, frames;
+
+	start(false);
+	for (n = 0; n < NOISE_BYTES; n++)
+		bytes[n] = (uint8_t) rand();
+	feed(bytes, NOISE_BYTES);
+	frames = parser.stats.frames;
+
+	outputs = 0;
+	now += PROTOCOL_GAP_MS + 1;
+	random_message(&frame, 0, false);
+	feed(encoded, encode(&frame, encoded));
+	check(outputs == 1 && same(&out[0], &frame), "frame after noise and a pause");
+	printf("noise: %lu random bytes, %lu false frames, %lu CRC and %lu length errors\n",
+			(unsigned long) NOISE_BYTES, (unsigned long) frames,
+			(unsigned long) parser.stats.crc_errors, (unsigned long) parser.stats.len_errors);
+}
+
+int main(void) {
+	srand(1);
+	clean();
+	stray_sync();
+	damaged();
+	noise();
+	return sim_result();
+}
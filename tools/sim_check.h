@@ -0,0 +1,63 @@
+// sim_check.h
+
+#ifndef SIM_CHECK_H
+#define SIM_CHECK_H
+
+#include <stdio.h>
+
+/**
+ * @file    sim_check.h
+ * @brief   Checks shared by the host simulations in tools/ and the host tests.
+ *
+ * Every simulation and test includes this once, calls check() or
+ * check_value() for each property and returns sim_result() from main().
+ * Only the first SIM_MAX_REPORTED failures are printed, so a broken model
+ * does not bury the first symptom; the last line is "passed" or "FAILED"
+ * and the exit status is non-zero on failure, which is what tools/Makefile
+ * and ctest run on.
+ */
+
+#define SIM_MAX_REPORTED (10)
+
+static int failures;
+
+/**
+ * @brief Count a failure, and print it with a value that locates it.
+ *
+ * @param condition Property that must hold.
+ * @param what      Description of the property.
+ * @param value     Sample, tick or index at which it was checked.
+ */
+static inline void check_value(int condition, const char *what, unsigned long value) {
+	if (!condition) {
+		if (failures < SIM_MAX_REPORTED)
+			printf("FAIL: %s (%lu)\n", what, value);
+		failures++;
+	}
+}
+
+/**
+ * @brief Count a failure, and print it.
+ *
+ * @param condition Property that must hold.
+ * @param what      Description of the property.
+ */
+static inline void check(int condition, const char *what) {
+	if (!condition) {
+		if (failures < SIM_MAX_REPORTED)
+			printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+/**
+ * @brief Print the verdict.
+ *
+ * @return Exit status for main(): 0 if every check passed.
+ */
+static inline int sim_result(void) {
+	printf("%s\n", failures ? "FAILED" : "passed");
+	return failures != 0;
+}
+
+#endif // SIM_CHECK_H
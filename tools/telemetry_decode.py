@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+"""Decode, plot and budget the binary telemetry sent by the robot on UART1.
+
+Everything here comes from the TELEMETRY_FIELDS table of
+source/telemetry.h, the same table the firmware packs from, so a field added
+there is decoded, printed and plotted without touching this script.
+
+A frame is the fields, little-endian in table order, and a CRC-8, COBS
+encoded and ended by a zero byte (see source/telemetry_codec.h). Frames
+that fail the length or CRC check are skipped and counted; gaps in the
+sample counter count frames the firmware dropped.
+
+Modes:
+- decode: print one CSV line per sample, after a header of field names;
+- --plot: also plot every field with a unit, one panel per unit, live for
+  a serial port (needs matplotlib);
+- --budget: report the line bandwidth of every field at the default and
+  highest rates, and exit with an error if the frames would take more than
+  TELEMETRY_LINK_SHARE percent of the link. The firmware build runs this as
+  a post-build step; telemetry.h checks the same total at compile time.
+
+Usage:
+    stty -F /dev/ttyUSB0 115200 raw && telemetry_decode.py /dev/ttyUSB0 telemetry.h
+    telemetry_decode.py capture.bin WheelsOnTheGo(BTEdition)/source/telemetry.h --plot
+    telemetry_decode.py --budget WheelsOnTheGo(BTEdition)/source/telemetry.h
+"""
+
+import re
+import struct
+import sys
+
+from profile_decode import crc8
+
+TYPES = {"U8": "B", "I8": "b", "U16": "H", "I16": "h", "U32": "I"}
+BITS_PER_BYTE = 10       # 8N1
+CRC_BYTES = 1
+COBS_RUN = 254
+
+FIELD = re.compile(r'X\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"([^"]*)"\s*,\s*"([^"]*)"\s*\)')
+DEFINE = re.compile(r"#define\s+(TELEMETRY_\w+)\s+\((\d+)\)")
+
+
+def load(path):
+    """Return (fields, constants) of telemetry.h.
+
+    fields is a list of dicts with name, type, unit and description;
+    constants maps the numeric TELEMETRY_ #defines to their values.
+    """
+    with open(path) as header:
+        text = header.read()
+    start = text.find("#define TELEMETRY_FIELDS(X)")
+    if start < 0:
+        sys.exit("%s: no TELEMETRY_FIELDS table" % path)
+    # The table ends at the first line without a continuation
+    lines = []
+    for line in text[start:].splitlines():
+        lines.append(line)
+        if not line.rstrip().endswith("\\"):
+            break
+    fields = []
+    for name, kind, unit, description in FIELD.findall("\n".join(lines)):
+        if kind not in TYPES:
+            sys.exit("%s: %s has unknown type %s" % (path, name, kind))
+        fields.append({"name": name, "type": kind, "unit": unit,
+                       "description": description})
+    if not fields:
+        sys.exit("%s: TELEMETRY_FIELDS is empty" % path)
+    constants = {name: int(value) for name, value in DEFINE.findall(text)}
+    return fields, constants
+
+
+def layout(fields):
+    """Return the struct format of the packed fields."""
+    return "<" + "".join(TYPES[f["type"]] for f in fields)
+
+
+def frame_bytes(fields):
+    """Bytes on the wire per frame: fields, CRC, COBS code and delimiter."""
+    block = struct.calcsize(layout(fields)) + CRC_BYTES
+    return block + block // COBS_RUN + 1 + 1
+
+
+def cobs_decode(data):
+    """Return the decoded block, or None if data is not valid COBS."""
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        code = data[pos]
+        if code == 0 or pos + code > len(data):
+            return None
+        out += data[pos + 1:pos + code]
+        pos += code
+        if code != 0xFF and pos < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def samples(stream, fields, stats):
+    """Yield a tuple of field values for every valid frame in a byte stream.
+
+    stats counts "bad" frames and samples "lost" by the firmware.
+    """
+    fmt = layout(fields)
+    size = struct.calcsize(fmt)
+    buf = bytearray()
+    last = None
+    while True:
+        chunk = stream.read(1)
+        if not chunk:
+            return
+        if chunk != b"\0":
+            buf += chunk
+            continue
+        block = cobs_decode(bytes(buf))
+        del buf[:]
+        if block is None or len(block) != size + CRC_BYTES or crc8(block[:size]) != block[size]:
+            stats["bad"] += 1
+            continue
+        values = struct.unpack(fmt, block[:size])
+        # The first field is the sample counter
+        if last is not None:
+            stats["lost"] += (values[0] - last - 1) & 0xFFFF
+        last = values[0]
+        yield values
+
+
+def budget(fields, constants):
+    """Print the bandwidth of every field and return False if over budget."""
+    baud = constants["TELEMETRY_BAUD"]
+    share = constants["TELEMETRY_LINK_SHARE"]
+    rates = [constants["TELEMETRY_DEFAULT_HZ"], constants["TELEMETRY_MAX_HZ"]]
+    per_frame = frame_bytes(fields)
+    overhead = per_frame - struct.calcsize(layout(fields))
+
+    print("%-14s %-5s %5s %10s %10s %6s" % ("field", "type", "bytes",
+          "bit/s@%u" % rates[0], "bit/s@%u" % rates[1], "link"))
+    rows = [(f["name"], f["type"], struct.calcsize("<" + TYPES[f["type"]])) for f in fields]
+    rows.append(("(framing)", "", overhead))
+    for name, kind, size in rows:
+        bps = [size * BITS_PER_BYTE * hz for hz in rates]
+        print("%-14s %-5s %5u %10u %10u %5.1f%%" % (name, kind, size, bps[0], bps[1],
+                                                   100.0 * bps[1] / baud))
+    total = [per_frame * BITS_PER_BYTE * hz for hz in rates]
+    print("%-14s %-5s %5u %10u %10u %5.1f%%" % ("total", "", per_frame, total[0], total[1],
+                                               100.0 * total[1] / baud))
+    limit = baud * share // 100 // (per_frame * BITS_PER_BYTE)
+    print("%u baud, budget %u%%: at most %u Hz with these fields"
+          % (baud, share, limit))
+    return total[1] <= baud // 100 * share
+
+
+def plot(stream, fields, stats, live):
+    import matplotlib.pyplot as plt
+
+    units = []
+    for f in fields:
+        if f["unit"] and f["unit"] != "ms" and f["unit"] not in units:
+            units.append(f["unit"])
+    _, axes = plt.subplots(len(units), 1, sharex=True, squeeze=False)
+    axes = [row[0] for row in axes]
+    columns = {f["name"]: [] for f in fields}
+    time = []
+    lines = {}
+    for axis, unit in zip(axes, units):
+        axis.set_ylabel(unit)
+        for f in fields:
+            if f["unit"] == unit:
+                lines[f["name"]], = axis.plot([], [], label=f["name"])
+        axis.legend(loc="upper left", fontsize="small")
+    axes[-1].set_xlabel("s")
+    if live:
+        plt.ion()
+        plt.show()
+
+    tick = fields.index(next(f for f in fields if f["unit"] == "ms"))
+    base = None
+    for values in samples(stream, fields, stats):
+        print(",".join(str(v) for v in values))
+        # Unwrap the 16-bit tick
+        if base is None:
+            base = values[tick]
+        else:
+            base += (values[tick] - base) & 0xFFFF
+        time.append(base / 1000.0)
+        for f, value in zip(fields, values):
+            columns[f["name"]].append(value)
+        if live and len(time) % 10 == 0:
+            for name, line in lines.items():
+                line.set_data(time, columns[name])
+            for axis in axes:
+                axis.relim()
+                axis.autoscale_view()
+            plt.pause(0.001)
+    for name, line in lines.items():
+        line.set_data(time, columns[name])
+    for axis in axes:
+        axis.relim()
+        axis.autoscale_view()
+    plt.ioff()
+    plt.show()
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    options = [a for a in sys.argv[1:] if a.startswith("--")]
+    if "--budget" in options and len(args) == 1:
+        fields, constants = load(args[0])
+        sys.exit(0 if budget(fields, constants) else "telemetry over its link budget")
+    if len(args) != 2 or set(options) - {"--plot"}:
+        sys.exit(__doc__)
+
+    fields, _ = load(args[1])
+    stats = {"bad": 0, "lost": 0}
+    print(",".join(f["name"] for f in fields))
+    with open(args[0], "rb", buffering=0) as stream:
+        if "--plot" in options:
+            plot(stream, fields, stats, stream.isatty())
+        else:
+            for values in samples(stream, fields, stats):
+                print(",".join(str(v) for v in values))
+                sys.stdout.flush()
+    print("%u bad frames, %u samples lost" % (stats["bad"], stats["lost"]), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,196 @@
+/*
+ * Host model of the telemetry framing.
+ *
+ * Runs source/cobs.c and source/telemetry_codec.c unchanged.
+ *
+ * - Round-trips random blocks of up to 600 bytes through COBS, from all
+ *   zeros to no zeros, including runs of exactly 253, 254 and 255 non-zero
+ *   bytes. Checks that no encoded byte is zero and that the length never
+ *   exceeds COBS_MAX_ENCODED.
+ * - Checks that COBS decoding rejects empty blocks, zero bytes and codes
+ *   running past the end.
+ * - Round-trips random samples through whole frames. Checks every frame is
+ *   TELEMETRY_FRAME_BYTES long with its only zero at the end, and that
+ *   flipping any single bit of a data byte gets the frame rejected. A flip
+ *   in a COBS code byte moves zeros around the block; the share of those
+ *   caught by the length and CRC checks is printed.
+ * - With a file argument, also writes a capture for tools/telemetry_decode.py
+ *   of 200 samples, with sample 100 dropped and sample 150 garbled:
+ *   the decoder should print 198 samples, with dropped 1 after sample 100,
+ *   and report 1 bad frame and 2 lost samples.
+ *
+ * Build and run from the repository root:
+ *     cc -std=c99 -Wall -I"WheelsOnTheGo(BTEdition)/source" -o telemetry_sim \
+ *         tools/telemetry_sim.c "WheelsOnTheGo(BTEdition)/source/cobs.c" \
+ *         "WheelsOnTheGo(BTEdition)/source/telemetry_codec.c" \
+ *         "WheelsOnTheGo(BTEdition)/source/protocol.c"
+ *     ./telemetry_sim [capture.bin]
+ *     python3 tools/telemetry_decode.py capture.bin \
+ *         "WheelsOnTheGo(BTEdition)/source/telemetry.h"
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cobs.h"
+#include "telemetry_codec.h"
+#include "sim_check.h"
+
+#define BLOCKS        (20000)
+#define MAX_BLOCK     (600)
+#define SAMPLES       (5000)
+#define CAPTURE       (200)
+
+static void cobs_round_trip(const uint8_t *block, size_t len) {
+	uint8_t encoded[COBS_MAX_ENCODED(MAX_BLOCK)];
+	uint8_t decoded[COBS_MAX_ENCODED(MAX_BLOCK)];
+	size_t n;
+	size_t i;
+
+	n = Cobs_Encode(block, len, encoded);
+	check_value(n <= COBS_MAX_ENCODED(len), "encoded length", n);
+	for (i = 0; i < n; i++)
+		check_value(encoded[i] != 0, "no zero in the encoding", i);
+	// Decoding in place, as a receiver short of RAM would
+	memcpy(decoded, encoded, n);
+	check_value(Cobs_Decode(decoded, n, decoded) == len
+			&& (len == 0 || memcmp(decoded, block, len) == 0), "COBS round trip", len);
+}
+
+static void cobs(void) {
+	uint8_t block[MAX_BLOCK];
+	static const uint8_t empty_run[] = { 0x01, 0x00 };
+	static const uint8_t past_end[] = { 0x04, 0x11, 0x22 };
+	static const uint16_t runs[] = { 1, 253, 254, 255, 508, 509, 600 };
+	uint8_t out[8];
+	uint32_t n;
+	size_t len;
+	size_t i;
+	int zeros;
+
+	for (n = 0; n < BLOCKS; n++) {
+		len = 1 + (size_t) rand() % MAX_BLOCK;
+		zeros = rand() % 5;     // 0: none, 4: one byte in two
+		for (i = 0; i < len; i++)
+			block[i] = (zeros != 0 && rand() % 8 < zeros) ? 0 : (uint8_t) (1 + rand() % 255);
+		cobs_round_trip(block, len);
+	}
+
+	// Runs at and around the COBS block size, then followed by a zero
+	for (n = 0; n < sizeof(runs) / sizeof(runs[0]); n++) {
+		memset(block, 0x5A, runs[n]);
+		cobs_round_trip(block, runs[n]);
+		block[runs[n] - 1] = 0;
+		cobs_round_trip(block, runs[n]);
+	}
+	memset(block, 0, MAX_BLOCK);
+	cobs_round_trip(block, MAX_BLOCK);
+
+	check_value(Cobs_Decode(empty_run, 0, out) == 0, "empty block rejected", 0);
+	check_value(Cobs_Decode(empty_run, sizeof(empty_run), out) == 0, "zero rejected", 1);
+	check_value(Cobs_Decode(past_end, sizeof(past_end), out) == 0, "code past the end rejected", 2);
+}
+
+static void random_sample(telemetry_sample_t *sample) {
+	uint8_t *bytes = (uint8_t *) sample;
+	size_t i;
+
+	// Every bit pattern, zero bytes included, half of the time
+	for (i = 0; i < sizeof(*sample); i++)
+		bytes[i] = (rand() % 2) ? (uint8_t) rand() : 0;
+}
+
+static void frames(void) {
+	uint8_t frame[TELEMETRY_FRAME_BYTES];
+	telemetry_sample_t sent;
+	telemetry_sample_t got;
+	size_t len;
+	size_t i;
+	size_t code;
+	uint32_t n;
+	uint32_t bit;
+	uint32_t code_flips = 0;
+	uint32_t code_missed = 0;
+
+	for (n = 0; n < SAMPLES; n++) {
+		random_sample(&sent);
+		len = Telemetry_Encode(&sent, frame);
+		check_value(len == TELEMETRY_FRAME_BYTES, "frame length", len);
+		for (i = 0; i + 1 < len; i++)
+			check_value(frame[i] != 0, "no zero before the delimiter", i);
+		check_value(frame[len - 1] == 0, "delimiter", n);
+
+		memset(&got, 0, sizeof(got));
+		check_value(Telemetry_Decode(frame, len, &got) == 1, "frame decodes", n);
+		check_value(Telemetry_Decode(frame, len - 1, &got) == 1, "frame decodes without delimiter", n);
+#define SAME_FIELD(name, type, unit, description) \
+		check_value(got.name == sent.name, "field round trip: " #name, n);
+		TELEMETRY_FIELDS(SAME_FIELD)
+
+		// A flipped bit that leaves a zero in the frame splits it on the wire
+		for (code = 0, bit = 0; bit < 8 * (len - 1); bit++) {
+			i = bit / 8;
+			if (i > code)
+				code += frame[code];
+			frame[i] ^= (uint8_t) (1U << (bit % 8));
+			if (frame[i] != 0 && i == code) {
+				code_flips++;
+				code_missed += Telemetry_Decode(frame, len, &got);
+			} else if (frame[i] != 0) {
+				check_value(Telemetry_Decode(frame, len, &got) == 0, "flipped data bit rejected", bit);
+			}
+			frame[i] ^= (uint8_t) (1U << (bit % 8));
+		}
+	}
+	printf("%u samples in %u-byte frames, %u bit/s at %u Hz\n", SAMPLES,
+			TELEMETRY_FRAME_BYTES, TELEMETRY_BPS_AT(TELEMETRY_MAX_HZ), TELEMETRY_MAX_HZ);
+	printf("code byte flips caught: %.2f%%\n",
+			100.0 * (code_flips - code_missed) / code_flips);
+}
+
+/*
+ * Two seconds at 100 Hz of a car pulling away, for telemetry_decode.py.
+ */
+static void capture(const char *path) {
+	uint8_t frame[TELEMETRY_FRAME_BYTES];
+	telemetry_sample_t sample;
+	uint32_t n;
+	size_t len;
+	FILE *out = fopen(path, "wb");
+
+	if (out == NULL) {
+		perror(path);
+		failures++;
+		return;
+	}
+	memset(&sample, 0, sizeof(sample));
+	for (n = 0; n < CAPTURE; n++) {
+		sample.sample = (uint16_t) n;
+		sample.tick = (uint16_t) (65000 + 10 * n);        // Wraps
+		sample.pwm_cmd_a = sample.pwm_cmd_b = (n >= 20) ? 2400 : 0;
+		sample.pwm_out_a = (n < 20) ? 0 : (uint16_t) ((n - 20 < 30) ? 80 * (n - 20) : 2400);
+		sample.pwm_out_b = sample.pwm_out_a;
+		sample.dir_a = sample.dir_b = (n >= 20) ? 0x11 : 0;
+		sample.cmd_seq = (n >= 20) ? 1 : 0;
+		sample.cmd_depth = (n == 20) ? 1 : 0;
+		sample.bt_tx_depth = (uint16_t) (n % 7);
+		sample.battery_mv = (uint16_t) (7400 - ((n >= 20) ? 300 : 0) - n % 3);
+		sample.dropped = (n > 100) ? 1 : 0;
+		len = Telemetry_Encode(&sample, frame);
+		if (n == 100)
+			continue;               // Dropped by the firmware
+		if (n == 150)
+			frame[5] ^= 0x40;       // Garbled on the wire
+		fwrite(frame, 1, len, out);
+	}
+	fclose(out);
+	printf("wrote %s\n", path);
+}
+
+int main(int argc, char **argv) {
+	srand(1);
+	cobs();
+	frames();
+	if (argc > 1)
+		capture(argv[1]);
+	return sim_result();
+}
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Convert a trace recorder dump from the robot to Chrome/Perfetto JSON.
+
+The firmware must be built with TRACE_RECORDER defined (see source/trace.h);
+otherwise it answers with an empty dump, which is reported as such.
+When given a serial device, the script sends the dump request itself and
+stops once the dump is complete; when given a capture file, the last dump in
+it is converted. Open the output in https://ui.perfetto.dev or
+chrome://tracing: each task is a track showing when it ran, with queue,
+delay and priority-inheritance events marked on it.
+
+Usage:
+    stty -F /dev/rfcomm0 115200 raw && trace_to_perfetto.py /dev/rfcomm0 trace.json
+    trace_to_perfetto.py capture.bin trace.json
+"""
+
+import json
+import os
+import stat
+import struct
+import sys
+
+from profile_decode import SYNC, crc8, frames
+
+FRAME_TRACE_DUMP = 0x02
+FRAME_TRACE_INFO = 0x83
+FRAME_TRACE_NAME = 0x84
+FRAME_TRACE_EVENT = 0x85
+
+SWITCH_IN, SWITCH_OUT, QUEUE_SEND, QUEUE_RECEIVE, DELAY, DELAY_UNTIL, INHERIT = range(1, 8)
+NAME_TASK = 0
+NAME_QUEUE = 1
+
+
+def request_dump(stream):
+    body = bytes([1, 0, FRAME_TRACE_DUMP])
+    stream.write(bytes([SYNC]) + body + bytes([crc8(body)]))
+
+
+def read_dump(stream, live):
+    """Return (info, names, events) of the last complete or partial dump."""
+    dump = None
+    for kind, data in frames(stream):
+        if kind == FRAME_TRACE_INFO and len(data) == 10:
+            dump = (struct.unpack("<HII", data), {}, [])
+        elif dump is None:
+            continue
+        elif kind == FRAME_TRACE_NAME and len(data) >= 2:
+            dump[1][(data[0], data[1])] = data[2:].decode("ascii", "replace")
+        elif kind == FRAME_TRACE_EVENT and len(data) == 8:
+            dump[2].append(struct.unpack("<IBBH", data))
+        if live and dump is not None and len(dump[2]) == dump[0][0]:
+            break
+    return dump
+
+
+def convert(info, names, events):
+    count, cycles_per_tick, overwritten = info
+    task_name = lambda tid: names.get((NAME_TASK, tid), "task %u" % tid)
+    queue_name = lambda qid: names.get((NAME_QUEUE, qid), "queue %u" % qid)
+
+    out = [{"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "KL25Z"}}]
+    for tid in sorted({e[2] for e in events}):
+        out.append({"ph": "M", "pid": 1, "tid": tid, "name": "thread_name",
+                    "args": {"name": task_name(tid)}})
+
+    base = events[0][0] if events else 0
+    wraps = 0
+    previous = base
+    running = {}
+    for time, kind, tid, arg in events:
+        if time < previous:
+            wraps += 1
+        previous = time
+        ts = ((time + (wraps << 32)) - base) * 1000.0 / cycles_per_tick
+
+        if kind == SWITCH_IN:
+            running[tid] = ts
+            continue
+        if kind == SWITCH_OUT:
+            if tid in running:
+                start = running.pop(tid)
+                out.append({"ph": "X", "pid": 1, "tid": tid, "name": "running",
+                            "ts": start, "dur": ts - start})
+            continue
+
+        if kind == QUEUE_SEND:
+            name, args = "send " + queue_name(arg), {}
+        elif kind == QUEUE_RECEIVE:
+            name, args = "receive " + queue_name(arg), {}
+        elif kind == DELAY:
+            name, args = "delay", {"ticks": arg}
+        elif kind == DELAY_UNTIL:
+            name, args = "delay until", {"wake_tick": arg}
+        elif kind == INHERIT:
+            name, args = "inherit priority %u" % arg, {}
+        else:
+            continue
+        out.append({"ph": "i", "s": "t", "pid": 1, "tid": tid, "name": name,
+                    "ts": ts, "args": args})
+
+    if count != len(events):
+        sys.stderr.write("warning: %u of %u events received\n" % (len(events), count))
+    if overwritten:
+        sys.stderr.write("note: %u older events were overwritten\n" % overwritten)
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    live = stat.S_ISCHR(os.stat(sys.argv[1]).st_mode)
+    with open(sys.argv[1], "r+b" if live else "rb", buffering=0) as stream:
+        if live:
+            request_dump(stream)
+        dump = read_dump(stream, live)
+    if dump is None:
+        sys.exit("no trace dump found")
+    if dump[0][1] == 0:
+        sys.exit("the firmware was built without TRACE_RECORDER, no events recorded")
+    with open(sys.argv[2], "w") as out:
+        json.dump(convert(*dump), out)
+
+
+if __name__ == "__main__":
+    main()